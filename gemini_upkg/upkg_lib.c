@@ -22,8 +22,9 @@ int g_log_level = LOG_LEVEL_INFO;
  * @brief Helper function to print formatted messages with optional ANSI color codes.
  *
  * This is the core logging function. It checks the provided `level` against the global
- * `g_log_level` before printing anything. It also checks if stdout is a terminal to
- * apply colors, otherwise prints plain text. Ensures messages are flushed immediately.
+ * `g_log_level` before printing anything. It also checks (once) if stdout is a terminal
+ * to apply colors, otherwise prints plain text. Warnings and errors are flushed
+ * immediately; other levels ride stdout's own buffering.
  *
  * @param level The verbosity level of the message (e.g., LOG_LEVEL_INFO).
  * @param prefix The string prefix for the message (e.g., "[INFO] ").
@@ -36,18 +37,25 @@ static void print_message(int level, const char *prefix, const char *color_code,
         return; // Do not print if message level is higher than current log level
     }
 
-    if (isatty(fileno(stdout))) { // Check if stdout is a terminal
+    static int use_color = -1;
+    if (use_color < 0) {
+        use_color = isatty(fileno(stdout)); // Check if stdout is a terminal
+    }
+
+    if (use_color) {
         fprintf(stdout, "%s%s", color_code, prefix);
     } else {
         fprintf(stdout, "%s", prefix);
     }
     vfprintf(stdout, format, args);
-    if (isatty(fileno(stdout))) {
+    if (use_color) {
         fprintf(stdout, "\033[0m\n"); // Reset color
     } else {
         fprintf(stdout, "\n");
     }
-    fflush(stdout); // Ensure message is printed immediately
+    if (level >= LOG_LEVEL_WARN) {
+        fflush(stdout); // Warnings and errors are printed immediately
+    }
 }
 
 /**
@@ -0,0 +1,88 @@
+// Installs .deb files concurrently through upkg_async.hpp: every package is
+// read ahead and extracted in parallel, then committed one at a time. The
+// first failure cancels the installs that have not committed yet.
+//
+// Usage: upkgasync [-n] [-j threads] [-c command ...] file.deb...
+//   -n            extract and plan only; commit nothing
+//   -j threads    worker threads (default: one per CPU)
+//   -c command    run a command after the installs, e.g. -c ldconfig -r /root
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "upkg_async.hpp"
+
+static upkg::task<> install_one(upkg::executor &ex, std::string deb, bool dry_run, std::stop_source &cancel) {
+    std::stop_token stop = cancel.get_token();
+    try {
+        co_await ex.fetch(deb, stop);
+        upkg::staged_package staged = co_await ex.extract(deb, stop);
+        upkg::install_plan plan = co_await ex.plan(staged, stop);
+        std::cout << plan.package << ' ' << plan.version;
+        if (!plan.previous_version.empty()) std::cout << " (upgrades " << plan.previous_version << ')';
+        std::cout << ": " << plan.files << " files, " << plan.bytes << " bytes";
+        if (plan.conflicts) std::cout << ", " << plan.conflicts << " owned by other packages";
+        std::cout << '\n';
+        if (dry_run) co_return;
+
+        std::string name(plan.package);
+        co_await ex.commit(staged, stop, [&name](const upkg::progress_event &e) {
+            if (e.kind == UPKG_PROGRESS_WARNING) std::cerr << name << ": " << e.detail << '\n';
+        });
+        std::cout << "Installed " << name << '\n';
+    } catch (const upkg::error &e) {
+        if (e.status() != UPKG_ECANCELED) {
+            std::cerr << deb << ": " << e.what() << '\n';
+            cancel.request_stop();
+        } else {
+            std::cerr << deb << ": canceled\n";
+        }
+        throw;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool dry_run = false;
+    int threads = 0;
+    std::vector<std::string> debs;
+    std::vector<std::string> command;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-n") == 0) {
+            dry_run = true;
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0) {
+            // Everything up to the next .deb belongs to the command
+            while (i + 1 < argc && !std::strstr(argv[i + 1], ".deb")) command.push_back(argv[++i]);
+        } else {
+            debs.push_back(argv[i]);
+        }
+    }
+    if (debs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-n] [-j threads] [-c command ...] file.deb...\n";
+        return 1;
+    }
+
+    try {
+        upkg::database db;
+        upkg::executor ex(db, threads);
+        std::stop_source cancel;
+
+        for (const auto &deb : debs) ex.spawn(install_one(ex, deb, dry_run, cancel));
+        ex.drain();
+
+        if (!command.empty() && !dry_run) {
+            int status = ex.run(ex.run_command(command, cancel.get_token()));
+            std::cout << command[0] << " exited with " << status << '\n';
+            return status == 0 ? 0 : 1;
+        }
+    } catch (const upkg::error &e) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+// bench.cc - compares walking the package database through libupkg's C API
+// and through the upkg.hpp wrapper. Both should cost the same: the wrapper
+// only adds inline calls, and neither allocates per record.
+//
+// Usage: ./bench [iterations]   (uses the normal upkgconfig lookup)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "upkg.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+// Sums name, version and file path lengths so the work cannot be optimised away
+std::size_t walk_c(upkg_handle_t *handle) {
+    std::size_t total = 0;
+    upkg_package_iter_t *iter;
+    if (upkg_package_iter_begin(handle, &iter) != UPKG_OK) return 0;
+    upkg_package_t pkg;
+    while (upkg_package_iter_next(iter, &pkg)) {
+        total += pkg.name.len + pkg.version.len;
+        for (std::size_t i = 0; i < pkg.file_count; i++) {
+            upkg_str_t path;
+            upkg_package_file(&pkg, i, &path);
+            total += path.len;
+        }
+    }
+    upkg_package_iter_end(iter);
+    return total;
+}
+
+std::size_t walk_cpp(const upkg::database &db) {
+    std::size_t total = 0;
+    for (const upkg::package &pkg : db.packages()) {
+        total += pkg.name().size() + pkg.version().size();
+        for (std::string_view path : pkg.files()) {
+            total += path.size();
+        }
+    }
+    return total;
+}
+
+std::size_t find_c(upkg_handle_t *handle, const std::vector<std::string> &names) {
+    std::size_t total = 0;
+    upkg_package_t pkg;
+    for (const std::string &name : names) {
+        if (upkg_package_find(handle, name.c_str(), &pkg) == UPKG_OK) total += pkg.file_count;
+    }
+    return total;
+}
+
+std::size_t find_cpp(const upkg::database &db, const std::vector<std::string> &names) {
+    std::size_t total = 0;
+    for (const std::string &name : names) {
+        if (auto pkg = db.find(name.c_str())) total += pkg->file_count();
+    }
+    return total;
+}
+
+template <typename F>
+void run(const char *label, int iterations, F &&body) {
+    std::size_t sink = 0;
+    auto start = bench_clock::now();
+    for (int i = 0; i < iterations; i++) sink += body();
+    std::chrono::duration<double, std::micro> elapsed = bench_clock::now() - start;
+    std::printf("%-10s %10.2f us/iteration  (checksum %zu)\n", label, elapsed.count() / iterations, sink);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    if (iterations <= 0) iterations = 1000;
+
+    try {
+        upkg::database db;
+        std::vector<std::string> names;
+        std::size_t files = 0;
+        for (const upkg::package &pkg : db.packages()) {
+            names.emplace_back(pkg.name());
+            files += pkg.file_count();
+        }
+        std::printf("%zu packages, %zu files, %d iterations\n", names.size(), files, iterations);
+
+        run("walk C", iterations, [&] { return walk_c(db.native_handle()); });
+        run("walk C++", iterations, [&] { return walk_cpp(db); });
+        run("find C", iterations, [&] { return find_c(db.native_handle(), names); });
+        run("find C++", iterations, [&] { return find_cpp(db, names); });
+    } catch (const upkg::error &e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
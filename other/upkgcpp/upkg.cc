@@ -1,44 +1,94 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <vector>
+
+#include "upkg.hpp"
 
 
 void printUsage(const char* programName) {
-    std::cout << "Usage: " << programName << " [options] input_file.deb\n";
+    std::cout << "Usage: " << programName << " [options] [input_file.deb...]\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help        Display this help message\n";
     std::cout << "  -v, --version     Display the program version\n";
     std::cout << "  -f, --file <file> Specify the input file\n";
-    // Add more options as needed
+    std::cout << "  -l, --list        List installed packages\n";
+    std::cout << "  -s, --status <p>  Show a package and its files\n";
+    std::cout << "Input files are installed together in one transaction.\n";
 }
 
 int main(int argc, char* argv[]) {
-    // ... (parse command-line arguments)
     if (argc == 1) {
         printUsage(argv[0]);
         return 0;
     }
+
+    std::vector<const char *> debs;
+    bool list = false;
+    const char *status = nullptr;
     for (int i = 1; i < argc; ++i) {
-	char *filename = argv[i];
-	char *extension = strrchr(filename, '.');
+        const char *filename = argv[i];
+        const char *extension = strrchr(filename, '.');
         if (std::string(argv[i]) == "-h" || std::string(argv[i]) == "--help") {
             printUsage(argv[0]);
             return 0;
         } else if (std::string(argv[i]) == "-v" || std::string(argv[i]) == "--version") {
             std::cout << "Program Version 1.0\n";
             return 0;
-	} else if (extension != NULL && strcmp(extension, ".deb") == 0) {
-	    std::cout << "filename=" << argv[i] << "\n";
+        } else if (extension != NULL && strcmp(extension, ".deb") == 0) {
+            debs.push_back(argv[i]);
         } else if (std::string(argv[i]) == "-f" || std::string(argv[i]) == "--file") {
             if (i + 1 < argc) {
-                std::string filename = argv[++i];
-                // ... (process the filename)
+                debs.push_back(argv[++i]);
             } else {
                 std::cerr << "Error: Missing filename after -f option\n";
                 return 1;
             }
+        } else if (std::string(argv[i]) == "-l" || std::string(argv[i]) == "--list") {
+            list = true;
+        } else if (std::string(argv[i]) == "-s" || std::string(argv[i]) == "--status") {
+            if (i + 1 < argc) {
+                status = argv[++i];
+            } else {
+                std::cerr << "Error: Missing package after -s option\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    try {
+        upkg::database db;
+
+        if (!debs.empty()) {
+            upkg::transaction txn = db.begin();
+            for (const char *deb : debs) {
+                std::cout << "filename=" << deb << "\n";
+                txn.install(deb);
+            }
+            txn.commit();
+        }
+        if (list) {
+            for (const upkg::package &pkg : db.packages()) {
+                std::cout << pkg.name() << " " << pkg.version() << "\n";
+            }
+        }
+        if (status) {
+            auto pkg = db.find(status);
+            if (!pkg) {
+                std::cerr << "Package '" << status << "' is not installed.\n";
+                return 1;
+            }
+            std::cout << pkg->name() << " " << pkg->version() << " (" << pkg->architecture() << ")\n";
+            for (std::string_view path : pkg->files()) {
+                std::cout << "  /" << path << "\n";
+            }
         }
-        // ... (handle other options)
+    } catch (const upkg::error &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
     }
     return 0;
 }
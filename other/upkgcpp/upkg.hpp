@@ -0,0 +1,360 @@
+// upkg.hpp - header-only C++20 layer over libupkg (reboot/upkg/libupkg.h).
+//
+// Everything here is a thin inline wrapper: handles are RAII and move-only,
+// strings are std::string_view straight into the loaded package database,
+// and iterating packages or file lists allocates nothing per record. Views
+// follow libupkg's rule: they stay valid until the next install, remove or
+// close on the database.
+//
+// Build: g++ -std=c++20 -I../../reboot/upkg ... ../../reboot/upkg/libupkg.a -lm -pthread
+
+#ifndef UPKG_HPP
+#define UPKG_HPP
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "libupkg.h"
+
+namespace upkg {
+
+// --- Errors ---
+
+class error : public std::runtime_error {
+public:
+    explicit error(int status) : std::runtime_error(upkg_strerror(status)), status_(status) {}
+    int status() const noexcept { return status_; }
+
+private:
+    int status_;
+};
+
+inline void check(int status) {
+    if (status != UPKG_OK) throw error(status);
+}
+
+inline std::string_view view(upkg_str_t s) noexcept { return {s.data, s.len}; }
+
+// --- Packages ---
+
+// The installed paths of one package, as a random-access range of string_views
+class file_range {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        iterator() noexcept = default;
+        iterator(const upkg_package_t &pkg, std::size_t index) noexcept : pkg_(pkg), index_(index) {}
+
+        std::string_view operator*() const noexcept {
+            upkg_str_t s{"", 0};
+            upkg_package_file(&pkg_, index_, &s);
+            return view(s);
+        }
+        std::string_view operator[](difference_type n) const noexcept { return *(*this + n); }
+
+        iterator &operator++() noexcept { ++index_; return *this; }
+        iterator operator++(int) noexcept { iterator t = *this; ++index_; return t; }
+        iterator &operator--() noexcept { --index_; return *this; }
+        iterator operator--(int) noexcept { iterator t = *this; --index_; return t; }
+        iterator &operator+=(difference_type n) noexcept { index_ += n; return *this; }
+        iterator &operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+        friend iterator operator+(iterator it, difference_type n) noexcept { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) noexcept { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(const iterator &a, const iterator &b) noexcept {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+        friend bool operator==(const iterator &a, const iterator &b) noexcept { return a.index_ == b.index_; }
+        friend auto operator<=>(const iterator &a, const iterator &b) noexcept { return a.index_ <=> b.index_; }
+
+    private:
+        // A copy of the view, so an iterator outlives the range it came from
+        upkg_package_t pkg_{};
+        std::size_t index_ = 0;
+    };
+
+    explicit file_range(const upkg_package_t &pkg) noexcept : pkg_(pkg) {}
+
+    iterator begin() const noexcept { return {pkg_, 0}; }
+    iterator end() const noexcept { return {pkg_, pkg_.file_count}; }
+    std::size_t size() const noexcept { return pkg_.file_count; }
+    bool empty() const noexcept { return pkg_.file_count == 0; }
+    std::string_view operator[](std::size_t i) const noexcept { return begin()[static_cast<std::ptrdiff_t>(i)]; }
+
+private:
+    upkg_package_t pkg_;
+};
+
+// A borrowed view of one installed package record
+class package {
+public:
+    explicit package(const upkg_package_t &pkg) noexcept : pkg_(pkg) {}
+
+    std::string_view name() const noexcept { return view(pkg_.name); }
+    std::string_view version() const noexcept { return view(pkg_.version); }
+    std::string_view architecture() const noexcept { return view(pkg_.architecture); }
+    std::string_view maintainer() const noexcept { return view(pkg_.maintainer); }
+    std::string_view description() const noexcept { return view(pkg_.description); }
+    std::string_view depends() const noexcept { return view(pkg_.depends); }
+    std::size_t file_count() const noexcept { return pkg_.file_count; }
+    file_range files() const noexcept { return file_range(pkg_); }
+
+    const upkg_package_t &c_view() const noexcept { return pkg_; }
+
+private:
+    upkg_package_t pkg_;
+};
+
+// Single-pass range over installed packages; owns the C iterator
+class package_range {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = package;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+        explicit iterator(package_range *range) noexcept : range_(range) {}
+
+        const package &operator*() const noexcept { return range_->current_; }
+        const package *operator->() const noexcept { return &range_->current_; }
+        iterator &operator++() noexcept { range_->advance(); return *this; }
+        void operator++(int) noexcept { range_->advance(); }
+        bool at_end() const noexcept { return !range_ || range_->done_; }
+        friend bool operator==(const iterator &it, std::default_sentinel_t) noexcept { return it.at_end(); }
+
+    private:
+        package_range *range_ = nullptr;
+    };
+
+    explicit package_range(upkg_handle_t *handle) : current_(upkg_package_t{}) {
+        check(upkg_package_iter_begin(handle, &iter_));
+    }
+    ~package_range() { upkg_package_iter_end(iter_); }
+
+    package_range(package_range &&other) noexcept
+        : iter_(std::exchange(other.iter_, nullptr)), current_(other.current_),
+          started_(other.started_), done_(other.done_) {}
+    package_range &operator=(package_range &&other) noexcept {
+        if (this != &other) {
+            upkg_package_iter_end(iter_);
+            iter_ = std::exchange(other.iter_, nullptr);
+            current_ = other.current_;
+            started_ = other.started_;
+            done_ = other.done_;
+        }
+        return *this;
+    }
+    package_range(const package_range &) = delete;
+    package_range &operator=(const package_range &) = delete;
+
+    iterator begin() noexcept {
+        if (!started_) {
+            started_ = true;
+            advance();
+        }
+        return iterator(this);
+    }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    void advance() noexcept {
+        upkg_package_t next;
+        done_ = !upkg_package_iter_next(iter_, &next);
+        if (!done_) current_ = package(next);
+    }
+
+    upkg_package_iter_t *iter_ = nullptr;
+    package current_;
+    bool started_ = false;
+    bool done_ = false;
+};
+
+// --- Manifests ---
+
+// A package's install-time file records, owned; entries() is a span over one array
+class manifest {
+public:
+    manifest(upkg_handle_t *handle, const char *package_name) {
+        check(upkg_package_manifest_open(handle, package_name, &m_));
+    }
+    ~manifest() { upkg_package_manifest_close(m_); }
+
+    manifest(manifest &&other) noexcept : m_(std::exchange(other.m_, nullptr)) {}
+    manifest &operator=(manifest &&other) noexcept {
+        if (this != &other) {
+            upkg_package_manifest_close(m_);
+            m_ = std::exchange(other.m_, nullptr);
+        }
+        return *this;
+    }
+    manifest(const manifest &) = delete;
+    manifest &operator=(const manifest &) = delete;
+
+    std::span<const upkg_file_record_t> entries() const noexcept {
+        std::size_t count = 0;
+        const upkg_file_record_t *records = upkg_package_manifest_records(m_, &count);
+        return {records, count};
+    }
+
+private:
+    upkg_package_manifest_t *m_ = nullptr;
+};
+
+// --- Progress ---
+
+namespace detail {
+
+template <typename F>
+void progress_trampoline(const upkg_progress_t *progress, void *user) {
+    (*static_cast<F *>(user))(*progress);
+}
+
+} // namespace detail
+
+// --- Database ---
+
+class transaction;
+
+// The open package database. libupkg allows one per process.
+class database {
+public:
+    explicit database(const char *config_path = nullptr) { check(upkg_open(config_path, &handle_)); }
+    ~database() { upkg_close(handle_); }
+
+    database(database &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    database &operator=(database &&other) noexcept {
+        if (this != &other) {
+            upkg_close(handle_);
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    database(const database &) = delete;
+    database &operator=(const database &) = delete;
+
+    std::optional<package> find(const char *name) const {
+        upkg_package_t pkg;
+        int status = upkg_package_find(handle_, name, &pkg);
+        if (status == UPKG_ENOTFOUND) return std::nullopt;
+        check(status);
+        return package(pkg);
+    }
+
+    package_range packages() const { return package_range(handle_); }
+
+    std::optional<std::string_view> owner(const char *path) const {
+        upkg_str_t s;
+        int status = upkg_path_owner(handle_, path, &s);
+        if (status == UPKG_ENOTFOUND) return std::nullopt;
+        check(status);
+        return view(s);
+    }
+
+    std::optional<std::string_view> provider(const char *soname) const {
+        upkg_str_t s;
+        int status = upkg_soname_provider(handle_, soname, &s);
+        if (status == UPKG_ENOTFOUND) return std::nullopt;
+        check(status);
+        return view(s);
+    }
+
+    upkg::manifest manifest(const char *package_name) const { return upkg::manifest(handle_, package_name); }
+
+    void install(const char *deb_path) { check(upkg_install(handle_, deb_path, nullptr, nullptr)); }
+
+    // on_progress is called as on_progress(const upkg_progress_t &)
+    template <typename F>
+    void install(const char *deb_path, F &&on_progress) {
+        using fn = std::remove_reference_t<F>;
+        check(upkg_install(handle_, deb_path, detail::progress_trampoline<fn>, &on_progress));
+    }
+
+    void remove(const char *package_name) { check(upkg_remove(handle_, package_name, nullptr, nullptr)); }
+
+    template <typename F>
+    void remove(const char *package_name, F &&on_progress) {
+        using fn = std::remove_reference_t<F>;
+        check(upkg_remove(handle_, package_name, detail::progress_trampoline<fn>, &on_progress));
+    }
+
+    transaction begin();
+
+    upkg_handle_t *native_handle() const noexcept { return handle_; }
+
+private:
+    upkg_handle_t *handle_ = nullptr;
+};
+
+// Groups installs and removals under one database lock with a single
+// directory-table write and upkgd reload. Changes apply as they are made;
+// commit() (or destruction) only finishes the group. Move-only.
+class transaction {
+public:
+    explicit transaction(database &db) : db_(&db) { check(upkg_transaction_begin(db.native_handle())); }
+    ~transaction() {
+        if (db_) upkg_transaction_commit(db_->native_handle());
+    }
+
+    transaction(transaction &&other) noexcept : db_(std::exchange(other.db_, nullptr)) {}
+    transaction &operator=(transaction &&other) noexcept {
+        if (this != &other) {
+            if (db_) upkg_transaction_commit(db_->native_handle());
+            db_ = std::exchange(other.db_, nullptr);
+        }
+        return *this;
+    }
+    transaction(const transaction &) = delete;
+    transaction &operator=(const transaction &) = delete;
+
+    void install(const char *deb_path) { active().install(deb_path); }
+    void remove(const char *package_name) { active().remove(package_name); }
+
+    void commit() {
+        database *db = std::exchange(db_, nullptr);
+        if (!db) throw error(UPKG_EINVAL);
+        check(upkg_transaction_commit(db->native_handle()));
+    }
+
+private:
+    database &active() {
+        if (!db_) throw error(UPKG_EINVAL);
+        return *db_;
+    }
+
+    database *db_;
+};
+
+inline transaction database::begin() { return transaction(*this); }
+
+// Keeps the views from lock-free queries made on this thread valid while
+// other threads commit; all of them see the same commit. Scoped, not movable.
+class read_section {
+public:
+    explicit read_section(const database &db) : handle_(db.native_handle()) { upkg_read_begin(handle_); }
+    ~read_section() { upkg_read_end(handle_); }
+
+    read_section(const read_section &) = delete;
+    read_section &operator=(const read_section &) = delete;
+
+private:
+    upkg_handle_t *handle_;
+};
+
+} // namespace upkg
+
+#endif // UPKG_HPP
@@ -0,0 +1,447 @@
+// upkg_async.hpp - C++20 coroutines over libupkg's executor (reboot/upkg/libupkg.h).
+//
+// An install is split into phases that each suspend the calling coroutine:
+// fetch (read the .deb into the page cache), extract, plan and commit run
+// as jobs on libupkg's worker threads; run_command waits on a pidfd. One
+// thread drives everything through an epoll set holding the executor's
+// completion descriptor and any pidfds, so coroutines always resume there.
+//
+// Extract, fetch and plan run in parallel across coroutines; commit runs
+// alone, so database changes stay serialised. Cancellation is a
+// std::stop_token checked at phase boundaries: a stopped install throws
+// upkg::error(UPKG_ECANCELED) before its next phase, and a running command
+// gets SIGTERM. A commit that has started always finishes.
+//
+// Progress callbacks run on the loop thread, in order, before the phase
+// they belong to completes.
+//
+// Build: g++ -std=c++20 -I../../reboot/upkg ... ../../reboot/upkg/libupkg.a -lm -pthread
+
+#ifndef UPKG_ASYNC_HPP
+#define UPKG_ASYNC_HPP
+
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <list>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "upkg.hpp"
+
+extern char **environ;
+
+namespace upkg {
+
+// --- Tasks ---
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+struct promise_base {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            return h.promise().continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+    std::optional<T> value;
+
+    task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct promise<void> : promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void take() const {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+// A lazily started coroutine; co_await it, or hand it to executor::run/spawn
+template <typename T>
+class task {
+public:
+    using promise_type = detail::promise<T>;
+
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+    ~task() {
+        if (h_) h_.destroy();
+    }
+    task(task &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, nullptr);
+        }
+        return *this;
+    }
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    bool done() const noexcept { return !h_ || h_.done(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        h_.promise().continuation = awaiting;
+        return h_;
+    }
+    T await_resume() { return h_.promise().take(); }
+
+private:
+    friend class executor;
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+// --- Results ---
+
+// A progress event copied off the worker thread
+struct progress_event {
+    upkg_progress_kind_t kind;
+    std::string package;
+    std::string detail;
+    std::uint64_t done;
+    std::uint64_t total;
+};
+
+using progress_fn = std::function<void(const progress_event &)>;
+
+// An extracted package waiting to be committed. Move-only.
+class staged_package {
+public:
+    staged_package() noexcept = default;
+    ~staged_package() { upkg_stage_free(s_); }
+    staged_package(staged_package &&other) noexcept : s_(std::exchange(other.s_, nullptr)) {}
+    staged_package &operator=(staged_package &&other) noexcept {
+        if (this != &other) {
+            upkg_stage_free(s_);
+            s_ = std::exchange(other.s_, nullptr);
+        }
+        return *this;
+    }
+    staged_package(const staged_package &) = delete;
+    staged_package &operator=(const staged_package &) = delete;
+
+    upkg_staged_t *native_handle() const noexcept { return s_; }
+    upkg_staged_t **out() noexcept { return &s_; }
+
+private:
+    upkg_staged_t *s_ = nullptr;
+};
+
+// What a commit would change; views live as long as the staged package
+struct install_plan {
+    std::string_view package;
+    std::string_view version;
+    std::string_view previous_version;
+    std::size_t files;
+    std::size_t conflicts;
+    std::uint64_t bytes;
+};
+
+// --- Awaitables ---
+
+namespace detail {
+
+// Runs fn() on a worker thread and resumes the awaiting coroutine on the loop
+template <typename F>
+class job_awaiter {
+public:
+    job_awaiter(upkg_executor_t *ex, F fn, bool exclusive, std::stop_token stop)
+        : ex_(ex), fn_(std::move(fn)), exclusive_(exclusive), stop_(std::move(stop)) {}
+
+    bool await_ready() const noexcept { return stop_.stop_requested(); }
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        h_ = h;
+        submitted_ = true;
+        status_ = upkg_executor_submit(ex_, &run, &done, this, exclusive_);
+        return status_ == UPKG_OK;
+    }
+    void await_resume() const {
+        // A stop that arrives once the job is submitted does not undo it; report what the job did
+        if (!submitted_) throw error(UPKG_ECANCELED);
+        check(status_);
+    }
+
+private:
+    static int run(void *arg) { return static_cast<job_awaiter *>(arg)->fn_(); }
+    static void done(int status, void *arg) {
+        auto *self = static_cast<job_awaiter *>(arg);
+        self->status_ = status;
+        self->h_.resume();
+    }
+
+    upkg_executor_t *ex_;
+    F fn_;
+    bool exclusive_;
+    std::stop_token stop_;
+    std::coroutine_handle<> h_;
+    bool submitted_ = false;
+    int status_ = UPKG_OK;
+};
+
+// Hands worker-thread progress to the loop thread
+struct progress_relay {
+    upkg_executor_t *ex;
+    const progress_fn *fn;
+
+    struct posted {
+        const progress_fn *fn;
+        progress_event event;
+    };
+
+    static void forward(const upkg_progress_t *p, void *user) {
+        auto *relay = static_cast<progress_relay *>(user);
+        auto *msg = new posted{relay->fn, {p->kind, std::string(view(p->package)),
+                                           std::string(view(p->detail)), p->done, p->total}};
+        if (upkg_executor_post(relay->ex, &deliver, 0, msg) != UPKG_OK) delete msg;
+    }
+    static void deliver(int, void *arg) {
+        auto *msg = static_cast<posted *>(arg);
+        (*msg->fn)(msg->event);
+        delete msg;
+    }
+
+    upkg_progress_fn callback() const noexcept { return *fn ? &forward : nullptr; }
+};
+
+} // namespace detail
+
+// --- Executor ---
+
+// Worker threads plus the epoll loop that resumes coroutines. One per
+// database; drive it from a single thread with run() and drain().
+class executor {
+public:
+    explicit executor(database &db, int threads = 0) : db_(db.native_handle()) {
+        check(upkg_executor_create(db_, threads, &ex_));
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        if (epoll_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, upkg_executor_fd(ex_), &ev) != 0) {
+            if (epoll_fd_ >= 0) ::close(epoll_fd_);
+            upkg_executor_destroy(ex_);
+            throw error(UPKG_EFAILED);
+        }
+    }
+    // Tasks must have finished (run/drain) before the executor goes away
+    ~executor() {
+        upkg_executor_destroy(ex_);
+        ::close(epoll_fd_);
+    }
+    executor(const executor &) = delete;
+    executor &operator=(const executor &) = delete;
+
+    // Starts t and runs the loop until it finishes; spawned tasks progress too
+    template <typename T>
+    T run(task<T> t) {
+        t.h_.resume();
+        while (!t.done()) poll_once();
+        return t.h_.promise().take();
+    }
+
+    // Starts t in the background; drain() waits for it
+    void spawn(task<void> t) {
+        spawned_.push_back(std::move(t));
+        spawned_.back().h_.resume();
+    }
+
+    // Runs the loop until every spawned task has finished, then rethrows the
+    // first failure among them
+    void drain() {
+        std::exception_ptr first;
+        for (;;) {
+            for (auto it = spawned_.begin(); it != spawned_.end();) {
+                if (!it->done()) {
+                    ++it;
+                    continue;
+                }
+                try {
+                    it->h_.promise().take();
+                } catch (...) {
+                    if (!first) first = std::current_exception();
+                }
+                it = spawned_.erase(it);
+            }
+            if (spawned_.empty()) break;
+            poll_once();
+        }
+        if (first) std::rethrow_exception(first);
+    }
+
+    // Reads a .deb ahead into the page cache so extraction does not wait on I/O
+    task<> fetch(std::string deb_path, std::stop_token stop = {}) {
+        co_await job([&deb_path] {
+            int fd = ::open(deb_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return static_cast<int>(UPKG_ENOTFOUND);
+            off_t size = ::lseek(fd, 0, SEEK_END);
+            int ret = size >= 0 && ::readahead(fd, 0, static_cast<size_t>(size)) == 0 ? UPKG_OK : UPKG_EFAILED;
+            ::close(fd);
+            return ret;
+        }, false, stop);
+    }
+
+    // Unpacks and parses a .deb; runs alongside other extracts and queries
+    task<staged_package> extract(std::string deb_path, std::stop_token stop = {}, progress_fn on_progress = {}) {
+        staged_package staged;
+        detail::progress_relay relay{ex_, &on_progress};
+        co_await job([&] {
+            return upkg_stage_extract(db_, deb_path.c_str(), relay.callback(), &relay, staged.out());
+        }, false, stop);
+        co_return std::move(staged);
+    }
+
+    task<install_plan> plan(const staged_package &staged, std::stop_token stop = {}) {
+        upkg_plan_t p{};
+        co_await job([&] { return upkg_stage_plan(db_, staged.native_handle(), &p); }, false, stop);
+        co_return install_plan{view(p.package), view(p.version), view(p.previous_version),
+                               p.files, p.conflicts, p.bytes};
+    }
+
+    // Installs a staged package; runs alone. Invalidates database views.
+    task<> commit(staged_package &staged, std::stop_token stop = {}, progress_fn on_progress = {}) {
+        detail::progress_relay relay{ex_, &on_progress};
+        co_await job([&] {
+            return upkg_stage_commit(db_, staged.native_handle(), relay.callback(), &relay);
+        }, true, stop);
+    }
+
+    task<> remove(std::string package_name, std::stop_token stop = {}, progress_fn on_progress = {}) {
+        detail::progress_relay relay{ex_, &on_progress};
+        co_await job([&] {
+            return upkg_remove(db_, package_name.c_str(), relay.callback(), &relay);
+        }, true, stop);
+    }
+
+    // fetch, extract and commit in sequence
+    task<> install(std::string deb_path, std::stop_token stop = {}, progress_fn on_progress = {}) {
+        co_await fetch(deb_path, stop);
+        staged_package staged = co_await extract(deb_path, stop, on_progress);
+        co_await commit(staged, stop, std::move(on_progress));
+    }
+
+    // Runs a helper command without blocking the loop and returns its exit
+    // status (128 + signal if it was killed). Stopping sends SIGTERM.
+    task<int> run_command(std::vector<std::string> argv, std::stop_token stop = {}) {
+        if (argv.empty()) throw error(UPKG_EINVAL);
+        if (stop.stop_requested()) throw error(UPKG_ECANCELED);
+
+        std::vector<char *> args;
+        for (auto &a : argv) args.push_back(a.data());
+        args.push_back(nullptr);
+
+        pid_t pid;
+        if (posix_spawnp(&pid, args[0], nullptr, nullptr, args.data(), environ) != 0) {
+            throw error(UPKG_EFAILED);
+        }
+        int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd >= 0) {
+            // The pid cannot be reused until it is reaped below
+            std::stop_callback on_stop(stop, [pid] { ::kill(pid, SIGTERM); });
+            co_await readable{this, pidfd};
+            ::close(pidfd);
+        }
+
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        if (stop.stop_requested()) throw error(UPKG_ECANCELED);
+        co_return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+
+    upkg_executor_t *native_handle() const noexcept { return ex_; }
+
+private:
+    // Resumes the awaiting coroutine once fd is readable
+    struct readable {
+        executor *self;
+        int fd;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) const noexcept {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.ptr = h.address();
+            return epoll_ctl(self->epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    template <typename F>
+    detail::job_awaiter<F> job(F fn, bool exclusive, std::stop_token stop) {
+        return detail::job_awaiter<F>(ex_, std::move(fn), exclusive, std::move(stop));
+    }
+
+    void poll_once() {
+        epoll_event events[16];
+        int n = epoll_wait(epoll_fd_, events, 16, -1);
+        if (n < 0 && errno != EINTR) throw error(UPKG_EFAILED);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr) {
+                std::coroutine_handle<>::from_address(events[i].data.ptr).resume();
+            } else {
+                upkg_executor_dispatch(ex_);
+            }
+        }
+    }
+
+    upkg_handle_t *db_;
+    upkg_executor_t *ex_ = nullptr;
+    int epoll_fd_ = -1;
+    std::list<task<void>> spawned_;
+};
+
+} // namespace upkg
+
+#endif // UPKG_ASYNC_HPP
@@ -0,0 +1,575 @@
+/******************************************************************************
+ * Filename:    libupkg.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Public C API of libupkg, the embeddable upkg core
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "libupkg.h"
+#include "upkg_config.h"
+#include "upkg_daemon.h"
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_hash.h"
+#include "upkg_index.h"
+#include "upkg_manifest.h"
+#include "upkg_metrics.h"
+#include "upkg_ops.h"
+#include "upkg_pool.h"
+#include "upkg_snap.h"
+#include "upkg_space.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// The state itself lives in the core's globals; the handle marks ownership
+struct upkg_handle {
+    bool open;
+    bool in_transaction;
+};
+
+struct upkg_package_manifest {
+    upkg_manifest_t manifest;       // Owns the path strings
+    upkg_file_record_t *records;
+    size_t count;
+};
+
+struct upkg_staged {
+    upkg_ops_staged_t ops;
+};
+
+struct upkg_executor {
+    upkg_pool_t *pool;
+};
+
+struct upkg_package_iter {
+    upkg_handle_t *handle;
+    const upkg_snap_t *snap;    // Pinned for the iterator's lifetime
+    size_t next;
+};
+
+// The core's state is per process, so only one handle can be open
+static upkg_handle_t *g_open_handle = NULL;
+
+// Serialises the first, lazy build of the path index between readers
+static pthread_mutex_t g_path_index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// --- Helpers ---
+
+/**
+ * @brief Makes a view of a C string (NULL becomes the empty string).
+ */
+static upkg_str_t make_str(const char *s) {
+    upkg_str_t view = { s ? s : "", s ? strlen(s) : 0 };
+    return view;
+}
+
+/**
+ * @brief Fills a package view from a record.
+ */
+static void fill_package(const upkg_hash_package_info_t *pkg, upkg_package_t *out) {
+    out->name = make_str(pkg->package_name);
+    out->version = make_str(pkg->version);
+    out->architecture = make_str(pkg->architecture);
+    out->maintainer = make_str(pkg->maintainer);
+    out->description = make_str(pkg->description);
+    out->depends = make_str(pkg->depends);
+    out->file_count = pkg->file_count > 0 ? (size_t)pkg->file_count : 0;
+    out->record = pkg;
+}
+
+typedef struct {
+    upkg_progress_fn fn;
+    void *user;
+} progress_adapter_t;
+
+/**
+ * @brief Translates internal progress events into the public form.
+ */
+static void adapt_progress(const upkg_ops_event_t *event, void *user) {
+    const progress_adapter_t *adapter = user;
+    upkg_progress_t progress;
+    switch (event->kind) {
+    case UPKG_OPS_EXTRACTED: progress.kind = UPKG_PROGRESS_EXTRACTED; break;
+    case UPKG_OPS_FILE:      progress.kind = UPKG_PROGRESS_FILE; break;
+    case UPKG_OPS_STORED:    progress.kind = UPKG_PROGRESS_STORED; break;
+    case UPKG_OPS_REMOVED:   progress.kind = UPKG_PROGRESS_REMOVED; break;
+    default:                 progress.kind = UPKG_PROGRESS_WARNING; break;
+    }
+    progress.package = make_str(event->package);
+    progress.detail = make_str(event->kind == UPKG_OPS_EXTRACTED ? NULL : event->detail);
+    progress.done = event->done;
+    progress.total = event->total;
+    adapter->fn(&progress, adapter->user);
+}
+
+// --- Handles ---
+
+/**
+ * @brief Loads the configuration and the installed-package database.
+ */
+int upkg_open(const char *config_path, upkg_handle_t **out) {
+    if (!out) return UPKG_EINVAL;
+    *out = NULL;
+    if (g_open_handle) return UPKG_EBUSY;
+
+    if (config_path && setenv("UPKG_CONFIG_PATH", config_path, 1) != 0) {
+        return UPKG_ENOMEM;
+    }
+    if (upkg_load_paths() != 0) {
+        return UPKG_ECONFIG;
+    }
+    if (upkg_log_init() != 0) {
+        upkg_cleanup_paths();
+        return UPKG_ECONFIG;
+    }
+    // Queries read published snapshots, so they can overlap commits
+    upkg_snap_enable();
+    if (upkg_db_load() != 0) {
+        upkg_snap_shutdown();
+        upkg_db_close();
+        upkg_cleanup_paths();
+        return UPKG_EFAILED;
+    }
+    upkg_handle_t *handle = calloc(1, sizeof(*handle));
+    if (!handle) {
+        upkg_db_close();
+        upkg_snap_shutdown();
+        upkg_cleanup_paths();
+        return UPKG_ENOMEM;
+    }
+    handle->open = true;
+    g_open_handle = handle;
+    *out = handle;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Writes metrics and frees everything the handle loaded.
+ */
+void upkg_close(upkg_handle_t *handle) {
+    if (!handle || handle != g_open_handle) return;
+    if (handle->in_transaction) {
+        upkg_transaction_commit(handle);
+    }
+
+    // Fold this run's counters into the node_exporter textfile, if configured
+    if (g_metrics_textfile && g_db_dir && upkg_db_lock() == 0) {
+        upkg_metrics_write_textfile();
+        upkg_db_unlock();
+    }
+
+    upkg_db_close();
+    if (upkg_main_hash_table) {
+        upkg_hash_destroy_table(upkg_main_hash_table);
+        upkg_main_hash_table = NULL;
+    }
+    upkg_snap_shutdown();
+    upkg_cleanup_paths();
+
+    handle->open = false;
+    free(handle);
+    g_open_handle = NULL;
+}
+
+/**
+ * @brief Describes a status code.
+ */
+const char *upkg_strerror(int status) {
+    switch (status) {
+    case UPKG_OK:        return "success";
+    case UPKG_EINVAL:    return "invalid argument";
+    case UPKG_ENOTFOUND: return "not found";
+    case UPKG_EBUSY:     return "a upkg handle is already open";
+    case UPKG_ECONFIG:   return "upkg configuration missing or unusable";
+    case UPKG_ENOMEM:    return "out of memory";
+    case UPKG_EFAILED:   return "operation failed";
+    case UPKG_ECANCELED: return "operation canceled";
+    case UPKG_ENOSPC:    return "not enough free space";
+    default:             return "unknown status";
+    }
+}
+
+// --- Changes ---
+
+/**
+ * @brief Installs or upgrades a .deb package.
+ */
+int upkg_install(upkg_handle_t *handle, const char *deb_path, upkg_progress_fn progress, void *user) {
+    if (!handle || handle != g_open_handle || !deb_path) return UPKG_EINVAL;
+    if (upkg_space_check_installs(&deb_path, 1) == 1) return UPKG_ENOSPC;
+    progress_adapter_t adapter = { progress, user };
+    int ret = upkg_ops_install(deb_path, !handle->in_transaction, progress ? adapt_progress : NULL, &adapter);
+    return ret == 0 ? UPKG_OK : UPKG_EFAILED;
+}
+
+/**
+ * @brief Removes an installed package.
+ */
+int upkg_remove(upkg_handle_t *handle, const char *package_name, upkg_progress_fn progress, void *user) {
+    if (!handle || handle != g_open_handle || !package_name) return UPKG_EINVAL;
+    if (!upkg_hash_search(upkg_main_hash_table, package_name)) return UPKG_ENOTFOUND;
+    progress_adapter_t adapter = { progress, user };
+    int ret = upkg_ops_remove(package_name, !handle->in_transaction, progress ? adapt_progress : NULL, &adapter);
+    return ret == 0 ? UPKG_OK : UPKG_EFAILED;
+}
+
+/**
+ * @brief Starts grouping installs and removals.
+ */
+int upkg_transaction_begin(upkg_handle_t *handle) {
+    if (!handle || handle != g_open_handle) return UPKG_EINVAL;
+    if (handle->in_transaction) return UPKG_EBUSY;
+    if (upkg_db_lock() != 0) return UPKG_EFAILED;
+    handle->in_transaction = true;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Writes the directory table once and tells upkgd to reload.
+ */
+int upkg_transaction_commit(upkg_handle_t *handle) {
+    if (!handle || handle != g_open_handle || !handle->in_transaction) return UPKG_EINVAL;
+    int ret = upkg_ops_commit("libupkg transaction") == 0 ? UPKG_OK : UPKG_EFAILED;
+    handle->in_transaction = false;
+    // The daemon takes the lock itself when it reloads
+    upkg_db_unlock();
+    upkg_daemon_request("reload", NULL);
+    return ret;
+}
+
+/**
+ * @brief Sizes a group of installs and removals as one plan.
+ */
+int upkg_check_space(upkg_handle_t *handle, const char *const *deb_paths, size_t deb_count,
+                     const char *const *removals, size_t removal_count) {
+    if (!handle || handle != g_open_handle || (deb_count && !deb_paths) || (removal_count && !removals)) {
+        return UPKG_EINVAL;
+    }
+    upkg_space_plan_t plan;
+    upkg_space_init(&plan);
+    int ret = 0;
+    for (size_t i = 0; i < deb_count && ret == 0; i++) {
+        ret = upkg_space_add_install(&plan, deb_paths[i]);
+    }
+    for (size_t i = 0; i < removal_count && ret == 0; i++) {
+        ret = upkg_space_add_removal(&plan, removals[i]);
+    }
+    if (ret == 0) {
+        ret = upkg_space_check(&plan);
+    }
+    upkg_space_free(&plan);
+    return ret == 0 ? UPKG_OK : ret == 1 ? UPKG_ENOSPC : UPKG_EFAILED;
+}
+
+// --- Staged Installs ---
+
+/**
+ * @brief Extracts and parses a .deb.
+ */
+int upkg_stage_extract(upkg_handle_t *handle, const char *deb_path, upkg_progress_fn progress,
+                       void *user, upkg_staged_t **out) {
+    if (!out) return UPKG_EINVAL;
+    *out = NULL;
+    if (!handle || handle != g_open_handle || !deb_path) return UPKG_EINVAL;
+    if (upkg_space_check_installs(&deb_path, 1) == 1) return UPKG_ENOSPC;
+
+    upkg_staged_t *staged = calloc(1, sizeof(*staged));
+    if (!staged) return UPKG_ENOMEM;
+    progress_adapter_t adapter = { progress, user };
+    if (upkg_ops_stage(deb_path, &staged->ops, progress ? adapt_progress : NULL, &adapter) != 0) {
+        upkg_stage_free(staged);
+        return UPKG_EFAILED;
+    }
+    *out = staged;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Describes what committing a staged package would change.
+ */
+int upkg_stage_plan(upkg_handle_t *handle, const upkg_staged_t *staged, upkg_plan_t *out) {
+    if (!handle || !staged || !out) return UPKG_EINVAL;
+    const upkg_package_info_t *info = &staged->ops.info;
+
+    pthread_mutex_lock(&g_path_index_lock);
+    upkg_index_t *index = upkg_db_path_index();
+    pthread_mutex_unlock(&g_path_index_lock);
+    if (!index) return UPKG_ENOMEM;
+
+    const upkg_hash_package_info_t *installed = upkg_hash_search(upkg_main_hash_table, info->package_name);
+    out->package = make_str(info->package_name);
+    out->version = make_str(info->version);
+    out->previous_version = make_str(installed ? installed->version : NULL);
+    out->files = info->file_count > 0 ? (size_t)info->file_count : 0;
+    out->conflicts = 0;
+    out->bytes = 0;
+
+    for (size_t i = 0; i < out->files; i++) {
+        const char *path = info->file_list[i];
+        for (upkg_index_entry_t *e = upkg_index_find(index, path); e; e = upkg_index_next_match(e)) {
+            if (strcmp(e->value, info->package_name) != 0) {
+                out->conflicts++;
+                break;
+            }
+        }
+
+        char *staged_path = upkg_util_concat_path(info->data_dir_path, path);
+        struct stat st;
+        if (staged_path && lstat(staged_path, &st) == 0 && S_ISREG(st.st_mode)) {
+            out->bytes += (uint64_t)st.st_size;
+        }
+        free(staged_path);
+    }
+    return UPKG_OK;
+}
+
+/**
+ * @brief Installs a staged package.
+ */
+int upkg_stage_commit(upkg_handle_t *handle, upkg_staged_t *staged, upkg_progress_fn progress, void *user) {
+    if (!handle || handle != g_open_handle || !staged) return UPKG_EINVAL;
+    progress_adapter_t adapter = { progress, user };
+    int ret = upkg_ops_apply(&staged->ops, !handle->in_transaction, progress ? adapt_progress : NULL, &adapter);
+    return ret == 0 ? UPKG_OK : UPKG_EFAILED;
+}
+
+/**
+ * @brief Frees a staged package.
+ */
+void upkg_stage_free(upkg_staged_t *staged) {
+    if (!staged) return;
+    upkg_ops_staged_free(&staged->ops);
+    free(staged);
+}
+
+// --- Executor ---
+
+/**
+ * @brief Starts worker threads.
+ */
+int upkg_executor_create(upkg_handle_t *handle, int threads, upkg_executor_t **out) {
+    if (!out) return UPKG_EINVAL;
+    *out = NULL;
+    if (!handle || handle != g_open_handle) return UPKG_EINVAL;
+
+    upkg_executor_t *executor = calloc(1, sizeof(*executor));
+    if (!executor) return UPKG_ENOMEM;
+    executor->pool = upkg_pool_create(threads);
+    if (!executor->pool) {
+        free(executor);
+        return UPKG_ENOMEM;
+    }
+    *out = executor;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Waits for queued jobs, then stops the workers.
+ */
+void upkg_executor_destroy(upkg_executor_t *executor) {
+    if (!executor) return;
+    upkg_pool_destroy(executor->pool);
+    free(executor);
+}
+
+/**
+ * @brief Returns the completion descriptor.
+ */
+int upkg_executor_fd(const upkg_executor_t *executor) {
+    return executor ? upkg_pool_fd(executor->pool) : -1;
+}
+
+/**
+ * @brief Runs pending completions.
+ */
+int upkg_executor_dispatch(upkg_executor_t *executor) {
+    return executor ? upkg_pool_dispatch(executor->pool) : 0;
+}
+
+/**
+ * @brief Queues a job.
+ */
+int upkg_executor_submit(upkg_executor_t *executor, upkg_job_fn job, upkg_done_fn done,
+                         void *arg, bool exclusive) {
+    if (!executor || !job) return UPKG_EINVAL;
+    return upkg_pool_submit(executor->pool, job, done, arg, exclusive) == 0 ? UPKG_OK : UPKG_ENOMEM;
+}
+
+/**
+ * @brief Queues a completion without a job.
+ */
+int upkg_executor_post(upkg_executor_t *executor, upkg_done_fn done, int status, void *arg) {
+    if (!executor || !done) return UPKG_EINVAL;
+    return upkg_pool_post(executor->pool, done, status, arg) == 0 ? UPKG_OK : UPKG_ENOMEM;
+}
+
+// --- Queries ---
+
+/**
+ * @brief Enters a read section on the calling thread.
+ */
+void upkg_read_begin(upkg_handle_t *handle) {
+    if (handle) upkg_snap_read_begin();
+}
+
+/**
+ * @brief Leaves a read section.
+ */
+void upkg_read_end(upkg_handle_t *handle) {
+    if (handle) upkg_snap_read_end();
+}
+
+/**
+ * @brief Looks up an installed package by name.
+ */
+int upkg_package_find(upkg_handle_t *handle, const char *name, upkg_package_t *out) {
+    if (!handle || !name || !out) return UPKG_EINVAL;
+    const upkg_hash_package_info_t *pkg = upkg_snap_find(upkg_snap_read_begin(), name);
+    if (pkg) fill_package(pkg, out);
+    upkg_snap_read_end();
+    return pkg ? UPKG_OK : UPKG_ENOTFOUND;
+}
+
+/**
+ * @brief Returns one of a package's installed paths.
+ */
+int upkg_package_file(const upkg_package_t *package, size_t index, upkg_str_t *out) {
+    if (!package || !package->record || !out || index >= package->file_count) return UPKG_EINVAL;
+    const upkg_hash_package_info_t *pkg = package->record;
+    *out = make_str(pkg->file_list[index]);
+    return UPKG_OK;
+}
+
+/**
+ * @brief Starts an iteration over installed packages.
+ */
+int upkg_package_iter_begin(upkg_handle_t *handle, upkg_package_iter_t **out) {
+    if (!handle || !out) return UPKG_EINVAL;
+    upkg_package_iter_t *iter = calloc(1, sizeof(*iter));
+    if (!iter) return UPKG_ENOMEM;
+    iter->handle = handle;
+    iter->snap = upkg_snap_pin();
+    *out = iter;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Advances an iterator.
+ */
+bool upkg_package_iter_next(upkg_package_iter_t *iter, upkg_package_t *out) {
+    if (!iter || !out || iter->next >= upkg_snap_count(iter->snap)) return false;
+    fill_package(upkg_snap_at(iter->snap, iter->next++), out);
+    return true;
+}
+
+/**
+ * @brief Frees an iterator.
+ */
+void upkg_package_iter_end(upkg_package_iter_t *iter) {
+    if (iter) upkg_snap_unpin(iter->snap);
+    free(iter);
+}
+
+/**
+ * @brief Finds the package that owns an installed path.
+ */
+int upkg_path_owner(upkg_handle_t *handle, const char *path, upkg_str_t *owner) {
+    if (!handle || !path || !owner) return UPKG_EINVAL;
+    while (*path == '/') path++;
+
+    pthread_mutex_lock(&g_path_index_lock);
+    upkg_index_t *index = upkg_db_path_index();
+    pthread_mutex_unlock(&g_path_index_lock);
+    if (!index) return UPKG_ENOMEM;
+
+    upkg_index_entry_t *e = upkg_index_find(index, path);
+    if (!e) return UPKG_ENOTFOUND;
+    *owner = make_str(e->value);
+    return UPKG_OK;
+}
+
+/**
+ * @brief Finds an installed package that provides a soname.
+ */
+int upkg_soname_provider(upkg_handle_t *handle, const char *soname, upkg_str_t *provider) {
+    if (!handle || !soname || !provider) return UPKG_EINVAL;
+    upkg_index_entry_t *e = upkg_index_find(upkg_soname_index, soname);
+    if (!e) return UPKG_ENOTFOUND;
+    *provider = make_str(e->value);
+    return UPKG_OK;
+}
+
+/**
+ * @brief Loads a package's install-time manifest.
+ */
+int upkg_package_manifest_open(upkg_handle_t *handle, const char *package_name,
+                               upkg_package_manifest_t **out) {
+    if (!handle || !package_name || !out) return UPKG_EINVAL;
+    *out = NULL;
+    bool installed = upkg_snap_find(upkg_snap_read_begin(), package_name) != NULL;
+    upkg_snap_read_end();
+    if (!installed) return UPKG_ENOTFOUND;
+
+    upkg_package_manifest_t *m = calloc(1, sizeof(*m));
+    if (!m) return UPKG_ENOMEM;
+    if (upkg_manifest_read(package_name, &m->manifest) != 0) {
+        free(m);
+        return UPKG_ENOTFOUND;
+    }
+    m->count = m->manifest.count > 0 ? (size_t)m->manifest.count : 0;
+    m->records = calloc(m->count ? m->count : 1, sizeof(*m->records));
+    if (!m->records) {
+        upkg_manifest_free(&m->manifest);
+        free(m);
+        return UPKG_ENOMEM;
+    }
+    for (size_t i = 0; i < m->count; i++) {
+        const upkg_manifest_entry_t *e = &m->manifest.entries[i];
+        upkg_file_record_t *r = &m->records[i];
+        r->path = make_str(e->path);
+        r->mode = (uint32_t)e->mode;
+        r->size = (uint64_t)e->size;
+        r->mtime_ns = (int64_t)e->mtime.tv_sec * 1000000000 + e->mtime.tv_nsec;
+        memcpy(r->sha256, e->digest, sizeof(r->sha256));
+    }
+    *out = m;
+    return UPKG_OK;
+}
+
+/**
+ * @brief Returns a manifest's records.
+ */
+const upkg_file_record_t *upkg_package_manifest_records(const upkg_package_manifest_t *manifest, size_t *count) {
+    if (count) *count = manifest ? manifest->count : 0;
+    return manifest ? manifest->records : NULL;
+}
+
+/**
+ * @brief Frees a manifest.
+ */
+void upkg_package_manifest_close(upkg_package_manifest_t *manifest) {
+    if (!manifest) return;
+    upkg_manifest_free(&manifest->manifest);
+    free(manifest->records);
+    free(manifest);
+}
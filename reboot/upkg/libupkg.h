@@ -0,0 +1,477 @@
+/******************************************************************************
+ * Filename:    libupkg.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Public C API of libupkg, the embeddable upkg core
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef LIBUPKG_H
+#define LIBUPKG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * libupkg exposes the package database, queries and install/remove to
+ * other programs without forking the upkg CLI. Link with -lupkg -lm -pthread.
+ *
+ * Handles: the core keeps its state (configuration, loaded database,
+ * indexes) per process, so only one handle may be open at a time;
+ * upkg_open returns UPKG_EBUSY otherwise.
+ *
+ * Strings: every upkg_str_t returned by a query points into the loaded
+ * database; nothing is copied. Views stay valid until the next
+ * upkg_install, upkg_remove or upkg_close on the handle returns; views
+ * from an iterator stay valid until upkg_package_iter_end, and views taken
+ * inside upkg_read_begin/upkg_read_end until the section ends. data is
+ * NUL-terminated, so it can also be used as a C string.
+ *
+ * Threads: each function documents its guarantee. "Read-only" functions
+ * may run concurrently with each other from any thread; "exclusive"
+ * functions must not overlap with any other call on the handle.
+ * "Lock-free" functions may also overlap exclusive ones: they read an
+ * immutable snapshot of the installed packages published at each commit,
+ * never wait for the writer, and see the database as of the last commit.
+ * A thread that keeps views while another thread commits wraps its
+ * queries in upkg_read_begin/upkg_read_end.
+ *
+ * Errors: functions return UPKG_OK or a negative upkg_status_t. Detailed
+ * diagnostics are written to stderr, as the CLI does.
+ */
+
+// Exported from libupkg.so; everything else in the library is hidden
+#if defined(__GNUC__)
+#define UPKG_API __attribute__((visibility("default")))
+#else
+#define UPKG_API
+#endif
+
+// --- Types ---
+
+typedef enum {
+    UPKG_OK = 0,
+    UPKG_EINVAL = -1,      // Invalid argument
+    UPKG_ENOTFOUND = -2,   // No such package, path or soname
+    UPKG_EBUSY = -3,       // A handle is already open in this process
+    UPKG_ECONFIG = -4,     // Configuration missing or unusable
+    UPKG_ENOMEM = -5,      // Allocation failure
+    UPKG_EFAILED = -6,     // The operation failed; see stderr
+    UPKG_ECANCELED = -7,   // Stopped at the caller's request
+    UPKG_ENOSPC = -8       // Not enough free space for an install; nothing was extracted
+} upkg_status_t;
+
+typedef struct upkg_handle upkg_handle_t;
+typedef struct upkg_package_iter upkg_package_iter_t;
+typedef struct upkg_staged upkg_staged_t;
+typedef struct upkg_executor upkg_executor_t;
+
+// A borrowed, NUL-terminated string
+typedef struct {
+    const char *data;
+    size_t len;
+} upkg_str_t;
+
+// A borrowed view of an installed package record
+typedef struct {
+    upkg_str_t name;
+    upkg_str_t version;
+    upkg_str_t architecture;
+    upkg_str_t maintainer;
+    upkg_str_t description;
+    upkg_str_t depends;
+    size_t file_count;
+    const void *record;    // Internal; pass the view to upkg_package_file
+} upkg_package_t;
+
+// One installed file as recorded at install time
+typedef struct {
+    upkg_str_t path;           // Relative to the install root
+    uint32_t mode;
+    uint64_t size;
+    int64_t mtime_ns;          // Nanoseconds since the epoch
+    uint8_t sha256[32];        // Contents, or a symlink's target
+} upkg_file_record_t;
+
+typedef struct upkg_package_manifest upkg_package_manifest_t;
+
+typedef enum {
+    UPKG_PROGRESS_EXTRACTED,   // The .deb was unpacked and parsed
+    UPKG_PROGRESS_FILE,        // detail: path placed; done/total: payload files
+    UPKG_PROGRESS_STORED,      // The package record was added to the database
+    UPKG_PROGRESS_REMOVED,     // The package and its record are gone
+    UPKG_PROGRESS_WARNING      // detail: message; the operation carries on
+} upkg_progress_kind_t;
+
+typedef struct {
+    upkg_progress_kind_t kind;
+    upkg_str_t package;        // Empty before extraction
+    upkg_str_t detail;
+    uint64_t done;
+    uint64_t total;
+} upkg_progress_t;
+
+/**
+ * @brief Receives install/remove progress on the calling thread.
+ * @param progress The event; valid only for the duration of the call.
+ * @param user The pointer given to upkg_install/upkg_remove.
+ */
+typedef void (*upkg_progress_fn)(const upkg_progress_t *progress, void *user);
+
+// What committing a staged package would do; strings borrow from the staged package
+typedef struct {
+    upkg_str_t package;
+    upkg_str_t version;
+    upkg_str_t previous_version;   // Empty when the package is not installed
+    size_t files;                  // Payload paths
+    size_t conflicts;              // Payload paths another installed package owns
+    uint64_t bytes;                // Size of the regular files in the payload
+} upkg_plan_t;
+
+// An executor job; runs on a worker thread and returns a upkg_status_t
+typedef int (*upkg_job_fn)(void *arg);
+
+// An executor completion; runs on the thread calling upkg_executor_dispatch
+typedef void (*upkg_done_fn)(int status, void *arg);
+
+// --- Handles ---
+
+/**
+ * @brief Loads the configuration and the installed-package database.
+ *        Thread safety: exclusive; also sets UPKG_CONFIG_PATH when
+ *        config_path is given, which is not safe against concurrent getenv.
+ * @param config_path The upkgconfig file, or NULL for the usual lookup.
+ * @param out Receives the handle.
+ * @return UPKG_OK, UPKG_EBUSY, UPKG_ECONFIG, UPKG_ENOMEM or UPKG_EFAILED.
+ */
+UPKG_API int upkg_open(const char *config_path, upkg_handle_t **out);
+
+/**
+ * @brief Writes metrics (if configured) and frees everything the handle
+ *        loaded. Invalidates all views. Thread safety: exclusive.
+ * @param handle The handle, or NULL.
+ */
+UPKG_API void upkg_close(upkg_handle_t *handle);
+
+/**
+ * @brief Describes a status code. Thread safety: any thread, any time.
+ * @param status A upkg_status_t value.
+ * @return A static string.
+ */
+UPKG_API const char *upkg_strerror(int status);
+
+// --- Changes ---
+
+/**
+ * @brief Installs or upgrades a .deb package. Invalidates all views.
+ *        Free space is checked for this package alone, against what is
+ *        free when the call is made; size a group with upkg_check_space.
+ *        Thread safety: exclusive. Serialised against other upkg
+ *        processes by the database lock.
+ * @param handle The handle.
+ * @param deb_path The package file.
+ * @param progress Progress callback, or NULL.
+ * @param user Passed through to progress.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_ENOSPC or UPKG_EFAILED.
+ */
+UPKG_API int upkg_install(upkg_handle_t *handle, const char *deb_path, upkg_progress_fn progress, void *user);
+
+/**
+ * @brief Removes an installed package. Invalidates all views.
+ *        Thread safety: exclusive.
+ * @param handle The handle.
+ * @param package_name The package; may be a view's name.data.
+ * @param progress Progress callback, or NULL.
+ * @param user Passed through to progress.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_ENOTFOUND or UPKG_EFAILED (also when
+ *         the record was removed but some of its files were not).
+ */
+UPKG_API int upkg_remove(upkg_handle_t *handle, const char *package_name, upkg_progress_fn progress, void *user);
+
+/**
+ * @brief Groups the following installs and removals: the database lock is
+ *        held throughout, and the directory table write and upkgd reload
+ *        happen once, at upkg_transaction_commit. Each change still takes
+ *        effect when its call returns; there is no rollback.
+ *        Thread safety: exclusive.
+ * @param handle The handle.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_EBUSY (already in a transaction) or UPKG_EFAILED.
+ */
+UPKG_API int upkg_transaction_begin(upkg_handle_t *handle);
+
+/**
+ * @brief Ends the transaction started by upkg_transaction_begin.
+ *        Thread safety: exclusive.
+ * @param handle The handle.
+ * @return UPKG_OK, UPKG_EINVAL (no transaction) or UPKG_EFAILED.
+ */
+UPKG_API int upkg_transaction_commit(upkg_handle_t *handle);
+
+/**
+ * @brief Checks that a group of installs and removals fits on disk as a
+ *        whole, before any of it is applied. upkg_install and
+ *        upkg_stage_extract only check one package at a time, so packages
+ *        staged together, or a transaction planned up front, should be
+ *        sized here first. A shortfall is logged per filesystem.
+ *        Thread safety: read-only.
+ * @param handle The handle.
+ * @param deb_paths The package files to install.
+ * @param deb_count The number of packages.
+ * @param removals The packages the group removes, or NULL.
+ * @param removal_count The number of removals.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_ENOSPC or UPKG_EFAILED (a package could not be sized).
+ */
+UPKG_API int upkg_check_space(upkg_handle_t *handle, const char *const *deb_paths, size_t deb_count,
+                              const char *const *removals, size_t removal_count);
+
+// --- Staged Installs ---
+
+/*
+ * upkg_install split into phases, so callers can unpack several packages in
+ * parallel, inspect them, and then commit (or drop) each one. Extraction
+ * only writes under the control directory, never the install root or the
+ * database.
+ */
+
+/**
+ * @brief Extracts and parses a .deb. Free space is checked for this package
+ *        alone; other staged but uncommitted packages are not counted, so
+ *        size them together with upkg_check_space first. Thread safety:
+ *        may run concurrently with read-only calls and with other
+ *        upkg_stage_extract calls.
+ * @param handle The handle.
+ * @param deb_path The package file.
+ * @param progress Receives UPKG_PROGRESS_EXTRACTED on the calling thread, or NULL.
+ * @param user Passed through to progress.
+ * @param out Receives the staged package; free it with upkg_stage_free.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_ENOMEM, UPKG_ENOSPC or UPKG_EFAILED.
+ */
+UPKG_API int upkg_stage_extract(upkg_handle_t *handle, const char *deb_path, upkg_progress_fn progress,
+                                void *user, upkg_staged_t **out);
+
+/**
+ * @brief Describes what committing a staged package would change.
+ *        Thread safety: read-only.
+ * @param handle The handle.
+ * @param staged The staged package.
+ * @param out Receives the plan; its strings live as long as staged.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_stage_plan(upkg_handle_t *handle, const upkg_staged_t *staged, upkg_plan_t *out);
+
+/**
+ * @brief Installs a staged package, as upkg_install does after extraction,
+ *        and honours an open transaction. Invalidates all views.
+ *        Thread safety: exclusive.
+ * @param handle The handle.
+ * @param staged The staged package; still needs upkg_stage_free.
+ * @param progress Progress callback, or NULL.
+ * @param user Passed through to progress.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_EFAILED.
+ */
+UPKG_API int upkg_stage_commit(upkg_handle_t *handle, upkg_staged_t *staged, upkg_progress_fn progress, void *user);
+
+/**
+ * @brief Frees a staged package. Thread safety: any thread.
+ * @param staged The staged package, or NULL.
+ */
+UPKG_API void upkg_stage_free(upkg_staged_t *staged);
+
+// --- Executor ---
+
+/*
+ * Worker threads for the staged calls above. Jobs submitted as shared run
+ * in parallel (extract, plan, queries); exclusive jobs (commit, remove)
+ * wait for them and run alone, so the thread-safety rules hold without
+ * extra locking. Completions are queued and upkg_executor_fd becomes
+ * readable; poll or epoll it and call upkg_executor_dispatch to run them.
+ */
+
+/**
+ * @brief Starts worker threads. Thread safety: exclusive.
+ * @param handle The handle; the executor must be destroyed before it closes.
+ * @param threads Number of workers; 0 picks one per online CPU.
+ * @param out Receives the executor.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_executor_create(upkg_handle_t *handle, int threads, upkg_executor_t **out);
+
+/**
+ * @brief Waits for queued jobs, then stops the workers. Completions not yet
+ *        dispatched are dropped. Thread safety: loop thread only.
+ * @param executor The executor, or NULL.
+ */
+UPKG_API void upkg_executor_destroy(upkg_executor_t *executor);
+
+/**
+ * @brief Returns a descriptor that is readable while completions are pending.
+ * @param executor The executor.
+ * @return The descriptor; do not close it.
+ */
+UPKG_API int upkg_executor_fd(const upkg_executor_t *executor);
+
+/**
+ * @brief Runs pending completions in queue order. Thread safety: call from
+ *        one thread (the event loop).
+ * @param executor The executor.
+ * @return The number of completions run.
+ */
+UPKG_API int upkg_executor_dispatch(upkg_executor_t *executor);
+
+/**
+ * @brief Queues a job. Thread safety: any thread.
+ * @param executor The executor.
+ * @param job Runs on a worker thread.
+ * @param done Receives job's status from upkg_executor_dispatch, or NULL.
+ * @param arg Passed to job and done.
+ * @param exclusive Whether the job needs the handle to itself.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_executor_submit(upkg_executor_t *executor, upkg_job_fn job, upkg_done_fn done,
+                                  void *arg, bool exclusive);
+
+/**
+ * @brief Queues a completion without a job, e.g. to hand progress from a
+ *        worker to the loop thread. Thread safety: any thread.
+ * @param executor The executor.
+ * @param done The callback.
+ * @param status Passed to done.
+ * @param arg Passed to done.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_executor_post(upkg_executor_t *executor, upkg_done_fn done, int status, void *arg);
+
+// --- Queries ---
+
+/**
+ * @brief Enters a read section on the calling thread: lock-free queries
+ *        made until upkg_read_end all see the same commit, and their views
+ *        stay valid until then even if another thread commits. Sections
+ *        nest. Keep them short; the memory of replaced snapshots is only
+ *        reclaimed once every section that could see them has ended.
+ *        Thread safety: lock-free.
+ * @param handle The handle.
+ */
+UPKG_API void upkg_read_begin(upkg_handle_t *handle);
+
+/**
+ * @brief Leaves a read section. Thread safety: lock-free.
+ * @param handle The handle.
+ */
+UPKG_API void upkg_read_end(upkg_handle_t *handle);
+
+/**
+ * @brief Looks up an installed package by name. Thread safety: lock-free.
+ * @param handle The handle.
+ * @param name The package name.
+ * @param out Receives the view.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOTFOUND.
+ */
+UPKG_API int upkg_package_find(upkg_handle_t *handle, const char *name, upkg_package_t *out);
+
+/**
+ * @brief Returns one of a package's installed paths, relative to the
+ *        install root. Thread safety: lock-free.
+ * @param package A view from upkg_package_find or upkg_package_iter_next.
+ * @param index 0 .. file_count - 1.
+ * @param out Receives the path.
+ * @return UPKG_OK or UPKG_EINVAL.
+ */
+UPKG_API int upkg_package_file(const upkg_package_t *package, size_t index, upkg_str_t *out);
+
+/**
+ * @brief Starts an iteration over installed packages, in name order. The
+ *        iterator keeps the snapshot it started on, so commits made
+ *        meanwhile do not affect it. Thread safety: lock-free; each
+ *        iterator belongs to one thread.
+ * @param handle The handle.
+ * @param out Receives the iterator; free it with upkg_package_iter_end.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_package_iter_begin(upkg_handle_t *handle, upkg_package_iter_t **out);
+
+/**
+ * @brief Advances an iterator. Thread safety: lock-free.
+ * @param iter The iterator.
+ * @param out Receives the next package.
+ * @return true if a package was produced, false at the end.
+ */
+UPKG_API bool upkg_package_iter_next(upkg_package_iter_t *iter, upkg_package_t *out);
+
+/**
+ * @brief Frees an iterator. Thread safety: lock-free.
+ * @param iter The iterator, or NULL.
+ */
+UPKG_API void upkg_package_iter_end(upkg_package_iter_t *iter);
+
+/**
+ * @brief Finds the package that owns an installed path. Thread safety: read-only.
+ * @param handle The handle.
+ * @param path The path relative to the install root (a leading '/' is ignored).
+ * @param owner Receives the owning package's name.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOTFOUND.
+ */
+UPKG_API int upkg_path_owner(upkg_handle_t *handle, const char *path, upkg_str_t *owner);
+
+/**
+ * @brief Finds an installed package that provides a soname. Thread safety: read-only.
+ * @param handle The handle.
+ * @param soname The DT_SONAME, e.g. "libssl.so.3".
+ * @param provider Receives the providing package's name.
+ * @return UPKG_OK, UPKG_EINVAL or UPKG_ENOTFOUND.
+ */
+UPKG_API int upkg_soname_provider(upkg_handle_t *handle, const char *soname, upkg_str_t *provider);
+
+/**
+ * @brief Loads a package's install-time manifest (path, mode, size,
+ *        mtime and SHA-256 of every file) into one contiguous array.
+ *        Thread safety: read-only.
+ * @param handle The handle.
+ * @param package_name The package.
+ * @param out Receives the manifest; free it with upkg_package_manifest_close.
+ * @return UPKG_OK, UPKG_EINVAL, UPKG_ENOTFOUND or UPKG_ENOMEM.
+ */
+UPKG_API int upkg_package_manifest_open(upkg_handle_t *handle, const char *package_name,
+                                        upkg_package_manifest_t **out);
+
+/**
+ * @brief Returns a manifest's records, valid until it is closed.
+ *        Thread safety: read-only.
+ * @param manifest The manifest.
+ * @param count Receives the number of records.
+ * @return The records.
+ */
+UPKG_API const upkg_file_record_t *upkg_package_manifest_records(const upkg_package_manifest_t *manifest,
+                                                                 size_t *count);
+
+/**
+ * @brief Frees a manifest. Thread safety: read-only.
+ * @param manifest The manifest, or NULL.
+ */
+UPKG_API void upkg_package_manifest_close(upkg_package_manifest_t *manifest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBUPKG_H
@@ -0,0 +1,131 @@
+/******************************************************************************
+ * Filename:    upkg_bloom.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Bloom filter for fast negative membership tests on paths
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_bloom.h"
+#include "upkg_util.h"
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * @brief Hashes a key with 64-bit FNV-1a; the two halves seed double hashing.
+ * @param key The key.
+ * @return The 64-bit hash.
+ */
+static uint64_t bloom_hash(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    // Final avalanche so paths sharing a long prefix spread across both halves
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Creates a Bloom filter sized for an expected number of keys at
+ *        UPKG_BLOOM_FALSE_POSITIVE_RATE.
+ * @param expected_keys The number of keys that will be added.
+ * @return A pointer to the new filter, or NULL on failure.
+ */
+upkg_bloom_t *upkg_bloom_create(size_t expected_keys) {
+    if (expected_keys == 0) expected_keys = 1;
+
+    // m = -n ln p / (ln 2)^2, k = (m / n) ln 2
+    double ln2 = log(2.0);
+    double wanted = -(double)expected_keys * log(UPKG_BLOOM_FALSE_POSITIVE_RATE) / (ln2 * ln2);
+    size_t bit_count = 64;
+    while ((double)bit_count < wanted) {
+        bit_count <<= 1;
+    }
+    unsigned int hashes = (unsigned int)((double)bit_count / expected_keys * ln2 + 0.5);
+    if (hashes < 1) hashes = 1;
+    if (hashes > UPKG_BLOOM_MAX_HASHES) hashes = UPKG_BLOOM_MAX_HASHES;
+
+    upkg_bloom_t *bloom = malloc(sizeof(upkg_bloom_t));
+    if (!bloom) {
+        upkg_util_error("Failed to allocate memory for Bloom filter.\n");
+        return NULL;
+    }
+    bloom->bits = calloc(bit_count / 64, sizeof(uint64_t));
+    if (!bloom->bits) {
+        upkg_util_error("Failed to allocate %zu bytes for Bloom filter bits.\n", bit_count / 8);
+        free(bloom);
+        return NULL;
+    }
+    bloom->bit_count = bit_count;
+    bloom->hashes = hashes;
+    return bloom;
+}
+
+/**
+ * @brief Destroys a Bloom filter.
+ * @param bloom The filter to destroy.
+ */
+void upkg_bloom_destroy(upkg_bloom_t *bloom) {
+    if (!bloom) return;
+    free(bloom->bits);
+    free(bloom);
+}
+
+/**
+ * @brief Adds a key to the filter.
+ * @param bloom The filter.
+ * @param key The key to add.
+ */
+void upkg_bloom_add(upkg_bloom_t *bloom, const char *key) {
+    if (!bloom || !key) return;
+
+    uint64_t hash = bloom_hash(key);
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    size_t mask = bloom->bit_count - 1;
+    for (unsigned int i = 0; i < bloom->hashes; i++) {
+        size_t bit = (h1 + (size_t)i * h2) & mask;
+        bloom->bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+/**
+ * @brief Tests a key against the filter. Safe to call from several threads
+ *        once all keys have been added.
+ * @param bloom The filter.
+ * @param key The key to test.
+ * @return false if the key was definitely never added, true if it may have been.
+ */
+bool upkg_bloom_maybe_contains(const upkg_bloom_t *bloom, const char *key) {
+    if (!bloom || !key) return true;
+
+    uint64_t hash = bloom_hash(key);
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    size_t mask = bloom->bit_count - 1;
+    for (unsigned int i = 0; i < bloom->hashes; i++) {
+        size_t bit = (h1 + (size_t)i * h2) & mask;
+        if (!(bloom->bits[bit / 64] & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
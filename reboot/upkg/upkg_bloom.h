@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Filename:    upkg_bloom.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Bloom filter for fast negative membership tests on paths
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_BLOOM_H
+#define UPKG_BLOOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- Bloom Filter Configuration ---
+#define UPKG_BLOOM_FALSE_POSITIVE_RATE 0.01
+#define UPKG_BLOOM_MAX_HASHES 16
+
+// --- Bloom Filter Structure ---
+typedef struct {
+    uint64_t *bits;
+    size_t bit_count;      // Power of two, so probes reduce with a mask
+    unsigned int hashes;   // Probes per key
+} upkg_bloom_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Creates a Bloom filter sized for an expected number of keys at
+ *        UPKG_BLOOM_FALSE_POSITIVE_RATE.
+ * @param expected_keys The number of keys that will be added.
+ * @return A pointer to the new filter, or NULL on failure.
+ */
+upkg_bloom_t *upkg_bloom_create(size_t expected_keys);
+
+/**
+ * @brief Destroys a Bloom filter.
+ * @param bloom The filter to destroy.
+ */
+void upkg_bloom_destroy(upkg_bloom_t *bloom);
+
+/**
+ * @brief Adds a key to the filter.
+ * @param bloom The filter.
+ * @param key The key to add.
+ */
+void upkg_bloom_add(upkg_bloom_t *bloom, const char *key);
+
+/**
+ * @brief Tests a key against the filter. Safe to call from several threads
+ *        once all keys have been added.
+ * @param bloom The filter.
+ * @param key The key to test.
+ * @return false if the key was definitely never added, true if it may have been.
+ */
+bool upkg_bloom_maybe_contains(const upkg_bloom_t *bloom, const char *key);
+
+#endif // UPKG_BLOOM_H
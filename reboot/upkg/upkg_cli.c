@@ -2,29 +2,66 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <stdarg.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "upkg_config.h"
 #include "upkg_pack.h"
 #include "upkg_hash.h"
+#include "upkg_util.h"
+#include "upkg_repack.h"
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_scan.h"
+#include "upkg_manifest.h"
+#include "upkg_daemon.h"
+#include "upkg_metrics.h"
+#include "upkg_ops.h"
+#include "upkg_gen.h"
+#include "upkg_history.h"
+#include "upkg_fleet.h"
+#include "upkg_cpu.h"
+#include "upkg_format.h"
+#include "upkg_json.h"
+#include "upkg_du.h"
+#include "upkg_space.h"
+#include "upkg_conflict.h"
+#include "libupkg.h"
 
-// Global variables
-bool g_verbose_mode = false;
+// Options for --repack, adjusted by --compress=, --frame-size= and --in-place
+static upkg_repack_options_t g_repack_options = { UPKG_COMPRESS_ZSTD, 0, false, NULL };
 
-// --- Simple Logging Functions ---
+// The CLI's libupkg handle, opened by upkg_init
+static upkg_handle_t *g_handle = NULL;
 
-/**
- * @brief Logging function for verbose output
- */
-void upkg_log_verbose(const char *format, ...) {
-    if (!g_verbose_mode) return;
+// Longest package name print_progress keeps for the final message
+#define UPKG_CLI_NAME_MAX 256
 
-    va_list args;
-    va_start(args, format);
-    printf("[VERBOSE] ");
-    vprintf(format, args);
-    va_end(args);
-}
+// --format sets a template for following -l, -s and --du commands; it is
+// compiled once per record type on first use
+static const char *g_format_text = NULL;
+static upkg_format_t *g_format = NULL;        // for package records
+static upkg_format_t *g_du_format = NULL;     // for --du rows
+
+// --json and --ndjson switch following query commands to machine-readable
+// records; --format switches back to text
+typedef enum { OUTPUT_TEXT, OUTPUT_JSON, OUTPUT_NDJSON } output_mode_t;
+static output_mode_t g_output = OUTPUT_TEXT;
+
+// --null makes --batch split records on NUL instead of newline
+static bool g_batch_null = false;
+
+// --no-space-check skips the free-space check before following installs
+static bool g_space_check = true;
+
+// --force-overwrite lets following installs take paths another package ships
+static bool g_force_overwrite = false;
+
+// Set while --batch applies its plan: handlers then leave the directory
+// table write and the upkgd reload to the end of the transaction
+static bool g_in_transaction = false;
 
 // --- Placeholder Function Implementations ---
 
@@ -40,9 +77,40 @@ void usage(void) {
     printf("  -r, --remove <package-name>             Remove a package.\n");
     printf("  -l, --list                              List all installed packages.\n");
     printf("  -s, --status <package-name>             Show detailed information about a package.\n");
-    printf("  -S, --search <query>                    Search for a package by name.\n");
+    printf("  -L, --contents <package-name>           List the files a package installed.\n");
+    printf("  -S, --search <query>                    Search installed packages by name or description.\n");
+    printf("      --provides-lib <soname>             Show which installed package provides a shared library.\n");
+    printf("      --audit [package-name]              Verify installed files, rehashing only changed ones.\n");
+    printf("      --export-manifest <file>            Write a compact manifest of everything installed.\n");
+    printf("      --diff-manifest <a> <b>             Compare two exported manifests (e.g. from two hosts).\n");
+    printf("      --modified [package-name]           List files changed since install (instant with upkgd).\n");
+    printf("      --daemon                            Run upkgd, the live modification tracker.\n");
+    printf("      --unowned [dir]                     List files under dir (default: usr) no package owns.\n");
+    printf("      --history [package] [--since date]  Show installs and removals, newest last.\n");
+    printf("      --du [by]                           Installed size by section, maintainer, priority,\n");
+    printf("                                          architecture or month, or the top[=N], files[=N]\n");
+    printf("                                          or newest[=N] packages (default: top=20).\n");
+    printf("      --generations                       List database generations (one per committed change).\n");
+    printf("      --rollback <generation>             Restore the packages of an earlier generation from cache.\n");
+    printf("      --batch [file]                      Run install/remove/status/query/list/provides-lib\n");
+    printf("                                          commands from file or stdin as one transaction;\n");
+    printf("                                          queries see the database as it was before it, and\n");
+    printf("                                          a failed change rolls the batch back.\n");
+    printf("      --null                              Split following --batch input on NUL, not newline.\n");
+    printf("      --no-space-check                    Skip the free-space check before following installs.\n");
+    printf("      --force-overwrite                   Let following installs take files other packages ship.\n");
+    printf("      --format <template>                 Print following -l/-s/-S results through a template,\n");
+    printf("                                          e.g. '${Package}\\t${Version}\\n' (see upkg_format.h).\n");
+    printf("      --json, --ndjson                    Print following -l/-s/-L/-S/--history/--audit results\n");
+    printf("                                          as a JSON array, or one JSON object per line.\n");
+    printf("      --repack <path-to-package.deb>...   Recompress .deb members (default: zstd) into the cache.\n");
+    printf("      --compress=<zstd|xz|gzip|none>      Target compression for following --repack commands.\n");
+    printf("      --frame-size=<bytes[K|M|G]>         Split repacked members into independent frames.\n");
+    printf("      --in-place                          Rewrite repacked .deb files in place.\n");
     printf("  -v, --verbose                           Enable verbose output.\n");
     printf("      --version                           Print version information.\n");
+    printf("      --cpu-features                      Show CPU features and the SIMD kernels in use\n");
+    printf("                                          (override with UPKG_CPU_FEATURES, e.g. none, -avx2).\n");
     printf("  -h, --help                              Display this help message.\n\n");
     printf("      --print-config                      Print current configuration settings.\n");
     printf("      --print-config-file                 Print path to configuration file in use.\n");
@@ -63,12 +131,16 @@ void handle_version(void) {
  * @return 0 on success, -1 on failure.
  */
 int upkg_init(void) {
-    upkg_log_verbose("Initializing upkg environment...\n");
+    upkg_util_log_verbose("Initializing upkg environment...\n");
     
-    // Initialize paths from configuration file
-    upkg_init_paths();
+    // Load the configuration and the installed package records
+    int status = upkg_open(NULL, &g_handle);
+    if (status != UPKG_OK) {
+        upkg_util_error("%s\n", upkg_strerror(status));
+        return -1;
+    }
     
-    upkg_log_verbose("upkg environment initialized successfully.\n");
+    upkg_util_log_verbose("upkg environment initialized successfully.\n");
     return 0; // Success
 }
 
@@ -76,140 +148,883 @@ int upkg_init(void) {
  * @brief Cleans up upkg environment and frees allocated memory.
  */
 void upkg_cleanup(void) {
-    upkg_log_verbose("Cleaning up upkg environment...\n");
-    
-    // Clean up hash table if it exists
-    if (upkg_main_hash_table) {
-        upkg_hash_destroy_table(upkg_main_hash_table);
-        upkg_main_hash_table = NULL;
-    }
+    upkg_util_log_verbose("Cleaning up upkg environment...\n");
     
-    // Clean up configuration paths
-    upkg_cleanup_paths();
+    upkg_close(g_handle);
+    g_handle = NULL;
     
-    upkg_log_verbose("upkg cleanup completed.\n");
+    upkg_util_log_verbose("upkg cleanup completed.\n");
 }
 
 /**
- * @brief Prints error messages with formatting support.
+ * @brief Prints install and removal progress the way the CLI always has.
+ * @param event The progress event.
+ * @param user Optional buffer of UPKG_CLI_NAME_MAX bytes that receives the package name.
  */
-void errormsg(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    
-    fprintf(stderr, "ERROR: ");
-    vfprintf(stderr, format, args);
-    
-    va_end(args);
+static void print_progress(const upkg_ops_event_t *event, void *user) {
+    switch (event->kind) {
+    case UPKG_OPS_EXTRACTED:
+        if (user) snprintf(user, UPKG_CLI_NAME_MAX, "%s", event->package);
+        printf("Package extraction successful!\n\n");
+        upkg_pack_print_package_info(event->pkg_info);
+        break;
+    case UPKG_OPS_STORED:
+        printf("Package successfully added to internal database.\n\n");
+        break;
+    case UPKG_OPS_WARNING:
+        printf("Warning: %s\n", event->detail);
+        break;
+    case UPKG_OPS_FILE:
+    case UPKG_OPS_REMOVED:
+        break;
+    }
+}
+
+/**
+ * @brief Interprets a free-space check's result. A group of installs that
+ *        cannot be sized is not installed unchecked.
+ * @param result 0 if it fits, 1 if it does not (already reported), -1 if
+ *        it could not be sized.
+ * @return true to go ahead with the installs.
+ */
+static bool space_fits(int result) {
+    if (result == -1) {
+        upkg_util_error("Cannot size the install for the free-space check; nothing was installed "
+                        "(--no-space-check to go ahead).\n");
+    }
+    return result == 0;
+}
+
+/**
+ * @brief Runs the checks that precede extraction for a group of installs:
+ *        file conflicts within the group and with installed packages, then
+ *        free space. Each archive's headers are read once, in parallel.
+ * @param debs The packages to install.
+ * @param deb_count The number of packages.
+ * @param removals The packages the same group removes.
+ * @param removal_count The number of removals.
+ * @return 0 to go ahead, -1 to install nothing.
+ */
+static int preflight_installs(const char *const *debs, int deb_count, const char *const *removals, int removal_count) {
+    if (deb_count == 0) return 0;
+
+    upkg_conflict_scan_t scan;
+    if (upkg_conflict_scan(debs, deb_count, removals, removal_count, &scan) != 0) {
+        // The scan has named the archive; without its contents neither check can vouch for the group
+        upkg_util_error("Cannot check the packages for conflicts or free space; nothing was installed.\n");
+        upkg_conflict_free(&scan);
+        return -1;
+    }
+
+    int ret = 0;
+    if (scan.conflict_count > 0) {
+        char *text = upkg_conflict_describe(&scan);
+        if (g_force_overwrite) {
+            printf("Warning: %d file conflict%s; overwriting (--force-overwrite):\n%s", scan.conflict_count,
+                   scan.conflict_count == 1 ? "" : "s", text ? text : "");
+        } else {
+            upkg_util_error("%d file conflict%s; nothing was installed (--force-overwrite to go ahead):\n%s",
+                            scan.conflict_count, scan.conflict_count == 1 ? "" : "s", text ? text : "");
+            ret = -1;
+        }
+        free(text);
+    }
+
+    if (ret == 0 && g_space_check) {
+        upkg_space_plan_t space;
+        upkg_space_init(&space);
+        int planned = 0;
+        for (int i = 0; i < deb_count && planned == 0; i++) {
+            planned = upkg_space_add_entries(&space, debs[i], scan.debs[i].entries, scan.debs[i].entry_count);
+        }
+        for (int i = 0; i < removal_count && planned == 0; i++) {
+            planned = upkg_space_add_removal(&space, removals[i]);
+        }
+        if (!space_fits(planned == 0 ? upkg_space_check(&space) : -1)) {
+            ret = -1;
+        }
+        upkg_space_free(&space);
+    }
+    upkg_conflict_free(&scan);
+    return ret;
 }
 
 /**
  * @brief Handles package installation with info collection and display.
+ * @return 0 on success, -1 on failure.
  */
-void handle_install(const char *deb_file_path) {
-    upkg_log_verbose("Installing package from: %s\n", deb_file_path);
+int handle_install(const char *deb_file_path) {
+    upkg_util_log_verbose("Installing package from: %s\n", deb_file_path);
     printf("Installing package from: %s\n", deb_file_path);
-    
-    if (!g_control_dir) {
-        printf("Error: Control directory not configured. Please check your upkg configuration.\n");
+    printf("\nExtracting package and collecting information...\n");
+
+    // Inside a --batch transaction the directory table and upkgd reload wait for the end
+    char package_name[UPKG_CLI_NAME_MAX] = "";
+    if (upkg_ops_install(deb_file_path, !g_in_transaction, print_progress, package_name) != 0) {
+        printf("Error: Failed to install %s.\n", deb_file_path);
+        return -1;
+    }
+
+    if (g_verbose_mode && g_system_install_root) {
+        printf("Installation Configuration:\n");
+        printf("=========================\n");
+        printf("  Control dir: %s\n", g_control_dir);
+        printf("  Install root: %s\n", g_system_install_root);
+        printf("\n");
+    }
+    printf("Package %s installed.\n", package_name);
+    return 0;
+}
+
+/**
+ * @brief Recompresses a .deb package with the current repack options.
+ */
+void handle_repack(const char *deb_file_path) {
+    upkg_util_log_verbose("Repacking package: %s\n", deb_file_path);
+
+    char *cache_dir = NULL;
+    if (!g_repack_options.in_place) {
+        cache_dir = upkg_util_concat_path(g_upkg_base_dir, "cache");
+        if (!cache_dir) {
+            upkg_util_error("Failed to build repack cache path.\n");
+            return;
+        }
+    }
+
+    upkg_repack_options_t opts = g_repack_options;
+    opts.output_dir = cache_dir;
+    if (upkg_repack_deb(deb_file_path, &opts) != 0) {
+        upkg_util_error("Failed to repack %s\n", deb_file_path);
+    }
+
+    upkg_util_free_and_null(&cache_dir);
+}
+
+/**
+ * @brief Removes an installed package, its record and its now-unowned directories.
+ * @return 0 on success, -1 if it is not installed, the database could not
+ *         be locked, or some of its files could not be removed.
+ */
+int handle_remove(const char *package_name) {
+    upkg_util_log_verbose("Removing package: %s\n", package_name);
+
+    if (!upkg_hash_search(upkg_main_hash_table, package_name)) {
+        printf("Package '%s' is not installed.\n", package_name);
+        return -1;
+    }
+    if (upkg_ops_remove(package_name, !g_in_transaction, print_progress, NULL) != 0) {
+        return -1;
+    }
+    printf("Package %s removed.\n", package_name);
+    return 0;
+}
+
+// --- Output Formats ---
+
+/**
+ * @brief Returns the --format template compiled for one record type,
+ *        compiling it on first use.
+ * @param cache Where the compiled template is kept.
+ * @param fields The record type's fields, or NULL for package records.
+ * @param field_count The number of fields.
+ * @param format Output: the template, or NULL when --format was not given.
+ * @return 0 on success, -1 if the template does not compile (reported).
+ */
+static int output_format(upkg_format_t **cache, const upkg_format_field_t *fields, int field_count,
+                         const upkg_format_t **format) {
+    *format = NULL;
+    if (!g_format_text) return 0;
+    if (!*cache) {
+        *cache = fields ? upkg_format_compile_fields(g_format_text, fields, field_count)
+                        : upkg_format_compile(g_format_text);
+        if (!*cache) return -1;
+    }
+    *format = *cache;
+    return 0;
+}
+
+// --- Machine-Readable Output ---
+
+// One query command's JSON output: a single stdout buffer and its writer
+typedef struct {
+    upkg_out_t out;
+    upkg_json_t json;
+} json_output_t;
+
+/**
+ * @brief Starts a query command's --json/--ndjson output. In JSON mode its
+ *        records form one array; in NDJSON mode one line each.
+ */
+static void json_output_begin(json_output_t *o) {
+    upkg_out_init(&o->out, STDOUT_FILENO);
+    upkg_json_init(&o->json, &o->out, g_output == OUTPUT_NDJSON);
+    if (g_output == OUTPUT_JSON) upkg_json_begin_array(&o->json);
+}
+
+/**
+ * @brief Finishes a query command's --json/--ndjson output.
+ */
+static void json_output_end(json_output_t *o) {
+    if (g_output == OUTPUT_JSON) upkg_json_end_array(&o->json);
+    if (upkg_out_flush(&o->out) != 0) {
+        upkg_util_error("Cannot write output: %s\n", strerror(o->out.error));
+    }
+}
+
+/**
+ * @brief Lists installed packages from the package database.
+ */
+void handle_list(void) {
+    upkg_util_log_verbose("Listing installed packages...\n");
+    if (g_db_dir) {
+        upkg_util_log_verbose("  Database dir: %s\n", g_db_dir);
+    }
+    if (g_output == OUTPUT_TEXT) {
+        const upkg_format_t *format;
+        if (output_format(&g_format, NULL, 0, &format) == 0) {
+            upkg_hash_list_packages(upkg_main_hash_table, format);
+        }
         return;
     }
-    
-    // Initialize package info structure
-    upkg_package_info_t pkg_info;
-    upkg_pack_init_package_info(&pkg_info);
-    
-    // Extract package and collect information
-    printf("\nExtracting package and collecting information...\n");
-    int result = upkg_pack_extract_and_collect_info(deb_file_path, g_control_dir, &pkg_info);
-    
-    if (result == 0) {
-        printf("Package extraction successful!\n\n");
-        
-        // Print the collected package information
-        upkg_pack_print_package_info(&pkg_info);
-        
-        // Initialize hash table if not already created
-        if (!upkg_main_hash_table) {
-            upkg_main_hash_table = upkg_hash_create_table(INITIAL_HASH_TABLE_SIZE);
-            if (!upkg_main_hash_table) {
-                printf("Warning: Failed to create hash table for package management.\n");
+
+    json_output_t o;
+    json_output_begin(&o);
+    for (size_t i = 0; upkg_main_hash_table && i < upkg_main_hash_table->size; i++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+            upkg_json_package(&o.json, &n->data, false);
+        }
+    }
+    json_output_end(&o);
+}
+
+/**
+ * @brief Shows the recorded information for an installed package.
+ */
+void handle_status(const char *package_name) {
+    upkg_hash_package_info_t *pkg = upkg_hash_search(upkg_main_hash_table, package_name);
+    if (g_output == OUTPUT_TEXT) {
+        if (!pkg) {
+            printf("Package '%s' is not installed.\n", package_name);
+            return;
+        }
+        const upkg_format_t *format;
+        if (output_format(&g_format, NULL, 0, &format) == 0) {
+            upkg_hash_print_package_info(pkg, format);
+        }
+        return;
+    }
+
+    json_output_t o;
+    json_output_begin(&o);
+    if (pkg) {
+        upkg_json_package(&o.json, pkg, true);
+    } else {
+        upkg_json_begin_object(&o.json);
+        upkg_json_key(&o.json, "package");
+        upkg_json_string(&o.json, package_name);
+        upkg_json_key(&o.json, "installed");
+        upkg_json_bool(&o.json, false);
+        upkg_json_end_object(&o.json);
+    }
+    json_output_end(&o);
+}
+
+/**
+ * @brief Lists the files an installed package owns, one per line.
+ */
+void handle_contents(const char *package_name) {
+    upkg_hash_package_info_t *pkg = upkg_hash_search(upkg_main_hash_table, package_name);
+    if (!pkg) {
+        if (g_output == OUTPUT_TEXT) {
+            printf("Package '%s' is not installed.\n", package_name);
+        } else {
+            json_output_t o;
+            json_output_begin(&o);
+            json_output_end(&o);
+        }
+        return;
+    }
+    if (g_output == OUTPUT_TEXT) {
+        upkg_out_t out;
+        upkg_out_init(&out, STDOUT_FILENO);
+        upkg_format_render(upkg_format_builtin(UPKG_FORMAT_CONTENTS), pkg, &out);
+        if (upkg_out_flush(&out) != 0) {
+            upkg_util_error("Cannot write output: %s\n", strerror(out.error));
+        }
+        return;
+    }
+
+    json_output_t o;
+    json_output_begin(&o);
+    for (int i = 0; i < pkg->file_count; i++) {
+        if (!pkg->file_list[i]) continue;
+        upkg_json_begin_object(&o.json);
+        upkg_json_key(&o.json, "package");
+        upkg_json_string(&o.json, pkg->package_name);
+        upkg_json_key(&o.json, "path");
+        upkg_json_string(&o.json, pkg->file_list[i]);
+        upkg_json_end_object(&o.json);
+    }
+    json_output_end(&o);
+}
+
+/**
+ * @brief Shows which installed package provides a shared library.
+ */
+void handle_provides_lib(const char *soname) {
+    upkg_util_log_verbose("Looking up providers of: %s\n", soname);
+    upkg_db_print_soname_providers(soname);
+}
+
+/**
+ * @brief Searches installed packages whose name or description contains
+ *        the query, ignoring case. Text output goes through --format when
+ *        one is set.
+ */
+void handle_search(const char *query) {
+    json_output_t o;
+    const upkg_format_t *row = NULL;
+    if (g_output != OUTPUT_TEXT) {
+        json_output_begin(&o);
+    } else {
+        if (output_format(&g_format, NULL, 0, &row) != 0) return;
+        if (!row) row = upkg_format_builtin(UPKG_FORMAT_SEARCH);
+        upkg_out_init(&o.out, STDOUT_FILENO);
+    }
+
+    int matches = 0;
+    for (size_t i = 0; upkg_main_hash_table && i < upkg_main_hash_table->size; i++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+            const upkg_hash_package_info_t *pkg = &n->data;
+            if (!strcasestr(pkg->package_name, query) &&
+                !(pkg->description && strcasestr(pkg->description, query))) {
+                continue;
+            }
+            matches++;
+            if (g_output != OUTPUT_TEXT) {
+                upkg_json_package(&o.json, pkg, false);
             } else {
-                upkg_log_verbose("Hash table initialized for package management.\n");
-            }
-        }
-        
-        // Add package to hash table if table exists
-        if (upkg_main_hash_table) {
-            upkg_hash_package_info_t hash_pkg_info;
-            if (upkg_hash_convert_package_info(&pkg_info, &hash_pkg_info) == 0) {
-                if (upkg_hash_add_package(upkg_main_hash_table, &hash_pkg_info) == 0) {
-                    printf("Package successfully added to internal database.\n\n");
-                    
-                    // Test: Search and print from hash table to verify integrity
-                    upkg_hash_package_info_t *stored_pkg = upkg_hash_search(upkg_main_hash_table, pkg_info.package_name);
-                    if (stored_pkg) {
-                        upkg_hash_print_package_info(stored_pkg);
-                    } else {
-                        printf("Warning: Package not found in hash table after adding.\n");
-                    }
-                } else {
-                    printf("Warning: Failed to add package to internal database.\n");
+                upkg_format_render(row, pkg, &o.out);
+            }
+        }
+    }
+
+    if (g_output != OUTPUT_TEXT) {
+        json_output_end(&o);
+        return;
+    }
+    if (matches == 0) {
+        upkg_out_printf(&o.out, "No installed package matches '%s'.\n", query);
+    }
+    if (upkg_out_flush(&o.out) != 0) {
+        upkg_util_error("Cannot write output: %s\n", strerror(o.out.error));
+    }
+}
+
+/**
+ * @brief Adds one audit finding to the package's JSON record.
+ */
+static void json_audit_finding(const char *package_name, const char *path, upkg_file_status_t status, void *user) {
+    (void)package_name;
+    upkg_json_t *json = user;
+    upkg_json_begin_object(json);
+    upkg_json_key(json, "path");
+    upkg_json_string(json, path);
+    upkg_json_key(json, "status");
+    upkg_json_string(json, upkg_manifest_status_name(status));
+    upkg_json_end_object(json);
+}
+
+/**
+ * @brief Audits one package, as one JSON record when machine-readable
+ *        output is on: its findings, then its counts.
+ * @return 0 if the package's manifest was read.
+ */
+static int audit_package(const char *package_name, upkg_audit_counts_t *counts, json_output_t *o) {
+    if (!o) return upkg_manifest_audit(package_name, g_system_install_root, counts);
+
+    upkg_audit_counts_t before = *counts;
+    upkg_json_begin_object(&o->json);
+    upkg_json_key(&o->json, "package");
+    upkg_json_string(&o->json, package_name);
+    upkg_json_key(&o->json, "findings");
+    upkg_json_begin_array(&o->json);
+    int rc = upkg_manifest_audit_visit(package_name, g_system_install_root, counts, json_audit_finding, &o->json);
+    upkg_json_end_array(&o->json);
+    upkg_json_key(&o->json, "audited");
+    upkg_json_bool(&o->json, rc == 0);
+    upkg_json_key(&o->json, "files");
+    upkg_json_int(&o->json, (int64_t)(counts->files - before.files));
+    upkg_json_key(&o->json, "rehashed");
+    upkg_json_int(&o->json, (int64_t)(counts->rehashed - before.rehashed));
+    upkg_json_end_object(&o->json);
+    return rc;
+}
+
+/**
+ * @brief Audits one installed package, or all of them when package_name is NULL.
+ */
+void handle_audit(const char *package_name) {
+    upkg_audit_counts_t counts;
+    memset(&counts, 0, sizeof(counts));
+    int packages = 0;
+
+    if (package_name) {
+        if (!upkg_hash_search(upkg_main_hash_table, package_name)) {
+            printf("Package '%s' is not installed.\n", package_name);
+            return;
+        }
+    }
+    // Refreshed snapshots are written back, so hold the database lock
+    if (upkg_db_lock() != 0) {
+        printf("Error: Failed to lock the package database.\n");
+        return;
+    }
+
+    json_output_t json_output;
+    json_output_t *o = NULL;
+    if (g_output != OUTPUT_TEXT) {
+        o = &json_output;
+        json_output_begin(o);
+    }
+    if (package_name) {
+        if (audit_package(package_name, &counts, o) == 0) {
+            packages++;
+        }
+    } else if (upkg_main_hash_table) {
+        for (size_t i = 0; i < upkg_main_hash_table->size; i++) {
+            for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+                if (audit_package(n->data.package_name, &counts, o) == 0) {
+                    packages++;
                 }
-                // Note: hash_pkg_info memory is managed by the hash table now
+            }
+        }
+    }
+    upkg_db_unlock();
+
+    if (o) {
+        json_output_end(o);
+        return;
+    }
+    printf("\nAudited %lu files in %d packages: %lu modified, %lu missing, %lu retyped (%lu rehashed).\n",
+           counts.files, packages, counts.modified, counts.missing, counts.retyped, counts.rehashed);
+}
+
+// --- Disk Usage ---
+
+// Where handle_du renders its rows
+typedef struct {
+    const upkg_format_t *format;
+    upkg_out_t *out;
+    upkg_json_t *json;
+} du_output_t;
+
+/**
+ * @brief Renders one --du row as text or as a JSON record.
+ */
+static int print_du_row(const upkg_du_row_t *row, void *user) {
+    du_output_t *o = user;
+    if (!o->json) {
+        upkg_format_render_record(o->format, row, o->out);
+        return 0;
+    }
+    upkg_json_begin_object(o->json);
+    upkg_json_key(o->json, "name");
+    upkg_json_string(o->json, row->name);
+    upkg_json_key(o->json, "size_kib");
+    upkg_json_int(o->json, row->size_kib);
+    upkg_json_key(o->json, "files");
+    upkg_json_int(o->json, row->files);
+    upkg_json_key(o->json, "packages");
+    upkg_json_int(o->json, row->packages);
+    upkg_json_key(o->json, "installed_at");
+    upkg_json_int(o->json, row->installed_at);
+    upkg_json_end_object(o->json);
+    return 0;
+}
+
+/**
+ * @brief Reports installed size grouped by a control field or install
+ *        month, or the N largest, fullest or newest packages.
+ * @param spec "section", "maintainer", "priority", "architecture", "month",
+ *        or "top", "files", "newest" with an optional "=N" (default 20).
+ */
+void handle_du(const char *spec) {
+    static const char *const group_template = "${Size;12} KiB ${Packages;7} pkgs ${Files;9} files  ${Name}\n";
+    static const char *const top_template = "${Size;12} KiB ${Files;9} files  ${Date;10}  ${Name}\n";
+
+    upkg_du_dimension_t dim;
+    bool grouped = upkg_du_parse_dimension(spec, &dim) == 0;
+    upkg_du_metric_t metric = UPKG_DU_BY_SIZE;
+    size_t n = 20;
+    if (!grouped) {
+        size_t len = strcspn(spec, "=");
+        if (strncmp(spec, "top", len) == 0 && len == 3) metric = UPKG_DU_BY_SIZE;
+        else if (strncmp(spec, "files", len) == 0 && len == 5) metric = UPKG_DU_BY_FILES;
+        else if (strncmp(spec, "newest", len) == 0 && len == 6) metric = UPKG_DU_BY_DATE;
+        else {
+            upkg_util_error("Error: --du expects section, maintainer, priority, architecture, month, "
+                            "top[=N], files[=N] or newest[=N], not '%s'.\n", spec);
+            return;
+        }
+        if (spec[len] == '=') {
+            char *end;
+            long v = strtol(spec + len + 1, &end, 10);
+            if (*end != '\0' || v <= 0) {
+                upkg_util_error("Error: --du %.*s expects a positive count.\n", (int)len, spec);
+                return;
+            }
+            n = (size_t)v;
+        }
+    }
+
+    du_output_t o = { NULL, NULL, NULL };
+    upkg_format_t *builtin = NULL;
+    json_output_t output;     // its writer is only used for --json/--ndjson
+    if (g_output == OUTPUT_TEXT) {
+        if (output_format(&g_du_format, upkg_du_fields, upkg_du_field_count, &o.format) != 0) return;
+        if (!o.format) {
+            builtin = upkg_format_compile_fields(grouped ? group_template : top_template, upkg_du_fields,
+                                                 upkg_du_field_count);
+            if (!builtin) return;
+            o.format = builtin;
+        }
+        upkg_out_init(&output.out, STDOUT_FILENO);
+        if (!g_format_text) {
+            if (grouped) {
+                upkg_out_printf(&output.out, "Installed size by %s:\n", spec);
             } else {
-                printf("Warning: Failed to convert package info for hash table.\n");
+                upkg_out_printf(&output.out, "Top %zu packages by %s:\n", n,
+                                metric == UPKG_DU_BY_FILES ? "file count"
+                                : metric == UPKG_DU_BY_DATE ? "install date" : "installed size");
             }
         }
-        
-        if (g_verbose_mode && g_system_install_root) {
-            printf("Installation Configuration:\n");
-            printf("=========================\n");
-            printf("  Control dir: %s\n", g_control_dir);
-            printf("  Install root: %s\n", g_system_install_root);
-            printf("\n");
+    } else {
+        json_output_begin(&output);
+        o.json = &output.json;
+    }
+    o.out = &output.out;
+
+    int rows = grouped ? upkg_du_group(dim, print_du_row, &o) : upkg_du_top(metric, n, print_du_row, &o);
+    if (rows < 0) {
+        upkg_util_error("Disk usage query failed.\n");
+    }
+    if (o.json) {
+        json_output_end(&output);
+    } else if (upkg_out_flush(&output.out) != 0) {
+        upkg_util_error("Cannot write output: %s\n", strerror(output.out.error));
+    }
+    upkg_format_free(builtin);
+}
+
+/**
+ * @brief Lists files changed since install, from upkgd when it is running
+ *        and by reconciling against the stat snapshots otherwise.
+ */
+void handle_modified(const char *package_name) {
+    char request[512];
+    snprintf(request, sizeof(request), package_name ? "modified %s" : "modified", package_name);
+    if (upkg_daemon_request(request, stdout) == 0) {
+        return;
+    }
+
+    upkg_util_log_verbose("upkgd not running; reconciling against stat snapshots.\n");
+    upkg_audit_counts_t counts;
+    memset(&counts, 0, sizeof(counts));
+    if (package_name) {
+        if (!upkg_hash_search(upkg_main_hash_table, package_name)) {
+            printf("Package '%s' is not installed.\n", package_name);
+            return;
         }
-        
-        printf("Package information collection completed successfully.\n");
-        printf("Note: Actual installation logic is not yet implemented.\n");
+    }
+    // Refreshed snapshots are written back, so hold the database lock as --audit does
+    if (upkg_db_lock() != 0) {
+        printf("Error: Failed to lock the package database.\n");
+        return;
+    }
+    if (package_name) {
+        upkg_manifest_audit(package_name, g_system_install_root, &counts);
+    } else if (upkg_main_hash_table) {
+        for (size_t i = 0; i < upkg_main_hash_table->size; i++) {
+            for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+                upkg_manifest_audit(n->data.package_name, g_system_install_root, &counts);
+            }
+        }
+    }
+    upkg_db_unlock();
+}
+
+// --- Generations ---
+
+/**
+ * @brief Lists the recorded database generations.
+ */
+void handle_generations(void) {
+    upkg_gen_list();
+}
+
+/**
+ * @brief Prints rollback progress: one line per package changed.
+ */
+static void print_rollback_progress(const upkg_ops_event_t *event, void *user) {
+    (void)user;
+    switch (event->kind) {
+    case UPKG_OPS_STORED:
+        printf("Restored %s.\n", event->package);
+        break;
+    case UPKG_OPS_REMOVED:
+        printf("Removed %s.\n", event->package);
+        break;
+    case UPKG_OPS_WARNING:
+        printf("Warning: %s\n", event->detail);
+        break;
+    case UPKG_OPS_EXTRACTED:
+    case UPKG_OPS_FILE:
+        break;
+    }
+}
+
+/**
+ * @brief Returns the installed packages to the state of an earlier generation.
+ * @return 0 if the target was reached (or already matched), -1 otherwise.
+ */
+int handle_rollback(const char *generation) {
+    char *end;
+    long target = strtol(generation, &end, 10);
+    if (end == generation || *end != '\0' || target < 1) {
+        printf("Error: --rollback needs a generation number (see --generations).\n");
+        return -1;
+    }
+
+    upkg_ops_rollback_t plan;
+    if (upkg_ops_rollback_plan((int)target, &plan) != 0) {
+        printf("Error: Cannot roll back to generation %ld.\n", target);
+        return -1;
+    }
+    if (plan.step_count == 0) {
+        printf("Generation %d already matches generation %ld; nothing to do.\n", plan.current, target);
+        upkg_ops_rollback_free(&plan);
+        return 0;
+    }
+
+    int written = 0, deleted = 0;
+    printf("Rolling back from generation %d to %ld:\n", plan.current, target);
+    for (int i = 0; i < plan.step_count; i++) {
+        const upkg_ops_rollback_step_t *step = &plan.steps[i];
+        if (step->kind == UPKG_ROLLBACK_REMOVE) {
+            printf("  remove   %s %s\n", step->package, step->from_version ? step->from_version : "");
+        } else if (step->from_version) {
+            printf("  restore  %s %s -> %s\n", step->package, step->from_version, step->to_version);
+        } else {
+            printf("  restore  %s %s\n", step->package, step->to_version);
+        }
+        written += step->files_written;
+        deleted += step->files_deleted;
+    }
+    printf("%d files to write, %d to delete; %d packages unchanged.\n\n", written, deleted, plan.unchanged);
+
+    int ret = upkg_ops_rollback_apply(&plan, print_rollback_progress, NULL);
+    if (ret != 0) {
+        printf("Error: Rollback to generation %ld did not complete.\n", target);
     } else {
-        printf("Error: Failed to extract package or collect information.\n");
+        printf("Rolled back to generation %ld.\n", target);
     }
-    
-    // Clean up allocated memory
-    upkg_pack_free_package_info(&pkg_info);
+    upkg_ops_rollback_free(&plan);
+    return ret;
 }
 
+// --- History ---
+
 /**
- * @brief Handles package removal (placeholder).
+ * @brief Prints one history entry: a header line, then one line per operation.
  */
-void handle_remove(const char *package_name) {
-    printf("Removing package: %s (placeholder)\n", package_name);
+static int print_history_entry(const upkg_history_entry_t *entry, void *user) {
+    const char *package = user;
+    char date[32] = "-";
+    time_t t = (time_t)entry->time;
+    struct tm tm;
+    if (localtime_r(&t, &tm)) strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+
+    printf("%s  %-6s %8.3fs  %s\n", date, entry->status ? "FAILED" : "ok",
+           (double)entry->duration_us / 1e6, entry->summary ? entry->summary : "");
+    for (size_t i = 0; i < entry->op_count; i++) {
+        const upkg_history_op_t *op = &entry->ops[i];
+        if (package && (!op->package || strcmp(op->package, package) != 0)) continue;
+        if (op->kind == UPKG_HISTORY_REMOVE) {
+            printf("    remove   %s %s", op->package, op->old_version ? op->old_version : "");
+        } else if (op->old_version) {
+            printf("    upgrade  %s %s -> %s", op->package, op->old_version, op->new_version ? op->new_version : "?");
+        } else {
+            printf("    install  %s %s", op->package, op->new_version ? op->new_version : "");
+        }
+        printf("  (%llu written, %llu deleted, %.3fs%s)\n", (unsigned long long)op->files_written,
+               (unsigned long long)op->files_deleted, (double)op->duration_us / 1e6,
+               op->status ? ", failed" : "");
+    }
+    return 0;
 }
 
+// What json_history_entry writes to, and the package --history was given
+typedef struct {
+    upkg_json_t *json;
+    const char *package;
+} json_history_t;
+
 /**
- * @brief Lists installed packages (placeholder).
+ * @brief Writes one history entry as a JSON record with its operations.
  */
-void handle_list(void) {
-    upkg_log_verbose("Listing installed packages...\n");
-    printf("Listing installed packages... (placeholder)\n");
-    if (g_db_dir) {
-        upkg_log_verbose("  Database dir: %s\n", g_db_dir);
+static int json_history_entry(const upkg_history_entry_t *entry, void *user) {
+    const json_history_t *ctx = user;
+    upkg_json_t *json = ctx->json;
+    upkg_json_begin_object(json);
+    upkg_json_key(json, "time");
+    upkg_json_int(json, entry->time);
+    upkg_json_key(json, "duration_us");
+    upkg_json_int(json, (int64_t)entry->duration_us);
+    upkg_json_key(json, "failed");
+    upkg_json_int(json, entry->status);
+    upkg_json_key(json, "summary");
+    upkg_json_string(json, entry->summary);
+    upkg_json_key(json, "ops");
+    upkg_json_begin_array(json);
+    for (size_t i = 0; i < entry->op_count; i++) {
+        const upkg_history_op_t *op = &entry->ops[i];
+        if (ctx->package && (!op->package || strcmp(op->package, ctx->package) != 0)) continue;
+        const char *action = op->kind == UPKG_HISTORY_REMOVE ? "remove" : op->old_version ? "upgrade" : "install";
+        upkg_json_begin_object(json);
+        upkg_json_key(json, "action");
+        upkg_json_string(json, action);
+        upkg_json_key(json, "package");
+        upkg_json_string(json, op->package);
+        upkg_json_key(json, "old_version");
+        upkg_json_string(json, op->old_version);
+        upkg_json_key(json, "new_version");
+        upkg_json_string(json, op->new_version);
+        upkg_json_key(json, "files_written");
+        upkg_json_int(json, (int64_t)op->files_written);
+        upkg_json_key(json, "files_deleted");
+        upkg_json_int(json, (int64_t)op->files_deleted);
+        upkg_json_key(json, "duration_us");
+        upkg_json_int(json, (int64_t)op->duration_us);
+        upkg_json_key(json, "ok");
+        upkg_json_bool(json, op->status == 0);
+        upkg_json_end_object(json);
     }
+    upkg_json_end_array(json);
+    upkg_json_end_object(json);
+    return 0;
 }
 
 /**
- * @brief Shows package status (placeholder).
+ * @brief Parses "YYYY-MM-DD", "YYYY-MM-DD HH:MM[:SS]" (local time) or "@<unix seconds>".
+ * @return 0 on success, -1 if the date is not understood.
  */
-void handle_status(const char *package_name) {
-    printf("Showing status for package: %s (placeholder)\n", package_name);
+static int parse_history_date(const char *text, int64_t *out) {
+    if (text[0] == '@') {
+        char *end;
+        long long v = strtoll(text + 1, &end, 10);
+        if (end == text + 1 || *end != '\0') return -1;
+        *out = v;
+        return 0;
+    }
+    static const char *const formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d" };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *end = strptime(text, formats[i], &tm);
+        if (end && *end == '\0') {
+            tm.tm_isdst = -1;
+            *out = (int64_t)mktime(&tm);
+            return 0;
+        }
+    }
+    return -1;
 }
 
 /**
- * @brief Searches for packages (placeholder).
+ * @brief Shows the transaction history, optionally for one package and/or
+ *        from a date on.
  */
-void handle_search(const char *query) {
-    printf("Searching for packages with query: %s (placeholder)\n", query);
+void handle_history(const char *package, const char *since_text) {
+    int64_t since = INT64_MIN;
+    if (since_text && parse_history_date(since_text, &since) != 0) {
+        printf("Error: --since expects YYYY-MM-DD[ HH:MM[:SS]] or @<unix time>, not '%s'.\n", since_text);
+        return;
+    }
+
+    if (g_output != OUTPUT_TEXT) {
+        json_output_t o;
+        json_output_begin(&o);
+        json_history_t ctx = { &o.json, package };
+        if (package) {
+            upkg_history_scan_package(package, since, json_history_entry, &ctx);
+        } else {
+            upkg_history_scan_since(since, json_history_entry, &ctx);
+        }
+        json_output_end(&o);
+        return;
+    }
+
+    int shown = package ? upkg_history_scan_package(package, since, print_history_entry, (void *)package)
+                        : upkg_history_scan_since(since, print_history_entry, NULL);
+    if (shown == 0) {
+        printf("No history%s%s.\n", package ? " for " : "", package ? package : "");
+    }
+}
+
+// --- Fleet Manifests ---
+
+/**
+ * @brief Writes the installed-set manifest of this host.
+ */
+void handle_export_manifest(const char *path) {
+    uint32_t packages = 0, files = 0;
+    if (upkg_fleet_export(path, &packages, &files) == 0) {
+        printf("Exported %u packages (%u files) to %s.\n", packages, files, path);
+    }
+}
+
+/**
+ * @brief Compares two installed-set manifests.
+ */
+void handle_diff_manifest(const char *path_a, const char *path_b) {
+    upkg_fleet_manifest_t a, b;
+    if (upkg_fleet_read(path_a, &a) != 0) return;
+    if (upkg_fleet_read(path_b, &b) != 0) {
+        upkg_fleet_free(&a);
+        return;
+    }
+
+    upkg_fleet_diff_counts_t counts;
+    upkg_fleet_diff(&a, &b, &counts);
+    printf("%lu identical, %lu changed, %lu only in %s, %lu only in %s (%lu files compared).\n",
+           counts.identical, counts.changed, counts.only_a, path_a, counts.only_b, path_b,
+           counts.files_compared);
+    upkg_fleet_free(&a);
+    upkg_fleet_free(&b);
+}
+
+/**
+ * @brief Reports files under a directory of the install root that no package owns.
+ */
+void handle_unowned(const char *dir) {
+    upkg_util_log_verbose("Scanning for unowned files under: %s\n", dir);
+
+    upkg_scan_result_t result;
+    if (upkg_scan_unowned(dir, g_system_install_root, &result) != 0) {
+        upkg_util_error("Failed to scan %s for unowned files.\n", dir);
+        upkg_scan_free_result(&result);
+        return;
+    }
+
+    unsigned long long total = 0;
+    for (size_t i = 0; i < result.count; i++) {
+        printf("%12lld  %s\n", (long long)result.entries[i].size, result.entries[i].path);
+        total += (unsigned long long)result.entries[i].size;
+    }
+    printf("\n%zu unowned files (%llu bytes) among %llu scanned.\n", result.count, total, result.files_scanned);
+    upkg_util_log_verbose("Bloom filter passed %llu paths to the exact index.\n", result.bloom_hits);
+    upkg_scan_free_result(&result);
 }
 
 /**
@@ -262,12 +1077,313 @@ void handle_print_config_file(void) {
     }
 }
 
+// --- Batch Mode ---
+
+typedef enum {
+    BATCH_INSTALL,
+    BATCH_REMOVE
+} batch_op_kind_t;
+
+typedef struct {
+    batch_op_kind_t kind;
+    char *arg;          // .deb path or package name
+    char *package;      // BATCH_INSTALL: the control file's Package, read on first need
+    unsigned long line; // Input record number, for messages
+} batch_op_t;
+
+typedef struct {
+    batch_op_t *ops;
+    size_t count;
+    size_t capacity;
+} batch_plan_t;
+
+/**
+ * @brief Appends an install or removal to the batch plan.
+ * @param plan The plan.
+ * @param kind The operation.
+ * @param arg The .deb path or package name (copied).
+ * @param line The input record number.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int batch_plan_add(batch_plan_t *plan, batch_op_kind_t kind, const char *arg, unsigned long line) {
+    if (plan->count == plan->capacity) {
+        size_t new_capacity = plan->capacity ? plan->capacity * 2 : 16;
+        batch_op_t *ops = realloc(plan->ops, new_capacity * sizeof(*ops));
+        if (!ops) return -1;
+        plan->ops = ops;
+        plan->capacity = new_capacity;
+    }
+    char *copy = strdup(arg);
+    if (!copy) return -1;
+    plan->ops[plan->count].kind = kind;
+    plan->ops[plan->count].arg = copy;
+    plan->ops[plan->count].package = NULL;
+    plan->ops[plan->count].line = line;
+    plan->count++;
+    return 0;
+}
+
+/**
+ * @brief Frees a batch plan.
+ * @param plan The plan.
+ */
+static void batch_plan_free(batch_plan_t *plan) {
+    for (size_t i = 0; i < plan->count; i++) {
+        free(plan->ops[i].arg);
+        free(plan->ops[i].package);
+    }
+    free(plan->ops);
+    memset(plan, 0, sizeof(*plan));
+}
+
+/**
+ * @brief Returns the package a planned install provides, from the Package
+ *        field of its control file. The .deb is extracted on first need.
+ * @param op The install.
+ * @return The package name, or NULL if the .deb could not be read.
+ */
+static const char *batch_op_package(batch_op_t *op) {
+    if (!op->package) {
+        upkg_package_info_t info;
+        upkg_pack_init_package_info(&info);
+        if (upkg_pack_extract_and_collect_info(op->arg, g_control_dir, &info) == 0 && info.package_name) {
+            op->package = strdup(info.package_name);
+        }
+        upkg_pack_free_package_info(&info);
+    }
+    return op->package;
+}
+
+/**
+ * @brief Checks that a removal names a package that will be installed at
+ *        that point of the plan: installed now or by an earlier install,
+ *        and not removed again since.
+ * @param plan The plan built so far.
+ * @param package_name The package to remove.
+ * @return true if the removal can be carried out.
+ */
+static bool batch_plan_can_remove(batch_plan_t *plan, const char *package_name) {
+    bool installed = upkg_hash_search(upkg_main_hash_table, package_name) != NULL;
+    size_t since = 0;
+    for (size_t i = 0; i < plan->count; i++) {
+        if (plan->ops[i].kind == BATCH_REMOVE && strcmp(plan->ops[i].arg, package_name) == 0) {
+            installed = false;
+            since = i + 1;
+        }
+    }
+    // Only then do the installs planned since matter, so only then are their .debs read
+    for (size_t i = since; i < plan->count && !installed; i++) {
+        if (plan->ops[i].kind != BATCH_INSTALL) continue;
+        const char *name = batch_op_package(&plan->ops[i]);
+        installed = name && strcmp(name, package_name) == 0;
+    }
+    return installed;
+}
+
+/**
+ * @brief Runs the pre-extraction checks over all of the plan's installs,
+ *        with its removals freeing their packages' files.
+ * @param plan The plan.
+ * @return 0 to apply the plan, -1 to apply nothing.
+ */
+static int batch_plan_preflight(const batch_plan_t *plan) {
+    const char **debs = malloc(plan->count * sizeof(*debs));
+    const char **removals = malloc(plan->count * sizeof(*removals));
+    if (!debs || !removals) {
+        upkg_util_error("batch: failed to allocate memory for the pre-install checks.\n");
+        free(debs);
+        free(removals);
+        return -1;
+    }
+    int deb_count = 0, removal_count = 0;
+    for (size_t i = 0; i < plan->count; i++) {
+        if (plan->ops[i].kind == BATCH_INSTALL) {
+            debs[deb_count++] = plan->ops[i].arg;
+        } else {
+            removals[removal_count++] = plan->ops[i].arg;
+        }
+    }
+    int ret = preflight_installs(debs, deb_count, removals, removal_count);
+    free(debs);
+    free(removals);
+    return ret;
+}
+
+/**
+ * @brief Answers a batch query immediately with one line per result.
+ * @param verb The query verb.
+ * @param arg The query argument, possibly empty.
+ * @return 0 if the verb is a query, -1 otherwise.
+ */
+static int batch_answer_query(const char *verb, const char *arg) {
+    if (strcmp(verb, "query") == 0) {
+        upkg_hash_package_info_t *pkg = upkg_hash_search(upkg_main_hash_table, arg);
+        if (pkg) {
+            printf("%s installed %s\n", arg, pkg->version ? pkg->version : "-");
+        } else {
+            printf("%s not-installed\n", arg);
+        }
+    } else if (strcmp(verb, "status") == 0) {
+        handle_status(arg);
+    } else if (strcmp(verb, "list") == 0) {
+        handle_list();
+    } else if (strcmp(verb, "provides-lib") == 0) {
+        handle_provides_lib(arg);
+    } else {
+        return -1;
+    }
+    // Let a provisioning tool on the other end of a pipe read answers as they come
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Runs newline- (or, after --null, NUL-) delimited commands from a
+ *        file or stdin against the loaded database. Queries are answered as
+ *        they are read, so they see the database as it was before the batch;
+ *        installs and removals are validated into a plan and applied at end
+ *        of input under a single database lock, with one directory-table
+ *        write and one upkgd reload. The plan stops at its first failed
+ *        change and the database is rolled back to the generation recorded
+ *        before the batch began.
+ * @param path The command file, or NULL / "-" for stdin.
+ * @return 0 if every record was valid and every change applied, -1 otherwise.
+ */
+int handle_batch(const char *path) {
+    FILE *in = stdin;
+    if (path && strcmp(path, "-") != 0) {
+        in = fopen(path, "r");
+        if (!in) {
+            upkg_util_error("Cannot open batch file '%s': %s\n", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    batch_plan_t plan = { NULL, 0, 0 };
+    unsigned long line_no = 0, errors = 0, queries = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    while ((len = getdelim(&line, &line_cap, g_batch_null ? '\0' : '\n', in)) != -1) {
+        line_no++;
+        if (len > 0 && line[len - 1] == (g_batch_null ? '\0' : '\n')) {
+            line[--len] = '\0';
+        }
+        char *record = g_batch_null ? line : upkg_util_trim_whitespace(line);
+        if (record[0] == '\0' || record[0] == '#') continue;
+
+        // "<verb> <argument>"; the argument is the rest of the record
+        char *arg = record + strcspn(record, " \t");
+        if (*arg) {
+            *arg++ = '\0';
+            arg += strspn(arg, " \t");
+        }
+
+        if (batch_answer_query(record, arg) == 0) {
+            queries++;
+        } else if (strcmp(record, "install") == 0) {
+            if (!upkg_util_file_exists(arg)) {
+                upkg_util_error("batch record %lu: package file not found: %s\n", line_no, arg);
+                errors++;
+            } else if (batch_plan_add(&plan, BATCH_INSTALL, arg, line_no) != 0) {
+                errors++;
+            }
+        } else if (strcmp(record, "remove") == 0) {
+            if (!batch_plan_can_remove(&plan, arg)) {
+                upkg_util_error("batch record %lu: package '%s' is not installed\n", line_no, arg);
+                errors++;
+            } else if (batch_plan_add(&plan, BATCH_REMOVE, arg, line_no) != 0) {
+                errors++;
+            }
+        } else {
+            upkg_util_error("batch record %lu: unknown command '%s'\n", line_no, record);
+            errors++;
+        }
+    }
+    free(line);
+    if (in != stdin) fclose(in);
+
+    int ret = 0;
+    size_t applied = 0;
+    if (errors) {
+        upkg_util_error("batch: %lu invalid records; no packages were installed or removed.\n", errors);
+        ret = -1;
+    } else if (plan.count > 0) {
+        if (upkg_db_lock() != 0) {
+            upkg_util_error("batch: failed to lock the package database.\n");
+            ret = -1;
+        } else if (batch_plan_preflight(&plan) != 0) {
+            upkg_db_unlock();
+            ret = -1;
+        } else {
+            // Mark where the batch started, so a failed change can undo the ones before it
+            upkg_gen_record("before batch");
+            int before = upkg_gen_latest();
+            batch_op_t *failed = NULL;
+
+            g_in_transaction = true;
+            for (size_t i = 0; i < plan.count && !failed; i++) {
+                upkg_util_log_verbose("batch record %lu: %s %s\n", plan.ops[i].line,
+                                 plan.ops[i].kind == BATCH_INSTALL ? "install" : "remove", plan.ops[i].arg);
+                ret = plan.ops[i].kind == BATCH_INSTALL ? handle_install(plan.ops[i].arg)
+                                                        : handle_remove(plan.ops[i].arg);
+                if (ret != 0) {
+                    failed = &plan.ops[i];
+                } else {
+                    applied++;
+                }
+            }
+            g_in_transaction = false;
+
+            // Commit once for the whole transaction
+            char summary[96];
+            if (failed) {
+                snprintf(summary, sizeof(summary), "batch of %zu changes (failed at record %lu)",
+                         plan.count, failed->line);
+            } else {
+                snprintf(summary, sizeof(summary), "batch of %zu changes", plan.count);
+            }
+            if (upkg_ops_commit(summary) != 0) {
+                printf("Warning: Failed to commit changes to %s.\n", g_db_dir);
+            }
+
+            if (failed) {
+                upkg_util_error("batch record %lu: %s %s failed; rolling back to generation %d.\n",
+                                failed->line, failed->kind == BATCH_INSTALL ? "install" : "remove",
+                                failed->arg, before);
+                upkg_ops_rollback_t rollback;
+                if (upkg_ops_rollback_plan(before, &rollback) != 0) {
+                    upkg_util_error("batch: cannot roll back; %zu of %zu changes remain applied.\n",
+                                    applied, plan.count);
+                } else {
+                    if (upkg_ops_rollback_apply(&rollback, print_rollback_progress, NULL) != 0) {
+                        upkg_util_error("batch: rollback to generation %d did not complete.\n", before);
+                    } else {
+                        printf("batch: rolled back to generation %d; no packages were changed.\n", before);
+                        applied = 0;
+                    }
+                    upkg_ops_rollback_free(&rollback);
+                }
+            }
+            upkg_db_unlock();
+            upkg_daemon_request("reload", NULL);
+        }
+    }
+    upkg_util_log_verbose("batch: %lu records, %lu queries, %zu changes applied.\n",
+                     line_no, queries, applied);
+    batch_plan_free(&plan);
+    return ret;
+}
+
 // --- Main Function ---
 int main(int argc, char *argv[]) {
+    if (upkg_log_init() != 0) return EXIT_FAILURE;
+
     // Check for verbose mode first, as it affects all subsequent output.
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             g_verbose_mode = true;
+            upkg_log_set_console(UPKG_LOG_DEBUG);
             break;
         }
     }
@@ -282,6 +1398,10 @@ int main(int argc, char *argv[]) {
             handle_version();
             return EXIT_SUCCESS;
         }
+        if (strcmp(argv[i], "--cpu-features") == 0) {
+            // Checks every kernel against the scalar one, so make test can run it per forced path
+            return upkg_cpu_report() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
         if (strcmp(argv[i], "--print-config") == 0) {
             // Initialize first to load config, then print
             if (upkg_init() != 0) {
@@ -306,9 +1426,9 @@ int main(int argc, char *argv[]) {
     
     // --- Core Program Flow ---
     // Step 1: Initialize the environment and load the database
-    upkg_log_verbose("Starting upkg with %d arguments\n", argc);
+    upkg_util_log_verbose("Starting upkg with %d arguments\n", argc);
     if (upkg_init() != 0) {
-        errormsg("Critical error during program initialization. Exiting.\n");
+        upkg_util_error("Critical error during program initialization. Exiting.\n");
         upkg_cleanup();
         return EXIT_FAILURE;
     }
@@ -317,27 +1437,31 @@ int main(int argc, char *argv[]) {
     atexit(upkg_cleanup);
 
     // Step 2: Execute commands based on the interleaved arguments.
+    int status = EXIT_SUCCESS;
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--install") == 0) {
             if (i + 1 < argc) {
-                // Loop to handle multiple .deb files
-                while (i + 1 < argc) {
-                    char *next_arg = argv[i+1];
-                    if (next_arg[0] == '-' || strstr(next_arg, ".deb") == NULL) {
-                        break; // Stop if it's a new command switch or not a .deb file
-                    }
-                    handle_install(next_arg);
+                // Gather the .deb files up to the next command switch
+                int first = i + 1;
+                while (i + 1 < argc && argv[i+1][0] != '-' && strstr(argv[i+1], ".deb") != NULL) {
                     i++;
                 }
+                // Check them together so a conflict or a full filesystem stops the group before any extraction
+                if (preflight_installs((const char *const *)&argv[first], i + 1 - first, NULL, 0) != 0) {
+                    continue;
+                }
+                for (int j = first; j <= i; j++) {
+                    handle_install(argv[j]);
+                }
             } else {
-                errormsg("Error: -i/--install requires at least one .deb file argument.");
+                upkg_util_error("Error: -i/--install requires at least one .deb file argument.");
             }
         } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--remove") == 0) {
             if (i + 1 < argc) {
                 handle_remove(argv[i+1]);
                 i++;
             } else {
-                errormsg("Error: -r/--remove requires a package name.");
+                upkg_util_error("Error: -r/--remove requires a package name.");
             }
         } else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--list") == 0) {
             handle_list();
@@ -346,25 +1470,169 @@ int main(int argc, char *argv[]) {
                 handle_status(argv[i+1]);
                 i++;
             } else {
-                errormsg("Error: -s/--status requires a package name.");
+                upkg_util_error("Error: -s/--status requires a package name.");
+            }
+        } else if (strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "--contents") == 0) {
+            if (i + 1 < argc) {
+                handle_contents(argv[i+1]);
+                i++;
+            } else {
+                upkg_util_error("Error: -L/--contents requires a package name.");
             }
         } else if (strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--search") == 0) {
             if (i + 1 < argc) {
                 handle_search(argv[i+1]);
                 i++;
             } else {
-                errormsg("Error: -S/--search requires a query.");
+                upkg_util_error("Error: -S/--search requires a query.");
+            }
+        } else if (strcmp(argv[i], "--provides-lib") == 0) {
+            if (i + 1 < argc) {
+                handle_provides_lib(argv[i+1]);
+                i++;
+            } else {
+                upkg_util_error("Error: --provides-lib requires a soname.");
+            }
+        } else if (strcmp(argv[i], "--audit") == 0) {
+            // The package argument is optional
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                handle_audit(argv[i+1]);
+                i++;
+            } else {
+                handle_audit(NULL);
+            }
+        } else if (strcmp(argv[i], "--export-manifest") == 0) {
+            if (i + 1 < argc) {
+                handle_export_manifest(argv[i+1]);
+                i++;
+            } else {
+                upkg_util_error("Error: --export-manifest requires an output file.");
+            }
+        } else if (strcmp(argv[i], "--diff-manifest") == 0) {
+            if (i + 2 < argc) {
+                handle_diff_manifest(argv[i+1], argv[i+2]);
+                i += 2;
+            } else {
+                upkg_util_error("Error: --diff-manifest requires two manifest files.");
+            }
+        } else if (strcmp(argv[i], "--modified") == 0) {
+            // The package argument is optional
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                handle_modified(argv[i+1]);
+                i++;
+            } else {
+                handle_modified(NULL);
+            }
+        } else if (strcmp(argv[i], "--daemon") == 0) {
+            if (upkg_daemon_run() != 0) {
+                upkg_util_error("upkgd failed to start.\n");
+            }
+        } else if (strcmp(argv[i], "--unowned") == 0) {
+            // The directory argument is optional
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                handle_unowned(argv[i+1]);
+                i++;
+            } else {
+                handle_unowned("usr");
+            }
+        } else if (strcmp(argv[i], "--history") == 0) {
+            // Both the package and "--since <date>" are optional
+            const char *package = NULL;
+            const char *since = NULL;
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                package = argv[++i];
+            }
+            if (i + 2 < argc && strcmp(argv[i+1], "--since") == 0) {
+                since = argv[i+2];
+                i += 2;
+            }
+            handle_history(package, since);
+        } else if (strcmp(argv[i], "--du") == 0) {
+            // The grouping or ranking is optional; the 20 largest packages otherwise
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                handle_du(argv[i+1]);
+                i++;
+            } else {
+                handle_du("top");
+            }
+        } else if (strcmp(argv[i], "--generations") == 0) {
+            handle_generations();
+        } else if (strcmp(argv[i], "--rollback") == 0) {
+            if (i + 1 < argc) {
+                if (handle_rollback(argv[i+1]) != 0) {
+                    status = EXIT_FAILURE;
+                }
+                i++;
+            } else {
+                upkg_util_error("Error: --rollback requires a generation number.");
+            }
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            // The file argument is optional; stdin otherwise
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                if (handle_batch(argv[i+1]) != 0) status = EXIT_FAILURE;
+                i++;
+            } else if (handle_batch(NULL) != 0) {
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--null") == 0) {
+            g_batch_null = true;
+        } else if (strcmp(argv[i], "--no-space-check") == 0) {
+            g_space_check = false;
+        } else if (strcmp(argv[i], "--force-overwrite") == 0) {
+            g_force_overwrite = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            g_output = OUTPUT_JSON;
+        } else if (strcmp(argv[i], "--ndjson") == 0) {
+            g_output = OUTPUT_NDJSON;
+        } else if (strcmp(argv[i], "--format") == 0) {
+            if (i + 1 < argc) {
+                g_format_text = argv[++i];
+                upkg_format_free(g_format);
+                upkg_format_free(g_du_format);
+                g_format = g_du_format = NULL;
+                g_output = OUTPUT_TEXT;
+            } else {
+                upkg_util_error("--format requires a template.\n");
+            }
+        } else if (strcmp(argv[i], "--repack") == 0) {
+            if (i + 1 < argc) {
+                while (i + 1 < argc) {
+                    char *next_arg = argv[i+1];
+                    if (next_arg[0] == '-' || strstr(next_arg, ".deb") == NULL) {
+                        break;
+                    }
+                    handle_repack(next_arg);
+                    i++;
+                }
+            } else {
+                upkg_util_error("Error: --repack requires at least one .deb file argument.");
+            }
+        } else if (strncmp(argv[i], "--compress=", 11) == 0) {
+            if (upkg_repack_parse_compress(argv[i] + 11, &g_repack_options.compress) != 0) {
+                upkg_util_error("Error: Unknown compression '%s' (expected zstd, xz, gzip or none).\n", argv[i] + 11);
+                break;
+            }
+        } else if (strncmp(argv[i], "--frame-size=", 13) == 0) {
+            unsigned long long frame_size;
+            if (upkg_util_parse_size(argv[i] + 13, &frame_size) != 0) {
+                upkg_util_error("Error: Invalid frame size '%s'.\n", argv[i] + 13);
+                break;
             }
+            g_repack_options.frame_size = (size_t)frame_size;
+        } else if (strcmp(argv[i], "--in-place") == 0) {
+            g_repack_options.in_place = true;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             // Already handled at the start of main
         } else {
-            errormsg("Error: Unknown argument or command: %s", argv[i]);
+            upkg_util_error("Error: Unknown argument or command: %s", argv[i]);
             // For interleaved commands, we should continue processing if possible
             // For now, let's just break on an unknown command
             break;
         }
     }
 
-    return EXIT_SUCCESS;
+    upkg_format_free(g_format);
+    upkg_format_free(g_du_format);
+    return status;
     // Note: The atexit handler will now call upkg_cleanup()
 }
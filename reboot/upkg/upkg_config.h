@@ -16,6 +16,7 @@ extern char *g_control_dir;
 extern char *g_db_dir; // New declaration for the database directory
 extern char *g_install_dir_internal;
 extern char *g_system_install_root;
+extern char *g_metrics_textfile; // Optional node-exporter textfile, NULL when unset
 
 // --- Function Prototypes for Configuration Management ---
 
@@ -28,6 +29,13 @@ extern char *g_system_install_root;
  */
 void upkg_init_paths();
 
+/**
+ * @brief Same as upkg_init_paths, but reports failure instead of exiting,
+ *        for callers such as libupkg that must not terminate the process.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_load_paths(void);
+
 /**
  * @brief Loads essential upkg path configurations from a cascading configuration file.
  *
@@ -0,0 +1,415 @@
+/******************************************************************************
+ * Filename:    upkg_conflict.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: File-conflict detection across a group of package installs
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_conflict.h"
+#include "upkg_db.h"
+#include "upkg_hash.h"
+#include "upkg_index.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// --- Shared Scan State ---
+
+typedef struct {
+    pthread_mutex_t lock;
+    upkg_index_t *paths;           // path -> index of each incoming package shipping it
+} path_shard_t;
+
+typedef struct {
+    upkg_conflict_scan_t *scan;
+    path_shard_t shards[UPKG_CONFLICT_SHARDS];
+    const upkg_index_t *owners;    // Installed path ownership; read-only while workers run
+    upkg_index_t *removals;        // Packages the group removes
+    pthread_mutex_t lock;          // Guards next, failed and the conflict list
+    int next;
+    int failed;
+} conflict_shared_t;
+
+typedef struct {
+    conflict_shared_t *shared;
+    int index;
+    char path[4096];
+} deb_walk_t;
+
+/**
+ * @brief Records a conflict.
+ * @param shared The shared state.
+ * @param path The path (copied).
+ * @param deb The incoming package.
+ * @param other_deb The other incoming package, or -1.
+ * @param owner The installed owner (copied), or NULL.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int add_conflict(conflict_shared_t *shared, const char *path, int deb, int other_deb, const char *owner) {
+    upkg_conflict_scan_t *scan = shared->scan;
+    int ret = 0;
+    pthread_mutex_lock(&shared->lock);
+    if (scan->conflict_count == scan->conflict_capacity) {
+        int capacity = scan->conflict_capacity ? scan->conflict_capacity * 2 : 16;
+        upkg_conflict_t *conflicts = realloc(scan->conflicts, (size_t)capacity * sizeof(*conflicts));
+        if (!conflicts) {
+            ret = -1;
+        } else {
+            scan->conflicts = conflicts;
+            scan->conflict_capacity = capacity;
+        }
+    }
+    if (ret == 0) {
+        upkg_conflict_t *c = &scan->conflicts[scan->conflict_count];
+        c->path = strdup(path);
+        c->owner = owner ? strdup(owner) : NULL;
+        c->deb = deb;
+        c->other_deb = other_deb;
+        if (!c->path || (owner && !c->owner)) {
+            free(c->path);
+            free(c->owner);
+            ret = -1;
+        } else {
+            scan->conflict_count++;
+        }
+    }
+    pthread_mutex_unlock(&shared->lock);
+    return ret;
+}
+
+// --- Archive Walking ---
+
+/**
+ * @brief Extracts the Package field from a control file.
+ * @param control The control file contents.
+ * @return A newly allocated name, or NULL if absent.
+ */
+static char *control_package(const char *control) {
+    for (const char *line = control; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        if (strncasecmp(line, "Package:", 8) != 0) continue;
+        const char *value = line + 8;
+        value += strspn(value, " \t");
+        size_t len = strcspn(value, "\r\n");
+        while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) len--;
+        return len ? strndup(value, len) : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Appends a copy of an entry to the package's entry list.
+ * @param deb The package.
+ * @param entry The entry.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int keep_entry(upkg_conflict_deb_t *deb, const upkg_deb_entry_t *entry) {
+    if (deb->entry_count == deb->entry_capacity) {
+        int capacity = deb->entry_capacity ? deb->entry_capacity * 2 : 64;
+        upkg_deb_entry_t *entries = realloc(deb->entries, (size_t)capacity * sizeof(*entries));
+        if (!entries) return -1;
+        deb->entries = entries;
+        deb->entry_capacity = capacity;
+    }
+    char *path = strdup(entry->path);
+    if (!path) return -1;
+    upkg_deb_entry_t *kept = &deb->entries[deb->entry_count++];
+    *kept = *entry;
+    kept->path = path;
+    kept->data = NULL;
+    return 0;
+}
+
+/**
+ * @brief Checks a payload path against the installed ownership index.
+ * @param shared The shared state.
+ * @param deb The incoming package.
+ * @param index The incoming package's index.
+ * @param path The path.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int check_owners(conflict_shared_t *shared, const upkg_conflict_deb_t *deb, int index, const char *path) {
+    upkg_index_entry_t *first = shared->owners ? upkg_index_find(shared->owners, path) : NULL;
+    if (!first) return 0;
+
+    // A path the package already owns is an upgrade, even if it is shared
+    for (upkg_index_entry_t *e = first; e; e = upkg_index_next_match(e)) {
+        if (deb->package && strcmp(e->value, deb->package) == 0) return 0;
+    }
+    for (upkg_index_entry_t *e = first; e; e = upkg_index_next_match(e)) {
+        if (shared->removals && upkg_index_find(shared->removals, e->value)) continue;
+        if (add_conflict(shared, path, index, -1, e->value) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps an entry and inserts its path into the shared path set.
+ */
+static int visit_entry(const upkg_deb_entry_t *entry, void *user) {
+    deb_walk_t *walk = (deb_walk_t *)user;
+    conflict_shared_t *shared = walk->shared;
+    upkg_conflict_deb_t *deb = &shared->scan->debs[walk->index];
+
+    if (keep_entry(deb, entry) != 0) {
+        upkg_util_error("Failed to allocate memory for the contents of '%s'.\n", deb->deb_path);
+        return -1;
+    }
+    if (entry->part == UPKG_DEB_CONTROL) {
+        const char *base = strrchr(entry->path, '/');
+        base = base ? base + 1 : entry->path;
+        if (entry->data && !deb->package && strcmp(base, "control") == 0) {
+            deb->package = control_package(entry->data);
+        }
+        return 0;
+    }
+    if (entry->type == '5') return 0;
+
+    // Paths are stored relative to the install root, as in the ownership index
+    const char *rel = entry->path;
+    while (rel[0] == '.' && rel[1] == '/') rel += 2;
+    while (*rel == '/') rel++;
+    upkg_util_safe_strncpy(walk->path, rel, sizeof(walk->path));
+    size_t len = strlen(walk->path);
+    while (len > 0 && walk->path[len - 1] == '/') walk->path[--len] = '\0';
+    if (len == 0) return 0;
+
+    char value[16];
+    snprintf(value, sizeof(value), "%d", walk->index);
+    path_shard_t *shard = &shared->shards[upkg_hash_fnv1a(walk->path) % UPKG_CONFLICT_SHARDS];
+    int ret = 0;
+    pthread_mutex_lock(&shard->lock);
+    for (upkg_index_entry_t *e = upkg_index_find(shard->paths, walk->path); e && ret == 0;
+         e = upkg_index_next_match(e)) {
+        int other = atoi(e->value);
+        // Keep the pair in group order, whichever worker got here second
+        if (other != walk->index) {
+            ret = add_conflict(shared, walk->path, other < walk->index ? other : walk->index,
+                               other < walk->index ? walk->index : other, NULL);
+        }
+    }
+    if (ret == 0) {
+        ret = upkg_index_insert(shard->paths, walk->path, value);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    if (ret == 0) {
+        ret = check_owners(shared, deb, walk->index, walk->path);
+    }
+    if (ret != 0) {
+        upkg_util_error("Failed to allocate memory for the conflict check.\n");
+    }
+    return ret;
+}
+
+/**
+ * @brief Worker thread: reads packages until none are left.
+ * @param arg The shared state.
+ * @return NULL.
+ */
+static void *conflict_worker_main(void *arg) {
+    conflict_shared_t *shared = (conflict_shared_t *)arg;
+    deb_walk_t *walk = malloc(sizeof(*walk));
+    if (!walk) {
+        pthread_mutex_lock(&shared->lock);
+        shared->failed = 1;
+        pthread_mutex_unlock(&shared->lock);
+        return NULL;
+    }
+    walk->shared = shared;
+
+    for (;;) {
+        pthread_mutex_lock(&shared->lock);
+        int index = shared->failed ? shared->scan->deb_count : shared->next++;
+        pthread_mutex_unlock(&shared->lock);
+        if (index >= shared->scan->deb_count) break;
+
+        walk->index = index;
+        if (upkg_repack_walk_deb(shared->scan->debs[index].deb_path, visit_entry, walk) != 0) {
+            upkg_util_error("Failed to read the contents of '%s'.\n", shared->scan->debs[index].deb_path);
+            pthread_mutex_lock(&shared->lock);
+            shared->failed = 1;
+            pthread_mutex_unlock(&shared->lock);
+        }
+    }
+    free(walk);
+    return NULL;
+}
+
+// --- Scanning ---
+
+/**
+ * @brief Orders conflicts by path, then by incoming package.
+ */
+static int compare_conflicts(const void *a, const void *b) {
+    const upkg_conflict_t *ca = (const upkg_conflict_t *)a;
+    const upkg_conflict_t *cb = (const upkg_conflict_t *)b;
+    int cmp = strcmp(ca->path, cb->path);
+    if (cmp != 0) return cmp;
+    return ca->deb - cb->deb;
+}
+
+/**
+ * @brief Reads a group of packages and collects their file conflicts.
+ */
+int upkg_conflict_scan(const char *const *deb_paths, int count, const char *const *removals,
+                       int removal_count, upkg_conflict_scan_t *scan) {
+    if (!scan) return -1;
+    memset(scan, 0, sizeof(*scan));
+    if (!deb_paths || count <= 0) return 0;
+
+    scan->debs = calloc((size_t)count, sizeof(*scan->debs));
+    conflict_shared_t *shared = calloc(1, sizeof(*shared));
+    if (!scan->debs || !shared) {
+        upkg_util_error("Failed to allocate memory for the conflict check.\n");
+        free(shared);
+        return -1;
+    }
+    scan->deb_count = count;
+    for (int i = 0; i < count; i++) {
+        scan->debs[i].deb_path = deb_paths[i];
+    }
+
+    // Build the ownership index up front; workers only read it
+    shared->scan = scan;
+    shared->owners = upkg_main_hash_table ? upkg_db_path_index() : NULL;
+    pthread_mutex_init(&shared->lock, NULL);
+    int ret = 0;
+    int shards_ready = 0;
+    for (; shards_ready < UPKG_CONFLICT_SHARDS; shards_ready++) {
+        shared->shards[shards_ready].paths = upkg_index_create(256);
+        if (!shared->shards[shards_ready].paths) {
+            ret = -1;
+            break;
+        }
+        pthread_mutex_init(&shared->shards[shards_ready].lock, NULL);
+    }
+    if (ret == 0 && removal_count > 0) {
+        shared->removals = upkg_index_create((size_t)removal_count * 2);
+        for (int i = 0; shared->removals && i < removal_count; i++) {
+            if (upkg_index_insert(shared->removals, removals[i], "") != 0) ret = -1;
+        }
+        if (!shared->removals) ret = -1;
+    }
+    if (ret != 0) {
+        upkg_util_error("Failed to allocate memory for the conflict check.\n");
+    }
+
+    if (ret == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int thread_count = (cpus < 1) ? 1 : (cpus > UPKG_CONFLICT_MAX_THREADS) ? UPKG_CONFLICT_MAX_THREADS : (int)cpus;
+        if (thread_count > count) thread_count = count;
+
+        pthread_t threads[UPKG_CONFLICT_MAX_THREADS];
+        int started = 0;
+        for (int i = 1; i < thread_count; i++) {
+            if (pthread_create(&threads[started], NULL, conflict_worker_main, shared) != 0) break;
+            started++;
+        }
+        upkg_util_log_verbose("Checking %d packages for file conflicts with %d threads\n", count, started + 1);
+
+        // The calling thread works too, so the scan finishes even if no thread started
+        conflict_worker_main(shared);
+        for (int i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        if (shared->failed) ret = -1;
+    }
+
+    // Two versions of one package in the group are an upgrade, not a conflict
+    int kept = 0;
+    for (int i = 0; i < scan->conflict_count; i++) {
+        upkg_conflict_t *c = &scan->conflicts[i];
+        const char *a = scan->debs[c->deb].package;
+        const char *b = c->other_deb >= 0 ? scan->debs[c->other_deb].package : NULL;
+        if (c->other_deb >= 0 && a && b && strcmp(a, b) == 0) {
+            free(c->path);
+            free(c->owner);
+            continue;
+        }
+        scan->conflicts[kept++] = *c;
+    }
+    scan->conflict_count = kept;
+    if (kept > 1) {
+        qsort(scan->conflicts, (size_t)kept, sizeof(*scan->conflicts), compare_conflicts);
+    }
+
+    for (int i = 0; i < shards_ready; i++) {
+        upkg_index_destroy(shared->shards[i].paths);
+        pthread_mutex_destroy(&shared->shards[i].lock);
+    }
+    if (shared->removals) upkg_index_destroy(shared->removals);
+    pthread_mutex_destroy(&shared->lock);
+    free(shared);
+    return ret;
+}
+
+/**
+ * @brief Formats a scan's conflicts.
+ */
+char *upkg_conflict_describe(const upkg_conflict_scan_t *scan) {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    if (!out) return NULL;
+
+    for (int i = 0; scan && i < scan->conflict_count; i++) {
+        const upkg_conflict_t *c = &scan->conflicts[i];
+        const upkg_conflict_deb_t *deb = &scan->debs[c->deb];
+        const char *base = strrchr(deb->deb_path, '/');
+        base = base ? base + 1 : deb->deb_path;
+        if (c->other_deb >= 0) {
+            const upkg_conflict_deb_t *other = &scan->debs[c->other_deb];
+            const char *other_base = strrchr(other->deb_path, '/');
+            other_base = other_base ? other_base + 1 : other->deb_path;
+            fprintf(out, "  /%s: shipped by both %s (%s) and %s (%s)\n", c->path,
+                    deb->package ? deb->package : "?", base, other->package ? other->package : "?", other_base);
+        } else {
+            fprintf(out, "  /%s: %s (%s) would overwrite a file of installed package %s\n", c->path,
+                    deb->package ? deb->package : "?", base, c->owner);
+        }
+    }
+    fclose(out);
+    return text;
+}
+
+/**
+ * @brief Frees a scan.
+ */
+void upkg_conflict_free(upkg_conflict_scan_t *scan) {
+    if (!scan) return;
+    for (int i = 0; i < scan->deb_count; i++) {
+        upkg_conflict_deb_t *deb = &scan->debs[i];
+        for (int j = 0; j < deb->entry_count; j++) {
+            free((char *)deb->entries[j].path);
+        }
+        free(deb->entries);
+        free(deb->package);
+    }
+    free(scan->debs);
+    for (int i = 0; i < scan->conflict_count; i++) {
+        free(scan->conflicts[i].path);
+        free(scan->conflicts[i].owner);
+    }
+    free(scan->conflicts);
+    memset(scan, 0, sizeof(*scan));
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Filename:    upkg_conflict.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: File-conflict detection across a group of package installs
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_CONFLICT_H
+#define UPKG_CONFLICT_H
+
+#include "upkg_repack.h"
+
+/*
+ * Before a group of .debs is installed, worker threads read their tar
+ * headers (upkg_repack_walk_deb) and insert every payload path into one
+ * path set, sharded by hash with a lock per shard. A path that another
+ * package of the group already inserted is a conflict, as is a path the
+ * ownership index (upkg_db_path_index) gives to an installed package that
+ * is neither the one being upgraded nor removed by the same group.
+ * Directories are shared freely. Two versions of one package in the group
+ * do not conflict; the later simply upgrades the earlier.
+ *
+ * The headers read here are kept, so later checks (upkg_space.h) need not
+ * decode the archives again.
+ */
+
+// --- Configuration ---
+#define UPKG_CONFLICT_MAX_THREADS 16
+#define UPKG_CONFLICT_SHARDS 64
+
+// --- Scan Structures ---
+
+typedef struct {
+    const char *deb_path;
+    char *package;                 // Package field of the control file, or NULL
+    upkg_deb_entry_t *entries;     // Every entry in archive order; paths owned here, data NULL
+    int entry_count;
+    int entry_capacity;
+} upkg_conflict_deb_t;
+
+typedef struct {
+    char *path;                    // Relative to the install root
+    int deb;                       // Incoming package (index into debs)
+    int other_deb;                 // A later incoming package shipping the path, or -1
+    char *owner;                   // Installed owner when other_deb is -1
+} upkg_conflict_t;
+
+typedef struct {
+    upkg_conflict_deb_t *debs;     // One per package, in the order given
+    int deb_count;
+    upkg_conflict_t *conflicts;    // Sorted by path
+    int conflict_count;
+    int conflict_capacity;
+} upkg_conflict_scan_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Reads a group of packages in parallel and collects file conflicts
+ *        among them and with installed packages.
+ * @param deb_paths The package files.
+ * @param count The number of packages.
+ * @param removals Packages the same group removes; their files are free to take.
+ * @param removal_count The number of removals.
+ * @param scan Output; free with upkg_conflict_free.
+ * @return 0 on success (check scan->conflict_count), -1 if a package could not be read.
+ */
+int upkg_conflict_scan(const char *const *deb_paths, int count, const char *const *removals,
+                       int removal_count, upkg_conflict_scan_t *scan);
+
+/**
+ * @brief Formats a scan's conflicts, one line each.
+ * @param scan The scan.
+ * @return A newly allocated string, or NULL on allocation failure.
+ */
+char *upkg_conflict_describe(const upkg_conflict_scan_t *scan);
+
+/**
+ * @brief Frees a scan.
+ * @param scan The scan.
+ */
+void upkg_conflict_free(upkg_conflict_scan_t *scan);
+
+#endif // UPKG_CONFLICT_H
@@ -0,0 +1,555 @@
+/******************************************************************************
+ * Filename:    upkg_cpu.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Runtime CPU feature detection and kernel dispatch for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_cpu.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif
+
+// --- Feature Names ---
+
+static const struct {
+    unsigned int bit;
+    const char *name;
+} cpu_feature_names[] = {
+    { UPKG_CPU_SSE42, "sse4.2" },
+    { UPKG_CPU_AVX2, "avx2" },
+    { UPKG_CPU_AVX512BW, "avx512bw" },
+    { UPKG_CPU_NEON, "neon" },
+    { UPKG_CPU_CRC32, "crc32" },
+    { UPKG_CPU_SVE, "sve" },
+};
+
+#define CPU_FEATURE_COUNT (sizeof(cpu_feature_names) / sizeof(cpu_feature_names[0]))
+
+// --- CRC-32C Kernels ---
+
+#define CRC32C_POLY 0x82F63B78u     // Castagnoli, reflected
+
+static uint32_t crc32c_table[8][256];
+
+/**
+ * @brief Builds the slicing-by-8 CRC-32C tables.
+ */
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[t - 1][i] & 0xFF];
+        }
+    }
+}
+
+/**
+ * @brief Portable CRC-32C, eight bytes per step (slicing-by-8).
+ */
+static uint32_t crc32c_scalar(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][p[4]] ^ crc32c_table[2][p[5]] ^ crc32c_table[1][p[6]] ^ crc32c_table[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+    }
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief CRC-32C with the SSE4.2 crc32 instruction.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint64_t c = ~crc;
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+    }
+    return ~(uint32_t)c;
+}
+#elif defined(__aarch64__)
+/**
+ * @brief CRC-32C with the ARMv8 CRC32 extension.
+ */
+__attribute__((target("+crc")))
+static uint32_t crc32c_armv8(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = __crc32cb(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return ~crc;
+}
+#endif
+
+// --- Byte Counting Kernels ---
+
+/**
+ * @brief Portable byte count.
+ */
+static size_t count_byte_scalar(const void *data, int c, size_t len) {
+    const uint8_t *p = data;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n += p[i] == (uint8_t)c;
+    }
+    return n;
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief Byte count over 32-byte AVX2 compares.
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t count_byte_avx2(const void *data, int c, size_t len) {
+    const uint8_t *p = data;
+    size_t n = 0;
+    __m256i needle = _mm256_set1_epi8((char)c);
+    while (len >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        n += (size_t)__builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+        p += 32;
+        len -= 32;
+    }
+    return n + count_byte_scalar(p, c, len);
+}
+
+/**
+ * @brief Byte count over 64-byte AVX-512BW compares.
+ */
+__attribute__((target("avx512bw,popcnt")))
+static size_t count_byte_avx512bw(const void *data, int c, size_t len) {
+    const uint8_t *p = data;
+    size_t n = 0;
+    __m512i needle = _mm512_set1_epi8((char)c);
+    while (len >= 64) {
+        __mmask64 eq = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)p), needle);
+        n += (size_t)__builtin_popcountll(eq);
+        p += 64;
+        len -= 64;
+    }
+    return n + count_byte_scalar(p, c, len);
+}
+#elif defined(__aarch64__)
+/**
+ * @brief Byte count over 16-byte NEON compares, summed in 8-bit lanes.
+ */
+static size_t count_byte_neon(const void *data, int c, size_t len) {
+    const uint8_t *p = data;
+    size_t n = 0;
+    uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+    while (len >= 16) {
+        // A lane holds at most 255 matches before it wraps
+        size_t blocks = len / 16 > 255 ? 255 : len / 16;
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (size_t b = 0; b < blocks; b++) {
+            acc = vsubq_u8(acc, vceqq_u8(vld1q_u8(p), needle));   // a match is 0xFF, i.e. -1
+            p += 16;
+        }
+        n += vaddlvq_u8(acc);
+        len -= blocks * 16;
+    }
+    return n + count_byte_scalar(p, c, len);
+}
+#endif
+
+// --- JSON Escape Scanning Kernels ---
+
+#define JSON_NEEDS_ESCAPE(b) ((b) < 0x20 || (b) == '"' || (b) == '\\')
+
+/**
+ * @brief Portable scan for the first byte a JSON string must escape.
+ */
+static size_t json_plain_scalar(const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        if (JSON_NEEDS_ESCAPE(p[i])) return i;
+    }
+    return len;
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief Escape scan over 32-byte AVX2 compares.
+ */
+__attribute__((target("avx2,bmi")))
+static size_t json_plain_avx2(const void *data, size_t len) {
+    const uint8_t *p = data;
+    size_t i = 0;
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        // Unsigned v <= 0x1F exactly when min(v, 0x1F) == v
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                      _mm256_cmpeq_epi8(v, backslash)));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + json_plain_scalar(p + i, len - i);
+}
+#elif defined(__aarch64__)
+/**
+ * @brief Escape scan over 16-byte NEON compares; the hit is located in scalar.
+ */
+static size_t json_plain_neon(const void *data, size_t len) {
+    const uint8_t *p = data;
+    size_t i = 0;
+    const uint8x16_t control = vdupq_n_u8(0x20);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        uint8x16_t hit = vorrq_u8(vcltq_u8(v, control), vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+        if (vmaxvq_u8(hit)) return i + json_plain_scalar(p + i, 16);
+    }
+    return i + json_plain_scalar(p + i, len - i);
+}
+#endif
+
+// --- Implementation Tables (best first) ---
+
+typedef struct {
+    const char *name;
+    unsigned int requires;
+    uint32_t (*fn)(uint32_t crc, const void *data, size_t len);
+} crc32c_impl_t;
+
+typedef struct {
+    const char *name;
+    unsigned int requires;
+    size_t (*fn)(const void *data, int c, size_t len);
+} count_byte_impl_t;
+
+typedef struct {
+    const char *name;
+    unsigned int requires;
+    size_t (*fn)(const void *data, size_t len);
+} json_plain_impl_t;
+
+static const crc32c_impl_t crc32c_impls[] = {
+#if defined(__x86_64__)
+    { "sse4.2", UPKG_CPU_SSE42, crc32c_sse42 },
+#elif defined(__aarch64__)
+    { "crc32", UPKG_CPU_CRC32, crc32c_armv8 },
+#endif
+    { "scalar", 0, crc32c_scalar },
+};
+
+static const count_byte_impl_t count_byte_impls[] = {
+#if defined(__x86_64__)
+    { "avx512bw", UPKG_CPU_AVX512BW, count_byte_avx512bw },
+    { "avx2", UPKG_CPU_AVX2, count_byte_avx2 },
+#elif defined(__aarch64__)
+    { "neon", UPKG_CPU_NEON, count_byte_neon },
+#endif
+    { "scalar", 0, count_byte_scalar },
+};
+
+static const json_plain_impl_t json_plain_impls[] = {
+#if defined(__x86_64__)
+    { "avx2", UPKG_CPU_AVX2, json_plain_avx2 },
+#elif defined(__aarch64__)
+    { "neon", UPKG_CPU_NEON, json_plain_neon },
+#endif
+    { "scalar", 0, json_plain_scalar },
+};
+
+#define IMPL_COUNT(table) (sizeof(table) / sizeof((table)[0]))
+
+// --- Detection and Dispatch ---
+
+static unsigned int g_detected = 0;
+static unsigned int g_enabled = 0;
+static upkg_cpu_kernels_t g_kernels;
+static pthread_once_t g_cpu_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Queries the CPU (x86-64) or the kernel's hwcaps (arm64).
+ */
+static unsigned int cpu_detect(void) {
+    unsigned int features = 0;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) features |= UPKG_CPU_SSE42;
+    if (__builtin_cpu_supports("avx2")) features |= UPKG_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512bw")) features |= UPKG_CPU_AVX512BW;
+#elif defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    features |= UPKG_CPU_NEON;   // mandatory in AArch64
+#ifdef HWCAP_CRC32
+    if (hwcap & HWCAP_CRC32) features |= UPKG_CPU_CRC32;
+#endif
+#ifdef HWCAP_SVE
+    if (hwcap & HWCAP_SVE) features |= UPKG_CPU_SVE;
+#endif
+    (void)hwcap;
+#endif
+    return features;
+}
+
+/**
+ * @brief Applies UPKG_CPU_FEATURES to the detected set.
+ */
+static unsigned int cpu_apply_override(unsigned int detected) {
+    const char *env = getenv("UPKG_CPU_FEATURES");
+    if (!env || *env == '\0') return detected;
+
+    char *copy = strdup(env);
+    if (!copy) return detected;
+
+    unsigned int allow = 0, deny = 0;
+    bool restrict_to = false;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(copy, ", ", &saveptr); tok; tok = strtok_r(NULL, ", ", &saveptr)) {
+        bool off = *tok == '-';
+        if (off) tok++;
+        if (strcmp(tok, "none") == 0 || strcmp(tok, "scalar") == 0) {
+            restrict_to = true;
+            continue;
+        }
+        unsigned int bit = 0;
+        for (size_t i = 0; i < CPU_FEATURE_COUNT; i++) {
+            if (strcmp(tok, cpu_feature_names[i].name) == 0) bit = cpu_feature_names[i].bit;
+        }
+        if (!bit) {
+            upkg_util_error("Ignoring unknown CPU feature '%s' in UPKG_CPU_FEATURES.\n", tok);
+        } else if (off) {
+            deny |= bit;
+        } else {
+            allow |= bit;
+            restrict_to = true;
+        }
+    }
+    free(copy);
+
+    unsigned int enabled = (restrict_to ? detected & allow : detected) & ~deny;
+    upkg_util_log_verbose("UPKG_CPU_FEATURES=%s: enabled mask 0x%x of 0x%x\n", env, enabled, detected);
+    return enabled;
+}
+
+/**
+ * @brief Detects features and fills the kernel table.
+ */
+static void cpu_init(void) {
+    crc32c_init_table();
+    g_detected = cpu_detect();
+    g_enabled = cpu_apply_override(g_detected);
+
+    for (size_t i = 0; i < IMPL_COUNT(crc32c_impls); i++) {
+        if ((crc32c_impls[i].requires & g_enabled) == crc32c_impls[i].requires) {
+            g_kernels.crc32c = crc32c_impls[i].fn;
+            g_kernels.crc32c_impl = crc32c_impls[i].name;
+            break;
+        }
+    }
+    for (size_t i = 0; i < IMPL_COUNT(count_byte_impls); i++) {
+        if ((count_byte_impls[i].requires & g_enabled) == count_byte_impls[i].requires) {
+            g_kernels.count_byte = count_byte_impls[i].fn;
+            g_kernels.count_byte_impl = count_byte_impls[i].name;
+            break;
+        }
+    }
+    for (size_t i = 0; i < IMPL_COUNT(json_plain_impls); i++) {
+        if ((json_plain_impls[i].requires & g_enabled) == json_plain_impls[i].requires) {
+            g_kernels.json_plain = json_plain_impls[i].fn;
+            g_kernels.json_plain_impl = json_plain_impls[i].name;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Returns the features the CPU supports, ignoring UPKG_CPU_FEATURES.
+ */
+unsigned int upkg_cpu_detected(void) {
+    pthread_once(&g_cpu_once, cpu_init);
+    return g_detected;
+}
+
+/**
+ * @brief Returns the features kernels may use.
+ */
+unsigned int upkg_cpu_enabled(void) {
+    pthread_once(&g_cpu_once, cpu_init);
+    return g_enabled;
+}
+
+/**
+ * @brief Returns the kernels selected for the enabled features.
+ */
+const upkg_cpu_kernels_t *upkg_cpu_kernels(void) {
+    pthread_once(&g_cpu_once, cpu_init);
+    return &g_kernels;
+}
+
+/**
+ * @brief Counts occurrences of a byte.
+ */
+size_t upkg_cpu_count_byte(const void *data, int c, size_t len) {
+    return upkg_cpu_kernels()->count_byte(data, c, len);
+}
+
+/**
+ * @brief Measures the run of bytes a JSON string can hold unescaped.
+ */
+size_t upkg_cpu_json_plain(const void *data, size_t len) {
+    return upkg_cpu_kernels()->json_plain(data, len);
+}
+
+// --- Report and Self-Check ---
+
+/**
+ * @brief Prints the names of the features in a mask.
+ */
+static void print_features(const char *label, unsigned int mask) {
+    printf("  %-10s", label);
+    if (mask == 0) printf(" (none)");
+    for (size_t i = 0; i < CPU_FEATURE_COUNT; i++) {
+        if (mask & cpu_feature_names[i].bit) printf(" %s", cpu_feature_names[i].name);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Prints features and selected kernels, then checks every runnable
+ *        kernel against the scalar one over varied lengths and alignments.
+ */
+int upkg_cpu_report(void) {
+    const upkg_cpu_kernels_t *k = upkg_cpu_kernels();
+
+    printf("CPU features:\n");
+    print_features("detected:", g_detected);
+    print_features("enabled:", g_enabled);
+    printf("Kernels:\n");
+    printf("  %-10s %s\n", "crc32c", k->crc32c_impl);
+    printf("  %-10s %s\n", "count_byte", k->count_byte_impl);
+    printf("  %-10s %s\n", "json_plain", k->json_plain_impl);
+
+    // Pseudo-random bytes with plenty of newlines for count_byte
+    static uint8_t buf[4096 + 64];
+    uint32_t seed = 0x9E3779B9u;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = (seed >> 24) % 5 == 0 ? '\n' : (uint8_t)(seed >> 16);
+    }
+    static const size_t lengths[] = { 0, 1, 7, 8, 15, 16, 31, 33, 63, 64, 65, 127, 1000, 4096 };
+
+    int failures = 0;
+    printf("Self-check:\n");
+    for (size_t i = 0; i < IMPL_COUNT(crc32c_impls); i++) {
+        if ((crc32c_impls[i].requires & g_detected) != crc32c_impls[i].requires) continue;
+        bool ok = crc32c_impls[i].fn(0, "123456789", 9) == 0xE3069283u;   // RFC 3720 check value
+        for (size_t off = 0; ok && off < 8; off++) {
+            for (size_t l = 0; ok && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+                uint32_t expect = crc32c_scalar(0x12345678u, buf + off, lengths[l]);
+                ok = crc32c_impls[i].fn(0x12345678u, buf + off, lengths[l]) == expect;
+            }
+        }
+        printf("  %-10s %-9s %s\n", "crc32c", crc32c_impls[i].name, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    for (size_t i = 0; i < IMPL_COUNT(count_byte_impls); i++) {
+        if ((count_byte_impls[i].requires & g_detected) != count_byte_impls[i].requires) continue;
+        bool ok = true;
+        for (size_t off = 0; ok && off < 8; off++) {
+            for (size_t l = 0; ok && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+                ok = count_byte_impls[i].fn(buf + off, '\n', lengths[l]) ==
+                     count_byte_scalar(buf + off, '\n', lengths[l]);
+            }
+        }
+        printf("  %-10s %-9s %s\n", "count_byte", count_byte_impls[i].name, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+
+    // Text that needs no escaping, including UTF-8 bytes, with one escapable byte moved through it
+    static uint8_t text[4096 + 64];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = JSON_NEEDS_ESCAPE(buf[i]) ? 'x' : buf[i];
+    }
+    static const uint8_t escapes[] = { '"', '\\', '\n', 0x00, 0x1F };
+    for (size_t i = 0; i < IMPL_COUNT(json_plain_impls); i++) {
+        if ((json_plain_impls[i].requires & g_detected) != json_plain_impls[i].requires) continue;
+        bool ok = true;
+        for (size_t off = 0; ok && off < 8; off++) {
+            for (size_t l = 0; ok && l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+                for (size_t at = 0; ok && at < sizeof(lengths) / sizeof(lengths[0]); at++) {
+                    uint8_t saved = text[off + lengths[at]];
+                    text[off + lengths[at]] = escapes[(l + at) % sizeof(escapes)];
+                    ok = json_plain_impls[i].fn(text + off, lengths[l]) == json_plain_scalar(text + off, lengths[l]);
+                    text[off + lengths[at]] = saved;
+                }
+            }
+        }
+        printf("  %-10s %-9s %s\n", "json_plain", json_plain_impls[i].name, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    return failures ? -1 : 0;
+}
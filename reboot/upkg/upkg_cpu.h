@@ -0,0 +1,107 @@
+/******************************************************************************
+ * Filename:    upkg_cpu.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Runtime CPU feature detection and kernel dispatch for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_CPU_H
+#define UPKG_CPU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * upkg is built for the baseline ISA (x86-64, armv8-a). Kernels that gain
+ * from wider instructions are compiled for each feature level with target
+ * attributes and picked once, at first use, from what the CPU and kernel
+ * report. Every kernel has a scalar fallback.
+ *
+ * UPKG_CPU_FEATURES narrows the selection for testing and for working
+ * around a misbehaving path: "none" forces the scalar kernels, a
+ * comma-separated list (e.g. "sse4.2") enables only those features, and a
+ * "-" prefix (e.g. "-avx512bw") disables one. Features the CPU lacks
+ * cannot be forced on.
+ */
+
+// --- Feature Bits ---
+#define UPKG_CPU_SSE42     (1u << 0)   // x86-64: crc32 instruction
+#define UPKG_CPU_AVX2      (1u << 1)
+#define UPKG_CPU_AVX512BW  (1u << 2)
+#define UPKG_CPU_NEON      (1u << 3)   // arm64: Advanced SIMD
+#define UPKG_CPU_CRC32     (1u << 4)   // arm64: CRC32/CRC32C instructions
+#define UPKG_CPU_SVE       (1u << 5)
+
+// --- Kernel Table ---
+typedef struct {
+    uint32_t (*crc32c)(uint32_t crc, const void *data, size_t len);   // see upkg_digest_crc32c
+    size_t (*count_byte)(const void *data, int c, size_t len);
+    size_t (*json_plain)(const void *data, size_t len);                // see upkg_cpu_json_plain
+    const char *crc32c_impl;
+    const char *count_byte_impl;
+    const char *json_plain_impl;
+} upkg_cpu_kernels_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Returns the features the CPU supports, ignoring UPKG_CPU_FEATURES.
+ * @return A mask of UPKG_CPU_* bits.
+ */
+unsigned int upkg_cpu_detected(void);
+
+/**
+ * @brief Returns the features kernels may use: the detected set narrowed
+ *        by UPKG_CPU_FEATURES.
+ * @return A mask of UPKG_CPU_* bits.
+ */
+unsigned int upkg_cpu_enabled(void);
+
+/**
+ * @brief Returns the kernels selected for the enabled features.
+ * @return The kernel table; valid for the life of the process.
+ */
+const upkg_cpu_kernels_t *upkg_cpu_kernels(void);
+
+/**
+ * @brief Counts occurrences of a byte, e.g. newlines to size a line array.
+ * @param data The bytes to search.
+ * @param c The byte value to count.
+ * @param len The number of bytes in data.
+ * @return The number of bytes in data equal to c.
+ */
+size_t upkg_cpu_count_byte(const void *data, int c, size_t len);
+
+/**
+ * @brief Measures the run of bytes a JSON string can hold unescaped: stops
+ *        at the first control character (< 0x20), '"' or '\\'.
+ * @param data The bytes to scan.
+ * @param len The number of bytes in data.
+ * @return The length of the leading run, len if nothing needs escaping.
+ */
+size_t upkg_cpu_json_plain(const void *data, size_t len);
+
+/**
+ * @brief Prints the detected and enabled features and the selected kernels,
+ *        then checks every kernel the CPU can run against the scalar one.
+ * @return 0 if every kernel agrees with the scalar result, -1 otherwise.
+ */
+int upkg_cpu_report(void);
+
+#endif // UPKG_CPU_H
@@ -0,0 +1,645 @@
+/******************************************************************************
+ * Filename:    upkg_daemon.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: upkgd, the live modification tracker for package-owned files
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_daemon.h"
+#include "upkg_config.h"
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_hash.h"
+#include "upkg_manifest.h"
+#include "upkg_metrics.h"
+#include "upkg_util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// --- Tracker State ---
+
+typedef struct {
+    char *name;
+    upkg_manifest_t manifest;
+    bool refreshed;                   // Manifest has stat updates to write back
+} tracked_package_t;
+
+typedef struct {
+    upkg_manifest_entry_t *entry;     // Owned by the package's manifest
+    tracked_package_t *package;
+    upkg_file_status_t status;
+    bool dirty;                       // An event arrived since the last check
+} tracked_file_t;
+
+static struct {
+    const char *root;                 // Install root as configured
+    char *real_root;                  // Canonical root, for fanotify's absolute paths
+    size_t real_root_len;
+
+    tracked_package_t *packages;
+    int package_count;
+    tracked_file_t *files;
+    size_t file_count;
+    tracked_file_t **slots;           // Open-addressed path lookup
+    size_t slot_mask;
+    tracked_file_t **dirty;
+    size_t dirty_count;
+    size_t dirty_capacity;
+
+    char **watch_dirs;                // inotify wd -> directory relative to root
+    int watch_capacity;
+    uint32_t inotify_mask;
+
+    int inotify_fd;
+    int fanotify_fd;
+    int listen_fd;
+    int signal_fd;
+    int epoll_fd;
+} g_tracker;
+
+/**
+ * @brief Builds the daemon socket path.
+ * @param addr Output socket address.
+ * @return 0 on success, -1 if unconfigured or too long.
+ */
+static int daemon_socket_address(struct sockaddr_un *addr) {
+    if (!g_upkg_base_dir) {
+        upkg_util_error("upkg_dir not configured; cannot locate the daemon socket.\n");
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%s", g_upkg_base_dir,
+                 UPKG_DAEMON_SOCKET_NAME) >= (int)sizeof(addr->sun_path)) {
+        upkg_util_error("Daemon socket path under '%s' is too long.\n", g_upkg_base_dir);
+        return -1;
+    }
+    return 0;
+}
+
+// --- File Table ---
+
+/**
+ * @brief Finds the tracked file for an install-root relative path.
+ * @param path The relative path.
+ * @return The tracked file, or NULL if no package owns the path.
+ */
+static tracked_file_t *tracker_find(const char *path) {
+    if (!g_tracker.slots) return NULL;
+
+    for (size_t i = upkg_hash_fnv1a(path) & g_tracker.slot_mask;; i = (i + 1) & g_tracker.slot_mask) {
+        tracked_file_t *tf = g_tracker.slots[i];
+        if (!tf) return NULL;
+        if (strcmp(tf->entry->path, path) == 0) return tf;
+    }
+}
+
+/**
+ * @brief Queues a tracked file for rechecking.
+ * @param tf The tracked file.
+ */
+static void tracker_mark_dirty(tracked_file_t *tf) {
+    if (tf->dirty) return;
+
+    if (g_tracker.dirty_count >= g_tracker.dirty_capacity) {
+        size_t capacity = g_tracker.dirty_capacity ? g_tracker.dirty_capacity * 2 : 64;
+        tracked_file_t **dirty = realloc(g_tracker.dirty, capacity * sizeof(tracked_file_t *));
+        if (!dirty) {
+            upkg_util_error("Failed to grow the dirty queue.\n");
+            return;
+        }
+        g_tracker.dirty = dirty;
+        g_tracker.dirty_capacity = capacity;
+    }
+    tf->dirty = true;
+    g_tracker.dirty[g_tracker.dirty_count++] = tf;
+}
+
+/**
+ * @brief Queues every tracked file below a directory (or all files for "").
+ * @param dir The directory, relative to the install root.
+ */
+static void tracker_mark_prefix_dirty(const char *dir) {
+    size_t len = strlen(dir);
+    for (size_t i = 0; i < g_tracker.file_count; i++) {
+        const char *path = g_tracker.files[i].entry->path;
+        if (len == 0 || (strncmp(path, dir, len) == 0 && path[len] == '/')) {
+            tracker_mark_dirty(&g_tracker.files[i]);
+        }
+    }
+}
+
+/**
+ * @brief Rechecks every dirty file and writes back refreshed manifests.
+ */
+static void tracker_flush(void) {
+    for (size_t i = 0; i < g_tracker.dirty_count; i++) {
+        tracked_file_t *tf = g_tracker.dirty[i];
+        bool rehashed, refreshed;
+        tf->status = upkg_manifest_check_entry(tf->entry, &tf->package->manifest.snapshot,
+                                               g_tracker.root, &rehashed, &refreshed);
+        tf->package->refreshed |= refreshed;
+        tf->dirty = false;
+    }
+    g_tracker.dirty_count = 0;
+
+    bool locked = false;
+    for (int i = 0; i < g_tracker.package_count; i++) {
+        tracked_package_t *pkg = &g_tracker.packages[i];
+        if (pkg->refreshed) {
+            if (!locked && upkg_db_lock() != 0) return;
+            locked = true;
+            upkg_manifest_write(pkg->name, &pkg->manifest);
+            pkg->refreshed = false;
+        }
+    }
+    if (locked) upkg_db_unlock();
+}
+
+// --- Watches ---
+
+/**
+ * @brief Adds an inotify watch on an owned directory.
+ * @param dir The directory, relative to the install root ("" for the root).
+ */
+static void tracker_watch_dir(const char *dir) {
+    char *path = (*dir != '\0') ? upkg_util_concat_path(g_tracker.root, dir) : strdup(g_tracker.root);
+    if (!path) return;
+
+    int wd = inotify_add_watch(g_tracker.inotify_fd, path, g_tracker.inotify_mask | IN_ONLYDIR);
+    if (wd < 0) {
+        upkg_util_log_verbose("Cannot watch %s: %s\n", path, strerror(errno));
+        free(path);
+        return;
+    }
+    free(path);
+
+    if (wd >= g_tracker.watch_capacity) {
+        int capacity = g_tracker.watch_capacity ? g_tracker.watch_capacity : 64;
+        while (capacity <= wd) capacity *= 2;
+        char **dirs = realloc(g_tracker.watch_dirs, (size_t)capacity * sizeof(char *));
+        if (!dirs) return;
+        memset(dirs + g_tracker.watch_capacity, 0, (size_t)(capacity - g_tracker.watch_capacity) * sizeof(char *));
+        g_tracker.watch_dirs = dirs;
+        g_tracker.watch_capacity = capacity;
+    }
+    if (!g_tracker.watch_dirs[wd]) {
+        g_tracker.watch_dirs[wd] = strdup(dir);
+    }
+}
+
+/**
+ * @brief Tries to put a fanotify mount mark on the install root.
+ * @return The fanotify descriptor, or -1 if not permitted or unsupported.
+ */
+static int tracker_setup_fanotify(void) {
+    int fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fd < 0) {
+        upkg_util_log_verbose("fanotify unavailable (%s); using inotify for data writes.\n", strerror(errno));
+        return -1;
+    }
+    if (fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_MOUNT, FAN_MODIFY | FAN_CLOSE_WRITE, AT_FDCWD, g_tracker.root) != 0) {
+        upkg_util_log_verbose("fanotify mount mark refused (%s); using inotify for data writes.\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// --- Loading ---
+
+/**
+ * @brief Releases all tracking state except the long-lived descriptors.
+ */
+static void tracker_unload(void) {
+    for (int wd = 0; wd < g_tracker.watch_capacity; wd++) {
+        if (g_tracker.watch_dirs[wd]) {
+            inotify_rm_watch(g_tracker.inotify_fd, wd);
+            free(g_tracker.watch_dirs[wd]);
+        }
+    }
+    free(g_tracker.watch_dirs);
+    g_tracker.watch_dirs = NULL;
+    g_tracker.watch_capacity = 0;
+
+    for (int i = 0; i < g_tracker.package_count; i++) {
+        free(g_tracker.packages[i].name);
+        upkg_manifest_free(&g_tracker.packages[i].manifest);
+    }
+    free(g_tracker.packages);
+    free(g_tracker.files);
+    free(g_tracker.slots);
+    free(g_tracker.dirty);
+    g_tracker.packages = NULL;
+    g_tracker.package_count = 0;
+    g_tracker.files = NULL;
+    g_tracker.file_count = 0;
+    g_tracker.slots = NULL;
+    g_tracker.dirty = NULL;
+    g_tracker.dirty_count = 0;
+    g_tracker.dirty_capacity = 0;
+}
+
+/**
+ * @brief Loads every manifest, reconciles each file against its stat
+ *        snapshot and watches the owned directories.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int tracker_load(void) {
+    size_t package_total = upkg_main_hash_table ? upkg_main_hash_table->count : 0;
+    g_tracker.packages = calloc(package_total ? package_total : 1, sizeof(tracked_package_t));
+    if (!g_tracker.packages) return -1;
+
+    size_t file_total = 0;
+    for (size_t b = 0; upkg_main_hash_table && b < upkg_main_hash_table->size; b++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[b]; n; n = n->next) {
+            tracked_package_t *pkg = &g_tracker.packages[g_tracker.package_count];
+            if (upkg_manifest_read(n->data.package_name, &pkg->manifest) != 0) {
+                upkg_util_error("No manifest for %s; its files are not tracked.\n", n->data.package_name);
+                continue;
+            }
+            pkg->name = strdup(n->data.package_name);
+            file_total += (size_t)pkg->manifest.count;
+            g_tracker.package_count++;
+
+            for (int d = 0; d < n->data.dir_count; d++) {
+                tracker_watch_dir(n->data.dir_list[d]);
+            }
+        }
+    }
+    tracker_watch_dir("");
+
+    size_t slots = 16;
+    while (slots < file_total * 2) slots <<= 1;
+    g_tracker.files = calloc(file_total ? file_total : 1, sizeof(tracked_file_t));
+    g_tracker.slots = calloc(slots, sizeof(tracked_file_t *));
+    if (!g_tracker.files || !g_tracker.slots) return -1;
+    g_tracker.slot_mask = slots - 1;
+
+    for (int p = 0; p < g_tracker.package_count; p++) {
+        tracked_package_t *pkg = &g_tracker.packages[p];
+        for (int e = 0; e < pkg->manifest.count; e++) {
+            tracked_file_t *tf = &g_tracker.files[g_tracker.file_count];
+            tf->entry = &pkg->manifest.entries[e];
+            tf->package = pkg;
+            if (tracker_find(tf->entry->path)) {
+                continue; // Shared path: the first owner tracks it
+            }
+            size_t i = upkg_hash_fnv1a(tf->entry->path) & g_tracker.slot_mask;
+            while (g_tracker.slots[i]) i = (i + 1) & g_tracker.slot_mask;
+            g_tracker.slots[i] = tf;
+            g_tracker.file_count++;
+
+            // Reconcile: changes made while no daemon was running
+            tracker_mark_dirty(tf);
+        }
+    }
+    tracker_flush();
+
+    upkg_util_log_verbose("Tracking %zu files from %d packages.\n", g_tracker.file_count, g_tracker.package_count);
+    return 0;
+}
+
+/**
+ * @brief Re-reads the package database and rebuilds all tracking state.
+ * @return 0 on success, -1 on failure.
+ */
+static int tracker_reload(void) {
+    tracker_unload();
+    upkg_db_close();
+    if (upkg_main_hash_table) {
+        upkg_hash_destroy_table(upkg_main_hash_table);
+        upkg_main_hash_table = NULL;
+    }
+    if (upkg_db_load() != 0) return -1;
+    return tracker_load();
+}
+
+// --- Event Handling ---
+
+/**
+ * @brief Drains the inotify queue, marking affected files dirty.
+ */
+static void tracker_handle_inotify(void) {
+    char buffer[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[PATH_MAX];
+
+    for (;;) {
+        ssize_t len = read(g_tracker.inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) break;
+
+        for (char *ptr = buffer; ptr < buffer + len;) {
+            const struct inotify_event *ev = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + ev->len;
+            upkg_metrics_add(UPKG_METRIC_FS_EVENTS, 1);
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                tracker_mark_prefix_dirty("");
+                continue;
+            }
+            if (ev->wd < 0 || ev->wd >= g_tracker.watch_capacity || !g_tracker.watch_dirs[ev->wd]) {
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                upkg_util_free_and_null(&g_tracker.watch_dirs[ev->wd]);
+                continue;
+            }
+            if (ev->len == 0) continue;
+
+            const char *dir = g_tracker.watch_dirs[ev->wd];
+            if (*dir != '\0') {
+                snprintf(path, sizeof(path), "%s/%s", dir, ev->name);
+            } else {
+                snprintf(path, sizeof(path), "%s", ev->name);
+            }
+
+            if (ev->mask & IN_ISDIR) {
+                // A whole owned subtree appeared or vanished
+                if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && upkg_dirtab_find(path)) {
+                    tracker_watch_dir(path);
+                }
+                tracker_mark_prefix_dirty(path);
+                continue;
+            }
+
+            tracked_file_t *tf = tracker_find(path);
+            if (tf) tracker_mark_dirty(tf);
+        }
+    }
+}
+
+/**
+ * @brief Drains the fanotify queue, marking written files dirty.
+ */
+static void tracker_handle_fanotify(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    char link[64];
+    char path[PATH_MAX];
+
+    for (;;) {
+        ssize_t len = read(g_tracker.fanotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) break;
+
+        struct fanotify_event_metadata *md = (struct fanotify_event_metadata *)buffer;
+        for (; FAN_EVENT_OK(md, len); md = FAN_EVENT_NEXT(md, len)) {
+            if (md->vers != FANOTIFY_METADATA_VERSION) {
+                upkg_util_error("fanotify metadata version mismatch.\n");
+                return;
+            }
+            upkg_metrics_add(UPKG_METRIC_FS_EVENTS, 1);
+            if (md->mask & FAN_Q_OVERFLOW) {
+                tracker_mark_prefix_dirty("");
+                continue;
+            }
+            if (md->fd < 0) continue;
+
+            snprintf(link, sizeof(link), "/proc/self/fd/%d", md->fd);
+            ssize_t n = readlink(link, path, sizeof(path) - 1);
+            close(md->fd);
+            if (n <= 0) continue;
+            path[n] = '\0';
+
+            if (strncmp(path, g_tracker.real_root, g_tracker.real_root_len) != 0) continue;
+            const char *relative = path + g_tracker.real_root_len;
+            while (*relative == '/') relative++;
+
+            tracked_file_t *tf = tracker_find(relative);
+            if (tf) tracker_mark_dirty(tf);
+        }
+    }
+}
+
+/**
+ * @brief Answers one client request on a connected socket.
+ * @param client The connected client socket (closed on return).
+ */
+static void tracker_serve_client(int client) {
+    struct timeval timeout = { 1, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char request[512];
+    size_t used = 0;
+    while (used < sizeof(request) - 1) {
+        ssize_t n = read(client, request + used, sizeof(request) - 1 - used);
+        if (n <= 0) break;
+        used += (size_t)n;
+        if (memchr(request, '\n', used)) break;
+    }
+    request[used] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+
+    FILE *out = fdopen(client, "w");
+    if (!out) {
+        close(client);
+        return;
+    }
+
+    if (strcmp(request, "ping") == 0) {
+        fprintf(out, "pong\n");
+    } else if (strcmp(request, "metrics") == 0) {
+        upkg_metrics_write(out);
+    } else if (strcmp(request, "reload") == 0) {
+        fprintf(out, tracker_reload() == 0 ? "ok\n" : "error: reload failed\n");
+    } else if (strncmp(request, "modified", 8) == 0 && (request[8] == '\0' || request[8] == ' ')) {
+        const char *package = (request[8] == ' ') ? request + 9 : NULL;
+        tracker_flush();
+        for (size_t i = 0; i < g_tracker.file_count; i++) {
+            const tracked_file_t *tf = &g_tracker.files[i];
+            if (tf->status == UPKG_FILE_CLEAN) continue;
+            if (package && strcmp(package, tf->package->name) != 0) continue;
+            fprintf(out, "%-9s %s (%s)\n", upkg_manifest_status_name(tf->status), tf->entry->path, tf->package->name);
+        }
+    } else {
+        fprintf(out, "error: unknown request '%s'\n", request);
+    }
+    fclose(out);
+}
+
+// --- Public Functions ---
+
+/**
+ * @brief Runs the tracker in the foreground until SIGINT or SIGTERM.
+ * @return 0 on clean shutdown, -1 on startup failure.
+ */
+int upkg_daemon_run(void) {
+    struct sockaddr_un addr;
+    if (daemon_socket_address(&addr) != 0) return -1;
+    if (upkg_daemon_request("ping", NULL) == 0) {
+        upkg_util_error("upkgd is already running on %s\n", addr.sun_path);
+        return -1;
+    }
+
+    memset(&g_tracker, 0, sizeof(g_tracker));
+    g_tracker.inotify_fd = g_tracker.fanotify_fd = g_tracker.listen_fd = -1;
+    g_tracker.signal_fd = g_tracker.epoll_fd = -1;
+    g_tracker.root = g_system_install_root ? g_system_install_root : "/";
+    g_tracker.real_root = realpath(g_tracker.root, NULL);
+    if (!g_tracker.real_root) {
+        upkg_util_error("Cannot resolve install root '%s': %s\n", g_tracker.root, strerror(errno));
+        return -1;
+    }
+    g_tracker.real_root_len = strlen(g_tracker.real_root);
+    if (g_tracker.real_root_len == 1) g_tracker.real_root_len = 0; // "/" itself
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int ret = -1;
+    g_tracker.signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    g_tracker.inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    g_tracker.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_tracker.signal_fd < 0 || g_tracker.inotify_fd < 0 || g_tracker.epoll_fd < 0) {
+        upkg_util_error("Failed to set up event descriptors: %s\n", strerror(errno));
+        goto out;
+    }
+
+    // Namespace and metadata changes always come from inotify
+    g_tracker.inotify_mask = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    g_tracker.fanotify_fd = tracker_setup_fanotify();
+    if (g_tracker.fanotify_fd < 0) {
+        g_tracker.inotify_mask |= IN_MODIFY | IN_CLOSE_WRITE;
+    }
+
+    unlink(addr.sun_path);
+    g_tracker.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (g_tracker.listen_fd < 0 || bind(g_tracker.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        chmod(addr.sun_path, 0600) != 0 || listen(g_tracker.listen_fd, 16) != 0) {
+        upkg_util_error("Failed to listen on %s: %s\n", addr.sun_path, strerror(errno));
+        goto out;
+    }
+
+    if (tracker_load() != 0) {
+        upkg_util_error("Failed to build the tracking tables.\n");
+        goto out;
+    }
+
+    int fds[] = { g_tracker.signal_fd, g_tracker.inotify_fd, g_tracker.listen_fd, g_tracker.fanotify_fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] < 0) continue;
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = fds[i] };
+        epoll_ctl(g_tracker.epoll_fd, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+
+    printf("upkgd: tracking %zu files from %d packages via %s on %s\n", g_tracker.file_count,
+           g_tracker.package_count, g_tracker.fanotify_fd >= 0 ? "fanotify+inotify" : "inotify", addr.sun_path);
+    fflush(stdout);
+
+    bool running = true;
+    while (running) {
+        struct epoll_event events[8];
+        int timeout = g_tracker.dirty_count ? UPKG_DAEMON_SETTLE_MS : -1;
+        int n = epoll_wait(g_tracker.epoll_fd, events, 8, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            upkg_util_error("epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+        if (n == 0) {
+            tracker_flush(); // Events have settled
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == g_tracker.signal_fd) {
+                running = false;
+            } else if (fd == g_tracker.inotify_fd) {
+                tracker_handle_inotify();
+            } else if (fd == g_tracker.fanotify_fd) {
+                tracker_handle_fanotify();
+            } else if (fd == g_tracker.listen_fd) {
+                int client = accept4(g_tracker.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                if (client >= 0) tracker_serve_client(client);
+            }
+        }
+    }
+
+    tracker_flush();
+    printf("upkgd: shutting down\n");
+    ret = 0;
+
+out:
+    tracker_unload();
+    if (g_tracker.listen_fd >= 0) {
+        close(g_tracker.listen_fd);
+        unlink(addr.sun_path);
+    }
+    if (g_tracker.fanotify_fd >= 0) close(g_tracker.fanotify_fd);
+    if (g_tracker.inotify_fd >= 0) close(g_tracker.inotify_fd);
+    if (g_tracker.signal_fd >= 0) close(g_tracker.signal_fd);
+    if (g_tracker.epoll_fd >= 0) close(g_tracker.epoll_fd);
+    free(g_tracker.real_root);
+    g_tracker.real_root = NULL;
+    return ret;
+}
+
+/**
+ * @brief Sends a request to a running daemon and copies its reply.
+ * @param request The request line, without the trailing newline.
+ * @param out Where to write the reply (NULL discards it).
+ * @return 0 on success, -1 if no daemon is reachable.
+ */
+int upkg_daemon_request(const char *request, FILE *out) {
+    struct sockaddr_un addr;
+    if (!g_upkg_base_dir || daemon_socket_address(&addr) != 0) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t len = strlen(request);
+    if (write(fd, request, len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+        close(fd);
+        return -1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        if (out) fwrite(buffer, 1, (size_t)n, out);
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ * Filename:    upkg_daemon.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: upkgd, the live modification tracker for package-owned files
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_DAEMON_H
+#define UPKG_DAEMON_H
+
+#include <stdio.h>
+
+/*
+ * upkgd keeps a live "modified since install" set for every package-owned
+ * file. On startup it reconciles each file against its manifest's stat
+ * snapshot (see upkg_manifest.h), then follows filesystem events:
+ *
+ *   - fanotify with a mount mark on the install root reports data writes
+ *     anywhere on the mount, when the caller is permitted to use it;
+ *   - inotify on every owned directory reports deletes, renames and
+ *     attribute changes, and data writes too when fanotify is unavailable.
+ *
+ * Events only mark paths dirty; dirty paths are rechecked once the event
+ * stream goes quiet, or immediately before answering a query.
+ *
+ * Clients talk to <upkg_dir>/upkgd.sock with one-line requests:
+ *   "modified [package]"   list non-clean files, one "<status> <path> (<pkg>)" per line
+ *   "metrics"              Prometheus text exposition of the daemon's metrics
+ *   "reload"               re-read the package database after install/remove
+ *   "ping"                 liveness check
+ */
+
+// --- Daemon Configuration ---
+#define UPKG_DAEMON_SOCKET_NAME "upkgd.sock"
+#define UPKG_DAEMON_SETTLE_MS 200
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Runs the tracker in the foreground until SIGINT or SIGTERM.
+ * @return 0 on clean shutdown, -1 on startup failure.
+ */
+int upkg_daemon_run(void);
+
+/**
+ * @brief Sends a request to a running daemon and copies its reply.
+ * @param request The request line, without the trailing newline.
+ * @param out Where to write the reply (NULL discards it).
+ * @return 0 on success, -1 if no daemon is reachable.
+ */
+int upkg_daemon_request(const char *request, FILE *out);
+
+#endif // UPKG_DAEMON_H
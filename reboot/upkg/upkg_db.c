@@ -0,0 +1,395 @@
+/******************************************************************************
+ * Filename:    upkg_db.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Persistent package database and secondary indexes for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_du.h"
+#include "upkg_gen.h"
+#include "upkg_store.h"
+#include "upkg_snap.h"
+#include "upkg_metrics.h"
+#include "upkg_trace.h"
+#include "upkg_config.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// --- Global Variables ---
+upkg_index_t *upkg_soname_index = NULL;
+upkg_index_t *upkg_path_index = NULL;
+
+static upkg_store_t *g_store = NULL;
+static int g_lock_fd = -1;
+static int g_lock_depth = 0;
+
+// --- Load / Store ---
+
+/**
+ * @brief Returns the store holding the package records, opening it on first use.
+ * @return The store, or NULL if db_dir is not configured or unusable.
+ */
+static upkg_store_t *db_store(void) {
+    if (!g_store && g_db_dir) {
+        g_store = upkg_store_open(&upkg_store_dir_backend, g_db_dir);
+    }
+    return g_store;
+}
+
+/**
+ * @brief Adds one loaded record to the hash table and indexes.
+ */
+static int load_record(const upkg_hash_package_info_t *pkg_info, void *user) {
+    int *loaded = user;
+    if (upkg_hash_add_package(upkg_main_hash_table, pkg_info) == 0) {
+        upkg_db_index_package(pkg_info);
+        (*loaded)++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Loads every package record from db_dir into upkg_main_hash_table
+ *        and builds the secondary indexes.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_load(void) {
+    if (!g_db_dir) {
+        upkg_util_error("Database directory not configured.\n");
+        return -1;
+    }
+
+    if (!upkg_main_hash_table) {
+        upkg_main_hash_table = upkg_hash_create_table(INITIAL_HASH_TABLE_SIZE);
+        if (!upkg_main_hash_table) return -1;
+    }
+    if (!upkg_soname_index) {
+        upkg_soname_index = upkg_index_create(INITIAL_HASH_TABLE_SIZE);
+        if (!upkg_soname_index) return -1;
+    }
+
+    upkg_store_t *store = db_store();
+    if (!store) return -1;
+    int loaded = 0;
+    if (upkg_store_iterate(store, load_record, &loaded) < 0) return -1;
+
+    upkg_util_log_verbose("Loaded %d package records from %s\n", loaded, g_db_dir);
+    if (upkg_snap_publish(upkg_main_hash_table) != 0) return -1;
+    return upkg_dirtab_load();
+}
+
+/**
+ * @brief Frees the secondary indexes built by upkg_db_load.
+ */
+void upkg_db_close(void) {
+    upkg_du_invalidate();
+    upkg_dirtab_close();
+    upkg_store_close(g_store);
+    g_store = NULL;
+    if (upkg_path_index) {
+        upkg_index_destroy(upkg_path_index);
+        upkg_path_index = NULL;
+    }
+    if (upkg_soname_index) {
+        upkg_index_destroy(upkg_soname_index);
+        upkg_soname_index = NULL;
+    }
+}
+
+// --- Locking ---
+
+/**
+ * @brief Takes the exclusive database lock (<db_dir>/.lock), waiting if
+ *        another upkg process holds it. Nested calls are counted.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_lock(void) {
+    if (g_lock_depth > 0) {
+        g_lock_depth++;
+        return 0;
+    }
+
+    char *path = g_db_dir ? upkg_util_concat_path(g_db_dir, ".lock") : NULL;
+    if (!path) return -1;
+    g_lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (g_lock_fd < 0) {
+        upkg_util_error("Failed to open database lock '%s': %s\n", path, strerror(errno));
+        free(path);
+        return -1;
+    }
+
+    uint64_t start = upkg_metrics_now_ns();
+    if (flock(g_lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        upkg_util_log_verbose("Waiting for database lock %s...\n", path);
+        while (flock(g_lock_fd, LOCK_EX) != 0) {
+            if (errno != EINTR) {
+                upkg_util_error("Failed to lock '%s': %s\n", path, strerror(errno));
+                close(g_lock_fd);
+                g_lock_fd = -1;
+                free(path);
+                return -1;
+            }
+        }
+    }
+    upkg_metrics_observe_since(UPKG_METRIC_LOCK_WAIT_SECONDS, start);
+
+    free(path);
+    g_lock_depth = 1;
+    return 0;
+}
+
+/**
+ * @brief Releases one level of the database lock.
+ */
+void upkg_db_unlock(void) {
+    if (g_lock_depth == 0 || --g_lock_depth > 0) return;
+
+    flock(g_lock_fd, LOCK_UN);
+    close(g_lock_fd);
+    g_lock_fd = -1;
+}
+
+/**
+ * @brief Writes a package record to db_dir.
+ * @param pkg_info The package record to persist.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_store_package(const upkg_hash_package_info_t *pkg_info) {
+    if (!pkg_info || !g_db_dir) {
+        upkg_util_error("store_package: NULL package or database directory.\n");
+        return -1;
+    }
+    if (!upkg_store_valid_name(pkg_info->package_name)) {
+        upkg_util_error("Refusing to store package with unsafe name '%s'.\n",
+                        pkg_info->package_name ? pkg_info->package_name : "(null)");
+        return -1;
+    }
+    upkg_store_t *store = db_store();
+    if (!store) return -1;
+    uint64_t trace_start = UPKG_TRACE_NOW();
+
+    int ret = upkg_store_put(store, pkg_info);
+    if (ret == 0) ret = upkg_store_commit(store);
+    upkg_gen_mark_dirty(pkg_info->package_name);
+    UPKG_TRACE4(db__commit, pkg_info->package_name, (uint64_t)pkg_info->file_count, ret,
+                UPKG_TRACE_NOW() - trace_start);
+    return ret;
+}
+
+/**
+ * @brief Deletes a package record from db_dir.
+ * @param package_name The package whose record is removed.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_delete_package(const char *package_name) {
+    if (!upkg_store_valid_name(package_name) || !g_db_dir) {
+        upkg_util_error("Refusing to delete record with unsafe name '%s'.\n",
+                        package_name ? package_name : "(null)");
+        return -1;
+    }
+    upkg_store_t *store = db_store();
+    if (!store) return -1;
+    upkg_gen_mark_dirty(package_name);
+
+    int ret = upkg_store_delete(store, package_name);
+    if (ret == 0) ret = upkg_store_commit(store);
+    return ret;
+}
+
+// --- Soname Index ---
+
+/**
+ * @brief Returns the path ownership index, building it from the loaded
+ *        records on first use. Later index/unindex calls keep it current.
+ * @return The index, or NULL on allocation failure.
+ */
+upkg_index_t *upkg_db_path_index(void) {
+    if (upkg_path_index || !upkg_main_hash_table) {
+        return upkg_path_index;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < upkg_main_hash_table->size; i++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+            total += (size_t)n->data.file_count;
+        }
+    }
+
+    // Size for the final count up front so the build never rehashes
+    upkg_path_index = upkg_index_create((size_t)(total / GROW_LOAD_FACTOR_THRESHOLD) + 1);
+    if (!upkg_path_index) return NULL;
+
+    for (size_t i = 0; i < upkg_main_hash_table->size; i++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+            for (int f = 0; f < n->data.file_count; f++) {
+                upkg_index_insert(upkg_path_index, n->data.file_list[f], n->data.package_name);
+            }
+        }
+    }
+    upkg_util_log_verbose("Built path index with %zu entries\n", upkg_path_index->count);
+    return upkg_path_index;
+}
+
+/**
+ * @brief Adds a package's provided sonames (and, once built, its paths) to the indexes.
+ * @param pkg_info The package record.
+ */
+void upkg_db_index_package(const upkg_hash_package_info_t *pkg_info) {
+    if (!pkg_info || !pkg_info->package_name) return;
+
+    upkg_du_invalidate();
+    if (upkg_path_index) {
+        for (int i = 0; i < pkg_info->file_count; i++) {
+            upkg_index_insert(upkg_path_index, pkg_info->file_list[i], pkg_info->package_name);
+        }
+    }
+
+    if (!upkg_soname_index) {
+        upkg_soname_index = upkg_index_create(INITIAL_HASH_TABLE_SIZE);
+        if (!upkg_soname_index) return;
+    }
+    for (int i = 0; i < pkg_info->provided_soname_count; i++) {
+        upkg_index_insert(upkg_soname_index, pkg_info->provided_sonames[i], pkg_info->package_name);
+    }
+}
+
+/**
+ * @brief Removes a package's provided sonames and paths from the indexes.
+ * @param pkg_info The package record.
+ */
+void upkg_db_unindex_package(const upkg_hash_package_info_t *pkg_info) {
+    if (!pkg_info || !pkg_info->package_name) return;
+
+    upkg_du_invalidate();
+    if (upkg_path_index) {
+        for (int i = 0; i < pkg_info->file_count; i++) {
+            upkg_index_remove(upkg_path_index, pkg_info->file_list[i], pkg_info->package_name);
+        }
+    }
+    if (!upkg_soname_index) return;
+
+    for (int i = 0; i < pkg_info->provided_soname_count; i++) {
+        upkg_index_remove(upkg_soname_index, pkg_info->provided_sonames[i], pkg_info->package_name);
+    }
+}
+
+/**
+ * @brief Maps a Debian architecture to its multiarch library triplet.
+ * @param arch The Debian architecture name.
+ * @return The triplet, or NULL if unknown.
+ */
+static const char *multiarch_triplet(const char *arch) {
+    static const char *const map[][2] = {
+        { "amd64", "x86_64-linux-gnu" },
+        { "arm64", "aarch64-linux-gnu" },
+        { "armhf", "arm-linux-gnueabihf" },
+        { "armel", "arm-linux-gnueabi" },
+        { "i386", "i386-linux-gnu" },
+        { "riscv64", "riscv64-linux-gnu" },
+        { "ppc64el", "powerpc64le-linux-gnu" },
+        { "s390x", "s390x-linux-gnu" }
+    };
+    if (!arch) return NULL;
+    for (size_t i = 0; i < sizeof(map) / sizeof(map[0]); i++) {
+        if (strcmp(map[i][0], arch) == 0) {
+            return map[i][1];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks whether a soname exists in one of the install root's library directories.
+ * @param soname The soname to look for.
+ * @param arch The package architecture (selects the multiarch directories).
+ * @return true if a file with that name exists.
+ */
+static bool soname_in_library_dirs(const char *soname, const char *arch) {
+    static const char *const lib_dirs[] = { "lib", "lib64", "usr/lib", "usr/lib64", "usr/local/lib" };
+    const char *root = g_system_install_root ? g_system_install_root : "/";
+    const char *triplet = multiarch_triplet(arch);
+    char path[PATH_MAX];
+    struct stat st;
+
+    for (size_t i = 0; i < sizeof(lib_dirs) / sizeof(lib_dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s/%s", root, lib_dirs[i], soname);
+        if (stat(path, &st) == 0) return true;
+        if (triplet && i < 3) {
+            snprintf(path, sizeof(path), "%s/%s/%s/%s", root, lib_dirs[i], triplet, soname);
+            if (stat(path, &st) == 0) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reports needed sonames that neither an installed package nor the
+ *        install root's library directories provide.
+ * @param pkg_info The package record to check.
+ * @return The number of unsatisfied sonames.
+ */
+int upkg_db_check_shlibs(const upkg_hash_package_info_t *pkg_info) {
+    if (!pkg_info) return 0;
+
+    int unsatisfied = 0;
+    for (int i = 0; i < pkg_info->needed_soname_count; i++) {
+        const char *soname = pkg_info->needed_sonames[i];
+        if (upkg_index_find(upkg_soname_index, soname)) {
+            continue; // Indexed provider: the common, stat-free case
+        }
+        if (soname_in_library_dirs(soname, pkg_info->architecture)) {
+            continue;
+        }
+        printf("Warning: %s needs %s, which no installed package provides.\n",
+               pkg_info->package_name, soname);
+        unsatisfied++;
+    }
+    return unsatisfied;
+}
+
+/**
+ * @brief Prints the installed packages that provide a soname.
+ * @param soname The soname to look up, e.g. "libfoo.so.3".
+ * @return The number of providers found.
+ */
+int upkg_db_print_soname_providers(const char *soname) {
+    int providers = 0;
+    for (upkg_index_entry_t *e = upkg_index_find(upkg_soname_index, soname); e; e = upkg_index_next_match(e)) {
+        printf("%s: %s\n", e->value, soname);
+        providers++;
+    }
+    if (providers == 0) {
+        printf("No installed package provides %s\n", soname);
+    }
+    return providers;
+}
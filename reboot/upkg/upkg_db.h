@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Filename:    upkg_db.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Persistent package database and secondary indexes for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_DB_H
+#define UPKG_DB_H
+
+#include "upkg_hash.h"
+#include "upkg_index.h"
+
+/*
+ * On-disk layout (one directory per installed package under db_dir):
+ *
+ *   <db_dir>/<package>/control   "Field: value" lines (Package, Version, ...)
+ *   <db_dir>/<package>/files     installed paths, one per line
+ *   <db_dir>/<package>/sonames   DT_SONAMEs the package provides, one per line
+ *   <db_dir>/<package>/needed    DT_NEEDED sonames the package requires, one per line
+ *   <db_dir>/<package>/dirs      directories the package ships, parents first
+ *   <db_dir>/<package>/manifest  per-file stat snapshot and SHA-256 (see upkg_manifest.h)
+ *   <db_dir>/.dirtab             directory refcounts (see upkg_dirtab.h)
+ *   <db_dir>/.lock               flock()ed by every process that writes the database
+ *   <db_dir>/.generations/       one snapshot per committed change (see upkg_gen.h)
+ *
+ * Every file is written to a temporary name and renamed into place. Records
+ * go through the "dir" storage backend (upkg_store.h); the mmap and btree
+ * backends hold the same records in one file but are not used here yet,
+ * since generations and manifests read record directories directly.
+ */
+
+// --- Global Variables ---
+extern upkg_index_t *upkg_soname_index;   // soname -> providing package(s)
+extern upkg_index_t *upkg_path_index;     // installed path -> owning package(s), built on demand
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Loads every package record from db_dir into upkg_main_hash_table
+ *        and builds the secondary indexes.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_load(void);
+
+/**
+ * @brief Frees the secondary indexes built by upkg_db_load.
+ */
+void upkg_db_close(void);
+
+/**
+ * @brief Takes the exclusive database lock (<db_dir>/.lock), waiting if
+ *        another upkg process holds it. Nested calls are counted.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_lock(void);
+
+/**
+ * @brief Releases one level of the database lock.
+ */
+void upkg_db_unlock(void);
+
+/**
+ * @brief Writes a package record to db_dir.
+ * @param pkg_info The package record to persist.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_store_package(const upkg_hash_package_info_t *pkg_info);
+
+/**
+ * @brief Deletes a package record from db_dir.
+ * @param package_name The package whose record is removed.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_db_delete_package(const char *package_name);
+
+/**
+ * @brief Returns the path ownership index, building it from the loaded
+ *        records on first use. Later index/unindex calls keep it current.
+ * @return The index, or NULL on allocation failure.
+ */
+upkg_index_t *upkg_db_path_index(void);
+
+/**
+ * @brief Adds a package's provided sonames (and, once built, its paths) to the indexes.
+ * @param pkg_info The package record.
+ */
+void upkg_db_index_package(const upkg_hash_package_info_t *pkg_info);
+
+/**
+ * @brief Removes a package's provided sonames and paths from the indexes.
+ * @param pkg_info The package record.
+ */
+void upkg_db_unindex_package(const upkg_hash_package_info_t *pkg_info);
+
+/**
+ * @brief Reports needed sonames that neither an installed package nor the
+ *        install root's library directories provide.
+ * @param pkg_info The package record to check.
+ * @return The number of unsatisfied sonames.
+ */
+int upkg_db_check_shlibs(const upkg_hash_package_info_t *pkg_info);
+
+/**
+ * @brief Prints the installed packages that provide a soname.
+ * @param soname The soname to look up, e.g. "libfoo.so.3".
+ * @return The number of providers found.
+ */
+int upkg_db_print_soname_providers(const char *soname);
+
+#endif // UPKG_DB_H
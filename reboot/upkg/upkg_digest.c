@@ -0,0 +1,253 @@
+/******************************************************************************
+ * Filename:    upkg_digest.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Message digest (SHA-256) implementation for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_digest.h"
+#include "upkg_cpu.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// --- SHA-256 Constants (FIPS 180-4) ---
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief Processes one 64-byte block into the running state.
+ * @param state The eight-word hash state.
+ * @param block The 64-byte message block.
+ */
+static void sha256_transform(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// --- SHA-256 Streaming Interface ---
+
+/**
+ * @brief Initializes a SHA-256 context.
+ * @param ctx Pointer to the context to initialize.
+ */
+void upkg_digest_sha256_init(upkg_sha256_ctx_t *ctx) {
+    if (!ctx) return;
+
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->total_len = 0;
+    ctx->buffer_len = 0;
+}
+
+/**
+ * @brief Feeds data into a SHA-256 context.
+ * @param ctx Pointer to an initialized context.
+ * @param data The bytes to hash.
+ * @param len The number of bytes in data.
+ */
+void upkg_digest_sha256_update(upkg_sha256_ctx_t *ctx, const void *data, size_t len) {
+    if (!ctx || (!data && len > 0)) return;
+
+    const uint8_t *p = (const uint8_t *)data;
+    ctx->total_len += len;
+
+    // Top up a pending partial block first
+    if (ctx->buffer_len > 0) {
+        size_t take = 64 - ctx->buffer_len;
+        if (take > len) take = len;
+        memcpy(ctx->buffer + ctx->buffer_len, p, take);
+        ctx->buffer_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buffer_len < 64) return;
+        sha256_transform(ctx->state, ctx->buffer);
+        ctx->buffer_len = 0;
+    }
+
+    // Hash whole blocks straight from the caller's buffer
+    while (len >= 64) {
+        sha256_transform(ctx->state, p);
+        p += 64;
+        len -= 64;
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buffer, p, len);
+        ctx->buffer_len = len;
+    }
+}
+
+/**
+ * @brief Finishes a SHA-256 computation and writes the digest.
+ * @param ctx Pointer to the context; it must be re-initialized before reuse.
+ * @param digest Output buffer of UPKG_SHA256_DIGEST_LENGTH bytes.
+ */
+void upkg_digest_sha256_final(upkg_sha256_ctx_t *ctx, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]) {
+    if (!ctx || !digest) return;
+
+    uint64_t bit_len = ctx->total_len * 8;
+
+    ctx->buffer[ctx->buffer_len++] = 0x80;
+    if (ctx->buffer_len > 56) {
+        memset(ctx->buffer + ctx->buffer_len, 0, 64 - ctx->buffer_len);
+        sha256_transform(ctx->state, ctx->buffer);
+        ctx->buffer_len = 0;
+    }
+    memset(ctx->buffer + ctx->buffer_len, 0, 56 - ctx->buffer_len);
+    for (int i = 0; i < 8; i++) {
+        ctx->buffer[63 - i] = (uint8_t)(bit_len >> (i * 8));
+    }
+    sha256_transform(ctx->state, ctx->buffer);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+// --- Convenience Helpers ---
+
+/**
+ * @brief Computes the SHA-256 digest of a file's contents.
+ * @param filepath The path to the file to hash.
+ * @param digest Output buffer of UPKG_SHA256_DIGEST_LENGTH bytes.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_digest_sha256_file(const char *filepath, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]) {
+    if (!filepath || !digest) {
+        upkg_util_error("sha256_file: NULL filepath or digest.\n");
+        return -1;
+    }
+
+    upkg_vfs_file_t *f = upkg_vfs->open(filepath, O_RDONLY, 0);
+    if (!f) {
+        upkg_util_log_verbose("Could not open '%s' for hashing: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    upkg_sha256_ctx_t ctx;
+    upkg_digest_sha256_init(&ctx);
+
+    char buffer[65536];
+    ssize_t bytes;
+    while ((bytes = upkg_vfs->read(f, buffer, sizeof(buffer))) != 0) {
+        if (bytes < 0) {
+            upkg_util_error("Read error while hashing '%s': %s\n", filepath, strerror(errno));
+            upkg_vfs->close(f);
+            return -1;
+        }
+        upkg_digest_sha256_update(&ctx, buffer, (size_t)bytes);
+    }
+    upkg_vfs->close(f);
+
+    upkg_digest_sha256_final(&ctx, digest);
+    return 0;
+}
+
+/**
+ * @brief Formats a binary digest as a lowercase hexadecimal string.
+ * @param digest The binary digest.
+ * @param len The number of bytes in digest.
+ * @param out Output buffer of at least (len * 2 + 1) bytes.
+ */
+void upkg_digest_to_hex(const uint8_t *digest, size_t len, char *out) {
+    static const char hex[] = "0123456789abcdef";
+    if (!digest || !out) return;
+
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = hex[digest[i] >> 4];
+        out[i * 2 + 1] = hex[digest[i] & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+// --- CRC-32C ---
+
+/**
+ * @brief Updates a CRC-32C (Castagnoli) checksum.
+ * @param crc 0 for a new checksum, or the result of a previous call.
+ * @param data The bytes to checksum.
+ * @param len The number of bytes in data.
+ * @return The updated checksum.
+ */
+uint32_t upkg_digest_crc32c(uint32_t crc, const void *data, size_t len) {
+    return upkg_cpu_kernels()->crc32c(crc, data, len);
+}
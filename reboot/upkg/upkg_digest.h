@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Filename:    upkg_digest.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Message digest (SHA-256) declarations for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_DIGEST_H
+#define UPKG_DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UPKG_SHA256_DIGEST_LENGTH 32
+#define UPKG_SHA256_HEX_LENGTH (UPKG_SHA256_DIGEST_LENGTH * 2 + 1)
+
+// --- SHA-256 Streaming Context ---
+
+/**
+ * @brief Incremental SHA-256 state, fed with any number of update calls.
+ */
+typedef struct {
+    uint32_t state[8];
+    uint64_t total_len;      // Total number of bytes hashed so far
+    uint8_t buffer[64];      // Pending partial block
+    size_t buffer_len;
+} upkg_sha256_ctx_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Initializes a SHA-256 context.
+ * @param ctx Pointer to the context to initialize.
+ */
+void upkg_digest_sha256_init(upkg_sha256_ctx_t *ctx);
+
+/**
+ * @brief Feeds data into a SHA-256 context.
+ * @param ctx Pointer to an initialized context.
+ * @param data The bytes to hash.
+ * @param len The number of bytes in data.
+ */
+void upkg_digest_sha256_update(upkg_sha256_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @brief Finishes a SHA-256 computation and writes the digest.
+ * @param ctx Pointer to the context; it must be re-initialized before reuse.
+ * @param digest Output buffer of UPKG_SHA256_DIGEST_LENGTH bytes.
+ */
+void upkg_digest_sha256_final(upkg_sha256_ctx_t *ctx, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 digest of a file's contents.
+ * @param filepath The path to the file to hash.
+ * @param digest Output buffer of UPKG_SHA256_DIGEST_LENGTH bytes.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_digest_sha256_file(const char *filepath, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Formats a binary digest as a lowercase hexadecimal string.
+ * @param digest The binary digest.
+ * @param len The number of bytes in digest.
+ * @param out Output buffer of at least (len * 2 + 1) bytes.
+ */
+void upkg_digest_to_hex(const uint8_t *digest, size_t len, char *out);
+
+/**
+ * @brief Updates a CRC-32C (Castagnoli) checksum.
+ * @param crc 0 for a new checksum, or the result of a previous call.
+ * @param data The bytes to checksum.
+ * @param len The number of bytes in data.
+ * @return The updated checksum.
+ */
+uint32_t upkg_digest_crc32c(uint32_t crc, const void *data, size_t len);
+
+#endif // UPKG_DIGEST_H
@@ -0,0 +1,312 @@
+/******************************************************************************
+ * Filename:    upkg_dirtab.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Refcounted table of package-owned directories for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_dirtab.h"
+#include "upkg_config.h"
+#include "upkg_hash.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Table State ---
+
+typedef struct {
+    upkg_dirtab_entry_t **buckets;
+    size_t size;
+    size_t count;
+    bool dirty;
+} upkg_dirtab_t;
+
+static upkg_dirtab_t *g_dirtab = NULL;
+
+/**
+ * @brief Builds the path of the on-disk table.
+ * @return The allocated path, or NULL on failure.
+ */
+static char *dirtab_file_path(void) {
+    if (!g_db_dir) {
+        upkg_util_error("Database directory not configured.\n");
+        return NULL;
+    }
+    return upkg_util_concat_path(g_db_dir, ".dirtab");
+}
+
+/**
+ * @brief Allocates the table on first use.
+ * @return 0 on success, -1 on failure.
+ */
+static int dirtab_ensure(void) {
+    if (g_dirtab) return 0;
+
+    g_dirtab = calloc(1, sizeof(upkg_dirtab_t));
+    if (!g_dirtab) {
+        upkg_util_error("Failed to allocate memory for directory table.\n");
+        return -1;
+    }
+    g_dirtab->size = upkg_hash_next_prime(INITIAL_HASH_TABLE_SIZE);
+    g_dirtab->buckets = calloc(g_dirtab->size, sizeof(upkg_dirtab_entry_t *));
+    if (!g_dirtab->buckets) {
+        upkg_util_error("Failed to allocate memory for directory table buckets.\n");
+        free(g_dirtab);
+        g_dirtab = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Grows the bucket array once the load factor is exceeded.
+ * @return 0 on success, -1 on failure.
+ */
+static int dirtab_grow(void) {
+    size_t new_size = upkg_hash_next_prime(g_dirtab->size * 2);
+    upkg_dirtab_entry_t **new_buckets = calloc(new_size, sizeof(upkg_dirtab_entry_t *));
+    if (!new_buckets) {
+        upkg_util_error("Failed to allocate memory for directory table resize.\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < g_dirtab->size; i++) {
+        upkg_dirtab_entry_t *current = g_dirtab->buckets[i];
+        while (current) {
+            upkg_dirtab_entry_t *next = current->next;
+            size_t b = upkg_hash_fnv1a(current->path) % new_size;
+            current->next = new_buckets[b];
+            new_buckets[b] = current;
+            current = next;
+        }
+    }
+
+    free(g_dirtab->buckets);
+    g_dirtab->buckets = new_buckets;
+    g_dirtab->size = new_size;
+    return 0;
+}
+
+/**
+ * @brief Inserts a new entry; the caller has checked the path is untracked.
+ * @param path The directory path.
+ * @param refcount The initial refcount.
+ * @param created Whether upkg created the directory.
+ * @return The new entry, or NULL on failure.
+ */
+static upkg_dirtab_entry_t *dirtab_insert(const char *path, int refcount, bool created) {
+    if ((double)(g_dirtab->count + 1) / g_dirtab->size > GROW_LOAD_FACTOR_THRESHOLD) {
+        if (dirtab_grow() != 0) {
+            return NULL;
+        }
+    }
+
+    upkg_dirtab_entry_t *entry = malloc(sizeof(upkg_dirtab_entry_t));
+    if (!entry || !(entry->path = strdup(path))) {
+        upkg_util_error("Failed to allocate memory for directory table entry.\n");
+        free(entry);
+        return NULL;
+    }
+    entry->refcount = refcount;
+    entry->created = created;
+
+    size_t b = upkg_hash_fnv1a(path) % g_dirtab->size;
+    entry->next = g_dirtab->buckets[b];
+    g_dirtab->buckets[b] = entry;
+    g_dirtab->count++;
+    return entry;
+}
+
+// --- Public Functions ---
+
+/**
+ * @brief Looks up a directory's entry.
+ * @param path The directory, relative to the install root.
+ * @return The entry, or NULL if untracked.
+ */
+const upkg_dirtab_entry_t *upkg_dirtab_find(const char *path) {
+    if (!g_dirtab || !path) return NULL;
+
+    upkg_dirtab_entry_t *current = g_dirtab->buckets[upkg_hash_fnv1a(path) % g_dirtab->size];
+    while (current) {
+        if (strcmp(current->path, path) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Loads the directory table from <db_dir>/.dirtab.
+ * @return 0 on success (a missing file yields an empty table), -1 on failure.
+ */
+int upkg_dirtab_load(void) {
+    if (dirtab_ensure() != 0) return -1;
+
+    char *path = dirtab_file_path();
+    if (!path) return -1;
+
+    size_t len = 0;
+    char *content = upkg_util_read_file_content(path, &len);
+    if (!content) {
+        upkg_util_log_verbose("No directory table at %s, starting empty.\n", path);
+        free(path);
+        return 0;
+    }
+
+    char *line = content;
+    while (line < content + len) {
+        char *end = memchr(line, '\n', (size_t)(content + len - line));
+        if (end) *end = '\0';
+
+        int refcount = 0;
+        char flag = 0;
+        int consumed = 0;
+        if (sscanf(line, "%d %c %n", &refcount, &flag, &consumed) == 2 && consumed > 0 &&
+            line[consumed] != '\0' && refcount > 0 && !upkg_dirtab_find(line + consumed)) {
+            if (!dirtab_insert(line + consumed, refcount, flag == 'c')) {
+                free(content);
+                free(path);
+                return -1;
+            }
+        } else if (*line != '\0') {
+            upkg_util_error("Ignoring malformed directory table line in %s: %s\n", path, line);
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+
+    upkg_util_log_verbose("Loaded %zu tracked directories from %s\n", g_dirtab->count, path);
+    g_dirtab->dirty = false;
+    free(content);
+    free(path);
+    return 0;
+}
+
+/**
+ * @brief Writes the directory table back to disk if it changed.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_dirtab_save(void) {
+    if (!g_dirtab || !g_dirtab->dirty) return 0;
+
+    char *path = dirtab_file_path();
+    if (!path) return -1;
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        upkg_util_error("Failed to allocate directory table buffer.\n");
+        free(path);
+        return -1;
+    }
+    for (size_t i = 0; i < g_dirtab->size; i++) {
+        for (upkg_dirtab_entry_t *e = g_dirtab->buckets[i]; e; e = e->next) {
+            fprintf(mem, "%d %c %s\n", e->refcount, e->created ? 'c' : 'p', e->path);
+        }
+    }
+    fclose(mem);
+
+    int ret = upkg_util_write_file_atomic(path, buffer, len);
+    if (ret == 0) {
+        g_dirtab->dirty = false;
+    }
+    free(buffer);
+    free(path);
+    return ret;
+}
+
+/**
+ * @brief Frees the in-memory directory table.
+ */
+void upkg_dirtab_close(void) {
+    if (!g_dirtab) return;
+
+    for (size_t i = 0; i < g_dirtab->size; i++) {
+        upkg_dirtab_entry_t *current = g_dirtab->buckets[i];
+        while (current) {
+            upkg_dirtab_entry_t *next = current->next;
+            free(current->path);
+            free(current);
+            current = next;
+        }
+    }
+    free(g_dirtab->buckets);
+    free(g_dirtab);
+    g_dirtab = NULL;
+}
+
+/**
+ * @brief Adds one owning package to a directory.
+ * @param path The directory, relative to the install root.
+ * @param existed Whether the directory was already present before this install.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_dirtab_acquire(const char *path, bool existed) {
+    if (!path || dirtab_ensure() != 0) return -1;
+
+    upkg_dirtab_entry_t *entry = (upkg_dirtab_entry_t *)upkg_dirtab_find(path);
+    if (entry) {
+        entry->refcount++;
+    } else if (!dirtab_insert(path, 1, !existed)) {
+        return -1;
+    }
+    g_dirtab->dirty = true;
+    return 0;
+}
+
+/**
+ * @brief Drops one owning package from a directory.
+ * @param path The directory, relative to the install root.
+ * @param prune Set to true if the directory is now unowned and was created by upkg.
+ * @return The remaining refcount, or -1 if the directory was not tracked.
+ */
+int upkg_dirtab_release(const char *path, bool *prune) {
+    if (prune) *prune = false;
+    if (!g_dirtab || !path) return -1;
+
+    size_t b = upkg_hash_fnv1a(path) % g_dirtab->size;
+    upkg_dirtab_entry_t *current = g_dirtab->buckets[b];
+    upkg_dirtab_entry_t *prev = NULL;
+    while (current) {
+        if (strcmp(current->path, path) == 0) {
+            g_dirtab->dirty = true;
+            if (--current->refcount > 0) {
+                return current->refcount;
+            }
+
+            if (prune) *prune = current->created;
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                g_dirtab->buckets[b] = current->next;
+            }
+            free(current->path);
+            free(current);
+            g_dirtab->count--;
+            return 0;
+        }
+        prev = current;
+        current = current->next;
+    }
+    return -1;
+}
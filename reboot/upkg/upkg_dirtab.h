@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Filename:    upkg_dirtab.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Refcounted table of package-owned directories for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_DIRTAB_H
+#define UPKG_DIRTAB_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Every directory a package ships is recorded here with the number of
+ * installed packages that own it. Removal decrements the counts and prunes
+ * exactly the directories that drop to zero, instead of rmdir()-probing
+ * every parent up to the root. Directories that existed before upkg first
+ * claimed them (/usr, /etc, ...) are pinned and never pruned.
+ *
+ * Persisted as <db_dir>/.dirtab, one "<refcount> <c|p> <path>" line per
+ * directory ('c' = created by upkg, 'p' = pre-existing).
+ */
+
+// --- Directory Table Entry ---
+typedef struct upkg_dirtab_entry {
+    char *path;                       // Relative to the install root
+    int refcount;                     // Installed packages owning the directory
+    bool created;                     // false for pinned, pre-existing directories
+    struct upkg_dirtab_entry *next;
+} upkg_dirtab_entry_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Loads the directory table from <db_dir>/.dirtab.
+ * @return 0 on success (a missing file yields an empty table), -1 on failure.
+ */
+int upkg_dirtab_load(void);
+
+/**
+ * @brief Writes the directory table back to disk if it changed.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_dirtab_save(void);
+
+/**
+ * @brief Frees the in-memory directory table.
+ */
+void upkg_dirtab_close(void);
+
+/**
+ * @brief Adds one owning package to a directory.
+ * @param path The directory, relative to the install root.
+ * @param existed Whether the directory was already present before this install.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_dirtab_acquire(const char *path, bool existed);
+
+/**
+ * @brief Drops one owning package from a directory.
+ * @param path The directory, relative to the install root.
+ * @param prune Set to true if the directory is now unowned and was created by upkg.
+ * @return The remaining refcount, or -1 if the directory was not tracked.
+ */
+int upkg_dirtab_release(const char *path, bool *prune);
+
+/**
+ * @brief Looks up a directory's entry.
+ * @param path The directory, relative to the install root.
+ * @return The entry, or NULL if untracked.
+ */
+const upkg_dirtab_entry_t *upkg_dirtab_find(const char *path);
+
+#endif // UPKG_DIRTAB_H
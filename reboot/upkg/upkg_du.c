@@ -0,0 +1,409 @@
+/******************************************************************************
+ * Filename:    upkg_du.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Columnar disk-usage aggregation over installed packages
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_du.h"
+#include "upkg_hash.h"
+#include "upkg_history.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+// --- Field Table ---
+
+#define ROW_STRING(name, member) { name, UPKG_FIELD_STRING, offsetof(upkg_du_row_t, member), 0 }
+#define ROW_INT(name, member) { name, UPKG_FIELD_INT, offsetof(upkg_du_row_t, member), 0 }
+
+const upkg_format_field_t upkg_du_fields[] = {
+    ROW_STRING("Name", name),
+    ROW_STRING("Date", date),
+    ROW_INT("Size", size_kib),
+    ROW_INT("Files", files),
+    ROW_INT("Packages", packages),
+    ROW_INT("Installed-At", installed_at),
+};
+const int upkg_du_field_count = (int)(sizeof(upkg_du_fields) / sizeof(upkg_du_fields[0]));
+
+static const char *const du_dimension_names[UPKG_DU_DIMENSIONS] = {
+    [UPKG_DU_SECTION] = "section",
+    [UPKG_DU_MAINTAINER] = "maintainer",
+    [UPKG_DU_PRIORITY] = "priority",
+    [UPKG_DU_ARCHITECTURE] = "architecture",
+    [UPKG_DU_MONTH] = "month",
+};
+
+// --- Columns ---
+
+// Dictionary of one grouping column's distinct values
+typedef struct {
+    char **values;              // id -> value
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;            // open addressing; id + 1, 0 when empty
+    size_t slot_count;          // power of two
+} du_dict_t;
+
+typedef struct {
+    bool built;
+    size_t count;
+    char **name;                // sorted by name
+    int64_t *size_kib;
+    int64_t *files;
+    int64_t *installed_at;
+    uint32_t *group[UPKG_DU_DIMENSIONS];
+    du_dict_t dict[UPKG_DU_DIMENSIONS];
+} du_columns_t;
+
+static du_columns_t g_columns;
+
+/**
+ * @brief Re-slots every dictionary value into a table twice the size.
+ * @param dict The dictionary.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int dict_grow(du_dict_t *dict) {
+    size_t slot_count = dict->slot_count ? dict->slot_count * 2 : 64;
+    uint32_t *slots = calloc(slot_count, sizeof(*slots));
+    if (!slots) return -1;
+    for (size_t id = 0; id < dict->count; id++) {
+        size_t s = upkg_hash_fnv1a(dict->values[id]) & (slot_count - 1);
+        while (slots[s]) s = (s + 1) & (slot_count - 1);
+        slots[s] = (uint32_t)id + 1;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slot_count = slot_count;
+    return 0;
+}
+
+/**
+ * @brief Returns a value's id, adding the value if it is new.
+ * @param dict The dictionary.
+ * @param value The value.
+ * @param id Output.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int dict_intern(du_dict_t *dict, const char *value, uint32_t *id) {
+    if ((dict->count + 1) * 2 > dict->slot_count && dict_grow(dict) != 0) return -1;
+
+    size_t s = upkg_hash_fnv1a(value) & (dict->slot_count - 1);
+    while (dict->slots[s]) {
+        if (strcmp(dict->values[dict->slots[s] - 1], value) == 0) {
+            *id = dict->slots[s] - 1;
+            return 0;
+        }
+        s = (s + 1) & (dict->slot_count - 1);
+    }
+    if (dict->count == dict->capacity) {
+        size_t capacity = dict->capacity ? dict->capacity * 2 : 16;
+        char **values = realloc(dict->values, capacity * sizeof(*values));
+        if (!values) return -1;
+        dict->values = values;
+        dict->capacity = capacity;
+    }
+    char *copy = strdup(value);
+    if (!copy) return -1;
+    dict->values[dict->count] = copy;
+    dict->slots[s] = (uint32_t)dict->count + 1;
+    *id = (uint32_t)dict->count++;
+    return 0;
+}
+
+/**
+ * @brief Drops the columns so the next query rebuilds them.
+ */
+void upkg_du_invalidate(void) {
+    if (!g_columns.built) return;
+    for (size_t r = 0; r < g_columns.count; r++) {
+        free(g_columns.name[r]);
+    }
+    free(g_columns.name);
+    free(g_columns.size_kib);
+    free(g_columns.files);
+    free(g_columns.installed_at);
+    for (int d = 0; d < UPKG_DU_DIMENSIONS; d++) {
+        free(g_columns.group[d]);
+        for (size_t id = 0; id < g_columns.dict[d].count; id++) {
+            free(g_columns.dict[d].values[id]);
+        }
+        free(g_columns.dict[d].values);
+        free(g_columns.dict[d].slots);
+    }
+    memset(&g_columns, 0, sizeof(g_columns));
+}
+
+/**
+ * @brief Orders package records by name.
+ */
+static int compare_records(const void *a, const void *b) {
+    const upkg_hash_package_info_t *pa = *(const upkg_hash_package_info_t *const *)a;
+    const upkg_hash_package_info_t *pb = *(const upkg_hash_package_info_t *const *)b;
+    return strcmp(pa->package_name, pb->package_name);
+}
+
+/**
+ * @brief Records the time of each package's latest install from the history.
+ */
+static int note_install_time(const upkg_history_entry_t *entry, void *user) {
+    (void)user;
+    for (size_t i = 0; i < entry->op_count; i++) {
+        const upkg_history_op_t *op = &entry->ops[i];
+        if (op->kind != UPKG_HISTORY_INSTALL || op->status != 0 || !op->package) continue;
+
+        // Rows are sorted by name
+        size_t lo = 0, hi = g_columns.count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            int cmp = strcmp(g_columns.name[mid], op->package);
+            if (cmp == 0) {
+                g_columns.installed_at[mid] = entry->time;
+                break;
+            }
+            if (cmp < 0) lo = mid + 1;
+            else hi = mid;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Builds the columns from the loaded database and the history log,
+ *        unless they are current.
+ * @return 0 on success, -1 on failure.
+ */
+static int du_build(void) {
+    if (g_columns.built) return 0;
+    if (!upkg_main_hash_table) return -1;
+
+    size_t count = 0;
+    const upkg_hash_package_info_t **records = malloc((upkg_main_hash_table->count + 1) * sizeof(*records));
+    if (!records) return -1;
+    for (size_t i = 0; i < upkg_main_hash_table->size; i++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[i]; n; n = n->next) {
+            if (n->data.package_name && count < upkg_main_hash_table->count) records[count++] = &n->data;
+        }
+    }
+    qsort(records, count, sizeof(*records), compare_records);
+
+    g_columns.built = true;     // lets upkg_du_invalidate free a partial build
+    g_columns.count = count;
+    g_columns.name = calloc(count + 1, sizeof(*g_columns.name));
+    g_columns.size_kib = calloc(count + 1, sizeof(int64_t));
+    g_columns.files = calloc(count + 1, sizeof(int64_t));
+    g_columns.installed_at = calloc(count + 1, sizeof(int64_t));
+    bool ok = g_columns.name && g_columns.size_kib && g_columns.files && g_columns.installed_at;
+    for (int d = 0; ok && d < UPKG_DU_DIMENSIONS; d++) {
+        g_columns.group[d] = calloc(count + 1, sizeof(uint32_t));
+        ok = g_columns.group[d] != NULL;
+    }
+
+    // Parse each string field once
+    for (size_t r = 0; ok && r < count; r++) {
+        const upkg_hash_package_info_t *pkg = records[r];
+        g_columns.name[r] = strdup(pkg->package_name);
+        ok = g_columns.name[r] != NULL;
+        g_columns.size_kib[r] = pkg->installed_size ? strtoll(pkg->installed_size, NULL, 10) : 0;
+        g_columns.files[r] = pkg->file_count;
+
+        const char *values[] = {
+            [UPKG_DU_SECTION] = pkg->section,
+            [UPKG_DU_MAINTAINER] = pkg->maintainer,
+            [UPKG_DU_PRIORITY] = pkg->priority,
+            [UPKG_DU_ARCHITECTURE] = pkg->architecture,
+        };
+        for (int d = 0; ok && d < UPKG_DU_MONTH; d++) {
+            ok = dict_intern(&g_columns.dict[d], values[d] ? values[d] : "(none)", &g_columns.group[d][r]) == 0;
+        }
+    }
+    free(records);
+
+    if (ok) {
+        upkg_history_scan_since(INT64_MIN, note_install_time, NULL);
+    }
+    for (size_t r = 0; ok && r < count; r++) {
+        char month[16] = "unknown";
+        time_t t = (time_t)g_columns.installed_at[r];
+        struct tm tm;
+        if (t > 0 && localtime_r(&t, &tm)) strftime(month, sizeof(month), "%Y-%m", &tm);
+        ok = dict_intern(&g_columns.dict[UPKG_DU_MONTH], month, &g_columns.group[UPKG_DU_MONTH][r]) == 0;
+    }
+
+    if (!ok) {
+        upkg_util_error("Out of memory building disk-usage columns.\n");
+        upkg_du_invalidate();
+        return -1;
+    }
+    upkg_util_log_verbose("Built disk-usage columns for %zu packages\n", count);
+    return 0;
+}
+
+// --- Queries ---
+
+/**
+ * @brief Fills a row's date text from its install time.
+ */
+static void row_set_date(upkg_du_row_t *row) {
+    time_t t = (time_t)row->installed_at;
+    struct tm tm;
+    row->date = "-";
+    if (t > 0 && localtime_r(&t, &tm) && strftime(row->date_buf, sizeof(row->date_buf), "%Y-%m-%d", &tm)) {
+        row->date = row->date_buf;
+    }
+}
+
+/**
+ * @brief Looks up a grouping dimension by name.
+ */
+int upkg_du_parse_dimension(const char *name, upkg_du_dimension_t *dim) {
+    for (int d = 0; d < UPKG_DU_DIMENSIONS; d++) {
+        if (strcmp(name, du_dimension_names[d]) == 0) {
+            *dim = (upkg_du_dimension_t)d;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Orders groups by total size, largest first, then by name.
+ */
+static int compare_groups(const void *a, const void *b) {
+    const upkg_du_row_t *ra = a, *rb = b;
+    if (ra->size_kib != rb->size_kib) return ra->size_kib > rb->size_kib ? -1 : 1;
+    return strcmp(ra->name, rb->name);
+}
+
+/**
+ * @brief Totals size, files and packages per value of a dimension.
+ */
+int upkg_du_group(upkg_du_dimension_t dim, upkg_du_visit_fn visit, void *user) {
+    if (dim >= UPKG_DU_DIMENSIONS || du_build() != 0) return -1;
+
+    const du_dict_t *dict = &g_columns.dict[dim];
+    upkg_du_row_t *rows = calloc(dict->count + 1, sizeof(*rows));
+    if (!rows) return -1;
+    for (size_t g = 0; g < dict->count; g++) {
+        rows[g].name = dict->values[g];
+    }
+
+    const uint32_t *group = g_columns.group[dim];
+    for (size_t r = 0; r < g_columns.count; r++) {
+        upkg_du_row_t *row = &rows[group[r]];
+        row->size_kib += g_columns.size_kib[r];
+        row->files += g_columns.files[r];
+        row->packages++;
+        if (g_columns.installed_at[r] > row->installed_at) row->installed_at = g_columns.installed_at[r];
+    }
+
+    qsort(rows, dict->count, sizeof(*rows), compare_groups);
+    for (size_t g = 0; g < dict->count; g++) {
+        row_set_date(&rows[g]);
+        if (visit(&rows[g], user) != 0) break;
+    }
+    free(rows);
+    return (int)dict->count;
+}
+
+/**
+ * @brief Tells whether row a ranks above row b: a higher value, or an
+ *        equal one and an earlier name.
+ */
+static bool ranks_above(const int64_t *column, size_t a, size_t b) {
+    if (column[a] != column[b]) return column[a] > column[b];
+    return strcmp(g_columns.name[a], g_columns.name[b]) < 0;
+}
+
+/**
+ * @brief Restores the min-heap property below position i: the root holds
+ *        the lowest-ranked row kept so far.
+ */
+static void heap_sift_down(size_t *heap, size_t size, size_t i, const int64_t *column) {
+    for (;;) {
+        size_t lowest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && ranks_above(column, heap[lowest], heap[left])) lowest = left;
+        if (right < size && ranks_above(column, heap[lowest], heap[right])) lowest = right;
+        if (lowest == i) return;
+        size_t tmp = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = tmp;
+        i = lowest;
+    }
+}
+
+/**
+ * @brief Selects the N packages ranking highest on one column.
+ */
+int upkg_du_top(upkg_du_metric_t metric, size_t n, upkg_du_visit_fn visit, void *user) {
+    if (du_build() != 0) return -1;
+
+    const int64_t *column = metric == UPKG_DU_BY_FILES ? g_columns.files
+                          : metric == UPKG_DU_BY_DATE  ? g_columns.installed_at
+                                                       : g_columns.size_kib;
+    size_t k = n < g_columns.count ? n : g_columns.count;
+    size_t *heap = malloc((k + 1) * sizeof(*heap));
+    if (!heap) return -1;
+
+    // Keep the best k rows seen so far; the root is the one to evict next
+    size_t size = 0;
+    for (size_t r = 0; r < g_columns.count && k > 0; r++) {
+        if (size < k) {
+            size_t i = size++;
+            heap[i] = r;
+            while (i > 0 && ranks_above(column, heap[(i - 1) / 2], heap[i])) {
+                size_t parent = (i - 1) / 2;
+                size_t tmp = heap[i];
+                heap[i] = heap[parent];
+                heap[parent] = tmp;
+                i = parent;
+            }
+        } else if (ranks_above(column, r, heap[0])) {
+            heap[0] = r;
+            heap_sift_down(heap, size, 0, column);
+        }
+    }
+
+    // Popping the lowest into the tail leaves the array best first
+    for (size_t end = size; end > 1; end--) {
+        size_t tmp = heap[0];
+        heap[0] = heap[end - 1];
+        heap[end - 1] = tmp;
+        heap_sift_down(heap, end - 1, 0, column);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        size_t r = heap[i];
+        upkg_du_row_t row;
+        memset(&row, 0, sizeof(row));
+        row.name = g_columns.name[r];
+        row.size_kib = g_columns.size_kib[r];
+        row.files = g_columns.files[r];
+        row.packages = 1;
+        row.installed_at = g_columns.installed_at[r];
+        row_set_date(&row);
+        if (visit(&row, user) != 0) break;
+    }
+    free(heap);
+    return (int)size;
+}
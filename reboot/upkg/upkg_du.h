@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Filename:    upkg_du.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Columnar disk-usage aggregation over installed packages
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_DU_H
+#define UPKG_DU_H
+
+#include "upkg_format.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * --du answers capacity questions from columns built once from the loaded
+ * database instead of rescanning package records per question:
+ *
+ *   numeric   installed size (KiB, parsed from Installed-Size), file
+ *             count and last install time (from the history log), each a
+ *             dense int64_t array indexed by row
+ *   grouping  section, maintainer, priority, architecture and install
+ *             month, each dictionary-encoded into a dense array of ids
+ *
+ * Grouped totals are one pass over an id column into per-group sums;
+ * top-N keeps an N-entry min-heap over one numeric column. The columns
+ * are built on first use and dropped whenever upkg_db_index_package or
+ * upkg_db_unindex_package changes the database. Not thread-safe.
+ */
+
+// --- Grouping Dimensions ---
+typedef enum {
+    UPKG_DU_SECTION,
+    UPKG_DU_MAINTAINER,
+    UPKG_DU_PRIORITY,
+    UPKG_DU_ARCHITECTURE,
+    UPKG_DU_MONTH,              // YYYY-MM of the last install
+    UPKG_DU_DIMENSIONS
+} upkg_du_dimension_t;
+
+// --- Top-N Orderings ---
+typedef enum {
+    UPKG_DU_BY_SIZE,
+    UPKG_DU_BY_FILES,
+    UPKG_DU_BY_DATE             // most recently installed first
+} upkg_du_metric_t;
+
+// --- Result Row ---
+// One group, or one package for top-N (packages is then 1)
+typedef struct {
+    const char *name;           // group value or package name
+    const char *date;           // YYYY-MM-DD of the newest install, or "-"
+    int64_t size_kib;
+    int64_t files;
+    int64_t packages;
+    int64_t installed_at;       // seconds since the epoch, 0 if unknown
+    char date_buf[16];
+} upkg_du_row_t;
+
+// Called once per row, largest first; return nonzero to stop
+typedef int (*upkg_du_visit_fn)(const upkg_du_row_t *row, void *user);
+
+// Field table for --format templates over rows: Name, Date, Size, Files,
+// Packages, Installed-At
+extern const upkg_format_field_t upkg_du_fields[];
+extern const int upkg_du_field_count;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Looks up a grouping dimension by name.
+ * @param name "section", "maintainer", "priority", "architecture" or "month".
+ * @param dim Output.
+ * @return 0 on success, -1 if unknown.
+ */
+int upkg_du_parse_dimension(const char *name, upkg_du_dimension_t *dim);
+
+/**
+ * @brief Totals size, files and packages per value of a dimension.
+ * @param dim The dimension.
+ * @param visit Called per group, largest total size first.
+ * @param user Passed to visit.
+ * @return The number of groups, or -1 on failure.
+ */
+int upkg_du_group(upkg_du_dimension_t dim, upkg_du_visit_fn visit, void *user);
+
+/**
+ * @brief Selects the N packages ranking highest on one column.
+ * @param metric The column to rank by.
+ * @param n The number of packages wanted.
+ * @param visit Called per package, highest first.
+ * @param user Passed to visit.
+ * @return The number of packages visited, or -1 on failure.
+ */
+int upkg_du_top(upkg_du_metric_t metric, size_t n, upkg_du_visit_fn visit, void *user);
+
+/**
+ * @brief Drops the columns so the next query rebuilds them.
+ */
+void upkg_du_invalidate(void);
+
+#endif // UPKG_DU_H
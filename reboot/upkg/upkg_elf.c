@@ -0,0 +1,322 @@
+/******************************************************************************
+ * Filename:    upkg_elf.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: ELF dynamic section reader (DT_SONAME / DT_NEEDED) for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_elf.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+
+// Sanity limits so a corrupt header cannot make us allocate gigabytes
+#define ELF_MAX_PHDR_BYTES   (64 * 1024)
+#define ELF_MAX_DYNAMIC_BYTES (1024 * 1024)
+#define ELF_MAX_STRTAB_BYTES (8 * 1024 * 1024)
+
+/**
+ * @brief Layout facts for the ELF class and byte order being read.
+ */
+typedef struct {
+    int fd;
+    bool is_64;
+    bool big_endian;
+} elf_reader_t;
+
+/**
+ * @brief A PT_LOAD segment, used to map virtual addresses to file offsets.
+ */
+typedef struct {
+    uint64_t vaddr;
+    uint64_t offset;
+    uint64_t filesz;
+} elf_load_t;
+
+// --- Byte Order Helpers ---
+
+static uint64_t read_uint(const elf_reader_t *r, const unsigned char *p, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; i++) {
+        size_t shift = r->big_endian ? (width - 1 - i) * 8 : i * 8;
+        value |= (uint64_t)p[i] << shift;
+    }
+    return value;
+}
+
+/**
+ * @brief Reads exactly len bytes at an offset.
+ * @return 0 on success, -1 on a short read or error.
+ */
+static int read_at(int fd, void *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, (char *)buf + done, len - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Translates a virtual address into a file offset using PT_LOAD segments.
+ * @return 0 on success, -1 if no segment maps the address.
+ */
+static int vaddr_to_offset(const elf_load_t *loads, int load_count, uint64_t vaddr, uint64_t *offset) {
+    for (int i = 0; i < load_count; i++) {
+        if (vaddr >= loads[i].vaddr && vaddr < loads[i].vaddr + loads[i].filesz) {
+            *offset = loads[i].offset + (vaddr - loads[i].vaddr);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Copies a NUL-terminated string out of the string table.
+ * @return A newly allocated string, or NULL if the offset is invalid.
+ */
+static char *strtab_dup(const char *strtab, uint64_t strsz, uint64_t offset) {
+    if (offset >= strsz) return NULL;
+    const char *start = strtab + offset;
+    const char *end = memchr(start, '\0', (size_t)(strsz - offset));
+    if (!end || end == start) return NULL;
+    return strndup(start, (size_t)(end - start));
+}
+
+// --- Public Interface ---
+
+/**
+ * @brief Frees the strings held by a dynamic section summary.
+ * @param dyn The structure to clear.
+ */
+void upkg_elf_free_dynamic(upkg_elf_dynamic_t *dyn) {
+    if (!dyn) return;
+
+    upkg_util_free_and_null(&dyn->soname);
+    if (dyn->needed) {
+        for (int i = 0; i < dyn->needed_count; i++) {
+            upkg_util_free_and_null(&dyn->needed[i]);
+        }
+        upkg_util_free_and_null((char **)&dyn->needed);
+    }
+    dyn->needed_count = 0;
+}
+
+/**
+ * @brief Reads DT_SONAME and DT_NEEDED from an ELF file's dynamic section.
+ * @param filepath The file to inspect.
+ * @param file_size The file size from an earlier stat, used to skip tiny files.
+ * @param dyn Output structure; free with upkg_elf_free_dynamic.
+ * @return 1 if the file is a dynamic ELF object, 0 if it is not, -1 on a read error.
+ */
+int upkg_elf_read_dynamic(const char *filepath, off_t file_size, upkg_elf_dynamic_t *dyn) {
+    if (!filepath || !dyn) return -1;
+
+    dyn->soname = NULL;
+    dyn->needed = NULL;
+    dyn->needed_count = 0;
+
+    if (file_size < (off_t)sizeof(Elf32_Ehdr)) {
+        return 0;
+    }
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        upkg_util_log_verbose("Could not open '%s' for ELF inspection: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    unsigned char ehdr[sizeof(Elf64_Ehdr)];
+    size_t ehdr_len = (file_size < (off_t)sizeof(Elf64_Ehdr)) ? sizeof(Elf32_Ehdr) : sizeof(Elf64_Ehdr);
+    if (read_at(fd, ehdr, ehdr_len, 0) != 0 || memcmp(ehdr, ELFMAG, SELFMAG) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    elf_reader_t r = { fd, ehdr[EI_CLASS] == ELFCLASS64, ehdr[EI_DATA] == ELFDATA2MSB };
+    if ((ehdr[EI_CLASS] != ELFCLASS32 && ehdr[EI_CLASS] != ELFCLASS64) ||
+        (ehdr[EI_DATA] != ELFDATA2LSB && ehdr[EI_DATA] != ELFDATA2MSB) ||
+        (r.is_64 && ehdr_len < sizeof(Elf64_Ehdr))) {
+        close(fd);
+        return 0;
+    }
+
+    uint64_t phoff, phentsize, phnum;
+    if (r.is_64) {
+        phoff = read_uint(&r, ehdr + offsetof(Elf64_Ehdr, e_phoff), 8);
+        phentsize = read_uint(&r, ehdr + offsetof(Elf64_Ehdr, e_phentsize), 2);
+        phnum = read_uint(&r, ehdr + offsetof(Elf64_Ehdr, e_phnum), 2);
+    } else {
+        phoff = read_uint(&r, ehdr + offsetof(Elf32_Ehdr, e_phoff), 4);
+        phentsize = read_uint(&r, ehdr + offsetof(Elf32_Ehdr, e_phentsize), 2);
+        phnum = read_uint(&r, ehdr + offsetof(Elf32_Ehdr, e_phnum), 2);
+    }
+
+    size_t min_phentsize = r.is_64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr);
+    if (phnum == 0 || phentsize < min_phentsize || phnum * phentsize > ELF_MAX_PHDR_BYTES) {
+        close(fd);
+        return 0; // Relocatable objects and oddities carry no program headers
+    }
+
+    unsigned char *phdrs = malloc((size_t)(phnum * phentsize));
+    elf_load_t *loads = malloc(sizeof(elf_load_t) * (size_t)phnum);
+    if (!phdrs || !loads) {
+        upkg_util_error("Failed to allocate memory for ELF program headers.\n");
+        free(phdrs);
+        free(loads);
+        close(fd);
+        return -1;
+    }
+    if (read_at(fd, phdrs, (size_t)(phnum * phentsize), phoff) != 0) {
+        free(phdrs);
+        free(loads);
+        close(fd);
+        return 0;
+    }
+
+    int load_count = 0;
+    bool has_dynamic = false;
+    uint64_t dyn_offset = 0, dyn_size = 0;
+    for (uint64_t i = 0; i < phnum; i++) {
+        const unsigned char *ph = phdrs + i * phentsize;
+        uint64_t type, offset, vaddr, filesz;
+        if (r.is_64) {
+            type = read_uint(&r, ph + offsetof(Elf64_Phdr, p_type), 4);
+            offset = read_uint(&r, ph + offsetof(Elf64_Phdr, p_offset), 8);
+            vaddr = read_uint(&r, ph + offsetof(Elf64_Phdr, p_vaddr), 8);
+            filesz = read_uint(&r, ph + offsetof(Elf64_Phdr, p_filesz), 8);
+        } else {
+            type = read_uint(&r, ph + offsetof(Elf32_Phdr, p_type), 4);
+            offset = read_uint(&r, ph + offsetof(Elf32_Phdr, p_offset), 4);
+            vaddr = read_uint(&r, ph + offsetof(Elf32_Phdr, p_vaddr), 4);
+            filesz = read_uint(&r, ph + offsetof(Elf32_Phdr, p_filesz), 4);
+        }
+
+        if (type == PT_LOAD) {
+            loads[load_count].vaddr = vaddr;
+            loads[load_count].offset = offset;
+            loads[load_count].filesz = filesz;
+            load_count++;
+        } else if (type == PT_DYNAMIC) {
+            has_dynamic = true;
+            dyn_offset = offset;
+            dyn_size = filesz;
+        }
+    }
+    free(phdrs);
+
+    if (!has_dynamic || dyn_size == 0 || dyn_size > ELF_MAX_DYNAMIC_BYTES) {
+        free(loads);
+        close(fd);
+        return 0; // Static executables have nothing to index
+    }
+
+    unsigned char *dynamic = malloc((size_t)dyn_size);
+    if (!dynamic) {
+        upkg_util_error("Failed to allocate memory for ELF dynamic section.\n");
+        free(loads);
+        close(fd);
+        return -1;
+    }
+    if (read_at(fd, dynamic, (size_t)dyn_size, dyn_offset) != 0) {
+        free(dynamic);
+        free(loads);
+        close(fd);
+        return 0;
+    }
+
+    // First pass: locate the string table and count the entries we want.
+    size_t entsize = r.is_64 ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+    size_t width = r.is_64 ? 8 : 4;
+    uint64_t strtab_vaddr = 0, strsz = 0, soname_off = 0;
+    bool has_strtab = false, has_soname = false;
+    int needed_total = 0;
+    size_t entry_count = 0;
+    for (size_t off = 0; off + entsize <= dyn_size; off += entsize) {
+        uint64_t tag = read_uint(&r, dynamic + off, width);
+        uint64_t val = read_uint(&r, dynamic + off + width, width);
+        entry_count++;
+        if (tag == DT_NULL) break;
+        if (tag == DT_NEEDED) needed_total++;
+        else if (tag == DT_SONAME) { has_soname = true; soname_off = val; }
+        else if (tag == DT_STRTAB) { has_strtab = true; strtab_vaddr = val; }
+        else if (tag == DT_STRSZ) strsz = val;
+    }
+
+    uint64_t strtab_offset;
+    if (!has_strtab || strsz == 0 || strsz > ELF_MAX_STRTAB_BYTES ||
+        vaddr_to_offset(loads, load_count, strtab_vaddr, &strtab_offset) != 0) {
+        free(dynamic);
+        free(loads);
+        close(fd);
+        return 0;
+    }
+    free(loads);
+
+    char *strtab = malloc((size_t)strsz);
+    if (!strtab) {
+        upkg_util_error("Failed to allocate memory for ELF string table.\n");
+        free(dynamic);
+        close(fd);
+        return -1;
+    }
+    if (read_at(fd, strtab, (size_t)strsz, strtab_offset) != 0) {
+        free(strtab);
+        free(dynamic);
+        close(fd);
+        return 0;
+    }
+    close(fd);
+
+    // Second pass: copy the strings out.
+    if (has_soname) {
+        dyn->soname = strtab_dup(strtab, strsz, soname_off);
+    }
+    if (needed_total > 0) {
+        dyn->needed = calloc((size_t)needed_total, sizeof(char *));
+        if (!dyn->needed) {
+            upkg_util_error("Failed to allocate memory for DT_NEEDED list.\n");
+            free(strtab);
+            free(dynamic);
+            upkg_elf_free_dynamic(dyn);
+            return -1;
+        }
+        for (size_t i = 0; i < entry_count; i++) {
+            const unsigned char *entry = dynamic + i * entsize;
+            if (read_uint(&r, entry, width) != DT_NEEDED) continue;
+            char *name = strtab_dup(strtab, strsz, read_uint(&r, entry + width, width));
+            if (name) {
+                dyn->needed[dyn->needed_count++] = name;
+            }
+        }
+    }
+
+    free(strtab);
+    free(dynamic);
+    return 1;
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * Filename:    upkg_elf.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: ELF dynamic section reader (DT_SONAME / DT_NEEDED) for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_ELF_H
+#define UPKG_ELF_H
+
+#include <sys/types.h>
+
+// --- Dynamic Section Summary ---
+
+/**
+ * @brief The shared-library facts upkg needs from one ELF object.
+ */
+typedef struct {
+    char *soname;      // DT_SONAME, or NULL for executables and unversioned objects
+    char **needed;     // DT_NEEDED entries in file order
+    int needed_count;
+} upkg_elf_dynamic_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Reads DT_SONAME and DT_NEEDED from an ELF file's dynamic section.
+ *
+ * Handles 32- and 64-bit objects of either byte order, so packages for
+ * foreign architectures (e.g. arm64 on an amd64 host) are indexed too.
+ *
+ * @param filepath The file to inspect.
+ * @param file_size The file size from an earlier stat, used to skip tiny files.
+ * @param dyn Output structure; free with upkg_elf_free_dynamic.
+ * @return 1 if the file is a dynamic ELF object, 0 if it is not, -1 on a read error.
+ */
+int upkg_elf_read_dynamic(const char *filepath, off_t file_size, upkg_elf_dynamic_t *dyn);
+
+/**
+ * @brief Frees the strings held by a dynamic section summary.
+ * @param dyn The structure to clear.
+ */
+void upkg_elf_free_dynamic(upkg_elf_dynamic_t *dyn);
+
+#endif // UPKG_ELF_H
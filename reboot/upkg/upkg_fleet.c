@@ -0,0 +1,474 @@
+/******************************************************************************
+ * Filename:    upkg_fleet.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Compact installed-set manifests for comparing hosts
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_fleet.h"
+#include "upkg_hash.h"
+#include "upkg_manifest.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#define FLEET_MAGIC "UPKGFLT1"
+#define FLEET_HEADER_SIZE 24
+#define FLEET_PACKAGE_SIZE (20 + UPKG_SHA256_DIGEST_LENGTH)
+#define FLEET_FILE_SIZE (4 + UPKG_SHA256_DIGEST_LENGTH)
+
+// --- Byte Buffers ---
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} fleet_buf_t;
+
+/**
+ * @brief Appends bytes to a growable buffer.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int buf_append(fleet_buf_t *buf, const void *data, size_t len) {
+    if (buf->len + len > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap < buf->len + len) cap *= 2;
+        uint8_t *grown = realloc(buf->data, cap);
+        if (!grown) return -1;
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+/**
+ * @brief Appends a little-endian u32.
+ */
+static int buf_put_u32(fleet_buf_t *buf, uint32_t v) {
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return buf_append(buf, b, sizeof(b));
+}
+
+/**
+ * @brief Appends a NUL-terminated string to the string table.
+ * @return The string's offset, or UINT32_MAX if out of memory.
+ */
+static uint32_t buf_put_string(fleet_buf_t *strings, const char *s) {
+    uint32_t offset = (uint32_t)strings->len;
+    if (buf_append(strings, s ? s : "", strlen(s ? s : "") + 1) != 0) return UINT32_MAX;
+    return offset;
+}
+
+/**
+ * @brief Reads a little-endian u32.
+ */
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// --- Merkle Roots ---
+
+/**
+ * @brief Computes the Merkle root of a package's files (already sorted by path).
+ * @return 0 on success, -1 if out of memory.
+ */
+static int merkle_root(const upkg_fleet_file_t *files, uint32_t count, uint8_t root[UPKG_SHA256_DIGEST_LENGTH]) {
+    upkg_sha256_ctx_t ctx;
+    if (count == 0) {
+        upkg_digest_sha256_init(&ctx);
+        upkg_digest_sha256_final(&ctx, root);
+        return 0;
+    }
+
+    uint8_t (*level)[UPKG_SHA256_DIGEST_LENGTH] = malloc((size_t)count * UPKG_SHA256_DIGEST_LENGTH);
+    if (!level) return -1;
+    static const uint8_t leaf_tag = 0x00, node_tag = 0x01;
+    for (uint32_t i = 0; i < count; i++) {
+        upkg_digest_sha256_init(&ctx);
+        upkg_digest_sha256_update(&ctx, &leaf_tag, 1);
+        upkg_digest_sha256_update(&ctx, files[i].path, strlen(files[i].path) + 1);
+        upkg_digest_sha256_update(&ctx, files[i].digest, UPKG_SHA256_DIGEST_LENGTH);
+        upkg_digest_sha256_final(&ctx, level[i]);
+    }
+
+    // Pair nodes level by level; an odd node out is carried up unchanged
+    for (uint32_t n = count; n > 1; n = (n + 1) / 2) {
+        for (uint32_t i = 0; i < n / 2; i++) {
+            upkg_digest_sha256_init(&ctx);
+            upkg_digest_sha256_update(&ctx, &node_tag, 1);
+            upkg_digest_sha256_update(&ctx, level[2 * i], 2 * UPKG_SHA256_DIGEST_LENGTH);
+            upkg_digest_sha256_final(&ctx, level[i]);
+        }
+        if (n % 2) memmove(level[n / 2], level[n - 1], UPKG_SHA256_DIGEST_LENGTH);
+    }
+    memcpy(root, level[0], UPKG_SHA256_DIGEST_LENGTH);
+    free(level);
+    return 0;
+}
+
+// --- Export ---
+
+/**
+ * @brief qsort comparator for package names.
+ */
+static int compare_package_nodes(const void *a, const void *b) {
+    const upkg_hash_package_info_t *pa = *(const upkg_hash_package_info_t *const *)a;
+    const upkg_hash_package_info_t *pb = *(const upkg_hash_package_info_t *const *)b;
+    return strcmp(pa->package_name, pb->package_name);
+}
+
+/**
+ * @brief qsort comparator for file paths.
+ */
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const upkg_fleet_file_t *)a)->path, ((const upkg_fleet_file_t *)b)->path);
+}
+
+/**
+ * @brief Appends one package's record, files and strings.
+ * @return 0 on success, -1 on failure.
+ */
+static int export_package(const upkg_hash_package_info_t *pkg, fleet_buf_t *records, fleet_buf_t *files,
+                          fleet_buf_t *strings, uint32_t *file_total) {
+    static const uint8_t no_digest[UPKG_SHA256_DIGEST_LENGTH] = { 0 };
+    upkg_manifest_t manifest;
+    bool have_manifest = upkg_manifest_read(pkg->package_name, &manifest) == 0;
+    uint32_t count = have_manifest ? (uint32_t)manifest.count : (uint32_t)pkg->file_count;
+    if (!have_manifest) {
+        upkg_util_log_verbose("%s has no manifest; exporting its files without digests.\n", pkg->package_name);
+    }
+
+    upkg_fleet_file_t *list = calloc(count ? count : 1, sizeof(*list));
+    if (!list) {
+        if (have_manifest) upkg_manifest_free(&manifest);
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        list[i].path = have_manifest ? manifest.entries[i].path : pkg->file_list[i];
+        list[i].digest = have_manifest ? manifest.entries[i].digest : no_digest;
+    }
+    qsort(list, count, sizeof(*list), compare_files);
+
+    uint8_t root[UPKG_SHA256_DIGEST_LENGTH];
+    int ret = merkle_root(list, count, root);
+    if (ret == 0) {
+        uint32_t name = buf_put_string(strings, pkg->package_name);
+        uint32_t arch = buf_put_string(strings, pkg->architecture);
+        uint32_t version = buf_put_string(strings, pkg->version);
+        ret = (name == UINT32_MAX || arch == UINT32_MAX || version == UINT32_MAX) ? -1 : 0;
+        if (ret == 0) {
+            ret = buf_put_u32(records, name) | buf_put_u32(records, arch) | buf_put_u32(records, version) |
+                  buf_put_u32(records, *file_total) | buf_put_u32(records, count) |
+                  buf_append(records, root, sizeof(root));
+        }
+    }
+    for (uint32_t i = 0; i < count && ret == 0; i++) {
+        uint32_t path = buf_put_string(strings, list[i].path);
+        ret = path == UINT32_MAX ? -1 : buf_put_u32(files, path) | buf_append(files, list[i].digest, UPKG_SHA256_DIGEST_LENGTH);
+    }
+    *file_total += count;
+
+    free(list);
+    if (have_manifest) upkg_manifest_free(&manifest);
+    return ret;
+}
+
+/**
+ * @brief Writes the installed-set manifest of the loaded database.
+ */
+int upkg_fleet_export(const char *path, uint32_t *package_count, uint32_t *file_count) {
+    if (!upkg_main_hash_table) return -1;
+
+    size_t count = 0;
+    const upkg_hash_package_info_t **sorted = calloc(upkg_main_hash_table->count + 1, sizeof(*sorted));
+    if (!sorted) return -1;
+    for (size_t b = 0; b < upkg_main_hash_table->size; b++) {
+        for (upkg_hash_node_t *node = upkg_main_hash_table->buckets[b]; node; node = node->next) {
+            if (count < upkg_main_hash_table->count) sorted[count++] = &node->data;
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), compare_package_nodes);
+
+    fleet_buf_t records = { 0 }, files = { 0 }, strings = { 0 }, out = { 0 };
+    uint32_t file_total = 0;
+    int ret = 0;
+    for (size_t i = 0; i < count && ret == 0; i++) {
+        ret = export_package(sorted[i], &records, &files, &strings, &file_total);
+    }
+
+    if (ret == 0) {
+        uint32_t crc = upkg_digest_crc32c(0, records.data, records.len);
+        crc = upkg_digest_crc32c(crc, files.data, files.len);
+        crc = upkg_digest_crc32c(crc, strings.data, strings.len);
+        ret = buf_append(&out, FLEET_MAGIC, 8) | buf_put_u32(&out, (uint32_t)count) |
+              buf_put_u32(&out, file_total) | buf_put_u32(&out, (uint32_t)strings.len) | buf_put_u32(&out, crc);
+        if (records.len) ret |= buf_append(&out, records.data, records.len);
+        if (files.len) ret |= buf_append(&out, files.data, files.len);
+        if (strings.len) ret |= buf_append(&out, strings.data, strings.len);
+    }
+    if (ret == 0) {
+        ret = upkg_util_write_file_atomic(path, (const char *)out.data, out.len);
+    }
+    if (ret != 0) {
+        upkg_util_error("Failed to export the installed-set manifest to %s.\n", path);
+    } else {
+        if (package_count) *package_count = (uint32_t)count;
+        if (file_count) *file_count = file_total;
+    }
+
+    free(records.data);
+    free(files.data);
+    free(strings.data);
+    free(out.data);
+    free(sorted);
+    return ret;
+}
+
+// --- Reading ---
+
+/**
+ * @brief Reads and validates an installed-set manifest.
+ */
+int upkg_fleet_read(const char *path, upkg_fleet_manifest_t *manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    size_t size = 0;
+    char *data = upkg_util_read_file_content(path, &size);
+    if (!data) {
+        upkg_util_error("Cannot read manifest %s.\n", path);
+        return -1;
+    }
+
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t packages = 0, files = 0, string_size = 0;
+    bool valid = size >= FLEET_HEADER_SIZE && memcmp(p, FLEET_MAGIC, 8) == 0;
+    if (valid) {
+        packages = get_u32(p + 8);
+        files = get_u32(p + 12);
+        string_size = get_u32(p + 16);
+        valid = (uint64_t)FLEET_HEADER_SIZE + (uint64_t)packages * FLEET_PACKAGE_SIZE +
+                (uint64_t)files * FLEET_FILE_SIZE + string_size == size &&
+                upkg_digest_crc32c(0, p + FLEET_HEADER_SIZE, size - FLEET_HEADER_SIZE) == get_u32(p + 20) &&
+                (string_size == 0 || data[size - 1] == '\0');
+    }
+
+    const uint8_t *package_base = p + FLEET_HEADER_SIZE;
+    const uint8_t *file_base = package_base + (size_t)packages * FLEET_PACKAGE_SIZE;
+    const char *string_base = (const char *)file_base + (size_t)files * FLEET_FILE_SIZE;
+    if (valid) {
+        manifest->packages = calloc(packages ? packages : 1, sizeof(*manifest->packages));
+        manifest->files = calloc(files ? files : 1, sizeof(*manifest->files));
+        valid = manifest->packages && manifest->files;
+    }
+
+    for (uint32_t i = 0; valid && i < files; i++) {
+        const uint8_t *f = file_base + (size_t)i * FLEET_FILE_SIZE;
+        uint32_t offset = get_u32(f);
+        valid = offset < string_size;
+        manifest->files[i].path = string_base + offset;
+        manifest->files[i].digest = f + 4;
+    }
+    for (uint32_t i = 0; valid && i < packages; i++) {
+        const uint8_t *r = package_base + (size_t)i * FLEET_PACKAGE_SIZE;
+        uint32_t name = get_u32(r), arch = get_u32(r + 4), version = get_u32(r + 8);
+        uint32_t first = get_u32(r + 12), count = get_u32(r + 16);
+        valid = name < string_size && arch < string_size && version < string_size &&
+                first <= files && count <= files - first;
+        if (!valid) break;
+
+        upkg_fleet_package_t *pkg = &manifest->packages[i];
+        pkg->name = string_base + name;
+        pkg->architecture = string_base + arch;
+        pkg->version = string_base + version;
+        pkg->files = manifest->files + first;
+        pkg->file_count = count;
+        pkg->root = r + 20;
+
+        // The diff merge-joins, so the sort order is part of the format
+        valid = i == 0 || strcmp(manifest->packages[i - 1].name, pkg->name) < 0;
+        for (uint32_t j = 1; valid && j < count; j++) {
+            valid = strcmp(pkg->files[j - 1].path, pkg->files[j].path) < 0;
+        }
+    }
+
+    if (!valid) {
+        upkg_util_error("%s is not a valid installed-set manifest.\n", path);
+        free(data);
+        upkg_fleet_free(manifest);
+        return -1;
+    }
+    manifest->data = data;
+    manifest->size = size;
+    manifest->package_count = packages;
+    manifest->file_count = files;
+    return 0;
+}
+
+/**
+ * @brief Frees a loaded manifest.
+ */
+void upkg_fleet_free(upkg_fleet_manifest_t *manifest) {
+    if (!manifest) return;
+    free(manifest->packages);
+    free(manifest->files);
+    free(manifest->data);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+// --- Diff ---
+
+/**
+ * @brief Orders the characters of a Debian version fragment: '~' sorts
+ *        before everything (even the end), letters before other symbols.
+ */
+static int version_char_order(int c) {
+    if (isdigit(c)) return 0;
+    if (isalpha(c)) return c;
+    if (c == '~') return -1;
+    if (c) return c + 256;
+    return 0;
+}
+
+/**
+ * @brief Compares two upstream or revision strings the way dpkg does.
+ */
+static int compare_version_part(const char *a, const char *b) {
+    while (*a || *b) {
+        int diff = 0;
+        while ((*a && !isdigit((unsigned char)*a)) || (*b && !isdigit((unsigned char)*b))) {
+            int ac = version_char_order((unsigned char)*a);
+            int bc = version_char_order((unsigned char)*b);
+            if (ac != bc) return ac - bc;
+            a++;
+            b++;
+        }
+        while (*a == '0') a++;
+        while (*b == '0') b++;
+        while (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+            if (!diff) diff = *a - *b;
+            a++;
+            b++;
+        }
+        if (isdigit((unsigned char)*a)) return 1;
+        if (isdigit((unsigned char)*b)) return -1;
+        if (diff) return diff;
+    }
+    return 0;
+}
+
+/**
+ * @brief Compares two Debian versions ([epoch:]upstream[-revision]).
+ * @return <0, 0 or >0.
+ */
+static int compare_versions(const char *a, const char *b) {
+    long epoch_a = 0, epoch_b = 0;
+    const char *colon = strchr(a, ':');
+    if (colon) { epoch_a = strtol(a, NULL, 10); a = colon + 1; }
+    colon = strchr(b, ':');
+    if (colon) { epoch_b = strtol(b, NULL, 10); b = colon + 1; }
+    if (epoch_a != epoch_b) return epoch_a < epoch_b ? -1 : 1;
+
+    char *ua = strdup(a), *ub = strdup(b);
+    if (!ua || !ub) {
+        free(ua);
+        free(ub);
+        return strcmp(a, b);
+    }
+    char *dash_a = strrchr(ua, '-'), *dash_b = strrchr(ub, '-');
+    if (dash_a) *dash_a++ = '\0';
+    if (dash_b) *dash_b++ = '\0';
+    int ret = compare_version_part(ua, ub);
+    if (ret == 0) ret = compare_version_part(dash_a ? dash_a : "", dash_b ? dash_b : "");
+    free(ua);
+    free(ub);
+    return ret;
+}
+
+/**
+ * @brief Merge-joins the file lists of one package on both sides and
+ *        prints added, removed and changed files.
+ */
+static void diff_files(const upkg_fleet_package_t *a, const upkg_fleet_package_t *b, unsigned long *compared) {
+    uint32_t i = 0, j = 0;
+    while (i < a->file_count || j < b->file_count) {
+        int cmp = i == a->file_count ? 1 : j == b->file_count ? -1 : strcmp(a->files[i].path, b->files[j].path);
+        if (cmp < 0) {
+            printf("    - %s\n", a->files[i++].path);
+        } else if (cmp > 0) {
+            printf("    + %s\n", b->files[j++].path);
+        } else {
+            if (memcmp(a->files[i].digest, b->files[j].digest, UPKG_SHA256_DIGEST_LENGTH) != 0) {
+                printf("    M %s\n", a->files[i].path);
+            }
+            (*compared)++;
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * @brief Merge-joins two manifests and prints what differs.
+ */
+void upkg_fleet_diff(const upkg_fleet_manifest_t *a, const upkg_fleet_manifest_t *b,
+                     upkg_fleet_diff_counts_t *counts) {
+    memset(counts, 0, sizeof(*counts));
+    uint32_t i = 0, j = 0;
+    while (i < a->package_count || j < b->package_count) {
+        int cmp = i == a->package_count ? 1 : j == b->package_count ? -1
+                : strcmp(a->packages[i].name, b->packages[j].name);
+        if (cmp < 0) {
+            printf("- %s %s\n", a->packages[i].name, a->packages[i].version);
+            counts->only_a++;
+            i++;
+            continue;
+        }
+        if (cmp > 0) {
+            printf("+ %s %s\n", b->packages[j].name, b->packages[j].version);
+            counts->only_b++;
+            j++;
+            continue;
+        }
+
+        const upkg_fleet_package_t *pa = &a->packages[i++], *pb = &b->packages[j++];
+        bool same_files = memcmp(pa->root, pb->root, UPKG_SHA256_DIGEST_LENGTH) == 0;
+        bool same_version = strcmp(pa->version, pb->version) == 0;
+        bool same_arch = strcmp(pa->architecture, pb->architecture) == 0;
+        if (same_files && same_version && same_arch) {
+            counts->identical++;
+            continue;
+        }
+
+        counts->changed++;
+        if (!same_version) {
+            int order = compare_versions(pa->version, pb->version);
+            printf("~ %s %s -> %s (%s)\n", pa->name, pa->version, pb->version,
+                   order < 0 ? "newer" : order > 0 ? "older" : "equal");
+        } else {
+            printf("~ %s %s\n", pa->name, pa->version);
+        }
+        if (!same_arch) printf("    arch %s -> %s\n", pa->architecture, pb->architecture);
+        if (!same_files) diff_files(pa, pb, &counts->files_compared);
+    }
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * Filename:    upkg_fleet.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Compact installed-set manifests for comparing hosts
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_FLEET_H
+#define UPKG_FLEET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "upkg_digest.h"
+
+/*
+ * An installed-set manifest describes everything installed on a host in
+ * one small binary file, so manifests from many hosts can be compared
+ * without touching the hosts again. All integers are little-endian:
+ *
+ *   header    "UPKGFLT1", <u32 packages><u32 files><u32 string bytes>
+ *             <u32 CRC-32C of everything after the header>
+ *   packages  52 bytes each, sorted by name:
+ *             <u32 name><u32 arch><u32 version><u32 first file>
+ *             <u32 file count><32-byte Merkle root>
+ *   files     36 bytes each, sorted by path within a package:
+ *             <u32 path><32-byte SHA-256>
+ *   strings   NUL-terminated; the u32 fields above are offsets into them
+ *
+ * File digests come from the package manifests recorded at install time.
+ * A package's Merkle root is built over SHA-256(0x00 path 0x00 digest)
+ * leaves in path order, with SHA-256(0x01 left right) inner nodes, so two
+ * packages with equal roots have the same files and contents and a diff
+ * can skip them without looking at a single file.
+ */
+
+// --- Manifest Structures ---
+typedef struct {
+    const char *path;
+    const uint8_t *digest;              // UPKG_SHA256_DIGEST_LENGTH bytes
+} upkg_fleet_file_t;
+
+typedef struct {
+    const char *name;
+    const char *architecture;
+    const char *version;
+    const upkg_fleet_file_t *files;     // Sorted by path
+    uint32_t file_count;
+    const uint8_t *root;                // Merkle root over files
+} upkg_fleet_package_t;
+
+// A loaded manifest; the pointers above point into data
+typedef struct {
+    char *data;
+    size_t size;
+    upkg_fleet_package_t *packages;     // Sorted by name
+    uint32_t package_count;
+    upkg_fleet_file_t *files;
+    uint32_t file_count;
+} upkg_fleet_manifest_t;
+
+// --- Diff Counters ---
+typedef struct {
+    unsigned long identical;
+    unsigned long changed;              // Different version, arch or files
+    unsigned long only_a;
+    unsigned long only_b;
+    unsigned long files_compared;       // Per-file comparisons actually made
+} upkg_fleet_diff_counts_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Writes the installed-set manifest of the loaded database.
+ * @param path The output file.
+ * @param package_count If non-NULL, receives the number of packages written.
+ * @param file_count If non-NULL, receives the number of files written.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_fleet_export(const char *path, uint32_t *package_count, uint32_t *file_count);
+
+/**
+ * @brief Reads and validates an installed-set manifest.
+ * @param path The manifest file.
+ * @param manifest Output; free with upkg_fleet_free.
+ * @return 0 on success, -1 if missing, truncated or corrupt.
+ */
+int upkg_fleet_read(const char *path, upkg_fleet_manifest_t *manifest);
+
+/**
+ * @brief Frees a loaded manifest.
+ * @param manifest The manifest to clear.
+ */
+void upkg_fleet_free(upkg_fleet_manifest_t *manifest);
+
+/**
+ * @brief Merge-joins two manifests and prints what differs: packages only
+ *        on one side, version and architecture changes, and for packages
+ *        whose Merkle roots differ, the added, removed and changed files.
+ * @param a The first manifest.
+ * @param b The second manifest.
+ * @param counts Output counters.
+ */
+void upkg_fleet_diff(const upkg_fleet_manifest_t *a, const upkg_fleet_manifest_t *b,
+                     upkg_fleet_diff_counts_t *counts);
+
+#endif // UPKG_FLEET_H
@@ -0,0 +1,483 @@
+/******************************************************************************
+ * Filename:    upkg_format.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Compiled output templates and buffered writer for upkg queries
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_format.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// --- Fields ---
+
+#define SCALAR(name, member) { name, UPKG_FIELD_STRING, offsetof(upkg_hash_package_info_t, member), 0 }
+#define LIST(name, member, count) \
+    { name, UPKG_FIELD_LIST, offsetof(upkg_hash_package_info_t, member), offsetof(upkg_hash_package_info_t, count) }
+
+enum {
+    F_PACKAGE, F_VERSION, F_ARCHITECTURE, F_MAINTAINER, F_SECTION, F_PRIORITY, F_INSTALLED_SIZE,
+    F_DEPENDS, F_HOMEPAGE, F_DESCRIPTION, F_FILENAME, F_FILES, F_DIRS, F_PROVIDES_LIBS, F_NEEDS_LIBS
+};
+
+static const upkg_format_field_t format_fields[] = {
+    [F_PACKAGE]        = SCALAR("Package", package_name),
+    [F_VERSION]        = SCALAR("Version", version),
+    [F_ARCHITECTURE]   = SCALAR("Architecture", architecture),
+    [F_MAINTAINER]     = SCALAR("Maintainer", maintainer),
+    [F_SECTION]        = SCALAR("Section", section),
+    [F_PRIORITY]       = SCALAR("Priority", priority),
+    [F_INSTALLED_SIZE] = SCALAR("Installed-Size", installed_size),
+    [F_DEPENDS]        = SCALAR("Depends", depends),
+    [F_HOMEPAGE]       = SCALAR("Homepage", homepage),
+    [F_DESCRIPTION]    = SCALAR("Description", description),
+    [F_FILENAME]       = SCALAR("Filename", filename),
+    [F_FILES]          = LIST("Files", file_list, file_count),
+    [F_DIRS]           = LIST("Dirs", dir_list, dir_count),
+    [F_PROVIDES_LIBS]  = LIST("Provides-Libs", provided_sonames, provided_soname_count),
+    [F_NEEDS_LIBS]     = LIST("Needs-Libs", needed_sonames, needed_soname_count),
+};
+#define FORMAT_FIELD_COUNT ((int)(sizeof(format_fields) / sizeof(format_fields[0])))
+
+// --- Ops ---
+
+typedef enum {
+    OP_LITERAL,     // text
+    OP_FIELD,       // text, value (padded to width), suffix
+    OP_LIST,        // text once, then item + entry + suffix per entry
+    OP_COUNT        // the number of entries in a list field
+} format_op_kind_t;
+
+typedef struct {
+    format_op_kind_t kind;
+    const char *text;       // OP_LITERAL: the text; otherwise printed before a present value
+    size_t text_len;
+    int field;
+    int width;              // 0: none; negative: left-aligned
+    int optional;           // skip text and suffix too when the field is unset
+    const char *item;       // OP_LIST: printed before each entry
+    const char *suffix;     // printed after the value, or after each entry
+    const char *empty;      // printed instead when the field is unset or has no entries
+} format_op_t;
+
+struct upkg_format {
+    const upkg_format_field_t *fields;
+    const format_op_t *ops;
+    int count;
+    char *storage;          // literal text of a compiled template
+};
+
+#define TEXT(s) .text = (s), .text_len = sizeof(s) - 1
+#define LIT(s) { .kind = OP_LITERAL, TEXT(s) }
+#define LINE(label, f) { .kind = OP_FIELD, TEXT(label), .field = (f), .optional = 1, .suffix = "\n" }
+
+static const format_op_t list_ops[] = {
+    { .kind = OP_FIELD, .field = F_PACKAGE, .optional = 1, .suffix = "\n" },
+};
+
+static const format_op_t status_ops[] = {
+    LIT("Hash Table Package Information:\n==============================\n"),
+    LINE("Package:      ", F_PACKAGE),
+    LINE("Version:      ", F_VERSION),
+    LINE("Architecture: ", F_ARCHITECTURE),
+    LINE("Maintainer:   ", F_MAINTAINER),
+    LINE("Section:      ", F_SECTION),
+    LINE("Priority:     ", F_PRIORITY),
+    LINE("Installed-Size: ", F_INSTALLED_SIZE),
+    LINE("Depends:      ", F_DEPENDS),
+    LINE("Homepage:     ", F_HOMEPAGE),
+    LINE("Description:  ", F_DESCRIPTION),
+    LINE("Filename:     ", F_FILENAME),
+    LIT("\nHash Table File List ("),
+    { .kind = OP_COUNT, .field = F_FILES },
+    LIT(" files):\n"),
+    { .kind = OP_LIST, TEXT("================================\n"), .field = F_FILES,
+      .item = "  ", .suffix = "\n", .empty = "  (No files or empty package)\n" },
+    { .kind = OP_LIST, TEXT("\nProvides Libraries:\n"), .field = F_PROVIDES_LIBS, .item = "  ", .suffix = "\n" },
+    { .kind = OP_LIST, TEXT("\nNeeds Libraries:\n"), .field = F_NEEDS_LIBS, .item = "  ", .suffix = "\n" },
+    LIT("\n"),
+};
+
+static const format_op_t search_ops[] = {
+    { .kind = OP_FIELD, .field = F_PACKAGE },
+    { .kind = OP_FIELD, TEXT(" "), .field = F_VERSION, .optional = 1, .empty = " -" },
+    LIT(" - "),
+    { .kind = OP_FIELD, .field = F_DESCRIPTION },
+    LIT("\n"),
+};
+
+static const format_op_t contents_ops[] = {
+    { .kind = OP_LIST, .field = F_FILES, .suffix = "\n" },
+};
+
+static const upkg_format_t builtin_formats[] = {
+    [UPKG_FORMAT_LIST]     = { format_fields, list_ops, (int)(sizeof(list_ops) / sizeof(list_ops[0])), NULL },
+    [UPKG_FORMAT_STATUS]   = { format_fields, status_ops, (int)(sizeof(status_ops) / sizeof(status_ops[0])), NULL },
+    [UPKG_FORMAT_SEARCH]   = { format_fields, search_ops, (int)(sizeof(search_ops) / sizeof(search_ops[0])), NULL },
+    [UPKG_FORMAT_CONTENTS] = { format_fields, contents_ops, (int)(sizeof(contents_ops) / sizeof(contents_ops[0])), NULL },
+};
+
+// --- Output Buffer ---
+
+/**
+ * @brief Prepares an output buffer for a file descriptor.
+ */
+void upkg_out_init(upkg_out_t *out, int fd) {
+    if (fd == STDOUT_FILENO) fflush(stdout);
+    else if (fd == STDERR_FILENO) fflush(stderr);
+    out->fd = fd;
+    out->error = 0;
+    out->len = 0;
+}
+
+/**
+ * @brief Writes the buffered bytes followed by an optional extra piece
+ *        with one writev, retrying after short writes and EINTR.
+ * @param out The output buffer.
+ * @param extra Bytes to write after the buffer, or NULL.
+ * @param extra_len The number of extra bytes.
+ */
+static void out_drain(upkg_out_t *out, const char *extra, size_t extra_len) {
+    struct iovec iov[2] = {
+        { out->buf, out->len },
+        { (void *)extra, extra_len },
+    };
+    int first = out->len > 0 ? 0 : 1;
+    int last = extra_len > 0 ? 2 : 1;
+    out->len = 0;
+
+    while (first < last && !out->error) {
+        ssize_t n = writev(out->fd, iov + first, last - first);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            out->error = errno;
+            break;
+        }
+        size_t done = (size_t)n;
+        while (first < last && done >= iov[first].iov_len) {
+            done -= iov[first].iov_len;
+            first++;
+        }
+        if (first < last) {
+            iov[first].iov_base = (char *)iov[first].iov_base + done;
+            iov[first].iov_len -= done;
+        }
+    }
+}
+
+/**
+ * @brief Appends bytes to the buffer, writing it out when full.
+ */
+void upkg_out_write(upkg_out_t *out, const char *data, size_t len) {
+    if (len <= sizeof(out->buf) - out->len) {
+        memcpy(out->buf + out->len, data, len);
+        out->len += len;
+        return;
+    }
+    if (len >= sizeof(out->buf)) {
+        out_drain(out, data, len);
+        return;
+    }
+    // Fill the buffer, write it, and keep the rest
+    size_t take = sizeof(out->buf) - out->len;
+    memcpy(out->buf + out->len, data, take);
+    out->len += take;
+    out_drain(out, NULL, 0);
+    memcpy(out->buf, data + take, len - take);
+    out->len = len - take;
+}
+
+/**
+ * @brief Appends a NUL-terminated string.
+ */
+void upkg_out_puts(upkg_out_t *out, const char *str) {
+    upkg_out_write(out, str, strlen(str));
+}
+
+/**
+ * @brief Appends printf-style formatted text.
+ */
+void upkg_out_printf(upkg_out_t *out, const char *format, ...) {
+    va_list args;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t room = sizeof(out->buf) - out->len;
+        va_start(args, format);
+        int n = vsnprintf(out->buf + out->len, room, format, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            out->len += (size_t)n;
+            return;
+        }
+        if (attempt == 0 && out->len > 0) {
+            out_drain(out, NULL, 0);
+            continue;
+        }
+        // Longer than the whole buffer: format on the heap
+        char *text = malloc((size_t)n + 1);
+        if (!text) return;
+        va_start(args, format);
+        vsnprintf(text, (size_t)n + 1, format, args);
+        va_end(args);
+        upkg_out_write(out, text, (size_t)n);
+        free(text);
+        return;
+    }
+}
+
+/**
+ * @brief Writes everything buffered so far.
+ */
+int upkg_out_flush(upkg_out_t *out) {
+    if (out->len > 0) out_drain(out, NULL, 0);
+    return out->error ? -1 : 0;
+}
+
+// --- Rendering ---
+
+/**
+ * @brief Writes a value padded to an op's width.
+ * @param out The output buffer.
+ * @param value The value.
+ * @param len The length of value.
+ * @param width 0 for no padding, N to right-align, -N to left-align.
+ */
+static void out_padded(upkg_out_t *out, const char *value, size_t len, int width) {
+    static const char spaces[] = "                                ";
+    size_t target = (size_t)(width < 0 ? -width : width);
+    size_t pad = target > len ? target - len : 0;
+
+    if (width < 0) upkg_out_write(out, value, len);
+    while (pad > 0) {
+        size_t n = pad < sizeof(spaces) - 1 ? pad : sizeof(spaces) - 1;
+        upkg_out_write(out, spaces, n);
+        pad -= n;
+    }
+    if (width >= 0) upkg_out_write(out, value, len);
+}
+
+/**
+ * @brief Renders one record through a template compiled for its fields.
+ */
+void upkg_format_render_record(const upkg_format_t *format, const void *record, upkg_out_t *out) {
+    if (!format || !record || !out) return;
+
+    const char *base = record;
+    for (int i = 0; i < format->count; i++) {
+        const format_op_t *op = &format->ops[i];
+        const upkg_format_field_t *field = &format->fields[op->field];
+
+        switch (op->kind) {
+        case OP_LITERAL:
+            upkg_out_write(out, op->text, op->text_len);
+            break;
+
+        case OP_FIELD: {
+            char digits[24];
+            const char *value;
+            if (field->type == UPKG_FIELD_INT) {
+                snprintf(digits, sizeof(digits), "%" PRId64, *(const int64_t *)(base + field->offset));
+                value = digits;
+            } else {
+                value = *(char *const *)(base + field->offset);
+            }
+            if (!value && op->optional) {
+                if (op->empty) upkg_out_puts(out, op->empty);
+                break;
+            }
+            if (op->text) upkg_out_write(out, op->text, op->text_len);
+            out_padded(out, value ? value : "", value ? strlen(value) : 0, op->width);
+            if (op->suffix) upkg_out_puts(out, op->suffix);
+            break;
+        }
+
+        case OP_LIST: {
+            char *const *list = *(char *const *const *)(base + field->offset);
+            int count = *(const int *)(base + field->count_offset);
+            if (!list || count <= 0) {
+                if (op->empty) upkg_out_puts(out, op->empty);
+                break;
+            }
+            if (op->text) upkg_out_write(out, op->text, op->text_len);
+            for (int j = 0; j < count; j++) {
+                if (!list[j]) continue;
+                if (op->item) upkg_out_puts(out, op->item);
+                upkg_out_puts(out, list[j]);
+                if (op->suffix) upkg_out_puts(out, op->suffix);
+            }
+            break;
+        }
+
+        case OP_COUNT: {
+            char digits[16];
+            int n = snprintf(digits, sizeof(digits), "%d", *(const int *)(base + field->count_offset));
+            out_padded(out, digits, (size_t)n, op->width);
+            break;
+        }
+        }
+    }
+}
+
+/**
+ * @brief Renders one package through a compiled template.
+ */
+void upkg_format_render(const upkg_format_t *format, const upkg_hash_package_info_t *pkg_info, upkg_out_t *out) {
+    upkg_format_render_record(format, pkg_info, out);
+}
+
+/**
+ * @brief Returns one of the built-in human-readable formats.
+ */
+const upkg_format_t *upkg_format_builtin(upkg_format_builtin_t which) {
+    return &builtin_formats[which];
+}
+
+// --- Compilation ---
+
+/**
+ * @brief Appends an op to a growing array.
+ * @param ops The array, reallocated as needed.
+ * @param count The number of ops so far.
+ * @param capacity The allocated number of ops.
+ * @param op The op to append.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int push_op(format_op_t **ops, int *count, int *capacity, const format_op_t *op) {
+    if (*count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 8;
+        format_op_t *grown = realloc(*ops, (size_t)new_capacity * sizeof(**ops));
+        if (!grown) return -1;
+        *ops = grown;
+        *capacity = new_capacity;
+    }
+    (*ops)[(*count)++] = *op;
+    return 0;
+}
+
+/**
+ * @brief Compiles a template into an op list.
+ */
+upkg_format_t *upkg_format_compile(const char *text) {
+    return upkg_format_compile_fields(text, format_fields, FORMAT_FIELD_COUNT);
+}
+
+/**
+ * @brief Compiles a template against a caller's field table.
+ */
+upkg_format_t *upkg_format_compile_fields(const char *text, const upkg_format_field_t *fields, int field_count) {
+    if (!text || !fields) return NULL;
+
+    upkg_format_t *format = calloc(1, sizeof(*format));
+    // Unescaped literals are never longer than the template itself
+    char *storage = malloc(strlen(text) + 1);
+    format_op_t *ops = NULL;
+    int count = 0, capacity = 0;
+    if (!format || !storage) goto fail_oom;
+
+    char *lit = storage;          // start of the literal being collected
+    char *end = storage;
+    const char *p = text;
+    while (1) {
+        if (*p == '\0' || (p[0] == '$' && p[1] == '{')) {
+            if (end > lit) {
+                format_op_t op = { .kind = OP_LITERAL, .text = lit, .text_len = (size_t)(end - lit) };
+                if (push_op(&ops, &count, &capacity, &op) != 0) goto fail_oom;
+                lit = end;
+            }
+            if (*p == '\0') break;
+
+            const char *name = p + 2;
+            const char *close = strchr(name, '}');
+            if (!close) {
+                upkg_util_error("Format: unterminated '${' at column %d.\n", (int)(p - text) + 1);
+                goto fail;
+            }
+            const char *semi = memchr(name, ';', (size_t)(close - name));
+            size_t name_len = (size_t)((semi ? semi : close) - name);
+
+            format_op_t op = { .kind = OP_FIELD, .field = -1 };
+            for (int f = 0; f < field_count; f++) {
+                if (strlen(fields[f].name) == name_len && strncasecmp(fields[f].name, name, name_len) == 0) {
+                    op.field = f;
+                    break;
+                }
+            }
+            if (op.field < 0) {
+                upkg_util_error("Format: unknown field '%.*s'.\n", (int)name_len, name);
+                goto fail;
+            }
+            if (semi) {
+                char *width_end;
+                long width = strtol(semi + 1, &width_end, 10);
+                if (width_end != close || semi + 1 == close || width < -4096 || width > 4096) {
+                    upkg_util_error("Format: bad width in '${%.*s}'.\n", (int)(close - name), name);
+                    goto fail;
+                }
+                op.width = (int)width;
+            }
+            if (fields[op.field].type == UPKG_FIELD_LIST) {
+                op.kind = OP_LIST;
+                op.item = " ";
+                op.suffix = "\n";
+            }
+            if (push_op(&ops, &count, &capacity, &op) != 0) goto fail_oom;
+            p = close + 1;
+            continue;
+        }
+
+        if (p[0] == '\\' && (p[1] == 'n' || p[1] == 't' || p[1] == '\\')) {
+            *end++ = p[1] == 'n' ? '\n' : p[1] == 't' ? '\t' : '\\';
+            p += 2;
+        } else {
+            *end++ = *p++;
+        }
+    }
+
+    format->fields = fields;
+    format->ops = ops;
+    format->count = count;
+    format->storage = storage;
+    return format;
+
+fail_oom:
+    upkg_util_error("Format: out of memory.\n");
+fail:
+    free(ops);
+    free(storage);
+    free(format);
+    return NULL;
+}
+
+/**
+ * @brief Frees a template from upkg_format_compile or upkg_format_compile_fields.
+ */
+void upkg_format_free(upkg_format_t *format) {
+    if (!format || !format->storage) return;    // built-in formats are static
+    free((void *)format->ops);
+    free(format->storage);
+    free(format);
+}
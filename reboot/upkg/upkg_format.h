@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Filename:    upkg_format.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Compiled output templates and buffered writer for upkg queries
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_FORMAT_H
+#define UPKG_FORMAT_H
+
+#include "upkg_hash.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Query output (-l, -s, -S, -L, --format) is rendered from templates compiled once
+ * into an op list, dpkg-query -f style:
+ *
+ *   ${Field}       the field's value; unknown fields are a compile error
+ *   ${Field;N}     padded to N columns, right-aligned (-N: left-aligned)
+ *   \n \t \\       newline, tab, backslash
+ *
+ * Field names are case-insensitive: Package, Version, Architecture,
+ * Maintainer, Section, Priority, Installed-Size, Depends, Homepage,
+ * Description, Filename, and the list fields Files, Dirs, Provides-Libs
+ * and Needs-Libs, which print one " entry\n" line per item.
+ *
+ * Other record types (upkg_du.h) compile templates against their own
+ * field tables; integer fields print in decimal.
+ *
+ * Rendered text collects in one upkg_out_t buffer that is written with a
+ * single writev when full or flushed, so listing the whole database is a
+ * copy loop rather than a stream of printf calls. The built-in human
+ * formats run through the same engine.
+ */
+
+#define UPKG_OUT_BUFFER_SIZE (64 * 1024)
+
+// --- Output Buffer ---
+typedef struct {
+    int fd;
+    int error;                        // errno of the first failed write, or 0
+    size_t len;
+    char buf[UPKG_OUT_BUFFER_SIZE];
+} upkg_out_t;
+
+// --- Field Tables ---
+typedef enum {
+    UPKG_FIELD_STRING,      // char *; NULL prints as empty
+    UPKG_FIELD_LIST,        // char ** with an int count
+    UPKG_FIELD_INT          // int64_t
+} upkg_field_type_t;
+
+typedef struct {
+    const char *name;
+    upkg_field_type_t type;
+    size_t offset;          // of the member in the record
+    size_t count_offset;    // of the int count member of a list field
+} upkg_format_field_t;
+
+// --- Compiled Template (opaque) ---
+typedef struct upkg_format upkg_format_t;
+
+// --- Built-in Formats ---
+typedef enum {
+    UPKG_FORMAT_LIST,      // one package name per line
+    UPKG_FORMAT_STATUS,    // the full -s record with files and libraries
+    UPKG_FORMAT_SEARCH,    // one "name version - description" line per -S match
+    UPKG_FORMAT_CONTENTS   // the package's files, one per line (-L)
+} upkg_format_builtin_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Prepares an output buffer for a file descriptor. Pending stdio
+ *        output is flushed first so the two stay in order.
+ * @param out The buffer to initialize.
+ * @param fd The descriptor written on flush.
+ */
+void upkg_out_init(upkg_out_t *out, int fd);
+
+/**
+ * @brief Appends bytes to the buffer, writing it out when full. Pieces
+ *        larger than the buffer go out in the same writev as the
+ *        buffered bytes without being copied.
+ * @param out The output buffer.
+ * @param data The bytes to append.
+ * @param len The number of bytes.
+ */
+void upkg_out_write(upkg_out_t *out, const char *data, size_t len);
+
+/**
+ * @brief Appends a NUL-terminated string.
+ * @param out The output buffer.
+ * @param str The string to append.
+ */
+void upkg_out_puts(upkg_out_t *out, const char *str);
+
+/**
+ * @brief Appends printf-style formatted text.
+ * @param out The output buffer.
+ * @param format printf-style format.
+ */
+void upkg_out_printf(upkg_out_t *out, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Writes everything buffered so far.
+ * @param out The output buffer.
+ * @return 0 on success, -1 if any write since upkg_out_init failed.
+ */
+int upkg_out_flush(upkg_out_t *out);
+
+/**
+ * @brief Compiles a template into an op list.
+ * @param text The template text (see above).
+ * @return The compiled template, or NULL on a syntax error or unknown
+ *         field, which is reported.
+ */
+upkg_format_t *upkg_format_compile(const char *text);
+
+/**
+ * @brief Compiles a template against a caller's field table.
+ * @param text The template text.
+ * @param fields The fields records of this type have.
+ * @param field_count The number of fields.
+ * @return The compiled template, or NULL on a syntax error or unknown
+ *         field, which is reported.
+ */
+upkg_format_t *upkg_format_compile_fields(const char *text, const upkg_format_field_t *fields, int field_count);
+
+/**
+ * @brief Frees a template from upkg_format_compile or upkg_format_compile_fields.
+ * @param format The template, or NULL.
+ */
+void upkg_format_free(upkg_format_t *format);
+
+/**
+ * @brief Returns one of the built-in human-readable formats.
+ * @param which The format.
+ * @return A static template; never freed.
+ */
+const upkg_format_t *upkg_format_builtin(upkg_format_builtin_t which);
+
+/**
+ * @brief Renders one package through a compiled template.
+ * @param format The template.
+ * @param pkg_info The package record.
+ * @param out The output buffer.
+ */
+void upkg_format_render(const upkg_format_t *format, const upkg_hash_package_info_t *pkg_info, upkg_out_t *out);
+
+/**
+ * @brief Renders one record through a template from upkg_format_compile_fields.
+ * @param format The template.
+ * @param record The record the template's field table describes.
+ * @param out The output buffer.
+ */
+void upkg_format_render_record(const upkg_format_t *format, const void *record, upkg_out_t *out);
+
+#endif // UPKG_FORMAT_H
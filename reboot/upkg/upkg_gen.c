@@ -0,0 +1,386 @@
+/******************************************************************************
+ * Filename:    upkg_gen.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Database generations over content-addressed package records
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_gen.h"
+#include "upkg_config.h"
+#include "upkg_digest.h"
+#include "upkg_hash.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define GEN_DIR_NAME ".generations"
+#define GEN_OBJECT_DIR "objects"
+#define GEN_HASH_HEX_LENGTH (UPKG_SHA256_DIGEST_LENGTH * 2)
+
+// Record files captured in an object, in serialisation order
+static const char *const record_files[] = { "control", "files", "sonames", "needed", "dirs", "manifest" };
+#define RECORD_FILE_COUNT (sizeof(record_files) / sizeof(record_files[0]))
+
+// Packages whose records changed since the last generation
+static upkg_index_t *g_dirty = NULL;
+
+// --- Paths ---
+
+/**
+ * @brief Builds a path under <db_dir>/.generations.
+ * @param sub A subdirectory ("objects") or NULL.
+ * @param name The file name, or NULL for the directory itself.
+ * @return The path (caller frees), or NULL.
+ */
+static char *gen_path(const char *sub, const char *name) {
+    char path[PATH_MAX];
+    int n;
+    if (!g_db_dir) return NULL;
+    if (sub && name) n = snprintf(path, sizeof(path), "%s/%s/%s/%s", g_db_dir, GEN_DIR_NAME, sub, name);
+    else if (sub) n = snprintf(path, sizeof(path), "%s/%s/%s", g_db_dir, GEN_DIR_NAME, sub);
+    else if (name) n = snprintf(path, sizeof(path), "%s/%s/%s", g_db_dir, GEN_DIR_NAME, name);
+    else n = snprintf(path, sizeof(path), "%s/%s", g_db_dir, GEN_DIR_NAME);
+    return n < (int)sizeof(path) ? strdup(path) : NULL;
+}
+
+/**
+ * @brief Returns the path of generation N.
+ */
+static char *generation_path(int number) {
+    char name[32];
+    snprintf(name, sizeof(name), "%d", number);
+    return gen_path(NULL, name);
+}
+
+// --- Dirty Set ---
+
+/**
+ * @brief Notes that a package's record changed.
+ * @param package_name The package.
+ */
+void upkg_gen_mark_dirty(const char *package_name) {
+    if (!package_name) return;
+    if (!g_dirty) {
+        g_dirty = upkg_index_create(64);
+        if (!g_dirty) return;
+    }
+    if (!upkg_index_find(g_dirty, package_name)) {
+        upkg_index_insert(g_dirty, package_name, "");
+    }
+}
+
+// --- Objects ---
+
+/**
+ * @brief Serialises a package's record files into an object, stores it if
+ *        it is new, and returns its hash.
+ * @param package_name The package.
+ * @param hex Output: the object hash as hex.
+ * @return 0 on success, 1 if the package has no record, -1 on failure.
+ */
+static int store_record_object(const char *package_name, char hex[GEN_HASH_HEX_LENGTH + 1]) {
+    char *record_dir = upkg_util_concat_path(g_db_dir, package_name);
+    if (!record_dir) return -1;
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        free(record_dir);
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < RECORD_FILE_COUNT; i++) {
+        char *path = upkg_util_concat_path(record_dir, record_files[i]);
+        size_t file_len = 0;
+        char *content = path ? upkg_util_read_file_content(path, &file_len) : NULL;
+        free(path);
+        if (!content) {
+            // A record without a control file is absent (or half deleted)
+            if (i == 0) {
+                ret = 1;
+                break;
+            }
+            continue;
+        }
+        fprintf(mem, "%s %zu\n", record_files[i], file_len);
+        fwrite(content, 1, file_len, mem);
+        free(content);
+    }
+    fclose(mem);
+    free(record_dir);
+    if (ret != 0) {
+        free(buffer);
+        return ret;
+    }
+
+    uint8_t digest[UPKG_SHA256_DIGEST_LENGTH];
+    upkg_sha256_ctx_t ctx;
+    upkg_digest_sha256_init(&ctx);
+    upkg_digest_sha256_update(&ctx, buffer, len);
+    upkg_digest_sha256_final(&ctx, digest);
+    upkg_digest_to_hex(digest, sizeof(digest), hex);
+
+    char *object = gen_path(GEN_OBJECT_DIR, hex);
+    if (!object) {
+        ret = -1;
+    } else if (!upkg_util_file_exists(object)) {
+        // Unchanged records hash to an object that is already there
+        ret = upkg_util_write_file_atomic(object, buffer, len);
+    }
+    free(object);
+    free(buffer);
+    return ret;
+}
+
+/**
+ * @brief Reads one record file back out of a record object.
+ */
+char *upkg_gen_object_file(const char *hash, const char *name, size_t *len) {
+    char *object = gen_path(GEN_OBJECT_DIR, hash);
+    size_t object_len = 0;
+    char *data = object ? upkg_util_read_file_content(object, &object_len) : NULL;
+    free(object);
+    if (!data) return NULL;
+
+    char *result = NULL;
+    size_t pos = 0;
+    while (pos < object_len) {
+        char *eol = memchr(data + pos, '\n', object_len - pos);
+        if (!eol) break;
+        *eol = '\0';
+        char *space = strrchr(data + pos, ' ');
+        if (!space) break;
+        size_t file_len = strtoull(space + 1, NULL, 10);
+        *space = '\0';
+        size_t start = (size_t)(eol - data) + 1;
+        if (file_len > object_len - start) break;
+
+        if (strcmp(data + pos, name) == 0) {
+            result = malloc(file_len + 1);
+            if (result) {
+                memcpy(result, data + start, file_len);
+                result[file_len] = '\0';
+                if (len) *len = file_len;
+            }
+            break;
+        }
+        pos = start + file_len;
+    }
+    free(data);
+    return result;
+}
+
+/**
+ * @brief Tells whether two record objects describe the same installed package.
+ */
+bool upkg_gen_same_package(const char *hash_a, const char *hash_b) {
+    static const char *const identity_files[] = { "control", "files", "dirs" };
+
+    if (strcmp(hash_a, hash_b) == 0) return true;
+    for (size_t i = 0; i < sizeof(identity_files) / sizeof(identity_files[0]); i++) {
+        size_t len_a = 0, len_b = 0;
+        char *a = upkg_gen_object_file(hash_a, identity_files[i], &len_a);
+        char *b = upkg_gen_object_file(hash_b, identity_files[i], &len_b);
+        bool same = (!a && !b) || (a && b && len_a == len_b && memcmp(a, b, len_a) == 0);
+        free(a);
+        free(b);
+        if (!same) return false;
+    }
+    return true;
+}
+
+// --- Generation Files ---
+
+/**
+ * @brief Returns the number of the newest generation.
+ */
+int upkg_gen_latest(void) {
+    char *dir = gen_path(NULL, NULL);
+    upkg_vfs_dir_t *dp = dir ? upkg_vfs->opendir(dir) : NULL;
+    free(dir);
+    if (!dp) return 0;
+
+    int latest = 0;
+    const char *entry;
+    while ((entry = upkg_vfs->readdir(dp)) != NULL) {
+        char *end;
+        long n = strtol(entry, &end, 10);
+        if (end != entry && *end == '\0' && n > latest) latest = (int)n;
+    }
+    upkg_vfs->closedir(dp);
+    return latest;
+}
+
+/**
+ * @brief Loads a generation.
+ */
+int upkg_gen_read(int number, upkg_gen_t *gen) {
+    memset(gen, 0, sizeof(*gen));
+    gen->number = number;
+
+    char *path = generation_path(number);
+    size_t len = 0;
+    char *content = path ? upkg_util_read_file_content(path, &len) : NULL;
+    free(path);
+    if (!content) return -1;
+
+    gen->records = upkg_index_create(256);
+    if (!gen->records) {
+        free(content);
+        return -1;
+    }
+
+    for (char *line = content, *next; line < content + len; line = next) {
+        char *newline = memchr(line, '\n', (size_t)(content + len - line));
+        next = newline ? newline + 1 : content + len;
+        if (newline) *newline = '\0';
+        if (strncmp(line, "time ", 5) == 0) {
+            gen->time = (time_t)strtoll(line + 5, NULL, 10);
+        } else if (strncmp(line, "summary ", 8) == 0) {
+            free(gen->summary);
+            gen->summary = strdup(line + 8);
+        } else {
+            char *space = strchr(line, ' ');
+            if (!space || strlen(space + 1) != GEN_HASH_HEX_LENGTH) continue;
+            *space = '\0';
+            if (upkg_index_insert(gen->records, line, space + 1) == 0) gen->package_count++;
+        }
+    }
+    free(content);
+    return 0;
+}
+
+/**
+ * @brief Frees a generation loaded by upkg_gen_read.
+ */
+void upkg_gen_free(upkg_gen_t *gen) {
+    if (!gen) return;
+    upkg_index_destroy(gen->records);
+    free(gen->summary);
+    memset(gen, 0, sizeof(*gen));
+}
+
+/**
+ * @brief Writes a new generation if the database changed since the last one.
+ */
+int upkg_gen_record(const char *summary) {
+    if (!g_db_dir || !upkg_main_hash_table) return -1;
+
+    int latest = upkg_gen_latest();
+    upkg_gen_t previous;
+    bool have_previous = latest > 0 && upkg_gen_read(latest, &previous) == 0;
+    if (have_previous && (!g_dirty || g_dirty->count == 0)) {
+        upkg_gen_free(&previous);
+        return 0;
+    }
+
+    char *objects = gen_path(GEN_OBJECT_DIR, NULL);
+    if (!objects || upkg_util_create_dir_recursive(objects, 0755) != 0) {
+        upkg_util_error("Failed to create generation directory under %s.\n", g_db_dir);
+        free(objects);
+        if (have_previous) upkg_gen_free(&previous);
+        return -1;
+    }
+    free(objects);
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        if (have_previous) upkg_gen_free(&previous);
+        return -1;
+    }
+    fprintf(mem, "time %lld\nsummary %s\n", (long long)time(NULL), summary ? summary : "");
+
+    // Walk the installed packages; only changed (or, the first time, all) records are hashed
+    int ret = 0;
+    for (size_t b = 0; b < upkg_main_hash_table->size && ret == 0; b++) {
+        for (upkg_hash_node_t *node = upkg_main_hash_table->buckets[b]; node; node = node->next) {
+            const char *name = node->data.package_name;
+            const char *hash = NULL;
+            char hex[GEN_HASH_HEX_LENGTH + 1];
+
+            bool dirty = !have_previous || (g_dirty && upkg_index_find(g_dirty, name));
+            if (!dirty) hash = upkg_index_lookup(previous.records, name);
+            if (!hash) {
+                int stored = store_record_object(name, hex);
+                if (stored < 0) {
+                    upkg_util_error("Failed to store the record of %s in a generation.\n", name);
+                    ret = -1;
+                    break;
+                }
+                if (stored > 0) continue;
+                hash = hex;
+            }
+            fprintf(mem, "%s %s\n", name, hash);
+        }
+    }
+    fclose(mem);
+
+    if (ret == 0) {
+        char *path = generation_path(latest + 1);
+        ret = path ? upkg_util_write_file_atomic(path, buffer, len) : -1;
+        free(path);
+    }
+    if (ret == 0) {
+        upkg_util_log_verbose("Recorded generation %d: %s\n", latest + 1, summary ? summary : "");
+        upkg_index_destroy(g_dirty);
+        g_dirty = NULL;
+    }
+    free(buffer);
+    if (have_previous) upkg_gen_free(&previous);
+    return ret;
+}
+
+/**
+ * @brief Prints the recorded generations, newest last.
+ */
+int upkg_gen_list(void) {
+    int latest = upkg_gen_latest();
+    if (latest == 0) {
+        printf("No generations recorded yet.\n");
+        return 0;
+    }
+
+    int listed = 0;
+    printf("%-6s %-19s %8s  %s\n", "GEN", "DATE", "PACKAGES", "SUMMARY");
+    for (int n = 1; n <= latest; n++) {
+        upkg_gen_t gen;
+        if (upkg_gen_read(n, &gen) != 0) continue;
+
+        char date[32] = "-";
+        struct tm tm;
+        if (localtime_r(&gen.time, &tm)) strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+        printf("%-6d %-19s %8d  %s%s\n", n, date, gen.package_count,
+               gen.summary ? gen.summary : "", n == latest ? " (current)" : "");
+        upkg_gen_free(&gen);
+        listed++;
+    }
+    return listed;
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * Filename:    upkg_gen.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Database generations over content-addressed package records
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_GEN_H
+#define UPKG_GEN_H
+
+#include <stdbool.h>
+#include <time.h>
+#include "upkg_index.h"
+
+/*
+ * Every committed change to the package database produces a generation:
+ *
+ *   <db_dir>/.generations/<N>                 one generation, see below
+ *   <db_dir>/.generations/objects/<sha256>    one package record, by content
+ *
+ * A generation file is a small text file:
+ *
+ *   time <unix seconds>
+ *   summary <what changed>
+ *   <package> <sha256 of its record object>
+ *   ...
+ *
+ * A record object is the package's record files (control, files, sonames,
+ * needed, dirs, manifest) serialised as "<name> <length>\n<bytes>" each.
+ * Objects are immutable and named by their hash, so a package that did not
+ * change between generations is stored once and shared; a new generation
+ * only hashes the records upkg_db wrote or deleted since the last one.
+ */
+
+// One generation, loaded from disk
+typedef struct {
+    int number;
+    time_t time;
+    char *summary;
+    upkg_index_t *records;      // package name -> record object hash
+    int package_count;
+} upkg_gen_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Notes that a package's record changed, so the next generation
+ *        rehashes it. Called by upkg_db when it stores or deletes a record.
+ * @param package_name The package.
+ */
+void upkg_gen_mark_dirty(const char *package_name);
+
+/**
+ * @brief Writes a new generation if the database changed since the last
+ *        one. The first call snapshots every installed package.
+ *        The database lock must be held.
+ * @param summary A one-line description, e.g. "install foo".
+ * @return 0 on success (or nothing to record), -1 on failure.
+ */
+int upkg_gen_record(const char *summary);
+
+/**
+ * @brief Returns the number of the newest generation.
+ * @return The number, or 0 if none has been recorded.
+ */
+int upkg_gen_latest(void);
+
+/**
+ * @brief Loads a generation.
+ * @param number The generation number.
+ * @param gen Output; free with upkg_gen_free.
+ * @return 0 on success, -1 if it does not exist or cannot be read.
+ */
+int upkg_gen_read(int number, upkg_gen_t *gen);
+
+/**
+ * @brief Frees a generation loaded by upkg_gen_read.
+ * @param gen The generation.
+ */
+void upkg_gen_free(upkg_gen_t *gen);
+
+/**
+ * @brief Reads one record file back out of a record object.
+ * @param hash The object hash from a generation.
+ * @param name The record file, e.g. "control" or "files".
+ * @param len Output: the content length.
+ * @return The NUL-terminated content (caller frees), or NULL if the object
+ *         or the file within it is missing.
+ */
+char *upkg_gen_object_file(const char *hash, const char *name, size_t *len);
+
+/**
+ * @brief Tells whether two record objects describe the same installed
+ *        package: identical control data and file and directory lists.
+ *        The manifests may still differ, e.g. in install-time mtimes.
+ * @param hash_a One object hash.
+ * @param hash_b The other.
+ * @return true if they match.
+ */
+bool upkg_gen_same_package(const char *hash_a, const char *hash_b);
+
+/**
+ * @brief Prints the recorded generations, newest last.
+ * @return The number of generations listed, or -1 on failure.
+ */
+int upkg_gen_list(void);
+
+#endif // UPKG_GEN_H
@@ -23,10 +23,14 @@
 #include "upkg_hash.h"
 #include "upkg_util.h"
 #include "upkg_pack.h"
+#include "upkg_trace.h"
+#include "upkg_snap.h"
+#include "upkg_format.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 
 // --- Global Variables ---
 upkg_hash_table_t *upkg_main_hash_table = NULL;
@@ -55,7 +59,7 @@ static bool is_prime(size_t num) {
  * @param num The starting number.
  * @return The next prime number.
  */
-static size_t find_next_prime(size_t num) {
+size_t upkg_hash_next_prime(size_t num) {
     if (num <= 2) return 2;
     if (num % 2 == 0) num++;
 
@@ -66,23 +70,31 @@ static size_t find_next_prime(size_t num) {
 }
 
 /**
- * @brief Hash function using FNV-1a algorithm.
- * @param name The string to hash.
- * @param table_size The size of the hash table.
- * @return The hash value.
+ * @brief Hashes a string with the 32-bit FNV-1a algorithm.
+ * @param str The string to hash.
+ * @return The full 32-bit hash value.
  */
-static unsigned int hash_function(const char *name, size_t table_size) {
-    if (!name || table_size == 0) return 0;
-
+unsigned int upkg_hash_fnv1a(const char *str) {
     const unsigned int FNV_PRIME_32 = 16777619U;
     const unsigned int FNV_OFFSET_BASIS_32 = 2166136261U;
 
     unsigned int hash = FNV_OFFSET_BASIS_32;
-    for (const char *p = name; *p != '\0'; p++) {
+    for (const char *p = str; *p != '\0'; p++) {
         hash ^= (unsigned char)*p;
         hash *= FNV_PRIME_32;
     }
-    return hash % table_size;
+    return hash;
+}
+
+/**
+ * @brief Hash function using FNV-1a algorithm.
+ * @param name The string to hash.
+ * @param table_size The size of the hash table.
+ * @return The hash value.
+ */
+static unsigned int hash_function(const char *name, size_t table_size) {
+    if (!name || table_size == 0) return 0;
+    return upkg_hash_fnv1a(name) % table_size;
 }
 
 // --- Memory Management Functions ---
@@ -113,6 +125,76 @@ void upkg_hash_free_package_info(upkg_hash_package_info_t *pkg_info) {
         upkg_util_free_and_null((char**)&pkg_info->file_list);
     }
     pkg_info->file_count = 0;
+
+    upkg_util_free_string_list(&pkg_info->provided_sonames, &pkg_info->provided_soname_count);
+    upkg_util_free_string_list(&pkg_info->needed_sonames, &pkg_info->needed_soname_count);
+    upkg_util_free_string_list(&pkg_info->dir_list, &pkg_info->dir_count);
+}
+
+/**
+ * @brief Deep copies the soname and directory lists between package records.
+ * @param src The record to copy from.
+ * @param dst The record to copy into; its lists must already be empty.
+ */
+static void copy_string_lists(const upkg_hash_package_info_t *src, upkg_hash_package_info_t *dst) {
+    if (upkg_util_copy_string_list(src->provided_sonames, src->provided_soname_count, &dst->provided_sonames) == 0) {
+        dst->provided_soname_count = dst->provided_sonames ? src->provided_soname_count : 0;
+    } else {
+        dst->provided_soname_count = 0;
+    }
+    if (upkg_util_copy_string_list(src->needed_sonames, src->needed_soname_count, &dst->needed_sonames) == 0) {
+        dst->needed_soname_count = dst->needed_sonames ? src->needed_soname_count : 0;
+    } else {
+        dst->needed_soname_count = 0;
+    }
+    if (upkg_util_copy_string_list(src->dir_list, src->dir_count, &dst->dir_list) == 0) {
+        dst->dir_count = dst->dir_list ? src->dir_count : 0;
+    } else {
+        dst->dir_count = 0;
+    }
+}
+
+/**
+ * @brief Deep copies a package record.
+ * @param src The record to copy.
+ * @param dst The destination; overwritten without being freed first.
+ * @return 0 on success, -1 on allocation failure (dst is then left empty).
+ */
+int upkg_hash_copy_package_info(const upkg_hash_package_info_t *src, upkg_hash_package_info_t *dst) {
+    if (!src || !dst) return -1;
+    memset(dst, 0, sizeof(*dst));
+
+    // Deep copy all string fields
+    dst->package_name = src->package_name ? strdup(src->package_name) : NULL;
+    dst->version = src->version ? strdup(src->version) : NULL;
+    dst->architecture = src->architecture ? strdup(src->architecture) : NULL;
+    dst->maintainer = src->maintainer ? strdup(src->maintainer) : NULL;
+    dst->description = src->description ? strdup(src->description) : NULL;
+    dst->depends = src->depends ? strdup(src->depends) : NULL;
+    dst->installed_size = src->installed_size ? strdup(src->installed_size) : NULL;
+    dst->section = src->section ? strdup(src->section) : NULL;
+    dst->priority = src->priority ? strdup(src->priority) : NULL;
+    dst->homepage = src->homepage ? strdup(src->homepage) : NULL;
+    dst->filename = src->filename ? strdup(src->filename) : NULL;
+
+    // Deep copy file list
+    if (src->file_list && src->file_count > 0) {
+        dst->file_list = malloc(src->file_count * sizeof(char*));
+        if (dst->file_list) {
+            dst->file_count = src->file_count;
+            for (int i = 0; i < src->file_count; i++) {
+                dst->file_list[i] = src->file_list[i] ? strdup(src->file_list[i]) : NULL;
+            }
+        }
+    }
+
+    copy_string_lists(src, dst);
+
+    if (src->package_name && !dst->package_name) {
+        upkg_hash_free_package_info(dst);
+        return -1;
+    }
+    return 0;
 }
 
 // --- Hash Table Core Functions ---
@@ -132,7 +214,7 @@ upkg_hash_table_t* upkg_hash_create_table(size_t initial_size) {
     if (initial_size < MIN_HASH_TABLE_SIZE) {
         initial_size = MIN_HASH_TABLE_SIZE;
     }
-    initial_size = find_next_prime(initial_size);
+    initial_size = upkg_hash_next_prime(initial_size);
 
     table->buckets = calloc(initial_size, sizeof(upkg_hash_node_t*));
     if (!table->buckets) {
@@ -181,7 +263,7 @@ static int resize_hash_table(upkg_hash_table_t *table, size_t new_size) {
     if (new_size < MIN_HASH_TABLE_SIZE) {
         new_size = MIN_HASH_TABLE_SIZE;
     }
-    new_size = find_next_prime(new_size);
+    new_size = upkg_hash_next_prime(new_size);
 
     if (new_size == table->size) return 0;
 
@@ -192,6 +274,7 @@ static int resize_hash_table(upkg_hash_table_t *table, size_t new_size) {
     }
 
     upkg_util_log_verbose("Resizing hash table from %zu to %zu buckets\n", table->size, new_size);
+    uint64_t trace_start = UPKG_TRACE_NOW();
 
     // Rehash all existing nodes
     upkg_hash_node_t **old_buckets = table->buckets;
@@ -217,6 +300,8 @@ static int resize_hash_table(upkg_hash_table_t *table, size_t new_size) {
     }
 
     free(old_buckets);
+    UPKG_TRACE4(hash__resize, (uint64_t)old_size, (uint64_t)new_size, (uint64_t)table->count,
+                UPKG_TRACE_NOW() - trace_start);
     return 0;
 }
 
@@ -237,37 +322,13 @@ int upkg_hash_add_package(upkg_hash_table_t *table, const upkg_hash_package_info
     if (existing) {
         upkg_util_log_verbose("Package '%s' already exists in hash table, updating.\n", pkg_info->package_name);
         upkg_hash_free_package_info(existing);
-        
-        // Update existing entry with new data
-        existing->package_name = pkg_info->package_name ? strdup(pkg_info->package_name) : NULL;
-        existing->version = pkg_info->version ? strdup(pkg_info->version) : NULL;
-        existing->architecture = pkg_info->architecture ? strdup(pkg_info->architecture) : NULL;
-        existing->maintainer = pkg_info->maintainer ? strdup(pkg_info->maintainer) : NULL;
-        existing->description = pkg_info->description ? strdup(pkg_info->description) : NULL;
-        existing->depends = pkg_info->depends ? strdup(pkg_info->depends) : NULL;
-        existing->installed_size = pkg_info->installed_size ? strdup(pkg_info->installed_size) : NULL;
-        existing->section = pkg_info->section ? strdup(pkg_info->section) : NULL;
-        existing->priority = pkg_info->priority ? strdup(pkg_info->priority) : NULL;
-        existing->homepage = pkg_info->homepage ? strdup(pkg_info->homepage) : NULL;
-        existing->filename = pkg_info->filename ? strdup(pkg_info->filename) : NULL;
-        
-        // Copy file list
-        if (pkg_info->file_list && pkg_info->file_count > 0) {
-            existing->file_list = malloc(pkg_info->file_count * sizeof(char*));
-            if (existing->file_list) {
-                existing->file_count = pkg_info->file_count;
-                for (int i = 0; i < pkg_info->file_count; i++) {
-                    existing->file_list[i] = pkg_info->file_list[i] ? strdup(pkg_info->file_list[i]) : NULL;
-                }
-            } else {
-                existing->file_count = 0;
-            }
-        } else {
-            existing->file_list = NULL;
-            existing->file_count = 0;
-        }
-        
-        return 0;
+
+        // Published snapshots keep their own copy of the old data
+        upkg_hash_node_t *node = (upkg_hash_node_t *)((char *)existing - offsetof(upkg_hash_node_t, data));
+        upkg_snap_release_record(node->published);
+        node->published = NULL;
+
+        return upkg_hash_copy_package_info(pkg_info, existing);
     }
 
     // Check load factor and resize if needed
@@ -285,36 +346,11 @@ int upkg_hash_add_package(upkg_hash_table_t *table, const upkg_hash_package_info
         return -1;
     }
 
-    // Initialize the node data
-    memset(&new_node->data, 0, sizeof(upkg_hash_package_info_t));
-
-    // Deep copy all string fields
-    new_node->data.package_name = pkg_info->package_name ? strdup(pkg_info->package_name) : NULL;
-    new_node->data.version = pkg_info->version ? strdup(pkg_info->version) : NULL;
-    new_node->data.architecture = pkg_info->architecture ? strdup(pkg_info->architecture) : NULL;
-    new_node->data.maintainer = pkg_info->maintainer ? strdup(pkg_info->maintainer) : NULL;
-    new_node->data.description = pkg_info->description ? strdup(pkg_info->description) : NULL;
-    new_node->data.depends = pkg_info->depends ? strdup(pkg_info->depends) : NULL;
-    new_node->data.installed_size = pkg_info->installed_size ? strdup(pkg_info->installed_size) : NULL;
-    new_node->data.section = pkg_info->section ? strdup(pkg_info->section) : NULL;
-    new_node->data.priority = pkg_info->priority ? strdup(pkg_info->priority) : NULL;
-    new_node->data.homepage = pkg_info->homepage ? strdup(pkg_info->homepage) : NULL;
-    new_node->data.filename = pkg_info->filename ? strdup(pkg_info->filename) : NULL;
-
-    // Deep copy file list
-    if (pkg_info->file_list && pkg_info->file_count > 0) {
-        new_node->data.file_list = malloc(pkg_info->file_count * sizeof(char*));
-        if (new_node->data.file_list) {
-            new_node->data.file_count = pkg_info->file_count;
-            for (int i = 0; i < pkg_info->file_count; i++) {
-                new_node->data.file_list[i] = pkg_info->file_list[i] ? strdup(pkg_info->file_list[i]) : NULL;
-            }
-        } else {
-            new_node->data.file_count = 0;
-        }
-    } else {
-        new_node->data.file_list = NULL;
-        new_node->data.file_count = 0;
+    new_node->published = NULL;
+    if (upkg_hash_copy_package_info(pkg_info, &new_node->data) != 0) {
+        upkg_util_error("Failed to copy package '%s' into hash table.\n", pkg_info->package_name);
+        free(new_node);
+        return -1;
     }
 
     // Insert into hash table
@@ -352,6 +388,7 @@ void upkg_hash_remove_package(upkg_hash_table_t *table, const char *name) {
         }
 
         upkg_hash_free_package_info(&current->data);
+        upkg_snap_release_record(current->published);
         free(current);
         table->count--;
 
@@ -378,6 +415,7 @@ void upkg_hash_destroy_table(upkg_hash_table_t *table) {
             upkg_hash_node_t *temp = current;
             current = current->next;
             upkg_hash_free_package_info(&temp->data);
+            upkg_snap_release_record(temp->published);
             free(temp);
         }
     }
@@ -392,90 +430,59 @@ void upkg_hash_destroy_table(upkg_hash_table_t *table) {
 /**
  * @brief Prints package information from the hash table.
  * @param pkg_info A pointer to the package info to print.
+ * @param format A compiled --format template, or NULL for the full record.
  */
-void upkg_hash_print_package_info(const upkg_hash_package_info_t *pkg_info) {
+void upkg_hash_print_package_info(const upkg_hash_package_info_t *pkg_info, const upkg_format_t *format) {
     if (!pkg_info) {
         printf("No package information available in hash table.\n");
         return;
     }
 
-    printf("Hash Table Package Information:\n");
-    printf("==============================\n");
-
-    if (pkg_info->package_name) {
-        printf("Package:      %s\n", pkg_info->package_name);
-    }
-    if (pkg_info->version) {
-        printf("Version:      %s\n", pkg_info->version);
-    }
-    if (pkg_info->architecture) {
-        printf("Architecture: %s\n", pkg_info->architecture);
-    }
-    if (pkg_info->maintainer) {
-        printf("Maintainer:   %s\n", pkg_info->maintainer);
-    }
-    if (pkg_info->section) {
-        printf("Section:      %s\n", pkg_info->section);
-    }
-    if (pkg_info->priority) {
-        printf("Priority:     %s\n", pkg_info->priority);
-    }
-    if (pkg_info->installed_size) {
-        printf("Installed-Size: %s\n", pkg_info->installed_size);
-    }
-    if (pkg_info->depends) {
-        printf("Depends:      %s\n", pkg_info->depends);
-    }
-    if (pkg_info->homepage) {
-        printf("Homepage:     %s\n", pkg_info->homepage);
-    }
-    if (pkg_info->description) {
-        printf("Description:  %s\n", pkg_info->description);
-    }
-    if (pkg_info->filename) {
-        printf("Filename:     %s\n", pkg_info->filename);
-    }
-
-    printf("\nHash Table File List (%d files):\n", pkg_info->file_count);
-    if (pkg_info->file_count > 0 && pkg_info->file_list) {
-        printf("================================\n");
-        for (int i = 0; i < pkg_info->file_count; i++) {
-            if (pkg_info->file_list[i]) {
-                printf("  %s\n", pkg_info->file_list[i]);
-            }
-        }
-    } else {
-        printf("  (No files or empty package)\n");
+    upkg_out_t out;
+    upkg_out_init(&out, STDOUT_FILENO);
+    upkg_format_render(format ? format : upkg_format_builtin(UPKG_FORMAT_STATUS), pkg_info, &out);
+    if (upkg_out_flush(&out) != 0) {
+        upkg_util_error("Cannot write package information: %s\n", strerror(out.error));
     }
-    printf("\n");
 }
 
 /**
  * @brief Lists all packages in the hash table.
  * @param table A pointer to the hash table.
+ * @param format A compiled --format template, or NULL for the name list.
  */
-void upkg_hash_list_packages(upkg_hash_table_t *table) {
+void upkg_hash_list_packages(upkg_hash_table_t *table, const upkg_format_t *format) {
     if (!table) {
         printf("Hash table is NULL.\n");
         return;
     }
 
-    printf("Packages in Hash Table:\n");
-    printf("======================\n");
-    
+    upkg_out_t out;
+    upkg_out_init(&out, STDOUT_FILENO);
+    if (!format) {
+        upkg_out_puts(&out, "Packages in Hash Table:\n");
+        upkg_out_puts(&out, "======================\n");
+    }
+
+    const upkg_format_t *row = format ? format : upkg_format_builtin(UPKG_FORMAT_LIST);
     int count = 0;
     for (size_t i = 0; i < table->size; i++) {
         upkg_hash_node_t *current = table->buckets[i];
         while (current) {
             if (current->data.package_name) {
-                printf("%s\n", current->data.package_name);
+                upkg_format_render(row, &current->data, &out);
                 count++;
             }
             current = current->next;
         }
     }
-    
-    printf("\nTotal packages: %d\n", count);
+
+    if (!format) {
+        upkg_out_printf(&out, "\nTotal packages: %d\n", count);
+    }
+    if (upkg_out_flush(&out) != 0) {
+        upkg_util_error("Cannot write package list: %s\n", strerror(out.error));
+    }
 }
 
 /**
@@ -522,5 +529,14 @@ int upkg_hash_convert_package_info(const void *src, upkg_hash_package_info_t *ds
         dst->file_count = 0;
     }
 
+    if (upkg_util_copy_string_list(pkg_info->provided_sonames, pkg_info->provided_soname_count, &dst->provided_sonames) != 0 ||
+        upkg_util_copy_string_list(pkg_info->needed_sonames, pkg_info->needed_soname_count, &dst->needed_sonames) != 0 ||
+        upkg_util_copy_string_list(pkg_info->dir_list, pkg_info->dir_count, &dst->dir_list) != 0) {
+        return -1;
+    }
+    dst->provided_soname_count = dst->provided_sonames ? pkg_info->provided_soname_count : 0;
+    dst->needed_soname_count = dst->needed_sonames ? pkg_info->needed_soname_count : 0;
+    dst->dir_count = dst->dir_list ? pkg_info->dir_count : 0;
+
     return 0;
 }
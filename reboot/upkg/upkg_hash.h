@@ -48,12 +48,19 @@ typedef struct upkg_hash_package_info {
     char *filename;
     char **file_list;
     int file_count;
+    char **provided_sonames;
+    int provided_soname_count;
+    char **needed_sonames;
+    int needed_soname_count;
+    char **dir_list;
+    int dir_count;
 } upkg_hash_package_info_t;
 
 // --- Hash Table Node Structure ---
 typedef struct upkg_hash_node {
     upkg_hash_package_info_t data;
     struct upkg_hash_node *next;
+    struct upkg_snap_record *published;   // Shared copy of data in published snapshots (upkg_snap.h)
 } upkg_hash_node_t;
 
 // --- Hash Table Structure ---
@@ -63,12 +70,28 @@ typedef struct upkg_hash_table {
     size_t count;
 } upkg_hash_table_t;
 
+struct upkg_format;   // compiled output template (upkg_format.h)
+
 // --- Global Variables ---
 extern bool g_verbose_mode;
 extern upkg_hash_table_t *upkg_main_hash_table;
 
 // --- Function Prototypes ---
 
+/**
+ * @brief Hashes a string with the 32-bit FNV-1a algorithm.
+ * @param str The string to hash.
+ * @return The full 32-bit hash value.
+ */
+unsigned int upkg_hash_fnv1a(const char *str);
+
+/**
+ * @brief Finds the next prime number greater than or equal to num.
+ * @param num The starting number.
+ * @return The next prime number.
+ */
+size_t upkg_hash_next_prime(size_t num);
+
 /**
  * @brief Creates and initializes a new hash table.
  * @param initial_size The desired initial size of the hash table.
@@ -108,14 +131,17 @@ void upkg_hash_destroy_table(upkg_hash_table_t *table);
 /**
  * @brief Prints package information from the hash table.
  * @param pkg_info A pointer to the package info to print.
+ * @param format A compiled --format template, or NULL for the full record.
  */
-void upkg_hash_print_package_info(const upkg_hash_package_info_t *pkg_info);
+void upkg_hash_print_package_info(const upkg_hash_package_info_t *pkg_info, const struct upkg_format *format);
 
 /**
  * @brief Lists all packages in the hash table.
  * @param table A pointer to the hash table.
+ * @param format A compiled --format template rendered per package, or NULL
+ *        for the name list with its header and total.
  */
-void upkg_hash_list_packages(upkg_hash_table_t *table);
+void upkg_hash_list_packages(upkg_hash_table_t *table, const struct upkg_format *format);
 
 /**
  * @brief Converts upkg_package_info_t to upkg_hash_package_info_t.
@@ -125,6 +151,14 @@ void upkg_hash_list_packages(upkg_hash_table_t *table);
  */
 int upkg_hash_convert_package_info(const void *src, upkg_hash_package_info_t *dst);
 
+/**
+ * @brief Deep copies a package record.
+ * @param src The record to copy.
+ * @param dst The destination; overwritten without being freed first.
+ * @return 0 on success, -1 on allocation failure (dst is then left empty).
+ */
+int upkg_hash_copy_package_info(const upkg_hash_package_info_t *src, upkg_hash_package_info_t *dst);
+
 /**
  * @brief Frees all allocated memory in a hash package info structure.
  * @param pkg_info Pointer to the package info structure to free.
@@ -0,0 +1,552 @@
+/******************************************************************************
+ * Filename:    upkg_history.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Append-only binary transaction history with time and package indexes
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_history.h"
+#include "upkg_config.h"
+#include "upkg_digest.h"
+#include "upkg_hash.h"
+#include "upkg_metrics.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define HISTORY_MAGIC "UPKGHIS1"
+#define HISTORY_HEADER_LEN 8
+#define HISTORY_CHECKPOINT_BYTES (16 * 1024)
+#define HISTORY_MAX_FRAME (16 * 1024 * 1024)
+#define TIME_INDEX_ENTRY 16
+#define PACKAGE_INDEX_ENTRY 12
+
+// Operations noted since the last commit
+static upkg_history_op_t *g_pending = NULL;
+static size_t g_pending_count = 0;
+static uint64_t g_pending_start_ns = 0;
+
+// --- Encoding ---
+
+static void put_varint(FILE *out, uint64_t v) {
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, out);
+        v >>= 7;
+    }
+    fputc((int)v, out);
+}
+
+static void put_svarint(FILE *out, int64_t v) {
+    put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_string(FILE *out, const char *s) {
+    size_t len = s ? strlen(s) : 0;
+    put_varint(out, len);
+    if (len) fwrite(s, 1, len, out);
+}
+
+static void put_le(uint8_t *buf, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) buf[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *buf, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)buf[i] << (8 * i);
+    return v;
+}
+
+// --- Decoding ---
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
+} reader_t;
+
+static uint64_t get_varint(reader_t *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->p >= r->end) break;
+        uint8_t b = *r->p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->ok = false;
+    return 0;
+}
+
+static int64_t get_svarint(reader_t *r) {
+    uint64_t v = get_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Empty strings decode to NULL, matching how NULL was encoded
+static char *get_string(reader_t *r) {
+    uint64_t len = get_varint(r);
+    if (!r->ok || len > (uint64_t)(r->end - r->p)) {
+        r->ok = false;
+        return NULL;
+    }
+    char *s = len ? strndup((const char *)r->p, (size_t)len) : NULL;
+    r->p += len;
+    return s;
+}
+
+static void free_entry(upkg_history_entry_t *entry) {
+    for (size_t i = 0; i < entry->op_count; i++) {
+        free(entry->ops[i].package);
+        free(entry->ops[i].old_version);
+        free(entry->ops[i].new_version);
+    }
+    free(entry->ops);
+    free(entry->summary);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * @brief Decodes a frame payload into an entry.
+ * @return 0 on success, -1 if the payload is malformed.
+ */
+static int decode_entry(const uint8_t *payload, size_t len, uint64_t offset, upkg_history_entry_t *entry) {
+    reader_t r = { payload, payload + len, true };
+    memset(entry, 0, sizeof(*entry));
+    entry->offset = offset;
+    entry->time = get_svarint(&r);
+    entry->duration_us = get_varint(&r);
+    entry->status = (int)get_varint(&r);
+    entry->summary = get_string(&r);
+    uint64_t count = get_varint(&r);
+    if (!r.ok || count > len) {
+        free_entry(entry);
+        return -1;
+    }
+    entry->ops = calloc(count ? count : 1, sizeof(*entry->ops));
+    if (!entry->ops) {
+        free_entry(entry);
+        return -1;
+    }
+    for (uint64_t i = 0; i < count && r.ok; i++) {
+        upkg_history_op_t *op = &entry->ops[entry->op_count++];
+        op->kind = (upkg_history_op_kind_t)get_varint(&r);
+        op->package = get_string(&r);
+        op->old_version = get_string(&r);
+        op->new_version = get_string(&r);
+        op->files_written = get_varint(&r);
+        op->files_deleted = get_varint(&r);
+        op->duration_us = get_varint(&r);
+        op->status = (int)get_varint(&r);
+    }
+    if (!r.ok) {
+        free_entry(entry);
+        return -1;
+    }
+    return 0;
+}
+
+// --- Frames ---
+
+/**
+ * @brief Reads and checks the frame at offset.
+ * @param payload Output: the payload (caller frees).
+ * @param next Output: the offset of the following frame.
+ * @return 0 on success, 1 at the end of the log, -1 for a torn or corrupt frame.
+ */
+static int read_frame(int fd, uint64_t offset, uint64_t size, uint8_t **payload, size_t *len, uint64_t *next) {
+    if (offset >= size) return 1;
+
+    uint8_t head[10];
+    ssize_t got = pread(fd, head, sizeof(head), (off_t)offset);
+    if (got <= 0) return -1;
+    reader_t r = { head, head + got, true };
+    uint64_t payload_len = get_varint(&r);
+    uint64_t start = offset + (uint64_t)(r.p - head);
+    if (!r.ok || payload_len > HISTORY_MAX_FRAME || start + payload_len + 4 > size) return -1;
+
+    uint8_t *buf = malloc(payload_len + 4);
+    if (!buf) return -1;
+    if (pread(fd, buf, payload_len + 4, (off_t)start) != (ssize_t)(payload_len + 4) ||
+        upkg_digest_crc32c(0, buf, payload_len) != (uint32_t)get_le(buf + payload_len, 4)) {
+        free(buf);
+        return -1;
+    }
+    *payload = buf;
+    *len = payload_len;
+    *next = start + payload_len + 4;
+    return 0;
+}
+
+/**
+ * @brief Opens the log and checks its header.
+ * @return The descriptor, or -1 if there is no (valid) history.
+ */
+static int open_log(const char *path, int flags, uint64_t *size) {
+    int fd = open(path, flags | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    char magic[HISTORY_HEADER_LEN];
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    *size = (uint64_t)st.st_size;
+    if (*size == 0 && (flags & O_CREAT)) return fd;
+    if (*size < HISTORY_HEADER_LEN || pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic) ||
+        memcmp(magic, HISTORY_MAGIC, HISTORY_HEADER_LEN) != 0) {
+        upkg_util_error("%s is not a upkg history log.\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Reads an index file, dropping a partial trailing entry.
+ * @return The entries (caller frees), or NULL if the index is empty or missing.
+ */
+static uint8_t *read_index(const char *path, size_t entry_size, size_t *count) {
+    size_t len = 0;
+    char *data = upkg_util_read_file_content(path, &len);
+    *count = data ? len / entry_size : 0;
+    if (data && *count == 0) {
+        free(data);
+        data = NULL;
+    }
+    return (uint8_t *)data;
+}
+
+/**
+ * @brief Appends whole entries to an index file, first trimming any torn entry.
+ */
+static int append_index(const char *path, const uint8_t *entries, size_t entry_size, size_t count) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    int ret = -1;
+    if (fstat(fd, &st) == 0) {
+        off_t end = st.st_size - st.st_size % (off_t)entry_size;
+        if ((end == st.st_size || ftruncate(fd, end) == 0) &&
+            pwrite(fd, entries, entry_size * count, end) == (ssize_t)(entry_size * count)) {
+            ret = 0;
+        }
+    }
+    close(fd);
+    return ret;
+}
+
+// --- Recording ---
+
+/**
+ * @brief Queues a package operation for the next history entry.
+ */
+void upkg_history_note(upkg_history_op_kind_t kind, const char *package, const char *old_version,
+                       const char *new_version, uint64_t files_written, uint64_t files_deleted,
+                       uint64_t duration_ns, int status) {
+    upkg_history_op_t *ops = realloc(g_pending, (g_pending_count + 1) * sizeof(*ops));
+    if (!ops || !package) return;
+    g_pending = ops;
+
+    uint64_t now = upkg_metrics_now_ns();
+    uint64_t start = now > duration_ns ? now - duration_ns : 0;
+    if (g_pending_count == 0 || start < g_pending_start_ns) g_pending_start_ns = start;
+
+    upkg_history_op_t *op = &g_pending[g_pending_count++];
+    op->kind = kind;
+    op->package = strdup(package);
+    op->old_version = old_version ? strdup(old_version) : NULL;
+    op->new_version = new_version ? strdup(new_version) : NULL;
+    op->files_written = files_written;
+    op->files_deleted = files_deleted;
+    op->duration_us = duration_ns / 1000;
+    op->status = status;
+}
+
+/**
+ * @brief Drops the queued operations.
+ */
+static void clear_pending(void) {
+    for (size_t i = 0; i < g_pending_count; i++) {
+        free(g_pending[i].package);
+        free(g_pending[i].old_version);
+        free(g_pending[i].new_version);
+    }
+    free(g_pending);
+    g_pending = NULL;
+    g_pending_count = 0;
+}
+
+/**
+ * @brief Appends the queued operations as one transaction.
+ */
+int upkg_history_commit(const char *summary) {
+    if (g_pending_count == 0) return 0;
+    if (!g_db_dir) {
+        clear_pending();
+        return -1;
+    }
+
+    // Encode the payload
+    int64_t now = (int64_t)time(NULL);
+    int failed = 0;
+    for (size_t i = 0; i < g_pending_count; i++) {
+        if (g_pending[i].status != 0) failed++;
+    }
+    char *payload = NULL;
+    size_t payload_len = 0;
+    FILE *mem = open_memstream(&payload, &payload_len);
+    if (!mem) {
+        clear_pending();
+        return -1;
+    }
+    put_svarint(mem, now);
+    put_varint(mem, (upkg_metrics_now_ns() - g_pending_start_ns) / 1000);
+    put_varint(mem, (uint64_t)failed);
+    put_string(mem, summary);
+    put_varint(mem, g_pending_count);
+    for (size_t i = 0; i < g_pending_count; i++) {
+        const upkg_history_op_t *op = &g_pending[i];
+        put_varint(mem, (uint64_t)op->kind);
+        put_string(mem, op->package);
+        put_string(mem, op->old_version);
+        put_string(mem, op->new_version);
+        put_varint(mem, op->files_written);
+        put_varint(mem, op->files_deleted);
+        put_varint(mem, op->duration_us);
+        put_varint(mem, (uint64_t)op->status);
+    }
+    fclose(mem);
+
+    // Frame it: length, payload, checksum
+    char *frame = NULL;
+    size_t frame_len = 0;
+    mem = open_memstream(&frame, &frame_len);
+    if (!mem) {
+        free(payload);
+        clear_pending();
+        return -1;
+    }
+    uint8_t crc[4];
+    put_le(crc, upkg_digest_crc32c(0, payload, payload_len), 4);
+    put_varint(mem, payload_len);
+    fwrite(payload, 1, payload_len, mem);
+    fwrite(crc, 1, sizeof(crc), mem);
+    fclose(mem);
+    free(payload);
+
+    char *log_path = upkg_util_concat_path(g_db_dir, ".history");
+    char *idx_path = upkg_util_concat_path(g_db_dir, ".history.idx");
+    char *pkg_path = upkg_util_concat_path(g_db_dir, ".history.pkg");
+    uint64_t size = 0;
+    int fd = log_path && idx_path && pkg_path ? open_log(log_path, O_RDWR | O_CREAT, &size) : -1;
+    int ret = fd >= 0 ? 0 : -1;
+
+    if (ret == 0 && size == 0) {
+        if (pwrite(fd, HISTORY_MAGIC, HISTORY_HEADER_LEN, 0) != HISTORY_HEADER_LEN) ret = -1;
+        size = HISTORY_HEADER_LEN;
+    }
+
+    // Validate the frames after the last checkpoint, dropping a torn tail
+    size_t idx_count = 0;
+    uint8_t *idx = ret == 0 ? read_index(idx_path, TIME_INDEX_ENTRY, &idx_count) : NULL;
+    int64_t max_time = INT64_MIN;
+    uint64_t checkpoint = HISTORY_HEADER_LEN;
+    if (idx) {
+        const uint8_t *last = idx + (idx_count - 1) * TIME_INDEX_ENTRY;
+        max_time = (int64_t)get_le(last, 8);
+        checkpoint = get_le(last + 8, 8);
+        free(idx);
+    }
+    uint64_t pos = checkpoint < size ? checkpoint : HISTORY_HEADER_LEN;
+    while (ret == 0) {
+        uint8_t *buf;
+        size_t len;
+        uint64_t next;
+        int r = read_frame(fd, pos, size, &buf, &len, &next);
+        if (r == 1) break;
+        if (r < 0) {
+            upkg_util_log_verbose("Dropping %llu bytes of torn history at offset %llu.\n",
+                                  (unsigned long long)(size - pos), (unsigned long long)pos);
+            if (ftruncate(fd, (off_t)pos) != 0) ret = -1;
+            size = pos;
+            break;
+        }
+        reader_t rd = { buf, buf + len, true };
+        int64_t t = get_svarint(&rd);
+        if (rd.ok && t > max_time) max_time = t;
+        free(buf);
+        pos = next;
+    }
+
+    uint64_t offset = size;
+    if (ret == 0 && (pwrite(fd, frame, frame_len, (off_t)offset) != (ssize_t)frame_len || fdatasync(fd) != 0)) {
+        upkg_util_error("Failed to append to %s: %s\n", log_path, strerror(errno));
+        ret = -1;
+    }
+    if (fd >= 0) close(fd);
+    free(frame);
+
+    // A checkpoint stores the newest time before it, so --since can skip everything earlier
+    if (ret == 0 && (idx_count == 0 || offset - checkpoint >= HISTORY_CHECKPOINT_BYTES)) {
+        uint8_t entry[TIME_INDEX_ENTRY];
+        put_le(entry, (uint64_t)max_time, 8);
+        put_le(entry + 8, offset, 8);
+        if (append_index(idx_path, entry, TIME_INDEX_ENTRY, 1) != 0) ret = -1;
+    }
+    if (ret == 0) {
+        uint8_t *entries = malloc(g_pending_count * PACKAGE_INDEX_ENTRY);
+        if (!entries) {
+            ret = -1;
+        } else {
+            for (size_t i = 0; i < g_pending_count; i++) {
+                put_le(entries + i * PACKAGE_INDEX_ENTRY, upkg_hash_fnv1a(g_pending[i].package), 4);
+                put_le(entries + i * PACKAGE_INDEX_ENTRY + 4, offset, 8);
+            }
+            if (append_index(pkg_path, entries, PACKAGE_INDEX_ENTRY, g_pending_count) != 0) ret = -1;
+            free(entries);
+        }
+    }
+    if (ret != 0) upkg_util_error("Failed to record transaction history in %s.\n", g_db_dir);
+
+    free(log_path);
+    free(idx_path);
+    free(pkg_path);
+    clear_pending();
+    return ret;
+}
+
+// --- Queries ---
+
+/**
+ * @brief Decodes the frame at offset and visits it if it passes the filters.
+ * @return 1 if visited, 0 if filtered out, -1 if the frame is bad,
+ *         2 if the visitor asked to stop.
+ */
+static int visit_frame(int fd, uint64_t offset, uint64_t size, int64_t since, const char *package,
+                       upkg_history_visit_fn visit, void *user, uint64_t *next) {
+    uint8_t *payload;
+    size_t len;
+    if (read_frame(fd, offset, size, &payload, &len, next) != 0) return -1;
+
+    upkg_history_entry_t entry;
+    int ret = decode_entry(payload, len, offset, &entry);
+    free(payload);
+    if (ret != 0) return -1;
+
+    bool match = entry.time >= since;
+    if (match && package) {
+        match = false;
+        for (size_t i = 0; i < entry.op_count && !match; i++) {
+            match = entry.ops[i].package && strcmp(entry.ops[i].package, package) == 0;
+        }
+    }
+    ret = 0;
+    if (match) ret = visit(&entry, user) != 0 ? 2 : 1;
+    free_entry(&entry);
+    return ret;
+}
+
+/**
+ * @brief Visits entries committed at or after a time, oldest first.
+ */
+int upkg_history_scan_since(int64_t since, upkg_history_visit_fn visit, void *user) {
+    if (!g_db_dir || !visit) return -1;
+    char *log_path = upkg_util_concat_path(g_db_dir, ".history");
+    char *idx_path = upkg_util_concat_path(g_db_dir, ".history.idx");
+    uint64_t size = 0;
+    int fd = log_path ? open_log(log_path, O_RDONLY, &size) : -1;
+    if (fd < 0) {
+        free(log_path);
+        free(idx_path);
+        return 0;
+    }
+
+    // Start at the last checkpoint whose earlier entries are all older than since
+    uint64_t pos = HISTORY_HEADER_LEN;
+    size_t count = 0;
+    uint8_t *idx = idx_path ? read_index(idx_path, TIME_INDEX_ENTRY, &count) : NULL;
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((int64_t)get_le(idx + mid * TIME_INDEX_ENTRY, 8) < since) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0) {
+        uint64_t offset = get_le(idx + (lo - 1) * TIME_INDEX_ENTRY + 8, 8);
+        if (offset < size) pos = offset;
+    }
+    free(idx);
+
+    int visited = 0;
+    for (;;) {
+        uint64_t next;
+        int r = visit_frame(fd, pos, size, since, NULL, visit, user, &next);
+        if (r < 0 || r == 2) {
+            if (r == 2) visited++;
+            break;
+        }
+        visited += r;
+        pos = next;
+    }
+    close(fd);
+    free(log_path);
+    free(idx_path);
+    return visited;
+}
+
+/**
+ * @brief Visits entries that touched a package, oldest first.
+ */
+int upkg_history_scan_package(const char *package, int64_t since, upkg_history_visit_fn visit, void *user) {
+    if (!g_db_dir || !package || !visit) return -1;
+    char *log_path = upkg_util_concat_path(g_db_dir, ".history");
+    char *pkg_path = upkg_util_concat_path(g_db_dir, ".history.pkg");
+    uint64_t size = 0;
+    int fd = log_path ? open_log(log_path, O_RDONLY, &size) : -1;
+    size_t count = 0;
+    uint8_t *index = fd >= 0 && pkg_path ? read_index(pkg_path, PACKAGE_INDEX_ENTRY, &count) : NULL;
+
+    uint32_t hash = upkg_hash_fnv1a(package);
+    uint64_t previous = 0;
+    int visited = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *e = index + i * PACKAGE_INDEX_ENTRY;
+        uint64_t offset = get_le(e + 4, 8);
+        // One transaction can list a package twice; FNV collisions are filtered by name
+        if ((uint32_t)get_le(e, 4) != hash || offset == previous) continue;
+        previous = offset;
+
+        uint64_t next;
+        int r = visit_frame(fd, offset, size, since, package, visit, user, &next);
+        if (r > 0) visited++;
+        if (r == 2) break;
+    }
+    free(index);
+    if (fd >= 0) close(fd);
+    free(log_path);
+    free(pkg_path);
+    return visited;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * Filename:    upkg_history.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Append-only binary transaction history with time and package indexes
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_HISTORY_H
+#define UPKG_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Three append-only files in db_dir, written under the database lock:
+ *
+ *   .history       "UPKGHIS1", then one frame per committed transaction:
+ *                  <varint length><payload><CRC-32C of payload, 4 bytes LE>
+ *   .history.idx   sparse time index: a checkpoint every ~16 KiB of log,
+ *                  16 bytes each: <u64 max time before offset><u64 offset>
+ *   .history.pkg   package index, 12 bytes per operation:
+ *                  <u32 FNV-1a of the package name><u64 frame offset>
+ *
+ * A payload is varints (signed values zigzag-encoded) and length-prefixed
+ * strings: time, duration_us, status, summary, op count, then per op
+ * kind, package, old version, new version, files written, files deleted,
+ * duration_us, status. "--since" binary-searches the time index and reads
+ * only the tail of the log; a package query reads the small package index
+ * and only the frames it points at. A torn frame left by a crash is
+ * dropped at the next append.
+ */
+
+typedef enum {
+    UPKG_HISTORY_INSTALL = 1,   // Install, upgrade or rollback restore
+    UPKG_HISTORY_REMOVE = 2
+} upkg_history_op_kind_t;
+
+// One package operation within a transaction
+typedef struct {
+    upkg_history_op_kind_t kind;
+    char *package;
+    char *old_version;          // NULL when the package was not installed
+    char *new_version;          // NULL for removals
+    uint64_t files_written;
+    uint64_t files_deleted;
+    uint64_t duration_us;
+    int status;                 // 0 on success
+} upkg_history_op_t;
+
+// One committed transaction
+typedef struct {
+    uint64_t offset;            // Frame position in .history
+    int64_t time;               // Commit time, seconds since the epoch
+    uint64_t duration_us;
+    int status;                 // Number of failed operations
+    char *summary;
+    upkg_history_op_t *ops;
+    size_t op_count;
+} upkg_history_entry_t;
+
+/**
+ * @brief Receives one history entry.
+ * @param entry The entry; valid only for the duration of the call.
+ * @param user The pointer given to the scan.
+ * @return 0 to continue, non-zero to stop.
+ */
+typedef int (*upkg_history_visit_fn)(const upkg_history_entry_t *entry, void *user);
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Queues a package operation for the next history entry.
+ * @param kind Install or remove.
+ * @param package The package name.
+ * @param old_version The version replaced or removed, or NULL.
+ * @param new_version The version installed, or NULL.
+ * @param files_written Payload files placed.
+ * @param files_deleted Files removed.
+ * @param duration_ns How long the operation took.
+ * @param status 0 on success, non-zero on failure.
+ */
+void upkg_history_note(upkg_history_op_kind_t kind, const char *package, const char *old_version,
+                       const char *new_version, uint64_t files_written, uint64_t files_deleted,
+                       uint64_t duration_ns, int status);
+
+/**
+ * @brief Appends the queued operations as one transaction. Does nothing
+ *        when none are queued. The database lock must be held.
+ * @param summary What the transaction was, e.g. "install foo 1.0".
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_history_commit(const char *summary);
+
+/**
+ * @brief Visits entries committed at or after a time, oldest first.
+ * @param since Seconds since the epoch; INT64_MIN for everything.
+ * @param visit The callback.
+ * @param user Passed through to visit.
+ * @return The number of entries visited, or -1 on failure.
+ */
+int upkg_history_scan_since(int64_t since, upkg_history_visit_fn visit, void *user);
+
+/**
+ * @brief Visits entries that touched a package, oldest first.
+ * @param package The package name.
+ * @param since Seconds since the epoch; INT64_MIN for everything.
+ * @param visit The callback.
+ * @param user Passed through to visit.
+ * @return The number of entries visited, or -1 on failure.
+ */
+int upkg_history_scan_package(const char *package, int64_t since, upkg_history_visit_fn visit, void *user);
+
+#endif // UPKG_HISTORY_H
@@ -0,0 +1,237 @@
+/******************************************************************************
+ * Filename:    upkg_index.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: String-keyed secondary indexes (soname, path, ...) for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_index.h"
+#include "upkg_hash.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Computes the bucket of a key.
+ * @param key The key.
+ * @param size The number of buckets.
+ * @return The bucket index.
+ */
+static size_t bucket_of(const char *key, size_t size) {
+    return upkg_hash_fnv1a(key) % size;
+}
+
+/**
+ * @brief Creates an empty index.
+ * @param initial_size The desired initial number of buckets.
+ * @return A pointer to the new index, or NULL on failure.
+ */
+upkg_index_t *upkg_index_create(size_t initial_size) {
+    upkg_index_t *index = malloc(sizeof(upkg_index_t));
+    if (!index) {
+        upkg_util_error("Failed to allocate memory for index structure.\n");
+        return NULL;
+    }
+
+    if (initial_size < MIN_HASH_TABLE_SIZE) {
+        initial_size = MIN_HASH_TABLE_SIZE;
+    }
+    index->size = upkg_hash_next_prime(initial_size);
+    index->count = 0;
+    index->buckets = calloc(index->size, sizeof(upkg_index_entry_t *));
+    if (!index->buckets) {
+        upkg_util_error("Failed to allocate memory for index buckets.\n");
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Destroys an index and frees all keys and values.
+ * @param index The index to destroy.
+ */
+void upkg_index_destroy(upkg_index_t *index) {
+    if (!index) return;
+
+    for (size_t i = 0; i < index->size; i++) {
+        upkg_index_entry_t *current = index->buckets[i];
+        while (current) {
+            upkg_index_entry_t *next = current->next;
+            free(current->key);
+            free(current->value);
+            free(current);
+            current = next;
+        }
+    }
+    free(index->buckets);
+    free(index);
+}
+
+/**
+ * @brief Grows the bucket array once the load factor is exceeded.
+ * @param index The index.
+ * @return 0 on success, -1 on failure.
+ */
+static int grow_index(upkg_index_t *index) {
+    size_t new_size = upkg_hash_next_prime(index->size * 2);
+    upkg_index_entry_t **new_buckets = calloc(new_size, sizeof(upkg_index_entry_t *));
+    if (!new_buckets) {
+        upkg_util_error("Failed to allocate memory for index resize.\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < index->size; i++) {
+        upkg_index_entry_t *current = index->buckets[i];
+        while (current) {
+            upkg_index_entry_t *next = current->next;
+            size_t b = bucket_of(current->key, new_size);
+            current->next = new_buckets[b];
+            new_buckets[b] = current;
+            current = next;
+        }
+    }
+
+    free(index->buckets);
+    index->buckets = new_buckets;
+    index->size = new_size;
+    return 0;
+}
+
+/**
+ * @brief Adds a key/value pair; an identical pair is only stored once.
+ * @param index The index.
+ * @param key The key (copied).
+ * @param value The value (copied).
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_index_insert(upkg_index_t *index, const char *key, const char *value) {
+    if (!index || !key || !value) return -1;
+
+    for (upkg_index_entry_t *e = upkg_index_find(index, key); e; e = upkg_index_next_match(e)) {
+        if (strcmp(e->value, value) == 0) {
+            return 0;
+        }
+    }
+
+    if ((double)(index->count + 1) / index->size > GROW_LOAD_FACTOR_THRESHOLD) {
+        if (grow_index(index) != 0) {
+            return -1;
+        }
+    }
+
+    upkg_index_entry_t *entry = malloc(sizeof(upkg_index_entry_t));
+    if (!entry) {
+        upkg_util_error("Failed to allocate memory for index entry.\n");
+        return -1;
+    }
+    entry->key = strdup(key);
+    entry->value = strdup(value);
+    if (!entry->key || !entry->value) {
+        upkg_util_error("Failed to duplicate index entry strings.\n");
+        free(entry->key);
+        free(entry->value);
+        free(entry);
+        return -1;
+    }
+
+    size_t b = bucket_of(key, index->size);
+    entry->next = index->buckets[b];
+    index->buckets[b] = entry;
+    index->count++;
+    return 0;
+}
+
+/**
+ * @brief Finds the first entry stored under a key.
+ * @param index The index.
+ * @param key The key to look up.
+ * @return The entry, or NULL if the key is absent.
+ */
+upkg_index_entry_t *upkg_index_find(const upkg_index_t *index, const char *key) {
+    if (!index || !key) return NULL;
+
+    upkg_index_entry_t *current = index->buckets[bucket_of(key, index->size)];
+    while (current) {
+        if (strcmp(current->key, key) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Continues a lookup started with upkg_index_find.
+ * @param entry The previous match.
+ * @return The next entry with the same key, or NULL.
+ */
+upkg_index_entry_t *upkg_index_next_match(upkg_index_entry_t *entry) {
+    if (!entry) return NULL;
+
+    for (upkg_index_entry_t *current = entry->next; current; current = current->next) {
+        if (strcmp(current->key, entry->key) == 0) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the first value stored under a key.
+ * @param index The index.
+ * @param key The key to look up.
+ * @return The value, or NULL if the key is absent.
+ */
+const char *upkg_index_lookup(const upkg_index_t *index, const char *key) {
+    upkg_index_entry_t *entry = upkg_index_find(index, key);
+    return entry ? entry->value : NULL;
+}
+
+/**
+ * @brief Removes one key/value pair.
+ * @param index The index.
+ * @param key The key.
+ * @param value The value to remove from under the key.
+ * @return 0 if the pair was removed, -1 if it was not present.
+ */
+int upkg_index_remove(upkg_index_t *index, const char *key, const char *value) {
+    if (!index || !key || !value) return -1;
+
+    size_t b = bucket_of(key, index->size);
+    upkg_index_entry_t *current = index->buckets[b];
+    upkg_index_entry_t *prev = NULL;
+    while (current) {
+        if (strcmp(current->key, key) == 0 && strcmp(current->value, value) == 0) {
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                index->buckets[b] = current->next;
+            }
+            free(current->key);
+            free(current->value);
+            free(current);
+            index->count--;
+            return 0;
+        }
+        prev = current;
+        current = current->next;
+    }
+    return -1;
+}
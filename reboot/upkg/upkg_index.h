@@ -0,0 +1,103 @@
+/******************************************************************************
+ * Filename:    upkg_index.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: String-keyed secondary indexes (soname, path, ...) for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_INDEX_H
+#define UPKG_INDEX_H
+
+#include <stddef.h>
+
+// --- Index Entry Structure ---
+
+/**
+ * @brief One key/value pair. A key may appear several times with different values
+ * (e.g. a soname provided by two packages); all of them sit in the same chain.
+ */
+typedef struct upkg_index_entry {
+    char *key;
+    char *value;
+    struct upkg_index_entry *next;
+} upkg_index_entry_t;
+
+// --- Index Structure ---
+typedef struct upkg_index {
+    upkg_index_entry_t **buckets;
+    size_t size;
+    size_t count;
+} upkg_index_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Creates an empty index.
+ * @param initial_size The desired initial number of buckets.
+ * @return A pointer to the new index, or NULL on failure.
+ */
+upkg_index_t *upkg_index_create(size_t initial_size);
+
+/**
+ * @brief Destroys an index and frees all keys and values.
+ * @param index The index to destroy.
+ */
+void upkg_index_destroy(upkg_index_t *index);
+
+/**
+ * @brief Adds a key/value pair; an identical pair is only stored once.
+ * @param index The index.
+ * @param key The key (copied).
+ * @param value The value (copied).
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_index_insert(upkg_index_t *index, const char *key, const char *value);
+
+/**
+ * @brief Finds the first entry stored under a key.
+ * @param index The index.
+ * @param key The key to look up.
+ * @return The entry, or NULL if the key is absent. Use upkg_index_next_match for more.
+ */
+upkg_index_entry_t *upkg_index_find(const upkg_index_t *index, const char *key);
+
+/**
+ * @brief Continues a lookup started with upkg_index_find.
+ * @param entry The previous match.
+ * @return The next entry with the same key, or NULL.
+ */
+upkg_index_entry_t *upkg_index_next_match(upkg_index_entry_t *entry);
+
+/**
+ * @brief Returns the first value stored under a key.
+ * @param index The index.
+ * @param key The key to look up.
+ * @return The value, or NULL if the key is absent.
+ */
+const char *upkg_index_lookup(const upkg_index_t *index, const char *key);
+
+/**
+ * @brief Removes one key/value pair.
+ * @param index The index.
+ * @param key The key.
+ * @param value The value to remove from under the key.
+ * @return 0 if the pair was removed, -1 if it was not present.
+ */
+int upkg_index_remove(upkg_index_t *index, const char *key, const char *value);
+
+#endif // UPKG_INDEX_H
@@ -0,0 +1,232 @@
+/******************************************************************************
+ * Filename:    upkg_install.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Places package payloads under the install root and removes them
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_install.h"
+#include "upkg_dirtab.h"
+#include "upkg_index.h"
+#include "upkg_metrics.h"
+#include "upkg_trace.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// --- Install ---
+
+/**
+ * @brief Places one regular file or symlink at its target path.
+ * @param src The extracted file.
+ * @param dst The target path under the install root.
+ * @return 0 on success, -1 on failure.
+ */
+static int install_one_file(const char *src, const char *dst) {
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.upkg-new", dst) >= (int)sizeof(tmp_path)) {
+        upkg_util_error("Install path too long: %s\n", dst);
+        return -1;
+    }
+
+    struct stat st;
+    if (upkg_vfs->lstat(src, &st) != 0) {
+        upkg_util_error("Failed to stat '%s': %s\n", src, strerror(errno));
+        return -1;
+    }
+
+    uint64_t trace_start = UPKG_TRACE_NOW();
+    upkg_vfs->unlink(tmp_path);
+    if (S_ISLNK(st.st_mode)) {
+        char target[PATH_MAX];
+        ssize_t n = upkg_vfs->readlink(src, target, sizeof(target) - 1);
+        if (n < 0) {
+            upkg_util_error("Failed to read symlink '%s': %s\n", src, strerror(errno));
+            return -1;
+        }
+        target[n] = '\0';
+        if (upkg_vfs->symlink(target, tmp_path) != 0) {
+            upkg_util_error("Failed to create symlink '%s': %s\n", tmp_path, strerror(errno));
+            return -1;
+        }
+    } else if (upkg_util_copy_file(src, tmp_path) != 0) {
+        upkg_vfs->unlink(tmp_path);
+        return -1;
+    } else {
+        upkg_metrics_add(UPKG_METRIC_BYTES_WRITTEN, (uint64_t)st.st_size);
+    }
+
+    if (upkg_vfs->rename(tmp_path, dst) != 0) {
+        upkg_util_error("Failed to move '%s' into place: %s\n", dst, strerror(errno));
+        upkg_vfs->unlink(tmp_path);
+        return -1;
+    }
+    upkg_metrics_add(UPKG_METRIC_FILES_WRITTEN, 1);
+    UPKG_TRACE3(file__write, dst, (int64_t)st.st_size, UPKG_TRACE_NOW() - trace_start);
+    return 0;
+}
+
+/**
+ * @brief Copies an extracted package's directories, files and symlinks
+ *        under the install root and takes a reference on every directory.
+ * @param pkg_info The extracted package (data_dir_path, dir_list, file_list).
+ * @param root The install root.
+ * @param progress Called after every file, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_install_package_files(const upkg_package_info_t *pkg_info, const char *root,
+                               upkg_install_progress_fn progress, void *user) {
+    if (!pkg_info || !root || !pkg_info->data_dir_path) {
+        upkg_util_error("install_package_files: NULL package, data directory or root.\n");
+        return -1;
+    }
+
+    // Whether each directory predates this install decides if it may ever be pruned
+    bool *existed = calloc(pkg_info->dir_count > 0 ? (size_t)pkg_info->dir_count : 1, sizeof(bool));
+    if (!existed) {
+        upkg_util_error("Failed to allocate memory for directory state.\n");
+        return -1;
+    }
+
+    int ret = 0;
+    for (int i = 0; ret == 0 && i < pkg_info->dir_count; i++) {
+        char *src = upkg_util_concat_path(pkg_info->data_dir_path, pkg_info->dir_list[i]);
+        char *dst = upkg_util_concat_path(root, pkg_info->dir_list[i]);
+        struct stat st;
+        if (!src || !dst) {
+            ret = -1;
+        } else if (upkg_vfs->lstat(dst, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                existed[i] = true;
+            } else {
+                upkg_util_error("Cannot create directory '%s': a file is in the way.\n", dst);
+                ret = -1;
+            }
+        } else {
+            mode_t mode = (upkg_vfs->stat(src, &st) == 0) ? (st.st_mode & 07777) : 0755;
+            if (upkg_vfs->mkdir(dst, mode) != 0 && errno != EEXIST) {
+                upkg_util_error("Failed to create directory '%s': %s\n", dst, strerror(errno));
+                ret = -1;
+            }
+        }
+        free(src);
+        free(dst);
+    }
+
+    for (int i = 0; ret == 0 && i < pkg_info->file_count; i++) {
+        char *src = upkg_util_concat_path(pkg_info->data_dir_path, pkg_info->file_list[i]);
+        char *dst = upkg_util_concat_path(root, pkg_info->file_list[i]);
+        if (!src || !dst || install_one_file(src, dst) != 0) {
+            ret = -1;
+        } else {
+            upkg_util_log_verbose("Installed: %s\n", dst);
+            if (progress) {
+                progress(pkg_info->file_list[i], (size_t)i + 1, (size_t)pkg_info->file_count, user);
+            }
+        }
+        free(src);
+        free(dst);
+    }
+
+    // Only take references once the payload is in place
+    for (int i = 0; ret == 0 && i < pkg_info->dir_count; i++) {
+        ret = upkg_dirtab_acquire(pkg_info->dir_list[i], existed[i]);
+    }
+
+    free(existed);
+    return ret;
+}
+
+// --- Remove ---
+
+/**
+ * @brief Removes an installed package's files and drops its directory
+ *        references, pruning directories that become unowned.
+ * @param pkg_info The installed package record.
+ * @param root The install root.
+ * @param replacement The record replacing pkg_info on upgrade (its files are
+ *        kept), or NULL on plain removal.
+ * @return 0 on success, -1 if any path could not be removed.
+ */
+int upkg_install_remove_files(const upkg_hash_package_info_t *pkg_info, const char *root,
+                              const upkg_hash_package_info_t *replacement) {
+    if (!pkg_info || !root) return -1;
+
+    upkg_index_t *keep = NULL;
+    if (replacement && replacement->file_count > 0) {
+        keep = upkg_index_create((size_t)replacement->file_count);
+        if (!keep) return -1;
+        for (int i = 0; i < replacement->file_count; i++) {
+            upkg_index_insert(keep, replacement->file_list[i], "");
+        }
+    }
+
+    int ret = 0;
+    for (int i = 0; i < pkg_info->file_count; i++) {
+        if (keep && upkg_index_find(keep, pkg_info->file_list[i])) {
+            continue;
+        }
+        char *path = upkg_util_concat_path(root, pkg_info->file_list[i]);
+        if (!path) {
+            ret = -1;
+            continue;
+        }
+        if (upkg_vfs->unlink(path) != 0 && errno != ENOENT) {
+            upkg_util_error("Failed to remove '%s': %s\n", path, strerror(errno));
+            ret = -1;
+        } else {
+            upkg_util_log_verbose("Removed: %s\n", path);
+        }
+        free(path);
+    }
+    upkg_index_destroy(keep);
+
+    // dir_list is parents-first, so walking it backwards prunes children first
+    for (int i = pkg_info->dir_count - 1; i >= 0; i--) {
+        bool prune = false;
+        if (upkg_dirtab_release(pkg_info->dir_list[i], &prune) != 0 || !prune) {
+            continue;
+        }
+        char *path = upkg_util_concat_path(root, pkg_info->dir_list[i]);
+        if (!path) {
+            ret = -1;
+            continue;
+        }
+        if (upkg_vfs->rmdir(path) == 0) {
+            upkg_util_log_verbose("Pruned directory: %s\n", path);
+        } else if (errno == ENOTEMPTY || errno == EEXIST) {
+            upkg_util_log_verbose("Leaving directory with foreign contents: %s\n", path);
+        } else if (errno != ENOENT) {
+            upkg_util_error("Failed to remove directory '%s': %s\n", path, strerror(errno));
+            ret = -1;
+        }
+        free(path);
+    }
+    return ret;
+}
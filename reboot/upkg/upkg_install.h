@@ -0,0 +1,68 @@
+/******************************************************************************
+ * Filename:    upkg_install.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Places package payloads under the install root and removes them
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_INSTALL_H
+#define UPKG_INSTALL_H
+
+#include "upkg_pack.h"
+#include "upkg_hash.h"
+
+/**
+ * @brief Called after each payload file is placed.
+ * @param path The file's path relative to the install root.
+ * @param done Files placed so far.
+ * @param total Files in the package.
+ * @param user The caller's context pointer.
+ */
+typedef void (*upkg_install_progress_fn)(const char *path, size_t done, size_t total, void *user);
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Copies an extracted package's directories, files and symlinks
+ *        under the install root and takes a reference on every directory.
+ *
+ * Files are written to a temporary name and renamed over the target, so a
+ * running binary is replaced rather than truncated.
+ *
+ * @param pkg_info The extracted package (data_dir_path, dir_list, file_list).
+ * @param root The install root.
+ * @param progress Called after every file, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_install_package_files(const upkg_package_info_t *pkg_info, const char *root,
+                               upkg_install_progress_fn progress, void *user);
+
+/**
+ * @brief Removes an installed package's files and drops its directory
+ *        references, pruning directories that become unowned.
+ * @param pkg_info The installed package record.
+ * @param root The install root.
+ * @param replacement The record replacing pkg_info on upgrade (its files are
+ *        kept), or NULL on plain removal.
+ * @return 0 on success, -1 if any path could not be removed.
+ */
+int upkg_install_remove_files(const upkg_hash_package_info_t *pkg_info, const char *root,
+                              const upkg_hash_package_info_t *replacement);
+
+#endif // UPKG_INSTALL_H
@@ -0,0 +1,283 @@
+/******************************************************************************
+ * Filename:    upkg_install_bench.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Install and remove benchmark over the VFS backends
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_install.h"
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_manifest.h"
+#include "upkg_config.h"
+#include "upkg_metrics.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+
+/*
+ * Usage: upkg_install_bench [-v posix|memory] [-f files] [packages ...]
+ *
+ * For each size (default 100 and 1000 packages) and VFS backend, lays out
+ * synthetic extracted packages under a scratch root, then measures the
+ * per-package cost of each step an install or removal performs:
+ *   copy      upkg_install_package_files (dirs, files, symlink, dirtab refs)
+ *   record    upkg_db_store_package
+ *   manifest  upkg_manifest_create (stat + SHA-256 of every file)
+ *   audit     upkg_manifest_audit of the untouched tree
+ *   remove    upkg_install_remove_files + upkg_db_delete_package
+ * The memory backend has no disk or page cache behind it, so its numbers
+ * repeat run to run and isolate upkg's own CPU cost.
+ */
+
+#define BENCH_FILE_SIZE 4096
+
+// --- Synthetic Packages ---
+
+/**
+ * @brief Writes one synthetic file through the active VFS.
+ */
+static int write_file(const char *path, int seed) {
+    char buf[BENCH_FILE_SIZE];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char)('a' + (i * 7 + (size_t)seed) % 26);
+    }
+    upkg_vfs_file_t *f = upkg_vfs->open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (!f) return -1;
+    int ret = upkg_vfs->write(f, buf, sizeof(buf)) == (ssize_t)sizeof(buf) ? 0 : -1;
+    if (upkg_vfs->close(f) != 0) ret = -1;
+    return ret;
+}
+
+/**
+ * @brief Lays out an extracted package under src and describes it;
+ *        free with upkg_pack_free_package_info.
+ */
+static int make_package(const char *src, int i, int files, upkg_package_info_t *pkg) {
+    char buf[512];
+    upkg_pack_init_package_info(pkg);
+    snprintf(buf, sizeof(buf), "bench-pkg-%06d", i);
+    pkg->package_name = strdup(buf);
+    pkg->version = strdup("1.0-1");
+    pkg->architecture = strdup("amd64");
+    snprintf(buf, sizeof(buf), "%s/bench-pkg-%06d", src, i);
+    pkg->data_dir_path = strdup(buf);
+
+    pkg->dir_list = calloc(4, sizeof(char *));
+    pkg->file_list = calloc((size_t)files + 1, sizeof(char *));
+    if (!pkg->package_name || !pkg->data_dir_path || !pkg->dir_list || !pkg->file_list) return -1;
+
+    pkg->dir_list[pkg->dir_count++] = strdup("usr");
+    pkg->dir_list[pkg->dir_count++] = strdup("usr/share");
+    snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d", i);
+    pkg->dir_list[pkg->dir_count++] = strdup(buf);
+    snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d/data", i);
+    pkg->dir_list[pkg->dir_count++] = strdup(buf);
+
+    char *data = upkg_util_concat_path(pkg->data_dir_path, buf);
+    if (!data || upkg_util_create_dir_recursive(data, 0755) != 0) {
+        free(data);
+        return -1;
+    }
+    free(data);
+
+    for (int f = 0; f < files; f++) {
+        snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d/data/file-%03d.dat", i, f);
+        pkg->file_list[pkg->file_count++] = strdup(buf);
+        char *path = upkg_util_concat_path(pkg->data_dir_path, buf);
+        if (!path || write_file(path, i + f) != 0) {
+            free(path);
+            return -1;
+        }
+        free(path);
+    }
+
+    snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d/current", i);
+    pkg->file_list[pkg->file_count++] = strdup(buf);
+    char *link = upkg_util_concat_path(pkg->data_dir_path, buf);
+    int ret = link && upkg_vfs->symlink("data/file-000.dat", link) == 0 ? 0 : -1;
+    free(link);
+    return ret;
+}
+
+// --- Measurements ---
+
+/**
+ * @brief Removes one path for nftw.
+ */
+static int remove_path(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Installs and removes n packages through one backend and measures it.
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_vfs(const upkg_vfs_ops_t *vfs, int n, int files, const char *tmp) {
+    char base[3072];
+    if (vfs == &upkg_vfs_memory) {
+        upkg_vfs_memory_reset();
+        snprintf(base, sizeof(base), "/bench");
+    } else {
+        snprintf(base, sizeof(base), "%s/upkg-install-bench-XXXXXX", tmp);
+        if (!mkdtemp(base)) {
+            perror("mkdtemp");
+            return -1;
+        }
+    }
+    upkg_vfs_use(vfs);
+
+    char src[4096], root[4096], db[4096];
+    snprintf(src, sizeof(src), "%s/src", base);
+    snprintf(root, sizeof(root), "%s/root", base);
+    snprintf(db, sizeof(db), "%s/db", base);
+    g_db_dir = db;
+
+    int ret = -1;
+    uint64_t copy_ns = 0, record_ns = 0, manifest_ns = 0, audit_ns = 0, remove_ns = 0;
+    upkg_package_info_t *pkgs = calloc((size_t)n, sizeof(*pkgs));
+    upkg_hash_package_info_t *recs = calloc((size_t)n, sizeof(*recs));
+    if (!pkgs || !recs || upkg_util_create_dir_recursive(root, 0755) != 0 ||
+        upkg_util_create_dir_recursive(db, 0755) != 0 || upkg_dirtab_load() != 0) {
+        goto out;
+    }
+
+    // Extraction is a dpkg-deb child process in real installs; not timed
+    for (int i = 0; i < n; i++) {
+        if (make_package(src, i, files, &pkgs[i]) != 0 ||
+            upkg_hash_convert_package_info(&pkgs[i], &recs[i]) != 0) {
+            goto out;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint64_t t0 = upkg_metrics_now_ns();
+        if (upkg_install_package_files(&pkgs[i], root, NULL, NULL) != 0) goto out;
+        uint64_t t1 = upkg_metrics_now_ns();
+        if (upkg_db_store_package(&recs[i]) != 0) goto out;
+        uint64_t t2 = upkg_metrics_now_ns();
+        if (upkg_manifest_create(recs[i].package_name, recs[i].file_list, recs[i].file_count, root) != 0) goto out;
+        copy_ns += t1 - t0;
+        record_ns += t2 - t1;
+        manifest_ns += upkg_metrics_now_ns() - t2;
+    }
+    if (upkg_dirtab_save() != 0) goto out;
+
+    size_t nodes = 0, bytes = vfs == &upkg_vfs_memory ? upkg_vfs_memory_usage(&nodes) : 0;
+
+    for (int i = 0; i < n; i++) {
+        upkg_audit_counts_t counts = { 0 };
+        uint64_t t0 = upkg_metrics_now_ns();
+        if (upkg_manifest_audit(recs[i].package_name, root, &counts) != 0 || counts.modified ||
+            counts.missing || counts.retyped) {
+            goto out;
+        }
+        audit_ns += upkg_metrics_now_ns() - t0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint64_t t0 = upkg_metrics_now_ns();
+        if (upkg_install_remove_files(&recs[i], root, NULL) != 0 ||
+            upkg_db_delete_package(recs[i].package_name) != 0) {
+            goto out;
+        }
+        remove_ns += upkg_metrics_now_ns() - t0;
+    }
+    if (upkg_dirtab_save() != 0) goto out;
+    ret = 0;
+
+out:
+    if (ret == 0) {
+        printf("%-6s %9d %6d %12.1f %12.1f %12.1f %12.1f %12.1f", vfs->name, n, files,
+               (double)copy_ns / n / 1e3, (double)record_ns / n / 1e3, (double)manifest_ns / n / 1e3,
+               (double)audit_ns / n / 1e3, (double)remove_ns / n / 1e3);
+        if (vfs == &upkg_vfs_memory) printf("   (%zu nodes, %.1f MiB)", nodes, (double)bytes / 1048576.0);
+        printf("\n");
+    } else {
+        printf("%-6s %9d %6d   failed\n", vfs->name, n, files);
+    }
+    fflush(stdout);
+
+    for (int i = 0; pkgs && i < n; i++) upkg_pack_free_package_info(&pkgs[i]);
+    for (int i = 0; recs && i < n; i++) upkg_hash_free_package_info(&recs[i]);
+    free(pkgs);
+    free(recs);
+    upkg_db_close();
+    g_db_dir = NULL;
+    upkg_vfs_use(NULL);
+    if (vfs == &upkg_vfs_memory) {
+        upkg_vfs_memory_reset();
+    } else {
+        nftw(base, remove_path, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    static const int default_sizes[] = { 100, 1000 };
+    static const upkg_vfs_ops_t *const backends[] = { &upkg_vfs_posix, &upkg_vfs_memory, NULL };
+    const upkg_vfs_ops_t *only = NULL;
+    int sizes[64], size_count = 0, files = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            i++;
+            for (int b = 0; backends[b]; b++) {
+                if (strcmp(argv[i], backends[b]->name) == 0) only = backends[b];
+            }
+            if (!only) {
+                fprintf(stderr, "Unknown VFS backend '%s'.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            files = atoi(argv[++i]);
+        } else if (atoi(argv[i]) > 0 && size_count < (int)(sizeof(sizes) / sizeof(sizes[0]))) {
+            sizes[size_count++] = atoi(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-v posix|memory] [-f files] [packages ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size_count == 0) {
+        size_count = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+        memcpy(sizes, default_sizes, sizeof(default_sizes));
+    }
+    const char *tmp = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    // UPKG_LOG_FILE=... measures the cost of debug logging on the install path
+    if (upkg_log_init() != 0) return 1;
+
+    int failed = 0;
+    printf("%-6s %9s %6s %12s %12s %12s %12s %12s\n", "vfs", "packages", "files", "copy(us)", "record(us)",
+           "manifest(us)", "audit(us)", "remove(us)");
+    for (int s = 0; s < size_count; s++) {
+        for (int b = 0; backends[b]; b++) {
+            if (only && backends[b] != only) continue;
+            if (bench_vfs(backends[b], sizes[s], files, tmp) != 0) failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,253 @@
+/******************************************************************************
+ * Filename:    upkg_json.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Streaming JSON writer for machine-readable upkg output
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_json.h"
+#include "upkg_cpu.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+// --- Structure ---
+
+/**
+ * @brief Writes the separator a new value needs at the current position.
+ * @param json The writer.
+ */
+static void json_value_prefix(upkg_json_t *json) {
+    if (json->after_key) {
+        json->after_key = false;
+        return;
+    }
+    if (json->need_comma[json->depth] && !(json->lines && json->depth == 0)) {
+        upkg_out_write(json->out, ",", 1);
+    }
+    json->need_comma[json->depth] = true;
+}
+
+/**
+ * @brief Ends a top-level value with a newline.
+ * @param json The writer.
+ */
+static void json_value_done(upkg_json_t *json) {
+    if (json->depth == 0) upkg_out_write(json->out, "\n", 1);
+}
+
+/**
+ * @brief Prepares a writer over an output buffer.
+ */
+void upkg_json_init(upkg_json_t *json, upkg_out_t *out, bool lines) {
+    memset(json, 0, sizeof(*json));
+    json->out = out;
+    json->lines = lines;
+}
+
+/**
+ * @brief Opens an object or array.
+ * @param json The writer.
+ * @param open The opening bracket.
+ */
+static void json_open(upkg_json_t *json, char open) {
+    json_value_prefix(json);
+    upkg_out_write(json->out, &open, 1);
+    // Nothing upkg writes nests this deep; the cap only keeps the stack in bounds
+    if (json->depth < UPKG_JSON_MAX_DEPTH) json->depth++;
+    json->need_comma[json->depth] = false;
+}
+
+/**
+ * @brief Closes the innermost object or array.
+ * @param json The writer.
+ * @param close The closing bracket.
+ */
+static void json_close(upkg_json_t *json, char close) {
+    upkg_out_write(json->out, &close, 1);
+    if (json->depth > 0) json->depth--;
+    json_value_done(json);
+}
+
+/**
+ * @brief Opens an object.
+ */
+void upkg_json_begin_object(upkg_json_t *json) {
+    json_open(json, '{');
+}
+
+/**
+ * @brief Closes the innermost object.
+ */
+void upkg_json_end_object(upkg_json_t *json) {
+    json_close(json, '}');
+}
+
+/**
+ * @brief Opens an array.
+ */
+void upkg_json_begin_array(upkg_json_t *json) {
+    json_open(json, '[');
+}
+
+/**
+ * @brief Closes the innermost array.
+ */
+void upkg_json_end_array(upkg_json_t *json) {
+    json_close(json, ']');
+}
+
+/**
+ * @brief Writes an object key; the next call writes its value.
+ */
+void upkg_json_key(upkg_json_t *json, const char *key) {
+    json_value_prefix(json);
+    upkg_out_write(json->out, "\"", 1);
+    upkg_out_puts(json->out, key);
+    upkg_out_write(json->out, "\":", 2);
+    json->after_key = true;
+}
+
+// --- Values ---
+
+/**
+ * @brief Writes a string value of known length.
+ */
+void upkg_json_string_len(upkg_json_t *json, const char *str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    json_value_prefix(json);
+    upkg_out_write(json->out, "\"", 1);
+    while (len > 0) {
+        size_t run = upkg_cpu_json_plain(str, len);
+        upkg_out_write(json->out, str, run);
+        if (run == len) break;
+
+        unsigned char c = (unsigned char)str[run];
+        char esc[6] = { '\\', 0 };
+        size_t esc_len = 2;
+        switch (c) {
+            case '"':  esc[1] = '"'; break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\t': esc[1] = 't'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\b': esc[1] = 'b'; break;
+            case '\f': esc[1] = 'f'; break;
+            default:
+                memcpy(esc + 1, "u00", 3);
+                esc[4] = hex[c >> 4];
+                esc[5] = hex[c & 0x0f];
+                esc_len = 6;
+                break;
+        }
+        upkg_out_write(json->out, esc, esc_len);
+        str += run + 1;
+        len -= run + 1;
+    }
+    upkg_out_write(json->out, "\"", 1);
+    json_value_done(json);
+}
+
+/**
+ * @brief Writes a string value, or null for NULL.
+ */
+void upkg_json_string(upkg_json_t *json, const char *str) {
+    if (!str) {
+        json_value_prefix(json);
+        upkg_out_write(json->out, "null", 4);
+        json_value_done(json);
+        return;
+    }
+    upkg_json_string_len(json, str, strlen(str));
+}
+
+/**
+ * @brief Writes an integer value.
+ */
+void upkg_json_int(upkg_json_t *json, int64_t value) {
+    char digits[24];
+    int n = snprintf(digits, sizeof(digits), "%" PRId64, value);
+    json_value_prefix(json);
+    upkg_out_write(json->out, digits, (size_t)n);
+    json_value_done(json);
+}
+
+/**
+ * @brief Writes true or false.
+ */
+void upkg_json_bool(upkg_json_t *json, bool value) {
+    json_value_prefix(json);
+    upkg_out_puts(json->out, value ? "true" : "false");
+    json_value_done(json);
+}
+
+/**
+ * @brief Writes an array of strings, skipping NULL entries.
+ */
+void upkg_json_string_array(upkg_json_t *json, char *const *list, int count) {
+    upkg_json_begin_array(json);
+    for (int i = 0; list && i < count; i++) {
+        if (list[i]) upkg_json_string(json, list[i]);
+    }
+    upkg_json_end_array(json);
+}
+
+// --- Package Records ---
+
+/**
+ * @brief Writes a package record as one object.
+ */
+void upkg_json_package(upkg_json_t *json, const upkg_hash_package_info_t *pkg_info, bool full) {
+    upkg_json_begin_object(json);
+    upkg_json_key(json, "package");
+    upkg_json_string(json, pkg_info->package_name);
+    upkg_json_key(json, "version");
+    upkg_json_string(json, pkg_info->version);
+    upkg_json_key(json, "architecture");
+    upkg_json_string(json, pkg_info->architecture);
+    if (full) {
+        upkg_json_key(json, "installed");
+        upkg_json_bool(json, true);
+        upkg_json_key(json, "maintainer");
+        upkg_json_string(json, pkg_info->maintainer);
+        upkg_json_key(json, "section");
+        upkg_json_string(json, pkg_info->section);
+        upkg_json_key(json, "priority");
+        upkg_json_string(json, pkg_info->priority);
+        upkg_json_key(json, "installed_size");
+        upkg_json_string(json, pkg_info->installed_size);
+        upkg_json_key(json, "depends");
+        upkg_json_string(json, pkg_info->depends);
+        upkg_json_key(json, "homepage");
+        upkg_json_string(json, pkg_info->homepage);
+    }
+    upkg_json_key(json, "description");
+    upkg_json_string(json, pkg_info->description);
+    if (full) {
+        upkg_json_key(json, "filename");
+        upkg_json_string(json, pkg_info->filename);
+        upkg_json_key(json, "files");
+        upkg_json_string_array(json, pkg_info->file_list, pkg_info->file_count);
+        upkg_json_key(json, "provides_libs");
+        upkg_json_string_array(json, pkg_info->provided_sonames, pkg_info->provided_soname_count);
+        upkg_json_key(json, "needs_libs");
+        upkg_json_string_array(json, pkg_info->needed_sonames, pkg_info->needed_soname_count);
+    }
+    upkg_json_end_object(json);
+}
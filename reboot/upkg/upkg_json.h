@@ -0,0 +1,144 @@
+/******************************************************************************
+ * Filename:    upkg_json.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Streaming JSON writer for machine-readable upkg output
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_JSON_H
+#define UPKG_JSON_H
+
+#include "upkg_format.h"
+#include "upkg_hash.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * --json and --ndjson output is written straight into an upkg_out_t
+ * buffer as values are produced: the writer keeps only a nesting stack,
+ * never builds a document, and never allocates, so a listing of any size
+ * streams in constant memory.
+ *
+ * Strings are copied in runs found by upkg_cpu_json_plain (SIMD where
+ * available); only '"', '\\' and control characters are escaped. Bytes
+ * >= 0x80 pass through, so UTF-8 stays UTF-8.
+ *
+ * In NDJSON mode every top-level value is followed by a newline; in JSON
+ * mode the caller wraps its records in one top-level array.
+ */
+
+#define UPKG_JSON_MAX_DEPTH 16
+
+// --- Writer State ---
+typedef struct {
+    upkg_out_t *out;
+    bool lines;                           // NDJSON: newline after each top-level value
+    int depth;
+    bool after_key;                       // the next value belongs to a key just written
+    bool need_comma[UPKG_JSON_MAX_DEPTH + 1];
+} upkg_json_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Prepares a writer over an output buffer.
+ * @param json The writer.
+ * @param out The buffer values are written into.
+ * @param lines true for NDJSON, false for JSON.
+ */
+void upkg_json_init(upkg_json_t *json, upkg_out_t *out, bool lines);
+
+/**
+ * @brief Opens an object.
+ * @param json The writer.
+ */
+void upkg_json_begin_object(upkg_json_t *json);
+
+/**
+ * @brief Closes the innermost object.
+ * @param json The writer.
+ */
+void upkg_json_end_object(upkg_json_t *json);
+
+/**
+ * @brief Opens an array.
+ * @param json The writer.
+ */
+void upkg_json_begin_array(upkg_json_t *json);
+
+/**
+ * @brief Closes the innermost array.
+ * @param json The writer.
+ */
+void upkg_json_end_array(upkg_json_t *json);
+
+/**
+ * @brief Writes an object key; the next call writes its value.
+ * @param json The writer.
+ * @param key The key, written as given (keys are ASCII identifiers).
+ */
+void upkg_json_key(upkg_json_t *json, const char *key);
+
+/**
+ * @brief Writes a string value, or null for NULL.
+ * @param json The writer.
+ * @param str The string.
+ */
+void upkg_json_string(upkg_json_t *json, const char *str);
+
+/**
+ * @brief Writes a string value of known length.
+ * @param json The writer.
+ * @param str The bytes, which may contain NULs.
+ * @param len The number of bytes.
+ */
+void upkg_json_string_len(upkg_json_t *json, const char *str, size_t len);
+
+/**
+ * @brief Writes an integer value.
+ * @param json The writer.
+ * @param value The value.
+ */
+void upkg_json_int(upkg_json_t *json, int64_t value);
+
+/**
+ * @brief Writes true or false.
+ * @param json The writer.
+ * @param value The value.
+ */
+void upkg_json_bool(upkg_json_t *json, bool value);
+
+/**
+ * @brief Writes an array of strings, skipping NULL entries.
+ * @param json The writer.
+ * @param list The strings.
+ * @param count The number of entries.
+ */
+void upkg_json_string_array(upkg_json_t *json, char *const *list, int count);
+
+/**
+ * @brief Writes a package record as one object: its control fields and,
+ *        when full is set, "installed": true, its files and shared library
+ *        names.
+ * @param json The writer.
+ * @param pkg_info The package record.
+ * @param full false for the summary -l prints, true for -s.
+ */
+void upkg_json_package(upkg_json_t *json, const upkg_hash_package_info_t *pkg_info, bool full);
+
+#endif // UPKG_JSON_H
@@ -0,0 +1,293 @@
+/******************************************************************************
+ * Filename:    upkg_log.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Level-gated logging with an asynchronous structured sink for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOG_RING_SLOTS 1024            // Power of two
+#define LOG_MESSAGE_MAX 480
+#define LOG_IDLE_SLEEP_NS 2000000      // Writer poll interval when the ring is empty
+#define LOG_STREAM_BUFFER (64 * 1024)
+
+// One queued record. seq implements a bounded multi-producer queue: a slot
+// is free for ticket t when seq == t, and holds ticket t's record when
+// seq == t + 1.
+typedef struct {
+    uint64_t seq;
+    struct timespec when;
+    const char *file;
+    int line;
+    int level;
+    int tid;
+    char message[LOG_MESSAGE_MAX];
+} log_record_t;
+
+int upkg_log_threshold = UPKG_LOG_ERROR;
+
+static int g_console_level = UPKG_LOG_ERROR;
+static int g_file_level = 0;
+static FILE *g_file = NULL;
+static char *g_file_buffer = NULL;
+static log_record_t *g_ring = NULL;
+static uint64_t g_head = 0;            // Next ticket for producers (atomic)
+static uint64_t g_tail = 0;            // Next ticket for the writer thread
+static bool g_stop = false;            // Atomic
+static pthread_t g_writer;
+static bool g_writer_running = false;   // Atomic
+static int g_producers = 0;            // Atomic; callers inside ring_push
+static pthread_mutex_t g_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int t_tid = 0;
+
+static const char *const level_names[] = { "", "error", "warn", "info", "verbose", "debug" };
+
+/**
+ * @brief Recomputes the threshold UPKG_LOG tests.
+ */
+static void update_threshold(void) {
+    int console = __atomic_load_n(&g_console_level, __ATOMIC_RELAXED);
+    int file = __atomic_load_n(&g_file_level, __ATOMIC_RELAXED);
+    int level = console > file ? console : file;
+    __atomic_store_n(&upkg_log_threshold, level, __ATOMIC_RELAXED);
+}
+
+// --- Ring ---
+
+/**
+ * @brief Queues one record, yielding while the ring is full.
+ */
+static void ring_push(int level, const char *file, int line, const char *format, va_list args) {
+    uint64_t ticket = __atomic_fetch_add(&g_head, 1, __ATOMIC_RELAXED);
+    log_record_t *r = &g_ring[ticket & (LOG_RING_SLOTS - 1)];
+    while (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != ticket) {
+        sched_yield();   // Full: the writer has not freed this slot yet
+    }
+
+    if (t_tid == 0) t_tid = (int)syscall(SYS_gettid);
+    clock_gettime(CLOCK_REALTIME, &r->when);
+    r->file = file;
+    r->line = line;
+    r->level = level;
+    r->tid = t_tid;
+    vsnprintf(r->message, sizeof(r->message), format, args);
+    __atomic_store_n(&r->seq, ticket + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Writes one record as a logfmt line.
+ */
+static void write_record(const log_record_t *r) {
+    struct tm tm;
+    gmtime_r(&r->when.tv_sec, &tm);
+    const char *base = strrchr(r->file, '/');
+    fprintf(g_file, "ts=%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ level=%s tid=%d src=%s:%d msg=\"",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+            r->when.tv_nsec / 1000, level_names[r->level], r->tid, base ? base + 1 : r->file, r->line);
+
+    size_t len = strnlen(r->message, sizeof(r->message));
+    while (len > 0 && r->message[len - 1] == '\n') len--;
+    for (size_t i = 0; i < len; i++) {
+        char c = r->message[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', g_file);
+            fputc(c, g_file);
+        } else if (c == '\n') {
+            fputs("\\n", g_file);
+        } else {
+            fputc(c, g_file);
+        }
+    }
+    fputs("\"\n", g_file);
+}
+
+/**
+ * @brief Writes queued records in ticket order.
+ * @return The number of records written.
+ */
+static size_t ring_drain(void) {
+    size_t written = 0;
+    for (;;) {
+        log_record_t *r = &g_ring[g_tail & (LOG_RING_SLOTS - 1)];
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != g_tail + 1) break;
+        write_record(r);
+        __atomic_store_n(&r->seq, g_tail + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        g_tail++;
+        written++;
+    }
+    return written;
+}
+
+/**
+ * @brief Writer thread: drains the ring and flushes the stream when idle.
+ */
+static void *writer_main(void *arg) {
+    (void)arg;
+    bool dirty = false;
+    for (;;) {
+        if (ring_drain() > 0) {
+            dirty = true;
+            continue;
+        }
+        if (dirty) {
+            fflush(g_file);
+            dirty = false;
+        }
+        if (__atomic_load_n(&g_stop, __ATOMIC_ACQUIRE)) break;
+        struct timespec idle = { 0, LOG_IDLE_SLEEP_NS };
+        nanosleep(&idle, NULL);
+    }
+    ring_drain();
+    fflush(g_file);
+    return NULL;
+}
+
+// --- Public Interface ---
+
+/**
+ * @brief Formats one message and hands it to the enabled sinks.
+ */
+void upkg_log_write(int level, const char *file, int line, const char *format, ...) {
+    va_list args;
+    if (level <= __atomic_load_n(&g_console_level, __ATOMIC_RELAXED)) {
+        va_start(args, format);
+        if (level == UPKG_LOG_ERROR) {
+            fputs("ERROR: ", stderr);
+            vfprintf(stderr, format, args);
+        } else {
+            fputs(level == UPKG_LOG_DEBUG ? "[DEBUG] " : level == UPKG_LOG_WARN ? "WARNING: " : "[VERBOSE] ", stdout);
+            vprintf(format, args);
+        }
+        va_end(args);
+    }
+    if (level <= __atomic_load_n(&g_file_level, __ATOMIC_RELAXED)) {
+        // Counted so shutdown does not free the ring under a caller
+        __atomic_add_fetch(&g_producers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&g_writer_running, __ATOMIC_SEQ_CST)) {
+            va_start(args, format);
+            ring_push(level, file, line, format, args);
+            va_end(args);
+        }
+        __atomic_sub_fetch(&g_producers, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Sets the highest level printed on the console.
+ */
+void upkg_log_set_console(int level) {
+    __atomic_store_n(&g_console_level, level < UPKG_LOG_ERROR ? UPKG_LOG_ERROR : level, __ATOMIC_RELAXED);
+    update_threshold();
+}
+
+/**
+ * @brief Opens the UPKG_LOG_FILE sink and starts its writer thread.
+ */
+int upkg_log_init(void) {
+    const char *path = getenv("UPKG_LOG_FILE");
+    if (!path || *path == '\0') return 0;
+
+    pthread_mutex_lock(&g_init_lock);
+    if (g_writer_running) {
+        pthread_mutex_unlock(&g_init_lock);
+        return 0;
+    }
+
+    int level = UPKG_LOG_DEBUG;
+    const char *name = getenv("UPKG_LOG_LEVEL");
+    for (int i = UPKG_LOG_ERROR; name && i <= UPKG_LOG_DEBUG; i++) {
+        if (strcasecmp(name, level_names[i]) == 0) level = i;
+    }
+
+    g_ring = calloc(LOG_RING_SLOTS, sizeof(*g_ring));
+    g_file_buffer = malloc(LOG_STREAM_BUFFER);
+    g_file = fopen(path, "ae");
+    if (!g_ring || !g_file_buffer || !g_file) {
+        fprintf(stderr, "ERROR: Cannot open log file '%s'.\n", path);
+        if (g_file) fclose(g_file);
+        free(g_ring);
+        free(g_file_buffer);
+        g_file = NULL;
+        g_ring = NULL;
+        g_file_buffer = NULL;
+        pthread_mutex_unlock(&g_init_lock);
+        return -1;
+    }
+    setvbuf(g_file, g_file_buffer, _IOFBF, LOG_STREAM_BUFFER);
+    for (uint64_t i = 0; i < LOG_RING_SLOTS; i++) g_ring[i].seq = i;
+    g_head = g_tail = 0;
+    g_stop = false;
+
+    if (pthread_create(&g_writer, NULL, writer_main, NULL) != 0) {
+        fclose(g_file);
+        free(g_ring);
+        free(g_file_buffer);
+        g_file = NULL;
+        g_ring = NULL;
+        g_file_buffer = NULL;
+        pthread_mutex_unlock(&g_init_lock);
+        return -1;
+    }
+    __atomic_store_n(&g_writer_running, true, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_file_level, level, __ATOMIC_RELAXED);
+    update_threshold();
+    atexit(upkg_log_shutdown);
+    pthread_mutex_unlock(&g_init_lock);
+    return 0;
+}
+
+/**
+ * @brief Drains the ring, stops the writer thread and closes the file.
+ */
+void upkg_log_shutdown(void) {
+    pthread_mutex_lock(&g_init_lock);
+    if (!g_writer_running) {
+        pthread_mutex_unlock(&g_init_lock);
+        return;
+    }
+    __atomic_store_n(&g_file_level, 0, __ATOMIC_RELAXED);
+    update_threshold();
+    __atomic_store_n(&g_writer_running, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&g_producers, __ATOMIC_ACQUIRE) > 0) {
+        sched_yield();
+    }
+    __atomic_store_n(&g_stop, true, __ATOMIC_RELEASE);
+    pthread_join(g_writer, NULL);
+
+    fclose(g_file);
+    free(g_ring);
+    free(g_file_buffer);
+    g_file = NULL;
+    g_ring = NULL;
+    g_file_buffer = NULL;
+    pthread_mutex_unlock(&g_init_lock);
+}
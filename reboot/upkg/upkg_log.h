@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Filename:    upkg_log.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Level-gated logging with an asynchronous structured sink for upkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_LOG_H
+#define UPKG_LOG_H
+
+/*
+ * Every message goes through UPKG_LOG, which tests the level before the
+ * arguments are evaluated, so a disabled log call costs one compare.
+ * Levels above UPKG_LOG_COMPILE_LEVEL are removed by the compiler
+ * (make LOG_COMPILE_LEVEL=info); errors are always kept.
+ *
+ * Two sinks:
+ *   console  synchronous, as before: errors to stderr as "ERROR: ...",
+ *            and with -v verbose and debug lines to stdout
+ *   file     set UPKG_LOG_FILE=path (and UPKG_LOG_LEVEL=error|warn|info|
+ *            verbose|debug, default debug) to append one logfmt record per
+ *            message. Callers format the message into a lock-free ring;
+ *            a background thread adds the timestamp and writes through a
+ *            buffered stream, so callers never wait for the disk. When
+ *            the ring is full, callers yield until it drains rather than
+ *            drop records.
+ */
+
+// --- Levels ---
+#define UPKG_LOG_ERROR   1
+#define UPKG_LOG_WARN    2
+#define UPKG_LOG_INFO    3
+#define UPKG_LOG_VERBOSE 4
+#define UPKG_LOG_DEBUG   5
+
+#ifndef UPKG_LOG_COMPILE_LEVEL
+#define UPKG_LOG_COMPILE_LEVEL UPKG_LOG_DEBUG
+#endif
+
+// Highest level any sink currently wants; read by UPKG_LOG
+extern int upkg_log_threshold;
+
+#define UPKG_LOG(level, ...)                                                                  \
+    do {                                                                                      \
+        if (((level) <= UPKG_LOG_COMPILE_LEVEL || (level) == UPKG_LOG_ERROR) &&               \
+            (level) <= upkg_log_threshold) {                                                  \
+            upkg_log_write((level), __FILE__, __LINE__, __VA_ARGS__);                         \
+        }                                                                                     \
+    } while (0)
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Formats one message and hands it to the enabled sinks. Call
+ *        through UPKG_LOG rather than directly.
+ * @param level One of UPKG_LOG_*.
+ * @param file The source file of the call.
+ * @param line The source line of the call.
+ * @param format printf-style format; a trailing newline is optional.
+ */
+void upkg_log_write(int level, const char *file, int line, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Sets the highest level printed on the console (UPKG_LOG_ERROR by
+ *        default; -v raises it to UPKG_LOG_DEBUG).
+ * @param level One of UPKG_LOG_*.
+ */
+void upkg_log_set_console(int level);
+
+/**
+ * @brief Opens the file sink named by UPKG_LOG_FILE, if set, and starts its
+ *        writer thread. Records are drained at exit. Safe to call again.
+ * @return 0 on success or when no file is configured, -1 if the file
+ *         cannot be opened.
+ */
+int upkg_log_init(void);
+
+/**
+ * @brief Writes every queued record, stops the writer thread and closes
+ *        the file sink.
+ */
+void upkg_log_shutdown(void);
+
+#endif // UPKG_LOG_H
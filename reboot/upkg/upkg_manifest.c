@@ -0,0 +1,425 @@
+/******************************************************************************
+ * Filename:    upkg_manifest.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Per-file stat snapshots and digests for installed packages
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_manifest.h"
+#include "upkg_config.h"
+#include "upkg_metrics.h"
+#include "upkg_cpu.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// --- Helpers ---
+
+/**
+ * @brief Builds <db_dir>/<package>/manifest.
+ * @param package_name The package.
+ * @return The allocated path, or NULL on failure.
+ */
+static char *manifest_path(const char *package_name) {
+    if (!g_db_dir || !package_name) return NULL;
+
+    char *record_dir = upkg_util_concat_path(g_db_dir, package_name);
+    if (!record_dir) return NULL;
+    char *path = upkg_util_concat_path(record_dir, "manifest");
+    free(record_dir);
+    return path;
+}
+
+/**
+ * @brief Hashes a file's contents, or a symlink's target string.
+ * @param path The file.
+ * @param mode The file's mode from lstat.
+ * @param digest Output digest.
+ * @return 0 on success, -1 on failure.
+ */
+static int digest_path(const char *path, mode_t mode, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]) {
+    if (S_ISLNK(mode)) {
+        char target[PATH_MAX];
+        ssize_t n = upkg_vfs->readlink(path, target, sizeof(target));
+        if (n < 0) return -1;
+
+        upkg_sha256_ctx_t ctx;
+        upkg_digest_sha256_init(&ctx);
+        upkg_digest_sha256_update(&ctx, target, (size_t)n);
+        upkg_digest_sha256_final(&ctx, digest);
+        return 0;
+    }
+    return upkg_digest_sha256_file(path, digest);
+}
+
+/**
+ * @brief Copies the snapshot-relevant stat fields into an entry.
+ * @param entry The manifest entry.
+ * @param st The stat data.
+ */
+static void entry_set_stat(upkg_manifest_entry_t *entry, const struct stat *st) {
+    entry->mode = st->st_mode;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtim;
+    entry->ctime = st->st_ctim;
+}
+
+/**
+ * @brief Compares an entry's recorded stat data with a fresh lstat.
+ * @param entry The manifest entry.
+ * @param st The fresh stat data.
+ * @return true if inode, size, mtime and ctime all match.
+ */
+static bool entry_stat_matches(const upkg_manifest_entry_t *entry, const struct stat *st) {
+    return entry->ino == st->st_ino && entry->size == st->st_size &&
+           entry->mtime.tv_sec == st->st_mtim.tv_sec && entry->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+           entry->ctime.tv_sec == st->st_ctim.tv_sec && entry->ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
+
+/**
+ * @brief Checks whether an entry's stat data is too close to the snapshot to trust.
+ * @param entry The manifest entry.
+ * @param snapshot The time the snapshot was written.
+ * @return true if the entry must be rehashed even when its stat matches.
+ */
+static bool entry_is_racy(const upkg_manifest_entry_t *entry, const struct timespec *snapshot) {
+    return entry->mtime.tv_sec >= snapshot->tv_sec || entry->ctime.tv_sec >= snapshot->tv_sec;
+}
+
+/**
+ * @brief Parses a hex SHA-256 string.
+ * @param hex The 64-character hex string.
+ * @param digest Output digest.
+ * @return 0 on success, -1 on malformed input.
+ */
+static int parse_hex_digest(const char *hex, uint8_t digest[UPKG_SHA256_DIGEST_LENGTH]) {
+    for (int i = 0; i < UPKG_SHA256_DIGEST_LENGTH; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) return -1;
+        digest[i] = (uint8_t)byte;
+    }
+    return hex[UPKG_SHA256_DIGEST_LENGTH * 2] == '\0' ? 0 : -1;
+}
+
+// --- Read / Write ---
+
+/**
+ * @brief Frees a manifest's entries.
+ * @param manifest The manifest to clear.
+ */
+void upkg_manifest_free(upkg_manifest_t *manifest) {
+    if (!manifest) return;
+    for (int i = 0; i < manifest->count; i++) {
+        free(manifest->entries[i].path);
+    }
+    free(manifest->entries);
+    manifest->entries = NULL;
+    manifest->count = 0;
+}
+
+/**
+ * @brief Writes a manifest, stamping it with the current time.
+ * @param package_name The package.
+ * @param manifest The manifest; its snapshot time is updated.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_manifest_write(const char *package_name, upkg_manifest_t *manifest) {
+    char *path = manifest_path(package_name);
+    if (!path) return -1;
+
+    // Stamp after every entry was captured so racy entries are detectable
+    clock_gettime(CLOCK_REALTIME, &manifest->snapshot);
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        upkg_util_error("Failed to allocate manifest buffer.\n");
+        free(path);
+        return -1;
+    }
+    fprintf(mem, "snapshot %lld.%09ld\n", (long long)manifest->snapshot.tv_sec, manifest->snapshot.tv_nsec);
+    for (int i = 0; i < manifest->count; i++) {
+        const upkg_manifest_entry_t *e = &manifest->entries[i];
+        char hex[UPKG_SHA256_HEX_LENGTH];
+        upkg_digest_to_hex(e->digest, UPKG_SHA256_DIGEST_LENGTH, hex);
+        fprintf(mem, "%s %o %llu %lld %lld.%09ld %lld.%09ld %s\n", hex, (unsigned int)e->mode,
+                (unsigned long long)e->ino, (long long)e->size,
+                (long long)e->mtime.tv_sec, e->mtime.tv_nsec,
+                (long long)e->ctime.tv_sec, e->ctime.tv_nsec, e->path);
+    }
+    fclose(mem);
+
+    int ret = upkg_util_write_file_atomic(path, buffer, len);
+    free(buffer);
+    free(path);
+    return ret;
+}
+
+/**
+ * @brief Reads a package's manifest.
+ * @param package_name The package.
+ * @param manifest Output; free with upkg_manifest_free.
+ * @return 0 on success, -1 if missing or unreadable.
+ */
+int upkg_manifest_read(const char *package_name, upkg_manifest_t *manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+
+    char *path = manifest_path(package_name);
+    if (!path) return -1;
+    size_t len = 0;
+    char *content = upkg_util_read_file_content(path, &len);
+    if (!content) {
+        free(path);
+        return -1;
+    }
+
+    int lines = (int)upkg_cpu_count_byte(content, '\n', len);
+    manifest->entries = calloc(lines > 0 ? (size_t)lines : 1, sizeof(upkg_manifest_entry_t));
+    if (!manifest->entries) {
+        free(content);
+        free(path);
+        return -1;
+    }
+
+    int ret = 0;
+    char *line = content;
+    while (line < content + len) {
+        char *end = memchr(line, '\n', (size_t)(content + len - line));
+        if (end) *end = '\0';
+
+        long long sec;
+        long nsec;
+        char hex[UPKG_SHA256_HEX_LENGTH];
+        unsigned int mode;
+        unsigned long long ino;
+        long long size, msec, csec;
+        long mnsec, cnsec;
+        int consumed = 0;
+
+        if (sscanf(line, "snapshot %lld.%ld", &sec, &nsec) == 2) {
+            manifest->snapshot.tv_sec = (time_t)sec;
+            manifest->snapshot.tv_nsec = nsec;
+        } else if (sscanf(line, "%64s %o %llu %lld %lld.%ld %lld.%ld %n", hex, &mode, &ino, &size,
+                          &msec, &mnsec, &csec, &cnsec, &consumed) == 8 && consumed > 0 &&
+                   line[consumed] != '\0') {
+            upkg_manifest_entry_t *e = &manifest->entries[manifest->count];
+            if (parse_hex_digest(hex, e->digest) != 0 || !(e->path = strdup(line + consumed))) {
+                ret = -1;
+                break;
+            }
+            e->mode = (mode_t)mode;
+            e->ino = (ino_t)ino;
+            e->size = (off_t)size;
+            e->mtime.tv_sec = (time_t)msec;
+            e->mtime.tv_nsec = mnsec;
+            e->ctime.tv_sec = (time_t)csec;
+            e->ctime.tv_nsec = cnsec;
+            manifest->count++;
+        } else if (*line != '\0') {
+            upkg_util_error("Malformed manifest line in %s: %s\n", path, line);
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+
+    if (ret != 0) {
+        upkg_manifest_free(manifest);
+    }
+    free(content);
+    free(path);
+    return ret;
+}
+
+/**
+ * @brief Captures stat data and digests for a package's installed files and
+ *        writes them to the package's manifest.
+ * @param package_name The package.
+ * @param files The installed paths, relative to root.
+ * @param count The number of paths.
+ * @param root The install root.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_manifest_create(const char *package_name, char *const *files, int count, const char *root) {
+    upkg_manifest_t manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    manifest.entries = calloc(count > 0 ? (size_t)count : 1, sizeof(upkg_manifest_entry_t));
+    if (!manifest.entries) {
+        upkg_util_error("Failed to allocate memory for manifest.\n");
+        return -1;
+    }
+
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++) {
+        char *full_path = upkg_util_concat_path(root, files[i]);
+        upkg_manifest_entry_t *e = &manifest.entries[manifest.count];
+        struct stat st;
+        if (!full_path || upkg_vfs->lstat(full_path, &st) != 0 || digest_path(full_path, st.st_mode, e->digest) != 0) {
+            upkg_util_error("Failed to snapshot '%s': %s\n", full_path ? full_path : files[i], strerror(errno));
+            ret = -1;
+        } else if (!(e->path = strdup(files[i]))) {
+            ret = -1;
+        } else {
+            entry_set_stat(e, &st);
+            manifest.count++;
+        }
+        free(full_path);
+    }
+
+    if (ret == 0) {
+        ret = upkg_manifest_write(package_name, &manifest);
+    }
+    upkg_manifest_free(&manifest);
+    return ret;
+}
+
+// --- Audit ---
+
+/**
+ * @brief Returns the display name of a file status.
+ * @param status The status.
+ * @return "clean", "modified", "missing" or "retyped".
+ */
+const char *upkg_manifest_status_name(upkg_file_status_t status) {
+    switch (status) {
+        case UPKG_FILE_MODIFIED: return "modified";
+        case UPKG_FILE_MISSING:  return "missing";
+        case UPKG_FILE_RETYPED:  return "retyped";
+        default:                 return "clean";
+    }
+}
+
+/**
+ * @brief Checks one installed file against its manifest entry.
+ * @param entry The manifest entry (updated when refreshed).
+ * @param snapshot The manifest's snapshot time.
+ * @param root The install root.
+ * @param rehashed Set to true if the file contents were read.
+ * @param refreshed Set to true if the entry needs writing back.
+ * @return The file's status.
+ */
+upkg_file_status_t upkg_manifest_check_entry(upkg_manifest_entry_t *entry, const struct timespec *snapshot,
+                                             const char *root, bool *rehashed, bool *refreshed) {
+    *rehashed = false;
+    *refreshed = false;
+
+    char *full_path = upkg_util_concat_path(root, entry->path);
+    if (!full_path) return UPKG_FILE_MISSING;
+
+    upkg_file_status_t status = UPKG_FILE_CLEAN;
+    struct stat st;
+    if (upkg_vfs->lstat(full_path, &st) != 0) {
+        status = UPKG_FILE_MISSING;
+    } else if ((st.st_mode & S_IFMT) != (entry->mode & S_IFMT)) {
+        status = UPKG_FILE_RETYPED;
+    } else if (!entry_stat_matches(entry, &st) || entry_is_racy(entry, snapshot)) {
+        uint8_t digest[UPKG_SHA256_DIGEST_LENGTH];
+        *rehashed = true;
+        upkg_metrics_add(UPKG_METRIC_STAT_CACHE_MISSES, 1);
+        if (digest_path(full_path, st.st_mode, digest) != 0 ||
+            memcmp(digest, entry->digest, UPKG_SHA256_DIGEST_LENGTH) != 0) {
+            // Keep the old stat data so the file is rehashed (and reported) again next time
+            status = UPKG_FILE_MODIFIED;
+        } else {
+            // Clean: new stat data, or a newer snapshot time, settles a racy entry
+            entry_set_stat(entry, &st);
+            *refreshed = true;
+        }
+    } else {
+        upkg_metrics_add(UPKG_METRIC_STAT_CACHE_HITS, 1);
+    }
+    free(full_path);
+    return status;
+}
+
+/**
+ * @brief Prints one audit finding.
+ */
+static void print_audit_finding(const char *package_name, const char *path, upkg_file_status_t status,
+                                void *user) {
+    (void)user;
+    printf("%-9s %s (%s)\n", upkg_manifest_status_name(status), path, package_name);
+}
+
+/**
+ * @brief Verifies a package's installed files against its manifest,
+ *        rehashing only entries whose stat changed or is racy, and prints
+ *        modified, missing and retyped files.
+ * @param package_name The package.
+ * @param root The install root.
+ * @param counts Counters to accumulate into.
+ * @return 0 on success, -1 if the manifest could not be read.
+ */
+int upkg_manifest_audit(const char *package_name, const char *root, upkg_audit_counts_t *counts) {
+    return upkg_manifest_audit_visit(package_name, root, counts, print_audit_finding, NULL);
+}
+
+/**
+ * @brief Audits like upkg_manifest_audit, handing each finding to a callback.
+ * @param package_name The package.
+ * @param root The install root.
+ * @param counts Counters to accumulate into.
+ * @param visit Called for each modified, missing or retyped file.
+ * @param user Passed to visit.
+ * @return 0 on success, -1 if the manifest could not be read.
+ */
+int upkg_manifest_audit_visit(const char *package_name, const char *root, upkg_audit_counts_t *counts,
+                              upkg_audit_visit_fn visit, void *user) {
+    upkg_manifest_t manifest;
+    if (upkg_manifest_read(package_name, &manifest) != 0) {
+        upkg_util_error("No readable manifest for %s; reinstall it to enable auditing.\n", package_name);
+        return -1;
+    }
+
+    bool any_refreshed = false;
+    for (int i = 0; i < manifest.count; i++) {
+        bool rehashed, refreshed;
+        upkg_file_status_t status = upkg_manifest_check_entry(&manifest.entries[i], &manifest.snapshot,
+                                                              root, &rehashed, &refreshed);
+        counts->files++;
+        counts->rehashed += rehashed;
+        any_refreshed |= refreshed;
+
+        switch (status) {
+            case UPKG_FILE_MODIFIED: counts->modified++; break;
+            case UPKG_FILE_MISSING:  counts->missing++; break;
+            case UPKG_FILE_RETYPED:  counts->retyped++; break;
+            default: continue;
+        }
+        visit(package_name, manifest.entries[i].path, status, user);
+    }
+
+    if (any_refreshed && upkg_manifest_write(package_name, &manifest) != 0) {
+        upkg_util_error("Failed to refresh manifest for %s.\n", package_name);
+    }
+    upkg_manifest_free(&manifest);
+    return 0;
+}
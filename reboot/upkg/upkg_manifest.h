@@ -0,0 +1,175 @@
+/******************************************************************************
+ * Filename:    upkg_manifest.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Per-file stat snapshots and digests for installed packages
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_MANIFEST_H
+#define UPKG_MANIFEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include "upkg_digest.h"
+
+/*
+ * <db_dir>/<package>/manifest holds, like a git index, the stat data and
+ * SHA-256 of every installed file:
+ *
+ *   snapshot <sec>.<nsec>
+ *   <sha256> <mode> <ino> <size> <mtime sec.nsec> <ctime sec.nsec> <path>
+ *
+ * A file whose stat still matches is trusted without reading it, unless its
+ * mtime or ctime falls in the same second as (or after) the snapshot: such
+ * "racy" entries could have been modified after being stat()ed within one
+ * timestamp tick, so they are always rehashed.
+ */
+
+// --- Manifest Structures ---
+typedef struct {
+    char *path;                 // Relative to the install root
+    mode_t mode;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    uint8_t digest[UPKG_SHA256_DIGEST_LENGTH];  // Contents, or the target of a symlink
+} upkg_manifest_entry_t;
+
+typedef struct {
+    upkg_manifest_entry_t *entries;
+    int count;
+    struct timespec snapshot;   // When the stat data was captured
+} upkg_manifest_t;
+
+// --- File Status ---
+typedef enum {
+    UPKG_FILE_CLEAN = 0,
+    UPKG_FILE_MODIFIED,
+    UPKG_FILE_MISSING,
+    UPKG_FILE_RETYPED
+} upkg_file_status_t;
+
+// --- Audit Counters ---
+typedef struct {
+    unsigned long files;
+    unsigned long rehashed;
+    unsigned long modified;
+    unsigned long missing;
+    unsigned long retyped;
+} upkg_audit_counts_t;
+
+/**
+ * @brief Receives one file an audit found modified, missing or retyped.
+ * @param package_name The owning package.
+ * @param path The path, relative to the install root.
+ * @param status The file's status (never UPKG_FILE_CLEAN).
+ * @param user The pointer given to the audit.
+ */
+typedef void (*upkg_audit_visit_fn)(const char *package_name, const char *path, upkg_file_status_t status,
+                                    void *user);
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Captures stat data and digests for a package's installed files and
+ *        writes them to the package's manifest.
+ * @param package_name The package.
+ * @param files The installed paths, relative to root.
+ * @param count The number of paths.
+ * @param root The install root.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_manifest_create(const char *package_name, char *const *files, int count, const char *root);
+
+/**
+ * @brief Reads a package's manifest.
+ * @param package_name The package.
+ * @param manifest Output; free with upkg_manifest_free.
+ * @return 0 on success, -1 if missing or unreadable.
+ */
+int upkg_manifest_read(const char *package_name, upkg_manifest_t *manifest);
+
+/**
+ * @brief Writes a manifest, stamping it with the current time.
+ * @param package_name The package.
+ * @param manifest The manifest; its snapshot time is updated.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_manifest_write(const char *package_name, upkg_manifest_t *manifest);
+
+/**
+ * @brief Frees a manifest's entries.
+ * @param manifest The manifest to clear.
+ */
+void upkg_manifest_free(upkg_manifest_t *manifest);
+
+/**
+ * @brief Checks one installed file against its manifest entry.
+ *
+ * The file is rehashed only when its stat data changed or the entry is
+ * racy. When it hashes clean, the entry's stat data is refreshed.
+ *
+ * @param entry The manifest entry (updated when refreshed).
+ * @param snapshot The manifest's snapshot time.
+ * @param root The install root.
+ * @param rehashed Set to true if the file contents were read.
+ * @param refreshed Set to true if the entry needs writing back.
+ * @return The file's status.
+ */
+upkg_file_status_t upkg_manifest_check_entry(upkg_manifest_entry_t *entry, const struct timespec *snapshot,
+                                             const char *root, bool *rehashed, bool *refreshed);
+
+/**
+ * @brief Returns the display name of a file status.
+ * @param status The status.
+ * @return "clean", "modified", "missing" or "retyped".
+ */
+const char *upkg_manifest_status_name(upkg_file_status_t status);
+
+/**
+ * @brief Verifies a package's installed files against its manifest,
+ *        rehashing only entries whose stat changed or is racy, and prints
+ *        modified, missing and retyped files.
+ *
+ * Entries that turn out unchanged get their stat data refreshed so the next
+ * audit can skip them.
+ *
+ * @param package_name The package.
+ * @param root The install root.
+ * @param counts Counters to accumulate into.
+ * @return 0 on success, -1 if the manifest could not be read.
+ */
+int upkg_manifest_audit(const char *package_name, const char *root, upkg_audit_counts_t *counts);
+
+/**
+ * @brief Audits like upkg_manifest_audit, but hands each finding to a
+ *        callback instead of printing it.
+ * @param package_name The package.
+ * @param root The install root.
+ * @param counts Counters to accumulate into.
+ * @param visit Called for each modified, missing or retyped file.
+ * @param user Passed to visit.
+ * @return 0 on success, -1 if the manifest could not be read.
+ */
+int upkg_manifest_audit_visit(const char *package_name, const char *root, upkg_audit_counts_t *counts,
+                              upkg_audit_visit_fn visit, void *user);
+
+#endif // UPKG_MANIFEST_H
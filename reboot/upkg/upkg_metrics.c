@@ -0,0 +1,266 @@
+/******************************************************************************
+ * Filename:    upkg_metrics.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Lock-free counters and histograms exported in Prometheus text format
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_metrics.h"
+#include "upkg_config.h"
+#include "upkg_hash.h"
+#include "upkg_index.h"
+#include "upkg_util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// --- Global Variables ---
+uint64_t upkg_metric_counters[UPKG_METRIC_COUNTER_COUNT];
+upkg_metric_histogram_data_t upkg_metric_histograms[UPKG_METRIC_HISTOGRAM_COUNT];
+
+// --- Metric Descriptions ---
+
+typedef struct {
+    const char *name;
+    const char *help;
+} metric_desc_t;
+
+static const metric_desc_t counter_descs[UPKG_METRIC_COUNTER_COUNT] = {
+    { "upkg_installs_total",           "Packages installed." },
+    { "upkg_install_failures_total",   "Package installs that failed." },
+    { "upkg_removals_total",           "Packages removed." },
+    { "upkg_files_written_total",      "Files and symlinks written under the install root." },
+    { "upkg_bytes_written_total",      "Bytes of file content written under the install root." },
+    { "upkg_stat_cache_hits_total",    "Manifest checks answered from stat data without rehashing." },
+    { "upkg_stat_cache_misses_total",  "Manifest checks that had to rehash the file." },
+    { "upkg_fs_events_total",          "Filesystem events handled by upkgd." }
+};
+
+static const metric_desc_t histogram_descs[UPKG_METRIC_HISTOGRAM_COUNT] = {
+    { "upkg_install_duration_seconds", "Time to install one package, extraction included." },
+    { "upkg_extract_duration_seconds", "Time to extract a .deb and collect its metadata." },
+    { "upkg_command_duration_seconds", "Run time of external helper commands (ar, tar)." },
+    { "upkg_lock_wait_seconds",        "Time spent waiting for the package database lock." }
+};
+
+// Upper bounds in nanoseconds; the final bucket is +Inf
+static const uint64_t bucket_bounds_ns[UPKG_METRIC_BUCKET_COUNT - 1] = {
+    1000000ULL, 5000000ULL, 10000000ULL, 25000000ULL, 50000000ULL,
+    100000000ULL, 250000000ULL, 500000000ULL, 1000000000ULL, 5000000000ULL
+};
+
+// --- Collection ---
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds for duration measurements.
+ * @return The current CLOCK_MONOTONIC time.
+ */
+uint64_t upkg_metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Records one duration in a histogram.
+ * @param histogram The histogram.
+ * @param start_ns A timestamp from upkg_metrics_now_ns taken when the operation began.
+ */
+void upkg_metrics_observe_since(upkg_metric_histogram_t histogram, uint64_t start_ns) {
+    uint64_t elapsed = upkg_metrics_now_ns() - start_ns;
+    upkg_metric_histogram_data_t *h = &upkg_metric_histograms[histogram];
+
+    int bucket = 0;
+    while (bucket < UPKG_METRIC_BUCKET_COUNT - 1 && elapsed > bucket_bounds_ns[bucket]) {
+        bucket++;
+    }
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, elapsed, __ATOMIC_RELAXED);
+}
+
+// --- Export ---
+
+/**
+ * @brief Sums the sizes of the files in db_dir and its record directories.
+ * @return The total size in bytes.
+ */
+static unsigned long long db_size_bytes(void) {
+    unsigned long long total = 0;
+    DIR *dp = g_db_dir ? opendir(g_db_dir) : NULL;
+    if (!dp) return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        char *path = upkg_util_concat_path(g_db_dir, entry->d_name);
+        struct stat st;
+        if (path && stat(path, &st) == 0) {
+            if (S_ISREG(st.st_mode)) {
+                total += (unsigned long long)st.st_size;
+            } else if (S_ISDIR(st.st_mode)) {
+                DIR *record = opendir(path);
+                struct dirent *file;
+                while (record && (file = readdir(record)) != NULL) {
+                    if (fstatat(dirfd(record), file->d_name, &st, 0) == 0 && S_ISREG(st.st_mode)) {
+                        total += (unsigned long long)st.st_size;
+                    }
+                }
+                if (record) closedir(record);
+            }
+        }
+        free(path);
+    }
+    closedir(dp);
+    return total;
+}
+
+/**
+ * @brief Writes one sample, adding the previous run's value for cumulative series.
+ * @param out The output stream.
+ * @param previous Samples from an earlier export, or NULL.
+ * @param series The metric name with labels.
+ * @param value This process's value.
+ * @param cumulative Whether the series accumulates across runs.
+ */
+static void emit_sample(FILE *out, const upkg_index_t *previous, const char *series, double value, bool cumulative) {
+    if (cumulative && previous) {
+        const char *old = upkg_index_lookup(previous, series);
+        if (old) value += strtod(old, NULL);
+    }
+    fprintf(out, "%s %.17g\n", series, value);
+}
+
+/**
+ * @brief Renders all metrics, merging cumulative series with previous samples.
+ * @param out The output stream.
+ * @param previous Samples from an earlier export, or NULL.
+ */
+static void render_metrics(FILE *out, const upkg_index_t *previous) {
+    char series[256];
+
+    for (int c = 0; c < UPKG_METRIC_COUNTER_COUNT; c++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n", counter_descs[c].name, counter_descs[c].help, counter_descs[c].name);
+        emit_sample(out, previous, counter_descs[c].name,
+                    (double)__atomic_load_n(&upkg_metric_counters[c], __ATOMIC_RELAXED), true);
+    }
+
+    for (int h = 0; h < UPKG_METRIC_HISTOGRAM_COUNT; h++) {
+        const char *name = histogram_descs[h].name;
+        const upkg_metric_histogram_data_t *data = &upkg_metric_histograms[h];
+        fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_descs[h].help, name);
+
+        uint64_t cumulative = 0;
+        for (int b = 0; b < UPKG_METRIC_BUCKET_COUNT; b++) {
+            cumulative += __atomic_load_n(&data->buckets[b], __ATOMIC_RELAXED);
+            if (b < UPKG_METRIC_BUCKET_COUNT - 1) {
+                snprintf(series, sizeof(series), "%s_bucket{le=\"%g\"}", name, (double)bucket_bounds_ns[b] / 1e9);
+            } else {
+                snprintf(series, sizeof(series), "%s_bucket{le=\"+Inf\"}", name);
+            }
+            emit_sample(out, previous, series, (double)cumulative, true);
+        }
+        snprintf(series, sizeof(series), "%s_sum", name);
+        emit_sample(out, previous, series, (double)__atomic_load_n(&data->sum_ns, __ATOMIC_RELAXED) / 1e9, true);
+        snprintf(series, sizeof(series), "%s_count", name);
+        emit_sample(out, previous, series, (double)__atomic_load_n(&data->count, __ATOMIC_RELAXED), true);
+    }
+
+    unsigned long long files = 0;
+    for (size_t b = 0; upkg_main_hash_table && b < upkg_main_hash_table->size; b++) {
+        for (upkg_hash_node_t *n = upkg_main_hash_table->buckets[b]; n; n = n->next) {
+            files += (unsigned long long)n->data.file_count;
+        }
+    }
+    fprintf(out, "# HELP upkg_packages_installed Installed package records.\n# TYPE upkg_packages_installed gauge\n");
+    emit_sample(out, NULL, "upkg_packages_installed", upkg_main_hash_table ? (double)upkg_main_hash_table->count : 0, false);
+    fprintf(out, "# HELP upkg_package_files Paths recorded across all installed packages.\n# TYPE upkg_package_files gauge\n");
+    emit_sample(out, NULL, "upkg_package_files", (double)files, false);
+    fprintf(out, "# HELP upkg_db_size_bytes Size of the package database on disk.\n# TYPE upkg_db_size_bytes gauge\n");
+    emit_sample(out, NULL, "upkg_db_size_bytes", (double)db_size_bytes(), false);
+    fprintf(out, "# HELP upkg_last_run_timestamp_seconds When these metrics were written.\n# TYPE upkg_last_run_timestamp_seconds gauge\n");
+    emit_sample(out, NULL, "upkg_last_run_timestamp_seconds", (double)time(NULL), false);
+}
+
+/**
+ * @brief Writes this process's metrics plus database gauges.
+ * @param out The stream to write to.
+ */
+void upkg_metrics_write(FILE *out) {
+    render_metrics(out, NULL);
+}
+
+/**
+ * @brief Parses samples from an earlier export into an index.
+ * @param content The file content (modified in place).
+ * @param len The content length.
+ * @return The index, or NULL on failure.
+ */
+static upkg_index_t *parse_previous(char *content, size_t len) {
+    upkg_index_t *previous = upkg_index_create(64);
+    if (!previous) return NULL;
+
+    char *line = content;
+    while (line < content + len) {
+        char *end = memchr(line, '\n', (size_t)(content + len - line));
+        if (end) *end = '\0';
+        char *space = strrchr(line, ' ');
+        if (line[0] != '#' && space) {
+            *space = '\0';
+            upkg_index_insert(previous, line, space + 1);
+        }
+        if (!end) break;
+        line = end + 1;
+    }
+    return previous;
+}
+
+/**
+ * @brief Merges this run's counters into the configured node-exporter
+ *        textfile and replaces it atomically. Does nothing when no
+ *        metrics_textfile is configured.
+ * @return 0 on success or when disabled, -1 on failure.
+ */
+int upkg_metrics_write_textfile(void) {
+    if (!g_metrics_textfile) return 0;
+
+    size_t old_len = 0;
+    char *old = upkg_util_read_file_content(g_metrics_textfile, &old_len);
+    upkg_index_t *previous = old ? parse_previous(old, old_len) : NULL;
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        upkg_index_destroy(previous);
+        free(old);
+        return -1;
+    }
+    render_metrics(mem, previous);
+    fclose(mem);
+
+    int ret = upkg_util_write_file_atomic(g_metrics_textfile, buffer, len);
+    free(buffer);
+    upkg_index_destroy(previous);
+    free(old);
+    return ret;
+}
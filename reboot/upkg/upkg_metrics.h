@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Filename:    upkg_metrics.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Lock-free counters and histograms exported in Prometheus text format
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_METRICS_H
+#define UPKG_METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Hot paths only do relaxed atomic adds on static arrays; everything else
+ * (gauges, formatting, merging with earlier runs) happens at export time.
+ * Exports use the Prometheus text exposition format so the textfile can
+ * be picked up by node-exporter's textfile collector.
+ */
+
+// --- Counters ---
+typedef enum {
+    UPKG_METRIC_INSTALLS = 0,
+    UPKG_METRIC_INSTALL_FAILURES,
+    UPKG_METRIC_REMOVALS,
+    UPKG_METRIC_FILES_WRITTEN,
+    UPKG_METRIC_BYTES_WRITTEN,
+    UPKG_METRIC_STAT_CACHE_HITS,     // Manifest checks answered from stat data alone
+    UPKG_METRIC_STAT_CACHE_MISSES,   // Manifest checks that had to rehash
+    UPKG_METRIC_FS_EVENTS,           // Filesystem events handled by upkgd
+    UPKG_METRIC_COUNTER_COUNT
+} upkg_metric_counter_t;
+
+// --- Histograms ---
+typedef enum {
+    UPKG_METRIC_INSTALL_SECONDS = 0,
+    UPKG_METRIC_EXTRACT_SECONDS,
+    UPKG_METRIC_COMMAND_SECONDS,     // External helpers (ar, tar, compressors)
+    UPKG_METRIC_LOCK_WAIT_SECONDS,
+    UPKG_METRIC_HISTOGRAM_COUNT
+} upkg_metric_histogram_t;
+
+#define UPKG_METRIC_BUCKET_COUNT 11
+
+typedef struct {
+    uint64_t buckets[UPKG_METRIC_BUCKET_COUNT]; // Non-cumulative; the last is +Inf
+    uint64_t count;
+    uint64_t sum_ns;
+} upkg_metric_histogram_data_t;
+
+// --- Global Variables ---
+extern uint64_t upkg_metric_counters[UPKG_METRIC_COUNTER_COUNT];
+extern upkg_metric_histogram_data_t upkg_metric_histograms[UPKG_METRIC_HISTOGRAM_COUNT];
+
+// --- Collection (hot path) ---
+
+/**
+ * @brief Adds to a counter. A single relaxed atomic add.
+ * @param counter The counter.
+ * @param n The amount to add.
+ */
+static inline void upkg_metrics_add(upkg_metric_counter_t counter, uint64_t n) {
+    __atomic_fetch_add(&upkg_metric_counters[counter], n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds for duration measurements.
+ * @return The current CLOCK_MONOTONIC time.
+ */
+uint64_t upkg_metrics_now_ns(void);
+
+/**
+ * @brief Records one duration in a histogram.
+ * @param histogram The histogram.
+ * @param start_ns A timestamp from upkg_metrics_now_ns taken when the operation began.
+ */
+void upkg_metrics_observe_since(upkg_metric_histogram_t histogram, uint64_t start_ns);
+
+// --- Export ---
+
+/**
+ * @brief Writes this process's metrics plus database gauges.
+ * @param out The stream to write to.
+ */
+void upkg_metrics_write(FILE *out);
+
+/**
+ * @brief Merges this run's counters into the configured node-exporter
+ *        textfile and replaces it atomically. Does nothing when no
+ *        metrics_textfile is configured.
+ * @return 0 on success or when disabled, -1 on failure.
+ */
+int upkg_metrics_write_textfile(void);
+
+#endif // UPKG_METRICS_H
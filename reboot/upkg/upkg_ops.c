@@ -0,0 +1,646 @@
+/******************************************************************************
+ * Filename:    upkg_ops.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Install and remove operations shared by the CLI and libupkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_ops.h"
+#include "upkg_config.h"
+#include "upkg_daemon.h"
+#include "upkg_db.h"
+#include "upkg_dirtab.h"
+#include "upkg_gen.h"
+#include "upkg_hash.h"
+#include "upkg_history.h"
+#include "upkg_install.h"
+#include "upkg_manifest.h"
+#include "upkg_metrics.h"
+#include "upkg_pack.h"
+#include "upkg_snap.h"
+#include "upkg_trace.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+// --- Event Helpers ---
+
+/**
+ * @brief Delivers an event to the progress callback, if any.
+ */
+static void emit(upkg_ops_progress_fn progress, void *user, upkg_ops_event_kind_t kind, const char *package,
+                 const char *detail, const upkg_package_info_t *pkg_info, uint64_t done, uint64_t total) {
+    if (!progress) return;
+    upkg_ops_event_t event = { kind, package, detail, pkg_info, done, total };
+    progress(&event, user);
+}
+
+/**
+ * @brief Reports a non-fatal problem as a UPKG_OPS_WARNING event, or on
+ *        stderr when there is no callback.
+ */
+static void warn(upkg_ops_progress_fn progress, void *user, const char *package, const char *format, ...) {
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    if (progress) {
+        emit(progress, user, UPKG_OPS_WARNING, package, message, NULL, 0, 0);
+    } else {
+        fprintf(stderr, "Warning: %s\n", message);
+    }
+}
+
+typedef struct {
+    upkg_ops_progress_fn progress;
+    void *user;
+    const char *package;
+} file_progress_ctx_t;
+
+/**
+ * @brief Forwards upkg_install_package_files progress as UPKG_OPS_FILE events.
+ */
+static void forward_file_progress(const char *path, size_t done, size_t total, void *user) {
+    file_progress_ctx_t *ctx = user;
+    emit(ctx->progress, ctx->user, UPKG_OPS_FILE, ctx->package, path, NULL, done, total);
+}
+
+// --- Install ---
+
+/**
+ * @brief Counts the files of a previous version that its replacement does not ship.
+ */
+static uint64_t count_stale_files(const upkg_hash_package_info_t *previous, const upkg_hash_package_info_t *replacement) {
+    upkg_index_t *keep = upkg_index_create((size_t)replacement->file_count * 2 + 1);
+    if (!keep) return 0;
+    for (int i = 0; i < replacement->file_count; i++) {
+        upkg_index_insert(keep, replacement->file_list[i], "");
+    }
+    uint64_t stale = 0;
+    for (int i = 0; i < previous->file_count; i++) {
+        if (!upkg_index_find(keep, previous->file_list[i])) stale++;
+    }
+    upkg_index_destroy(keep);
+    return stale;
+}
+
+/**
+ * @brief Drops the paths in taken from another package's record, path index
+ *        entries and manifest, so removing it later leaves them alone.
+ * @return The number of paths dropped.
+ */
+static int disown_files(upkg_hash_package_info_t *owner, const upkg_index_t *taken) {
+    upkg_db_unindex_package(owner);
+    int kept = 0;
+    for (int i = 0; i < owner->file_count; i++) {
+        if (upkg_index_find(taken, owner->file_list[i])) {
+            free(owner->file_list[i]);
+        } else {
+            owner->file_list[kept++] = owner->file_list[i];
+        }
+    }
+    int dropped = owner->file_count - kept;
+    owner->file_count = kept;
+    upkg_db_index_package(owner);
+    if (upkg_db_store_package(owner) != 0) {
+        upkg_util_error("Failed to write package record for %s.\n", owner->package_name);
+    }
+
+    upkg_manifest_t manifest;
+    if (upkg_manifest_read(owner->package_name, &manifest) == 0) {
+        kept = 0;
+        for (int i = 0; i < manifest.count; i++) {
+            if (upkg_index_find(taken, manifest.entries[i].path)) {
+                free(manifest.entries[i].path);
+            } else {
+                manifest.entries[kept++] = manifest.entries[i];
+            }
+        }
+        manifest.count = kept;
+        if (upkg_manifest_write(owner->package_name, &manifest) != 0) {
+            upkg_util_error("Failed to write file manifest for %s.\n", owner->package_name);
+        }
+        upkg_manifest_free(&manifest);
+    }
+    return dropped;
+}
+
+/**
+ * @brief Moves ownership of every path pkg ships from the packages that
+ *        listed it before (possible only with --force-overwrite), as dpkg
+ *        does, so each installed path has exactly one owner. Call before
+ *        pkg itself is indexed.
+ */
+static void take_over_files(const upkg_hash_package_info_t *pkg, upkg_ops_progress_fn progress, void *user) {
+    upkg_index_t *index = upkg_db_path_index();
+    if (!index || pkg->file_count <= 0) return;
+
+    // Collect the other owners first; disowning edits the index being searched
+    char **owners = NULL;
+    int owner_count = 0;
+    for (int i = 0; i < pkg->file_count; i++) {
+        for (upkg_index_entry_t *e = upkg_index_find(index, pkg->file_list[i]); e; e = upkg_index_next_match(e)) {
+            if (strcmp(e->value, pkg->package_name) == 0) continue;
+            bool seen = false;
+            for (int j = 0; j < owner_count && !seen; j++) {
+                seen = strcmp(owners[j], e->value) == 0;
+            }
+            if (seen) continue;
+            char **grown = realloc(owners, (size_t)(owner_count + 1) * sizeof(*owners));
+            char *copy = strdup(e->value);
+            if (!grown || !copy) {
+                free(copy);
+                if (grown) owners = grown;
+                upkg_util_error("Failed to allocate memory for file ownership.\n");
+                goto out;
+            }
+            owners = grown;
+            owners[owner_count++] = copy;
+        }
+    }
+    if (owner_count == 0) goto out;
+
+    upkg_index_t *taken = upkg_index_create((size_t)pkg->file_count * 2 + 1);
+    if (!taken) goto out;
+    for (int i = 0; i < pkg->file_count; i++) {
+        upkg_index_insert(taken, pkg->file_list[i], "");
+    }
+    for (int j = 0; j < owner_count; j++) {
+        upkg_hash_package_info_t *owner = upkg_hash_search(upkg_main_hash_table, owners[j]);
+        if (!owner) continue;
+        int dropped = disown_files(owner, taken);
+        warn(progress, user, pkg->package_name, "%s took over %d file%s from %s.", pkg->package_name,
+             dropped, dropped == 1 ? "" : "s", owners[j]);
+    }
+    upkg_index_destroy(taken);
+
+out:
+    for (int j = 0; j < owner_count; j++) {
+        free(owners[j]);
+    }
+    free(owners);
+}
+
+/**
+ * @brief Places an extracted package and records it. The database lock is held.
+ * @param pkg_info The extracted package.
+ * @param commit Whether to write the directory table.
+ * @param progress Event callback, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+static int install_locked(const upkg_package_info_t *pkg_info, bool commit,
+                          upkg_ops_progress_fn progress, void *user) {
+    const char *name = pkg_info->package_name;
+    uint64_t start_ns = upkg_metrics_now_ns();
+
+    if (!upkg_main_hash_table) {
+        upkg_main_hash_table = upkg_hash_create_table(INITIAL_HASH_TABLE_SIZE);
+        if (!upkg_main_hash_table) {
+            upkg_util_error("Failed to create hash table for package management.\n");
+            return -1;
+        }
+    }
+
+    upkg_hash_package_info_t *installed = upkg_hash_search(upkg_main_hash_table, name);
+    char *old_version = installed && installed->version ? strdup(installed->version) : NULL;
+    uint64_t files_deleted = 0;
+
+    // Place the payload under the install root
+    int ret = 0;
+    file_progress_ctx_t ctx = { progress, user, name };
+    upkg_hash_package_info_t hash_pkg_info;
+    if (upkg_install_package_files(pkg_info, g_system_install_root, progress ? forward_file_progress : NULL, &ctx) != 0) {
+        upkg_util_error("Failed to install files for %s.\n", name);
+        ret = -1;
+    } else if (upkg_hash_convert_package_info(pkg_info, &hash_pkg_info) != 0) {
+        upkg_util_error("Failed to convert package info for %s.\n", name);
+        ret = -1;
+    } else {
+        // Retire the previous version: stale files, directory references and sonames
+        upkg_hash_package_info_t *previous = upkg_hash_search(upkg_main_hash_table, hash_pkg_info.package_name);
+        if (previous) {
+            files_deleted = count_stale_files(previous, &hash_pkg_info);
+            upkg_install_remove_files(previous, g_system_install_root, &hash_pkg_info);
+            upkg_db_unindex_package(previous);
+        }
+
+        upkg_hash_package_info_t *stored_pkg = NULL;
+        if (upkg_hash_add_package(upkg_main_hash_table, &hash_pkg_info) == 0) {
+            stored_pkg = upkg_hash_search(upkg_main_hash_table, name);
+        }
+        if (stored_pkg) {
+            emit(progress, user, UPKG_OPS_STORED, name, NULL, NULL, 0, 0);
+            take_over_files(stored_pkg, progress, user);
+            if (upkg_db_store_package(stored_pkg) != 0) {
+                warn(progress, user, name, "Failed to write package record to %s.", g_db_dir);
+            } else if (upkg_manifest_create(stored_pkg->package_name, stored_pkg->file_list,
+                                            stored_pkg->file_count, g_system_install_root) != 0) {
+                warn(progress, user, name, "Failed to write file manifest for %s.", name);
+            }
+            upkg_db_index_package(stored_pkg);
+            upkg_db_check_shlibs(stored_pkg);
+        } else {
+            upkg_util_error("Failed to add %s to the package database.\n", name);
+            ret = -1;
+        }
+        // The hash table keeps its own deep copy
+        upkg_hash_free_package_info(&hash_pkg_info);
+    }
+
+    upkg_history_note(UPKG_HISTORY_INSTALL, name, old_version, pkg_info->version,
+                      (uint64_t)pkg_info->file_count, files_deleted, upkg_metrics_now_ns() - start_ns, ret);
+    free(old_version);
+
+    if (commit) {
+        char summary[512];
+        snprintf(summary, sizeof(summary), "install %s %s%s", name, pkg_info->version ? pkg_info->version : "",
+                 ret == 0 ? "" : " (failed)");
+        if (upkg_ops_commit(summary) != 0) {
+            warn(progress, user, name, "Failed to commit changes to %s.", g_db_dir);
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Extracts and parses a .deb package.
+ */
+int upkg_ops_stage(const char *deb_path, upkg_ops_staged_t *staged, upkg_ops_progress_fn progress, void *user) {
+    upkg_pack_init_package_info(&staged->info);
+    staged->start_ns = upkg_metrics_now_ns();
+    if (!deb_path || !g_control_dir) {
+        upkg_util_error("Control directory not configured. Please check your upkg configuration.\n");
+        return -1;
+    }
+    UPKG_TRACE1(install__start, deb_path);
+
+    int ret = upkg_pack_extract_and_collect_info(deb_path, g_control_dir, &staged->info);
+    upkg_metrics_observe_since(UPKG_METRIC_EXTRACT_SECONDS, staged->start_ns);
+
+    if (ret != 0 || !staged->info.package_name) {
+        upkg_util_error("Failed to extract package or collect information.\n");
+        upkg_metrics_add(UPKG_METRIC_INSTALL_FAILURES, 1);
+        UPKG_TRACE4(install__done, deb_path, staged->info.package_name, -1, upkg_metrics_now_ns() - staged->start_ns);
+        return -1;
+    }
+    emit(progress, user, UPKG_OPS_EXTRACTED, staged->info.package_name, deb_path, &staged->info, 0, 0);
+    return 0;
+}
+
+/**
+ * @brief Installs a staged package under the database lock.
+ */
+int upkg_ops_apply(upkg_ops_staged_t *staged, bool commit, upkg_ops_progress_fn progress, void *user) {
+    int ret;
+    if (upkg_db_lock() != 0) {
+        upkg_util_error("Failed to lock the package database.\n");
+        ret = -1;
+    } else {
+        ret = install_locked(&staged->info, commit, progress, user);
+        // The daemon takes the lock itself when it reloads
+        upkg_db_unlock();
+        if (commit) upkg_daemon_request("reload", NULL);
+    }
+
+    if (ret == 0) {
+        upkg_metrics_add(UPKG_METRIC_INSTALLS, 1);
+        upkg_metrics_observe_since(UPKG_METRIC_INSTALL_SECONDS, staged->start_ns);
+    } else {
+        upkg_metrics_add(UPKG_METRIC_INSTALL_FAILURES, 1);
+    }
+    UPKG_TRACE4(install__done, staged->info.filename, staged->info.package_name, ret,
+                upkg_metrics_now_ns() - staged->start_ns);
+    return ret;
+}
+
+/**
+ * @brief Frees a staged package.
+ */
+void upkg_ops_staged_free(upkg_ops_staged_t *staged) {
+    upkg_pack_free_package_info(&staged->info);
+}
+
+/**
+ * @brief Extracts, installs and records a .deb package.
+ */
+int upkg_ops_install(const char *deb_path, bool commit, upkg_ops_progress_fn progress, void *user) {
+    upkg_ops_staged_t staged;
+    int ret = upkg_ops_stage(deb_path, &staged, progress, user);
+    if (ret == 0) {
+        ret = upkg_ops_apply(&staged, commit, progress, user);
+    } else if (deb_path) {
+        // Record the failed extraction too, so a transaction that contained it is not reported as ok
+        const char *base = strrchr(deb_path, '/');
+        base = base ? base + 1 : deb_path;
+        upkg_history_note(UPKG_HISTORY_INSTALL, staged.info.package_name ? staged.info.package_name : base, NULL,
+                          staged.info.version, 0, 0, upkg_metrics_now_ns() - staged.start_ns, -1);
+        if (commit && upkg_db_lock() == 0) {
+            char summary[512];
+            snprintf(summary, sizeof(summary), "install %s (failed)", base);
+            upkg_history_commit(summary);
+            upkg_db_unlock();
+        }
+    }
+    upkg_ops_staged_free(&staged);
+    return ret;
+}
+
+// --- Remove ---
+
+/**
+ * @brief Removes an installed package and its record.
+ */
+int upkg_ops_remove(const char *package_name, bool commit, upkg_ops_progress_fn progress, void *user) {
+    upkg_hash_package_info_t *pkg = package_name ? upkg_hash_search(upkg_main_hash_table, package_name) : NULL;
+    if (!pkg) {
+        upkg_util_error("Package '%s' is not installed.\n", package_name ? package_name : "(null)");
+        return -1;
+    }
+    // The caller's string may live inside the record that is about to go
+    char *name = strdup(package_name);
+    if (!name) {
+        upkg_util_error("Failed to allocate memory for package name.\n");
+        return -1;
+    }
+    if (upkg_db_lock() != 0) {
+        upkg_util_error("Failed to lock the package database.\n");
+        free(name);
+        return -1;
+    }
+    uint64_t start_ns = upkg_metrics_now_ns();
+    uint64_t files_deleted = pkg->file_count > 0 ? (uint64_t)pkg->file_count : 0;
+    char *old_version = pkg->version ? strdup(pkg->version) : NULL;
+
+    // The record goes either way; a partial removal is still reported as a failure
+    int ret = 0;
+    if (upkg_install_remove_files(pkg, g_system_install_root, NULL) != 0) {
+        warn(progress, user, name, "Some files of %s could not be removed.", name);
+        ret = -1;
+    }
+    upkg_db_unindex_package(pkg);
+    if (upkg_db_delete_package(name) != 0) {
+        warn(progress, user, name, "Failed to delete package record for %s.", name);
+    }
+    upkg_hash_remove_package(upkg_main_hash_table, name);
+    upkg_history_note(UPKG_HISTORY_REMOVE, name, old_version, NULL, 0, files_deleted,
+                      upkg_metrics_now_ns() - start_ns, ret);
+    free(old_version);
+
+    if (commit) {
+        char summary[512];
+        snprintf(summary, sizeof(summary), "remove %s", name);
+        if (upkg_ops_commit(summary) != 0) {
+            warn(progress, user, name, "Failed to commit changes to %s.", g_db_dir);
+        }
+    }
+    upkg_db_unlock();
+    if (commit) upkg_daemon_request("reload", NULL);
+
+    upkg_metrics_add(UPKG_METRIC_REMOVALS, 1);
+    emit(progress, user, UPKG_OPS_REMOVED, name, NULL, NULL, 0, 0);
+    free(name);
+    return ret;
+}
+
+// --- Commit ---
+
+/**
+ * @brief Writes the directory table, a database generation and a history
+ *        entry, then publishes the package index to concurrent readers.
+ */
+int upkg_ops_commit(const char *summary) {
+    int ret = upkg_dirtab_save();
+    if (upkg_gen_record(summary) != 0) ret = -1;
+    if (upkg_history_commit(summary) != 0) ret = -1;
+    if (upkg_snap_publish(upkg_main_hash_table) != 0) ret = -1;
+    return ret;
+}
+
+// --- Rollback ---
+
+/**
+ * @brief Reads a "Field: value" line out of a record's control file.
+ * @return The value (caller frees), or NULL.
+ */
+static char *control_field(const char *control, const char *field) {
+    size_t field_len = strlen(field);
+    for (const char *line = control; line && *line; ) {
+        const char *eol = strchr(line, '\n');
+        size_t len = eol ? (size_t)(eol - line) : strlen(line);
+        if (len > field_len + 1 && strncmp(line, field, field_len) == 0 && line[field_len] == ':') {
+            const char *value = line + field_len + 1;
+            while (*value == ' ') value++;
+            return strndup(value, len - (size_t)(value - line));
+        }
+        line = eol ? eol + 1 : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Appends a zeroed step to a plan.
+ * @return The step, or NULL on allocation failure.
+ */
+static upkg_ops_rollback_step_t *add_step(upkg_ops_rollback_t *plan, upkg_ops_rollback_kind_t kind, const char *package) {
+    upkg_ops_rollback_step_t *steps = realloc(plan->steps, (size_t)(plan->step_count + 1) * sizeof(*steps));
+    if (!steps) return NULL;
+    plan->steps = steps;
+    upkg_ops_rollback_step_t *step = &steps[plan->step_count];
+    memset(step, 0, sizeof(*step));
+    upkg_pack_init_package_info(&step->staged.info);
+    step->kind = kind;
+    step->package = strdup(package);
+    if (!step->package) return NULL;
+    plan->step_count++;
+    return step;
+}
+
+/**
+ * @brief Plans a restore of one package from its target record object,
+ *        using the cached extraction named by the record's Filename.
+ * @return 0 on success, -1 on failure.
+ */
+static int plan_restore(upkg_ops_rollback_step_t *step, const char *hash, const upkg_hash_package_info_t *installed) {
+    char *control = upkg_gen_object_file(hash, "control", NULL);
+    char *filename = control ? control_field(control, "Filename") : NULL;
+    step->to_version = control ? control_field(control, "Version") : NULL;
+    free(control);
+    if (installed && installed->version) step->from_version = strdup(installed->version);
+
+    int ret = 0;
+    if (!filename) {
+        upkg_util_error("The recorded state of %s does not name its .deb; it cannot be restored.\n", step->package);
+        ret = -1;
+    } else if (upkg_pack_collect_cached_info(filename, g_control_dir, &step->staged.info) != 0) {
+        upkg_util_error("No cached extraction of %s in %s; install %s %s from its .deb instead.\n",
+                        filename, g_control_dir, step->package, step->to_version ? step->to_version : "");
+        ret = -1;
+    } else if (!step->staged.info.package_name || strcmp(step->staged.info.package_name, step->package) != 0 ||
+               !step->staged.info.version || !step->to_version ||
+               strcmp(step->staged.info.version, step->to_version) != 0) {
+        upkg_util_error("Cached extraction of %s is %s %s, not %s %s.\n", filename,
+                        step->staged.info.package_name ? step->staged.info.package_name : "?",
+                        step->staged.info.version ? step->staged.info.version : "?",
+                        step->package, step->to_version ? step->to_version : "?");
+        ret = -1;
+    }
+    free(filename);
+    if (ret != 0) return -1;
+
+    // Files the installed version has that the restored one does not are deleted
+    step->files_written = step->staged.info.file_count;
+    if (installed) {
+        upkg_index_t *keep = upkg_index_create((size_t)step->staged.info.file_count * 2 + 1);
+        if (!keep) return -1;
+        for (int i = 0; i < step->staged.info.file_count; i++) {
+            upkg_index_insert(keep, step->staged.info.file_list[i], "");
+        }
+        for (int i = 0; i < installed->file_count; i++) {
+            if (!upkg_index_find(keep, installed->file_list[i])) step->files_deleted++;
+        }
+        upkg_index_destroy(keep);
+    }
+    return 0;
+}
+
+/**
+ * @brief Plans the package changes that return the database to an earlier generation.
+ */
+int upkg_ops_rollback_plan(int target, upkg_ops_rollback_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->target = target;
+    if (!g_db_dir || !g_control_dir || !upkg_main_hash_table) {
+        upkg_util_error("Database or control directory not configured.\n");
+        return -1;
+    }
+    if (upkg_db_lock() != 0) {
+        upkg_util_error("Failed to lock the package database.\n");
+        return -1;
+    }
+
+    // Capture any change that has not been recorded yet, so "current" is exact
+    upkg_gen_record("snapshot");
+    plan->current = upkg_gen_latest();
+
+    upkg_gen_t want, have;
+    if (target < 1 || target > plan->current || upkg_gen_read(target, &want) != 0) {
+        upkg_util_error("Generation %d does not exist (newest is %d).\n", target, plan->current);
+        upkg_db_unlock();
+        return -1;
+    }
+    if (upkg_gen_read(plan->current, &have) != 0) {
+        upkg_util_error("Failed to read generation %d.\n", plan->current);
+        upkg_gen_free(&want);
+        upkg_db_unlock();
+        return -1;
+    }
+
+    int ret = 0;
+    // Packages installed now but absent from the target go first
+    for (size_t b = 0; b < have.records->size && ret == 0; b++) {
+        for (upkg_index_entry_t *e = have.records->buckets[b]; e; e = e->next) {
+            if (upkg_index_find(want.records, e->key)) continue;
+            const upkg_hash_package_info_t *installed = upkg_hash_search(upkg_main_hash_table, e->key);
+            upkg_ops_rollback_step_t *step = add_step(plan, UPKG_ROLLBACK_REMOVE, e->key);
+            if (!step) {
+                ret = -1;
+                break;
+            }
+            if (installed) {
+                step->from_version = installed->version ? strdup(installed->version) : NULL;
+                step->files_deleted = installed->file_count;
+            }
+        }
+    }
+    for (size_t b = 0; b < want.records->size && ret == 0; b++) {
+        for (upkg_index_entry_t *e = want.records->buckets[b]; e; e = e->next) {
+            const char *current_hash = upkg_index_lookup(have.records, e->key);
+            // A reinstall of the same .deb differs only in its manifest's mtimes
+            if (current_hash && upkg_gen_same_package(current_hash, e->value)) {
+                plan->unchanged++;
+                continue;
+            }
+            upkg_ops_rollback_step_t *step = add_step(plan, UPKG_ROLLBACK_RESTORE, e->key);
+            if (!step || plan_restore(step, e->value, upkg_hash_search(upkg_main_hash_table, e->key)) != 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    upkg_gen_free(&want);
+    upkg_gen_free(&have);
+    upkg_db_unlock();
+    if (ret != 0) upkg_ops_rollback_free(plan);
+    return ret;
+}
+
+/**
+ * @brief Applies a rollback plan as one transaction.
+ */
+int upkg_ops_rollback_apply(upkg_ops_rollback_t *plan, upkg_ops_progress_fn progress, void *user) {
+    if (upkg_db_lock() != 0) {
+        upkg_util_error("Failed to lock the package database.\n");
+        return -1;
+    }
+    if (upkg_gen_latest() != plan->current) {
+        upkg_util_error("The database changed since the rollback was planned; plan it again.\n");
+        upkg_db_unlock();
+        return -1;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < plan->step_count; i++) {
+        upkg_ops_rollback_step_t *step = &plan->steps[i];
+        if (step->kind == UPKG_ROLLBACK_REMOVE) {
+            if (upkg_ops_remove(step->package, false, progress, user) != 0) failures++;
+        } else if (install_locked(&step->staged.info, false, progress, user) != 0) {
+            failures++;
+        }
+    }
+
+    char summary[64];
+    snprintf(summary, sizeof(summary), "rollback to generation %d", plan->target);
+    if (upkg_ops_commit(summary) != 0) {
+        warn(progress, user, NULL, "Failed to commit changes to %s.", g_db_dir);
+    }
+    upkg_db_unlock();
+    upkg_daemon_request("reload", NULL);
+    return failures ? -1 : 0;
+}
+
+/**
+ * @brief Frees a rollback plan.
+ */
+void upkg_ops_rollback_free(upkg_ops_rollback_t *plan) {
+    for (int i = 0; i < plan->step_count; i++) {
+        upkg_ops_rollback_step_t *step = &plan->steps[i];
+        free(step->package);
+        free(step->from_version);
+        free(step->to_version);
+        upkg_ops_staged_free(&step->staged);
+    }
+    free(plan->steps);
+    memset(plan, 0, sizeof(*plan));
+}
@@ -0,0 +1,183 @@
+/******************************************************************************
+ * Filename:    upkg_ops.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Install and remove operations shared by the CLI and libupkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_OPS_H
+#define UPKG_OPS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "upkg_pack.h"
+
+/*
+ * These functions do the work behind -i/-r without printing to stdout:
+ * progress and non-fatal problems are reported through the callback and
+ * errors through upkg_util_error. Each takes and releases the database
+ * lock itself. With commit == false the directory table write and the
+ * upkgd reload are left to the caller, which batches them.
+ */
+
+// --- Progress Events ---
+typedef enum {
+    UPKG_OPS_EXTRACTED,   // pkg_info holds the parsed package
+    UPKG_OPS_FILE,        // detail: path placed; done/total: payload files
+    UPKG_OPS_STORED,      // the package record was added to the database
+    UPKG_OPS_REMOVED,     // the package and its record are gone
+    UPKG_OPS_WARNING      // detail: message; the operation carries on
+} upkg_ops_event_kind_t;
+
+typedef struct {
+    upkg_ops_event_kind_t kind;
+    const char *package;                 // May be NULL before extraction
+    const char *detail;
+    const upkg_package_info_t *pkg_info; // UPKG_OPS_EXTRACTED only
+    uint64_t done;
+    uint64_t total;
+} upkg_ops_event_t;
+
+/**
+ * @brief Receives progress events.
+ * @param event The event; valid only for the duration of the call.
+ * @param user The caller's context pointer.
+ */
+typedef void (*upkg_ops_progress_fn)(const upkg_ops_event_t *event, void *user);
+
+// An extracted package waiting to be applied
+typedef struct {
+    upkg_package_info_t info;
+    uint64_t start_ns;          // When staging began, for install metrics
+} upkg_ops_staged_t;
+
+// One package change needed to return to an earlier generation
+typedef enum {
+    UPKG_ROLLBACK_REMOVE,       // Installed now, absent in the target
+    UPKG_ROLLBACK_RESTORE       // Different or absent now; reinstalled from the extraction cache
+} upkg_ops_rollback_kind_t;
+
+typedef struct {
+    upkg_ops_rollback_kind_t kind;
+    char *package;
+    char *from_version;         // Installed now, or NULL
+    char *to_version;           // In the target generation, or NULL
+    int files_written;
+    int files_deleted;
+    upkg_ops_staged_t staged;   // UPKG_ROLLBACK_RESTORE: the cached extraction
+} upkg_ops_rollback_step_t;
+
+typedef struct {
+    int target;                 // Generation to return to
+    int current;                // Generation the plan was made against
+    upkg_ops_rollback_step_t *steps;
+    int step_count;
+    int unchanged;              // Packages identical in both generations
+} upkg_ops_rollback_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Extracts and parses a .deb without touching the database or the
+ *        install root, so several packages can be staged concurrently.
+ * @param deb_path The package file.
+ * @param staged Output; free with upkg_ops_staged_free.
+ * @param progress Event callback, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_ops_stage(const char *deb_path, upkg_ops_staged_t *staged, upkg_ops_progress_fn progress, void *user);
+
+/**
+ * @brief Installs a staged package: places its payload, retires any
+ *        previous version and records it, under the database lock.
+ * @param staged The package from upkg_ops_stage.
+ * @param commit Whether to write the directory table and reload upkgd.
+ * @param progress Event callback, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_ops_apply(upkg_ops_staged_t *staged, bool commit, upkg_ops_progress_fn progress, void *user);
+
+/**
+ * @brief Frees a staged package.
+ * @param staged The package.
+ */
+void upkg_ops_staged_free(upkg_ops_staged_t *staged);
+
+/**
+ * @brief Finishes a group of changes: writes the directory table,
+ *        records a database generation, appends a history entry and
+ *        publishes the package index snapshot (upkg_snap.h).
+ *        The database lock must be held.
+ * @param summary What changed, for the generation list and history.
+ * @return 0 on success, -1 if any of them could not be written.
+ */
+int upkg_ops_commit(const char *summary);
+
+/**
+ * @brief Plans the package changes that return the database to an earlier
+ *        generation. Only packages whose records differ are touched, and
+ *        restored packages come from their cached extraction in control_dir,
+ *        so nothing is extracted again; the plan fails if a cache is gone.
+ * @param target The generation number.
+ * @param plan Output; free with upkg_ops_rollback_free.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_ops_rollback_plan(int target, upkg_ops_rollback_t *plan);
+
+/**
+ * @brief Applies a rollback plan as one transaction (removals first), then
+ *        records the result as a new generation.
+ * @param plan The plan; refused if another generation was recorded since.
+ * @param progress Event callback, or NULL.
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_ops_rollback_apply(upkg_ops_rollback_t *plan, upkg_ops_progress_fn progress, void *user);
+
+/**
+ * @brief Frees a rollback plan.
+ * @param plan The plan.
+ */
+void upkg_ops_rollback_free(upkg_ops_rollback_t *plan);
+
+/**
+ * @brief Extracts a .deb, places its payload under the install root,
+ *        retires any previous version and records the package.
+ * @param deb_path The package file.
+ * @param commit Whether to write the directory table and reload upkgd.
+ * @param progress Event callback, or NULL (warnings then go to stderr).
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_ops_install(const char *deb_path, bool commit, upkg_ops_progress_fn progress, void *user);
+
+/**
+ * @brief Removes an installed package's files, record and now-unowned directories.
+ * @param package_name The package to remove.
+ * @param commit Whether to write the directory table and reload upkgd.
+ * @param progress Event callback, or NULL (warnings then go to stderr).
+ * @param user Passed through to progress.
+ * @return 0 on success, -1 if the package is not installed, the lock fails
+ *         or some of its files could not be removed (its record is gone).
+ */
+int upkg_ops_remove(const char *package_name, bool commit, upkg_ops_progress_fn progress, void *user);
+
+#endif // UPKG_OPS_H
@@ -23,6 +23,7 @@
 #include "upkg_pack.h"
 #include "upkg_util.h"
 #include "upkg_config.h"
+#include "upkg_elf.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -65,6 +66,12 @@ void upkg_pack_init_package_info(upkg_package_info_t *pkg_info) {
     pkg_info->data_dir_path = NULL;
     pkg_info->file_list = NULL;
     pkg_info->file_count = 0;
+    pkg_info->provided_sonames = NULL;
+    pkg_info->provided_soname_count = 0;
+    pkg_info->needed_sonames = NULL;
+    pkg_info->needed_soname_count = 0;
+    pkg_info->dir_list = NULL;
+    pkg_info->dir_count = 0;
 }
 
 /**
@@ -96,6 +103,10 @@ void upkg_pack_free_package_info(upkg_package_info_t *pkg_info) {
         upkg_util_free_and_null((char**)&pkg_info->file_list);
     }
     pkg_info->file_count = 0;
+
+    upkg_util_free_string_list(&pkg_info->provided_sonames, &pkg_info->provided_soname_count);
+    upkg_util_free_string_list(&pkg_info->needed_sonames, &pkg_info->needed_soname_count);
+    upkg_util_free_string_list(&pkg_info->dir_list, &pkg_info->dir_count);
 }
 
 /**
@@ -189,6 +200,49 @@ int upkg_pack_parse_control_file(const char *control_file_path, upkg_package_inf
 
 // --- Main Package Processing Function ---
 
+/**
+ * @brief Parses the control file and collects the file list of an
+ *        extraction directory. Frees pkg_info on failure.
+ * @param package_extract_dir The directory holding control/ and data/.
+ * @param pkg_info Pointer to package info structure to populate.
+ * @return 0 on success, -1 on failure.
+ */
+static int collect_extracted_info(const char *package_extract_dir, upkg_package_info_t *pkg_info) {
+    // Set up paths for control and data directories
+    pkg_info->control_dir_path = upkg_util_concat_path(package_extract_dir, "control");
+    pkg_info->data_dir_path = upkg_util_concat_path(package_extract_dir, "data");
+    
+    if (!pkg_info->control_dir_path || !pkg_info->data_dir_path) {
+        upkg_util_error("Failed to create control/data directory paths.\n");
+        upkg_pack_free_package_info(pkg_info);
+        return -1;
+    }
+    
+    // Parse the control file
+    char *control_file_path = upkg_util_concat_path(pkg_info->control_dir_path, "control");
+    if (!control_file_path) {
+        upkg_util_error("Failed to create control file path.\n");
+        upkg_pack_free_package_info(pkg_info);
+        return -1;
+    }
+    
+    if (upkg_pack_parse_control_file(control_file_path, pkg_info) != 0) {
+        upkg_util_error("Failed to parse control file.\n");
+        upkg_util_free_and_null(&control_file_path);
+        upkg_pack_free_package_info(pkg_info);
+        return -1;
+    }
+    upkg_util_free_and_null(&control_file_path);
+    
+    // Collect file list from data directory
+    if (upkg_pack_collect_file_list(pkg_info->data_dir_path, pkg_info) != 0) {
+        upkg_util_error("Failed to collect package file list.\n");
+        upkg_pack_free_package_info(pkg_info);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief Extracts a .deb package and collects package information.
  * @param deb_path The full path to the .deb package file.
@@ -230,7 +284,7 @@ int upkg_pack_extract_and_collect_info(const char *deb_path, const char *control
     
     upkg_util_log_verbose("Extracting to directory: %s\n", package_extract_dir);
     
-    // Step 1: Extract the .deb package completely
+    // Extract the .deb package completely
     if (upkg_util_extract_deb_complete(deb_path, package_extract_dir) != 0) {
         upkg_util_error("Failed to extract .deb package.\n");
         upkg_util_free_and_null(&package_extract_dir);
@@ -238,63 +292,105 @@ int upkg_pack_extract_and_collect_info(const char *deb_path, const char *control
         return -1;
     }
     
-    // Step 2: Set up paths for control and data directories
-    pkg_info->control_dir_path = upkg_util_concat_path(package_extract_dir, "control");
-    pkg_info->data_dir_path = upkg_util_concat_path(package_extract_dir, "data");
+    int ret = collect_extracted_info(package_extract_dir, pkg_info);
+    upkg_util_free_and_null(&package_extract_dir);
     
-    if (!pkg_info->control_dir_path || !pkg_info->data_dir_path) {
-        upkg_util_error("Failed to create control/data directory paths.\n");
-        upkg_util_free_and_null(&package_extract_dir);
-        upkg_pack_free_package_info(pkg_info);
+    if (ret == 0) {
+        upkg_util_log_verbose("Package extraction and info collection completed successfully.\n");
+    }
+    return ret;
+}
+
+/**
+ * @brief Collects package information from an earlier extraction of a .deb
+ *        left in the control directory, without extracting it again.
+ * @param deb_filename The .deb file name the package was installed from.
+ * @param control_dir The control directory (from config).
+ * @param pkg_info Pointer to package info structure to populate.
+ * @return 0 on success, -1 if the extraction is missing or unreadable.
+ */
+int upkg_pack_collect_cached_info(const char *deb_filename, const char *control_dir, upkg_package_info_t *pkg_info) {
+    if (!deb_filename || !control_dir || !pkg_info) {
+        upkg_util_error("collect_cached_info: NULL parameter provided.\n");
         return -1;
     }
-    
-    // Step 3: Parse the control file
-    char *control_file_path = upkg_util_concat_path(pkg_info->control_dir_path, "control");
-    if (!control_file_path) {
-        upkg_util_error("Failed to create control file path.\n");
-        upkg_util_free_and_null(&package_extract_dir);
-        upkg_pack_free_package_info(pkg_info);
+    upkg_pack_init_package_info(pkg_info);
+
+    char *package_extract_dir = upkg_pack_create_extraction_path(control_dir, deb_filename);
+    if (!package_extract_dir) {
+        upkg_util_error("Failed to create extraction directory path.\n");
         return -1;
     }
-    
-    if (upkg_pack_parse_control_file(control_file_path, pkg_info) != 0) {
-        upkg_util_error("Failed to parse control file.\n");
-        upkg_util_free_and_null(&control_file_path);
+    char *data_dir = upkg_util_concat_path(package_extract_dir, "data");
+    struct stat st;
+    bool cached = data_dir && stat(data_dir, &st) == 0 && S_ISDIR(st.st_mode);
+    free(data_dir);
+    if (!cached) {
+        upkg_util_log_verbose("No cached extraction of %s in %s\n", deb_filename, control_dir);
         upkg_util_free_and_null(&package_extract_dir);
-        upkg_pack_free_package_info(pkg_info);
         return -1;
     }
-    
-    // Step 4: Collect file list from data directory
-    if (upkg_pack_collect_file_list(pkg_info->data_dir_path, pkg_info) != 0) {
-        upkg_util_error("Failed to collect package file list.\n");
-        upkg_util_free_and_null(&control_file_path);
+
+    pkg_info->filename = strdup(deb_filename);
+    if (!pkg_info->filename) {
+        upkg_util_error("Failed to store package filename.\n");
         upkg_util_free_and_null(&package_extract_dir);
-        upkg_pack_free_package_info(pkg_info);
         return -1;
     }
-    
-    // Clean up temporary variables
-    upkg_util_free_and_null(&control_file_path);
+    upkg_util_log_verbose("Using cached extraction: %s\n", package_extract_dir);
+    int ret = collect_extracted_info(package_extract_dir, pkg_info);
     upkg_util_free_and_null(&package_extract_dir);
-    
-    upkg_util_log_verbose("Package extraction and info collection completed successfully.\n");
-    return 0;
+    return ret;
 }
 
 // --- File List Collection ---
 
+/**
+ * @brief Records the shared-library facts of one extracted file.
+ *
+ * Runs inside the file-list walk so every payload file is opened at most
+ * once more, right after it was stat()ed.
+ *
+ * @param full_path The extracted file.
+ * @param st The file's stat information.
+ * @param pkg_info Package info receiving provided and needed sonames.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int collect_elf_sonames(const char *full_path, const struct stat *st, upkg_package_info_t *pkg_info) {
+    upkg_elf_dynamic_t dyn;
+    if (upkg_elf_read_dynamic(full_path, st->st_size, &dyn) != 1) {
+        return 0;
+    }
+
+    int ret = 0;
+    if (dyn.soname) {
+        ret = upkg_util_add_unique_string(&pkg_info->provided_sonames, &pkg_info->provided_soname_count, dyn.soname);
+        if (ret == 0) {
+            upkg_util_log_verbose("Shared library %s provides %s\n", full_path, dyn.soname);
+        }
+    }
+    for (int i = 0; ret == 0 && i < dyn.needed_count; i++) {
+        ret = upkg_util_add_unique_string(&pkg_info->needed_sonames, &pkg_info->needed_soname_count, dyn.needed[i]);
+    }
+
+    upkg_elf_free_dynamic(&dyn);
+    return ret;
+}
+
 /**
  * @brief Recursively collects all files in a directory.
  * @param dir_path The directory path to scan.
  * @param base_path The base path to remove from file paths (for relative paths).
- * @param file_list Pointer to array of file paths.
- * @param file_count Pointer to current file count.
- * @param capacity Pointer to current array capacity.
+ * @param pkg_info Package info whose file list (and soname lists) are filled in.
+ * @param capacity Pointer to current file list capacity.
+ * @param dir_capacity Pointer to current directory list capacity.
  * @return 0 on success, -1 on failure.
  */
-static int collect_files_recursive(const char *dir_path, const char *base_path, char ***file_list, int *file_count, int *capacity) {
+static int collect_files_recursive(const char *dir_path, const char *base_path, upkg_package_info_t *pkg_info,
+                                   int *capacity, int *dir_capacity) {
+    char ***file_list = &pkg_info->file_list;
+    int *file_count = &pkg_info->file_count;
+
     DIR *dp = opendir(dir_path);
     if (!dp) {
         upkg_util_log_verbose("Could not open directory: %s\n", dir_path);
@@ -314,15 +410,47 @@ static int collect_files_recursive(const char *dir_path, const char *base_path,
             return -1;
         }
         
+        // lstat so symlinks are recorded as links, never followed into
         struct stat st;
-        if (stat(full_path, &st) != 0) {
+        if (lstat(full_path, &st) != 0) {
             upkg_util_free_and_null(&full_path);
             continue;
         }
+
+        // Create relative path by removing base_path prefix
+        const char *relative_path = full_path;
+        if (strncmp(full_path, base_path, strlen(base_path)) == 0) {
+            relative_path = full_path + strlen(base_path);
+            // Skip leading slash if present
+            if (relative_path[0] == '/') {
+                relative_path++;
+            }
+        }
         
         if (S_ISDIR(st.st_mode)) {
+            // Record the directory before its children so parents sort first
+            if (pkg_info->dir_count >= *dir_capacity) {
+                *dir_capacity = (*dir_capacity == 0) ? 16 : (*dir_capacity * 2);
+                char **new_dirs = realloc(pkg_info->dir_list, sizeof(char*) * (*dir_capacity));
+                if (!new_dirs) {
+                    upkg_util_error("Failed to reallocate memory for directory list.\n");
+                    upkg_util_free_and_null(&full_path);
+                    closedir(dp);
+                    return -1;
+                }
+                pkg_info->dir_list = new_dirs;
+            }
+            pkg_info->dir_list[pkg_info->dir_count] = strdup(relative_path);
+            if (!pkg_info->dir_list[pkg_info->dir_count]) {
+                upkg_util_error("Failed to duplicate directory path string.\n");
+                upkg_util_free_and_null(&full_path);
+                closedir(dp);
+                return -1;
+            }
+            pkg_info->dir_count++;
+
             // Recursively process subdirectory
-            if (collect_files_recursive(full_path, base_path, file_list, file_count, capacity) != 0) {
+            if (collect_files_recursive(full_path, base_path, pkg_info, capacity, dir_capacity) != 0) {
                 upkg_util_free_and_null(&full_path);
                 closedir(dp);
                 return -1;
@@ -330,16 +458,6 @@ static int collect_files_recursive(const char *dir_path, const char *base_path,
         } else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
             // Add regular file or symlink to the list
             
-            // Create relative path by removing base_path prefix
-            const char *relative_path = full_path;
-            if (strncmp(full_path, base_path, strlen(base_path)) == 0) {
-                relative_path = full_path + strlen(base_path);
-                // Skip leading slash if present
-                if (relative_path[0] == '/') {
-                    relative_path++;
-                }
-            }
-            
             // Ensure we have enough capacity
             if (*file_count >= *capacity) {
                 *capacity = (*capacity == 0) ? 32 : (*capacity * 2);
@@ -364,6 +482,12 @@ static int collect_files_recursive(const char *dir_path, const char *base_path,
             (*file_count)++;
             
             upkg_util_log_verbose("Added file to list: %s\n", relative_path);
+
+            if (S_ISREG(st.st_mode) && collect_elf_sonames(full_path, &st, pkg_info) != 0) {
+                upkg_util_free_and_null(&full_path);
+                closedir(dp);
+                return -1;
+            }
         }
         
         upkg_util_free_and_null(&full_path);
@@ -398,16 +522,20 @@ int upkg_pack_collect_file_list(const char *data_dir_path, upkg_package_info_t *
     
     // Initialize file list
     int capacity = 0;
+    int dir_capacity = 0;
     pkg_info->file_count = 0;
     pkg_info->file_list = NULL;
     
     // Collect files recursively
-    if (collect_files_recursive(data_dir_path, data_dir_path, &pkg_info->file_list, &pkg_info->file_count, &capacity) != 0) {
+    if (collect_files_recursive(data_dir_path, data_dir_path, pkg_info, &capacity, &dir_capacity) != 0) {
         upkg_util_error("Failed to collect files from data directory.\n");
         return -1;
     }
     
-    upkg_util_log_verbose("Collected %d files from package data directory.\n", pkg_info->file_count);
+    upkg_util_log_verbose("Collected %d files and %d directories from package data directory.\n",
+                          pkg_info->file_count, pkg_info->dir_count);
+    upkg_util_log_verbose("Package provides %d and needs %d shared-library sonames.\n",
+                          pkg_info->provided_soname_count, pkg_info->needed_soname_count);
     return 0;
 }
 
@@ -478,5 +606,18 @@ void upkg_pack_print_package_info(const upkg_package_info_t *pkg_info) {
     } else {
         printf("  (No files or empty package)\n");
     }
+
+    if (pkg_info->provided_soname_count > 0) {
+        printf("\nProvides Libraries:\n");
+        for (int i = 0; i < pkg_info->provided_soname_count; i++) {
+            printf("  %s\n", pkg_info->provided_sonames[i]);
+        }
+    }
+    if (pkg_info->needed_soname_count > 0) {
+        printf("\nNeeds Libraries:\n");
+        for (int i = 0; i < pkg_info->needed_soname_count; i++) {
+            printf("  %s\n", pkg_info->needed_sonames[i]);
+        }
+    }
     printf("\n");
 }
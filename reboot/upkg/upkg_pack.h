@@ -52,6 +52,12 @@ typedef struct {
     char *data_dir_path;     // Path where data files are extracted
     char **file_list;        // Array of file paths contained in the package
     int file_count;          // Number of files in the package
+    char **provided_sonames; // DT_SONAME of each shared library in the package
+    int provided_soname_count;
+    char **needed_sonames;   // Union of DT_NEEDED over the package's ELF files
+    int needed_soname_count;
+    char **dir_list;         // Directories the package ships, parents before children
+    int dir_count;
 } upkg_package_info_t;
 
 // --- Function Prototypes ---
@@ -83,6 +89,16 @@ void upkg_pack_free_package_info(upkg_package_info_t *pkg_info);
  */
 int upkg_pack_extract_and_collect_info(const char *deb_path, const char *control_dir, upkg_package_info_t *pkg_info);
 
+/**
+ * @brief Collects package information from an earlier extraction of a .deb
+ *        left in the control directory, without extracting it again.
+ * @param deb_filename The .deb file name the package was installed from.
+ * @param control_dir The control directory (from config).
+ * @param pkg_info Pointer to package info structure to populate.
+ * @return 0 on success, -1 if the extraction is missing or unreadable.
+ */
+int upkg_pack_collect_cached_info(const char *deb_filename, const char *control_dir, upkg_package_info_t *pkg_info);
+
 /**
  * @brief Parses a control file and extracts package information.
  * @param control_file_path The path to the control file.
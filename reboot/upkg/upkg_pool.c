@@ -0,0 +1,275 @@
+/******************************************************************************
+ * Filename:    upkg_pool.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Worker threads with eventfd completion for libupkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_pool.h"
+#include "upkg_util.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+// --- Types ---
+
+typedef struct pool_job {
+    upkg_pool_run_fn run;
+    upkg_pool_complete_fn complete;
+    void *arg;
+    bool exclusive;
+    int result;
+    struct pool_job *next;
+} pool_job_t;
+
+typedef struct {
+    pool_job_t *head;
+    pool_job_t *tail;
+} job_list_t;
+
+struct upkg_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_rwlock_t gate;       // Shared jobs read-lock, exclusive jobs write-lock
+    job_list_t queue;            // Waiting to run
+    job_list_t done;             // Waiting for upkg_pool_dispatch
+    pthread_t *threads;
+    int thread_count;
+    int event_fd;
+    bool stopping;
+};
+
+// --- Helpers ---
+
+static void list_push(job_list_t *list, pool_job_t *job) {
+    job->next = NULL;
+    if (list->tail) list->tail->next = job;
+    else list->head = job;
+    list->tail = job;
+}
+
+static pool_job_t *list_pop(job_list_t *list) {
+    pool_job_t *job = list->head;
+    if (job) {
+        list->head = job->next;
+        if (!list->head) list->tail = NULL;
+    }
+    return job;
+}
+
+/**
+ * @brief Queues a finished job for dispatch and wakes the event loop.
+ */
+static void complete_job(upkg_pool_t *pool, pool_job_t *job) {
+    pthread_mutex_lock(&pool->mutex);
+    list_push(&pool->done, job);
+    pthread_mutex_unlock(&pool->mutex);
+
+    uint64_t one = 1;
+    if (write(pool->event_fd, &one, sizeof(one)) != sizeof(one)) {
+        // Only fails if the counter would overflow, and it is already readable then
+    }
+}
+
+/**
+ * @brief Worker thread: runs queued jobs until the pool stops and drains.
+ */
+static void *worker_main(void *arg) {
+    upkg_pool_t *pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->queue.head && !pool->stopping) {
+            pthread_cond_wait(&pool->work, &pool->mutex);
+        }
+        pool_job_t *job = list_pop(&pool->queue);
+        pthread_mutex_unlock(&pool->mutex);
+        if (!job) break;
+
+        if (job->exclusive) pthread_rwlock_wrlock(&pool->gate);
+        else pthread_rwlock_rdlock(&pool->gate);
+        job->result = job->run(job->arg);
+        pthread_rwlock_unlock(&pool->gate);
+
+        if (job->complete) complete_job(pool, job);
+        else free(job);
+    }
+    return NULL;
+}
+
+// --- Lifecycle ---
+
+/**
+ * @brief Starts a pool.
+ * @param threads Number of workers; 0 picks one per online CPU.
+ * @return The pool, or NULL on failure.
+ */
+upkg_pool_t *upkg_pool_create(int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    upkg_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+    pool->threads = calloc((size_t)threads, sizeof(pthread_t));
+    pool->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!pool->threads || pool->event_fd < 0) {
+        upkg_util_error("Failed to set up the worker pool.\n");
+        if (pool->event_fd >= 0) close(pool->event_fd);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    // Keep a stream of extractions from starving a commit
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&pool->gate, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            upkg_util_error("Failed to start worker thread.\n");
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        upkg_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/**
+ * @brief Waits for queued jobs, stops the workers and frees the pool.
+ * @param pool The pool, or NULL.
+ */
+void upkg_pool_destroy(upkg_pool_t *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pool_job_t *job;
+    while ((job = list_pop(&pool->done)) != NULL) free(job);
+
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_rwlock_destroy(&pool->gate);
+    close(pool->event_fd);
+    free(pool->threads);
+    free(pool);
+}
+
+// --- Jobs ---
+
+/**
+ * @brief Queues a job.
+ * @param pool The pool.
+ * @param run Work to do on a worker thread.
+ * @param complete Called from upkg_pool_dispatch with run's result, or NULL.
+ * @param arg Passed to both callbacks.
+ * @param exclusive Whether the job must run alone.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_pool_submit(upkg_pool_t *pool, upkg_pool_run_fn run, upkg_pool_complete_fn complete,
+                     void *arg, bool exclusive) {
+    if (!pool || !run) return -1;
+    pool_job_t *job = calloc(1, sizeof(*job));
+    if (!job) return -1;
+    job->run = run;
+    job->complete = complete;
+    job->arg = arg;
+    job->exclusive = exclusive;
+
+    pthread_mutex_lock(&pool->mutex);
+    list_push(&pool->queue, job);
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+/**
+ * @brief Queues a completion directly. Safe to call from any thread.
+ * @param pool The pool.
+ * @param complete The callback.
+ * @param result Passed to complete.
+ * @param arg Passed to complete.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_pool_post(upkg_pool_t *pool, upkg_pool_complete_fn complete, int result, void *arg) {
+    if (!pool || !complete) return -1;
+    pool_job_t *job = calloc(1, sizeof(*job));
+    if (!job) return -1;
+    job->complete = complete;
+    job->arg = arg;
+    job->result = result;
+    complete_job(pool, job);
+    return 0;
+}
+
+// --- Completion ---
+
+/**
+ * @brief Returns the eventfd that is readable while completions are pending.
+ * @param pool The pool.
+ * @return The descriptor.
+ */
+int upkg_pool_fd(const upkg_pool_t *pool) {
+    return pool->event_fd;
+}
+
+/**
+ * @brief Runs pending completions in the order they were queued.
+ * @param pool The pool.
+ * @return The number of completions run.
+ */
+int upkg_pool_dispatch(upkg_pool_t *pool) {
+    uint64_t count;
+    // Clear the counter first so a completion queued while we run still wakes the loop
+    if (read(pool->event_fd, &count, sizeof(count)) < 0) {
+        // EAGAIN: nothing signalled since the last dispatch
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    job_list_t ready = pool->done;
+    pool->done.head = pool->done.tail = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+
+    int ran = 0;
+    pool_job_t *job;
+    while ((job = list_pop(&ready)) != NULL) {
+        job->complete(job->result, job->arg);
+        free(job);
+        ran++;
+    }
+    return ran;
+}
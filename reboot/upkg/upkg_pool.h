@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Filename:    upkg_pool.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Worker threads with eventfd completion for libupkg
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_POOL_H
+#define UPKG_POOL_H
+
+#include <stdbool.h>
+
+/*
+ * Jobs run on worker threads; their completions are queued and the pool's
+ * eventfd becomes readable, so an event loop (epoll, poll) can call
+ * upkg_pool_dispatch() and run completion callbacks on its own thread.
+ *
+ * Shared jobs (extraction, planning) run concurrently. Exclusive jobs
+ * (database writes) wait for running shared jobs to drain and block new
+ * ones while they run; waiting exclusive jobs take priority.
+ */
+
+typedef struct upkg_pool upkg_pool_t;
+
+// Runs on a worker thread; the return value is passed to the completion
+typedef int (*upkg_pool_run_fn)(void *arg);
+
+// Runs on the thread that calls upkg_pool_dispatch
+typedef void (*upkg_pool_complete_fn)(int result, void *arg);
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Starts a pool.
+ * @param threads Number of workers; 0 picks one per online CPU.
+ * @return The pool, or NULL on failure.
+ */
+upkg_pool_t *upkg_pool_create(int threads);
+
+/**
+ * @brief Waits for queued jobs to finish, stops the workers and frees the
+ *        pool. Undispatched completions are dropped.
+ * @param pool The pool, or NULL.
+ */
+void upkg_pool_destroy(upkg_pool_t *pool);
+
+/**
+ * @brief Queues a job.
+ * @param pool The pool.
+ * @param run Work to do on a worker thread.
+ * @param complete Called from upkg_pool_dispatch with run's result, or NULL.
+ * @param arg Passed to both callbacks.
+ * @param exclusive Whether the job must run alone.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_pool_submit(upkg_pool_t *pool, upkg_pool_run_fn run, upkg_pool_complete_fn complete,
+                     void *arg, bool exclusive);
+
+/**
+ * @brief Queues a completion directly, e.g. progress from a running job.
+ *        Safe to call from any thread.
+ * @param pool The pool.
+ * @param complete The callback.
+ * @param result Passed to complete.
+ * @param arg Passed to complete.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_pool_post(upkg_pool_t *pool, upkg_pool_complete_fn complete, int result, void *arg);
+
+/**
+ * @brief Returns the eventfd that is readable while completions are pending.
+ * @param pool The pool.
+ * @return The descriptor.
+ */
+int upkg_pool_fd(const upkg_pool_t *pool);
+
+/**
+ * @brief Runs pending completions in the order they were queued.
+ * @param pool The pool.
+ * @return The number of completions run.
+ */
+int upkg_pool_dispatch(upkg_pool_t *pool);
+
+#endif // UPKG_POOL_H
@@ -0,0 +1,1199 @@
+/******************************************************************************
+ * Filename:    upkg_repack.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Recompression of .deb archives into faster-to-decode formats
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_repack.h"
+#include "upkg_digest.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define AR_MAGIC "!<arch>\n"
+#define AR_MAGIC_LEN 8
+#define AR_HEADER_LEN 60
+#define REPACK_BUFFER_SIZE 65536
+
+// --- Compression Tool Table ---
+
+/**
+ * @brief Describes the external program used to decode and encode one format.
+ */
+typedef struct {
+    upkg_compress_t type;
+    const char *name;
+    const char *suffix;
+    const char *tool_path;
+    const char *decompress_argv[5];
+    const char *compress_argv[6];
+} compress_tool_t;
+
+static const compress_tool_t compress_tools[] = {
+    { UPKG_COMPRESS_NONE,  "none",  "",      NULL,             { NULL }, { NULL } },
+    { UPKG_COMPRESS_GZIP,  "gzip",  ".gz",   "/usr/bin/gzip",  { "gzip", "-d", "-c", NULL },
+                                                               { "gzip", "-c", "-n", "-9", NULL } },
+    { UPKG_COMPRESS_XZ,    "xz",    ".xz",   "/usr/bin/xz",    { "xz", "-d", "-c", NULL },
+                                                               { "xz", "-c", "-6", NULL } },
+    { UPKG_COMPRESS_ZSTD,  "zstd",  ".zst",  "/usr/bin/zstd",  { "zstd", "-d", "-c", "-q", NULL },
+                                                               { "zstd", "-c", "-q", "-19", NULL } },
+    { UPKG_COMPRESS_BZIP2, "bzip2", ".bz2",  "/usr/bin/bzip2", { "bzip2", "-d", "-c", NULL },
+                                                               { "bzip2", "-c", "-9", NULL } },
+    { UPKG_COMPRESS_LZMA,  "lzma",  ".lzma", "/usr/bin/xz",    { "xz", "--format=lzma", "-d", "-c", NULL },
+                                                               { "xz", "--format=lzma", "-c", NULL } }
+};
+
+#define COMPRESS_TOOL_COUNT (sizeof(compress_tools) / sizeof(compress_tools[0]))
+
+/**
+ * @brief Finds the tool table entry for a compression format.
+ * @param compress The compression format.
+ * @return The matching entry, or NULL if unknown.
+ */
+static const compress_tool_t *find_compress_tool(upkg_compress_t compress) {
+    for (size_t i = 0; i < COMPRESS_TOOL_COUNT; i++) {
+        if (compress_tools[i].type == compress) {
+            return &compress_tools[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Looks up a compression format by name ("zstd", "xz", "gzip", "none").
+ * @param name The format name as given on the command line.
+ * @param compress Output parameter for the parsed format.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int upkg_repack_parse_compress(const char *name, upkg_compress_t *compress) {
+    if (!name || !compress) return -1;
+
+    // Only formats worth targeting are accepted here; bzip2 and lzma are decode-only.
+    if (strcmp(name, "zstd") == 0 || strcmp(name, "zst") == 0) {
+        *compress = UPKG_COMPRESS_ZSTD;
+    } else if (strcmp(name, "xz") == 0) {
+        *compress = UPKG_COMPRESS_XZ;
+    } else if (strcmp(name, "gzip") == 0 || strcmp(name, "gz") == 0) {
+        *compress = UPKG_COMPRESS_GZIP;
+    } else if (strcmp(name, "none") == 0) {
+        *compress = UPKG_COMPRESS_NONE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the canonical file suffix for a compression format (e.g. ".zst").
+ * @param compress The compression format.
+ * @return A static string; empty for UPKG_COMPRESS_NONE.
+ */
+const char *upkg_repack_compress_suffix(upkg_compress_t compress) {
+    const compress_tool_t *tool = find_compress_tool(compress);
+    return tool ? tool->suffix : "";
+}
+
+/**
+ * @brief Determines the compression of a tar member from its name suffix.
+ * @param suffix The part of the member name following ".tar".
+ * @param compress Output parameter for the detected format.
+ * @return 0 on success, -1 if the suffix is not recognized.
+ */
+static int compress_from_suffix(const char *suffix, upkg_compress_t *compress) {
+    for (size_t i = 0; i < COMPRESS_TOOL_COUNT; i++) {
+        if (strcmp(compress_tools[i].suffix, suffix) == 0) {
+            *compress = compress_tools[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// --- ar Archive Handling ---
+
+/**
+ * @brief One member of a .deb (ar) archive.
+ */
+typedef struct {
+    char name[17];                      // Member name with padding and '/' stripped
+    char header[AR_HEADER_LEN];         // Raw header, reused for untouched fields
+    off_t data_offset;                  // Offset of the member data in the archive
+    unsigned long long size;            // Member data size in bytes
+} ar_member_t;
+
+/**
+ * @brief Reads the member table of an ar archive.
+ * @param fd File descriptor of the archive.
+ * @param members Output array of members; the caller frees it.
+ * @param count Output number of members.
+ * @return 0 on success, -1 on failure.
+ */
+static int read_ar_members(int fd, ar_member_t **members, int *count) {
+    char magic[AR_MAGIC_LEN];
+    *members = NULL;
+    *count = 0;
+
+    if (pread(fd, magic, AR_MAGIC_LEN, 0) != AR_MAGIC_LEN || memcmp(magic, AR_MAGIC, AR_MAGIC_LEN) != 0) {
+        upkg_util_error("Not an ar archive (bad magic).\n");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        upkg_util_error("Failed to stat archive: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int capacity = 0;
+    off_t offset = AR_MAGIC_LEN;
+    while (offset + AR_HEADER_LEN <= st.st_size) {
+        char header[AR_HEADER_LEN];
+        if (pread(fd, header, AR_HEADER_LEN, offset) != AR_HEADER_LEN) {
+            upkg_util_error("Truncated ar member header at offset %lld.\n", (long long)offset);
+            free(*members);
+            *members = NULL;
+            return -1;
+        }
+        if (header[58] != '`' || header[59] != '\n') {
+            upkg_util_error("Corrupt ar member header at offset %lld.\n", (long long)offset);
+            free(*members);
+            *members = NULL;
+            return -1;
+        }
+
+        if (*count >= capacity) {
+            capacity = (capacity == 0) ? 4 : capacity * 2;
+            ar_member_t *new_members = realloc(*members, sizeof(ar_member_t) * capacity);
+            if (!new_members) {
+                upkg_util_error("Failed to allocate memory for ar member table.\n");
+                free(*members);
+                *members = NULL;
+                return -1;
+            }
+            *members = new_members;
+        }
+
+        ar_member_t *m = &(*members)[*count];
+        memcpy(m->header, header, AR_HEADER_LEN);
+        memcpy(m->name, header, 16);
+        m->name[16] = '\0';
+        for (int i = 15; i >= 0 && (m->name[i] == ' ' || m->name[i] == '/'); i--) {
+            m->name[i] = '\0';
+        }
+
+        char size_field[11];
+        memcpy(size_field, header + 48, 10);
+        size_field[10] = '\0';
+        m->size = strtoull(size_field, NULL, 10);
+        m->data_offset = offset + AR_HEADER_LEN;
+
+        if (m->data_offset + (off_t)m->size > st.st_size) {
+            upkg_util_error("ar member '%s' extends past end of archive.\n", m->name);
+            free(*members);
+            *members = NULL;
+            return -1;
+        }
+
+        (*count)++;
+        offset = m->data_offset + (off_t)m->size + (off_t)(m->size & 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a whole buffer to a file descriptor, retrying short writes.
+ * @param fd The destination descriptor.
+ * @param buf The data to write.
+ * @param len The number of bytes to write.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes an ar member header, keeping date/owner/mode from an original header.
+ * @param fd The archive descriptor, positioned at the header.
+ * @param name The member name.
+ * @param size The member size (may be a placeholder that is patched later).
+ * @param template_header The original header to copy date, uid, gid and mode from.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_ar_header(int fd, const char *name, unsigned long long size, const char *template_header) {
+    char header[AR_HEADER_LEN + 1];
+    snprintf(header, sizeof(header), "%-16.16s%-12.12s%-6.6s%-6.6s%-8.8s%-10llu`\n",
+             name, template_header + 16, template_header + 28, template_header + 34,
+             template_header + 40, size);
+    return write_all(fd, header, AR_HEADER_LEN);
+}
+
+/**
+ * @brief Rewrites the size field of an already written ar header.
+ * @param fd The archive descriptor.
+ * @param header_offset Offset of the header within the archive.
+ * @param size The final member size.
+ * @return 0 on success, -1 on failure.
+ */
+static int patch_ar_size(int fd, off_t header_offset, unsigned long long size) {
+    char size_field[11];
+    snprintf(size_field, sizeof(size_field), "%-10llu", size);
+    return (pwrite(fd, size_field, 10, header_offset + 48) == 10) ? 0 : -1;
+}
+
+// --- Streaming Pipeline ---
+
+/**
+ * @brief Forks a child that copies a byte range of a file into a pipe.
+ *
+ * The range feeder lets decompressors read exactly one ar member without
+ * extracting it to a temporary file first.
+ *
+ * @param fd The source file descriptor (read with pread, offset untouched).
+ * @param offset Start of the range.
+ * @param len Length of the range.
+ * @param read_fd Output: the read end of the pipe carrying the range.
+ * @return The feeder's pid, or -1 on failure.
+ */
+static pid_t spawn_range_feeder(int fd, off_t offset, unsigned long long len, int *read_fd) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        upkg_util_error("Failed to create feeder pipe: %s\n", strerror(errno));
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        upkg_util_error("Failed to fork feeder process: %s\n", strerror(errno));
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        char buffer[REPACK_BUFFER_SIZE];
+        while (len > 0) {
+            size_t want = len < sizeof(buffer) ? (size_t)len : sizeof(buffer);
+            ssize_t n = pread(fd, buffer, want, offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) _exit(1);
+            if (write_all(pipe_fds[1], buffer, (size_t)n) != 0) _exit(1);
+            offset += n;
+            len -= (unsigned long long)n;
+        }
+        _exit(0);
+    }
+
+    close(pipe_fds[1]);
+    *read_fd = pipe_fds[0];
+    return pid;
+}
+
+/**
+ * @brief Starts a filter process between two descriptors.
+ * @param tool The compression tool entry.
+ * @param decompress True to run the decoder, false for the encoder.
+ * @param in_fd Descriptor used as the filter's stdin.
+ * @param out_fd Descriptor used as the filter's stdout.
+ * @return The filter's pid, or -1 on failure.
+ */
+static pid_t spawn_filter(const compress_tool_t *tool, bool decompress, int in_fd, int out_fd) {
+    char *const *argv = (char *const *)(decompress ? tool->decompress_argv : tool->compress_argv);
+    return upkg_util_spawn_command(tool->tool_path, argv, in_fd, out_fd);
+}
+
+/**
+ * @brief Opens a decoded view of a compressed byte range.
+ * @param fd The file holding the compressed range.
+ * @param offset Start of the range.
+ * @param len Length of the range.
+ * @param tool The tool that decodes the range.
+ * @param read_fd Output: descriptor yielding the uncompressed stream.
+ * @param feeder_pid Output: pid of the range feeder.
+ * @param decoder_pid Output: pid of the decoder, or -1 for uncompressed data.
+ * @return 0 on success, -1 on failure.
+ */
+static int open_decoded_range(int fd, off_t offset, unsigned long long len, const compress_tool_t *tool,
+                              int *read_fd, pid_t *feeder_pid, pid_t *decoder_pid) {
+    int feed_fd = -1;
+    *decoder_pid = -1;
+    *feeder_pid = spawn_range_feeder(fd, offset, len, &feed_fd);
+    if (*feeder_pid == -1) {
+        return -1;
+    }
+
+    if (tool->type == UPKG_COMPRESS_NONE) {
+        *read_fd = feed_fd;
+        return 0;
+    }
+
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        upkg_util_error("Failed to create decoder pipe: %s\n", strerror(errno));
+        close(feed_fd);
+        upkg_util_wait_command(*feeder_pid, "range feeder");
+        return -1;
+    }
+
+    *decoder_pid = spawn_filter(tool, true, feed_fd, pipe_fds[1]);
+    close(feed_fd);
+    close(pipe_fds[1]);
+    if (*decoder_pid == -1) {
+        close(pipe_fds[0]);
+        upkg_util_wait_command(*feeder_pid, "range feeder");
+        return -1;
+    }
+
+    *read_fd = pipe_fds[0];
+    return 0;
+}
+
+/**
+ * @brief Closes a decoded view and reaps its helper processes.
+ * @param read_fd The descriptor returned by open_decoded_range.
+ * @param tool The decoding tool.
+ * @param feeder_pid The feeder's pid.
+ * @param decoder_pid The decoder's pid, or -1.
+ * @return 0 if all helpers exited cleanly, -1 otherwise.
+ */
+static int close_decoded_range(int read_fd, const compress_tool_t *tool, pid_t feeder_pid, pid_t decoder_pid) {
+    int ret = 0;
+    close(read_fd);
+    if (decoder_pid != -1 && upkg_util_wait_command(decoder_pid, tool->tool_path) != 0) {
+        ret = -1;
+    }
+    if (upkg_util_wait_command(feeder_pid, "range feeder") != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * @brief An encoder frame currently accepting data.
+ */
+typedef struct {
+    pid_t pid;
+    int write_fd;
+    size_t written;
+} encoder_frame_t;
+
+/**
+ * @brief Starts a new encoder frame appending to the output archive.
+ * @param tool The encoding tool.
+ * @param out_fd The archive descriptor.
+ * @param frame Output frame state.
+ * @return 0 on success, -1 on failure.
+ */
+static int start_frame(const compress_tool_t *tool, int out_fd, encoder_frame_t *frame) {
+    frame->written = 0;
+    if (tool->type == UPKG_COMPRESS_NONE) {
+        frame->pid = -1;
+        frame->write_fd = out_fd;
+        return 0;
+    }
+
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        upkg_util_error("Failed to create encoder pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    frame->pid = spawn_filter(tool, false, pipe_fds[0], out_fd);
+    close(pipe_fds[0]);
+    if (frame->pid == -1) {
+        close(pipe_fds[1]);
+        return -1;
+    }
+    frame->write_fd = pipe_fds[1];
+    return 0;
+}
+
+/**
+ * @brief Finishes an encoder frame and waits for its output to land.
+ * @param tool The encoding tool.
+ * @param frame The frame to finish.
+ * @return 0 on success, -1 on failure.
+ */
+static int finish_frame(const compress_tool_t *tool, encoder_frame_t *frame) {
+    if (frame->pid == -1) return 0;
+    close(frame->write_fd);
+    int result = upkg_util_wait_command(frame->pid, tool->tool_path);
+    frame->pid = -1;
+    frame->write_fd = -1;
+    return result == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Transcodes one tar member from the source archive into the output archive.
+ * @param deb_fd The source archive descriptor.
+ * @param member The member to transcode.
+ * @param src_tool The member's current compression tool.
+ * @param dst_tool The target compression tool.
+ * @param frame_size Uncompressed bytes per frame, 0 for a single frame.
+ * @param out_fd The output archive descriptor, positioned after the member header.
+ * @param digest Output SHA-256 of the uncompressed tar stream.
+ * @param raw_size Output size of the uncompressed tar stream.
+ * @param frame_count Output number of frames written.
+ * @return 0 on success, -1 on failure.
+ */
+static int transcode_member(int deb_fd, const ar_member_t *member, const compress_tool_t *src_tool,
+                            const compress_tool_t *dst_tool, size_t frame_size, int out_fd,
+                            uint8_t digest[UPKG_SHA256_DIGEST_LENGTH], unsigned long long *raw_size,
+                            int *frame_count) {
+    int read_fd;
+    pid_t feeder_pid, decoder_pid;
+    if (open_decoded_range(deb_fd, member->data_offset, member->size, src_tool,
+                           &read_fd, &feeder_pid, &decoder_pid) != 0) {
+        return -1;
+    }
+
+    upkg_sha256_ctx_t ctx;
+    upkg_digest_sha256_init(&ctx);
+    *raw_size = 0;
+    *frame_count = 0;
+
+    encoder_frame_t frame = { -1, -1, 0 };
+    bool frame_open = false;
+    int ret = 0;
+    char buffer[REPACK_BUFFER_SIZE];
+
+    for (;;) {
+        ssize_t n = read(read_fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            upkg_util_error("Read error while decoding '%s': %s\n", member->name, strerror(errno));
+            ret = -1;
+            break;
+        }
+        if (n == 0) break;
+
+        upkg_digest_sha256_update(&ctx, buffer, (size_t)n);
+        *raw_size += (unsigned long long)n;
+
+        // Split the chunk across frame boundaries so every frame decodes on its own.
+        size_t pos = 0;
+        while (pos < (size_t)n) {
+            if (!frame_open) {
+                if (start_frame(dst_tool, out_fd, &frame) != 0) {
+                    ret = -1;
+                    break;
+                }
+                frame_open = true;
+                (*frame_count)++;
+            }
+
+            size_t chunk = (size_t)n - pos;
+            if (frame_size > 0 && frame.written + chunk > frame_size) {
+                chunk = frame_size - frame.written;
+            }
+            if (write_all(frame.write_fd, buffer + pos, chunk) != 0) {
+                upkg_util_error("Write error while encoding '%s': %s\n", member->name, strerror(errno));
+                ret = -1;
+                break;
+            }
+            frame.written += chunk;
+            pos += chunk;
+
+            if (frame_size > 0 && frame.written >= frame_size) {
+                frame_open = false;
+                if (finish_frame(dst_tool, &frame) != 0) {
+                    ret = -1;
+                    break;
+                }
+            }
+        }
+        if (ret != 0) break;
+    }
+
+    // An empty tar stream still needs one valid (empty) compressed frame.
+    if (ret == 0 && *frame_count == 0) {
+        if (start_frame(dst_tool, out_fd, &frame) != 0) {
+            ret = -1;
+        } else {
+            frame_open = true;
+            (*frame_count)++;
+        }
+    }
+    if (frame_open && finish_frame(dst_tool, &frame) != 0) {
+        ret = -1;
+    }
+    if (close_decoded_range(read_fd, src_tool, feeder_pid, decoder_pid) != 0) {
+        upkg_util_error("Failed to decode member '%s'.\n", member->name);
+        ret = -1;
+    }
+
+    upkg_digest_sha256_final(&ctx, digest);
+    return ret;
+}
+
+/**
+ * @brief Decodes a freshly written member and compares its tar stream digest.
+ * @param out_fd The output archive descriptor.
+ * @param offset Offset of the member data.
+ * @param size Size of the member data.
+ * @param tool The member's compression tool.
+ * @param expected The digest of the original tar stream.
+ * @return 0 if the digests match, -1 otherwise.
+ */
+static int verify_member(int out_fd, off_t offset, unsigned long long size, const compress_tool_t *tool,
+                         const uint8_t expected[UPKG_SHA256_DIGEST_LENGTH]) {
+    int read_fd;
+    pid_t feeder_pid, decoder_pid;
+    if (open_decoded_range(out_fd, offset, size, tool, &read_fd, &feeder_pid, &decoder_pid) != 0) {
+        return -1;
+    }
+
+    upkg_sha256_ctx_t ctx;
+    upkg_digest_sha256_init(&ctx);
+    char buffer[REPACK_BUFFER_SIZE];
+    int ret = 0;
+    for (;;) {
+        ssize_t n = read(read_fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ret = -1;
+            break;
+        }
+        if (n == 0) break;
+        upkg_digest_sha256_update(&ctx, buffer, (size_t)n);
+    }
+    if (close_decoded_range(read_fd, tool, feeder_pid, decoder_pid) != 0) {
+        ret = -1;
+    }
+
+    uint8_t actual[UPKG_SHA256_DIGEST_LENGTH];
+    upkg_digest_sha256_final(&ctx, actual);
+    if (ret == 0 && memcmp(actual, expected, UPKG_SHA256_DIGEST_LENGTH) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * @brief Copies an ar member unchanged into the output archive.
+ * @param deb_fd The source archive descriptor.
+ * @param member The member to copy.
+ * @param out_fd The output archive descriptor.
+ * @return 0 on success, -1 on failure.
+ */
+static int copy_member(int deb_fd, const ar_member_t *member, int out_fd) {
+    if (write_all(out_fd, member->header, AR_HEADER_LEN) != 0) return -1;
+
+    char buffer[REPACK_BUFFER_SIZE];
+    off_t offset = member->data_offset;
+    unsigned long long remaining = member->size;
+    while (remaining > 0) {
+        size_t want = remaining < sizeof(buffer) ? (size_t)remaining : sizeof(buffer);
+        ssize_t n = pread(deb_fd, buffer, want, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        if (write_all(out_fd, buffer, (size_t)n) != 0) return -1;
+        offset += n;
+        remaining -= (unsigned long long)n;
+    }
+    if (member->size & 1) {
+        if (write_all(out_fd, "\n", 1) != 0) return -1;
+    }
+    return 0;
+}
+
+// --- Main Repack Function ---
+
+/**
+ * @brief Builds the destination path for a repacked archive.
+ * @param deb_path The source archive path.
+ * @param opts The repack options.
+ * @return A newly allocated path, or NULL on failure.
+ */
+static char *repack_destination(const char *deb_path, const upkg_repack_options_t *opts) {
+    if (opts->in_place) {
+        return strdup(deb_path);
+    }
+    if (!opts->output_dir) {
+        upkg_util_error("No output directory configured for repack.\n");
+        return NULL;
+    }
+    if (upkg_util_create_dir_recursive(opts->output_dir, 0755) != 0) {
+        upkg_util_error("Failed to create repack output directory '%s'.\n", opts->output_dir);
+        return NULL;
+    }
+
+    char *deb_copy = strdup(deb_path);
+    if (!deb_copy) {
+        upkg_util_error("Memory allocation failed for deb path copy.\n");
+        return NULL;
+    }
+    char *dest = upkg_util_concat_path(opts->output_dir, basename(deb_copy));
+    free(deb_copy);
+    return dest;
+}
+
+/**
+ * @brief Rewrites a .deb so its control and data members use another compression.
+ * @param deb_path The path to the .deb package file.
+ * @param opts The repack options.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_repack_deb(const char *deb_path, const upkg_repack_options_t *opts) {
+    if (!deb_path || !opts) {
+        upkg_util_error("repack_deb: NULL deb_path or options.\n");
+        return -1;
+    }
+
+    const compress_tool_t *dst_tool = find_compress_tool(opts->compress);
+    if (!dst_tool) {
+        upkg_util_error("Unknown target compression.\n");
+        return -1;
+    }
+    if (dst_tool->tool_path && access(dst_tool->tool_path, X_OK) != 0) {
+        upkg_util_error("%s is required to repack with %s compression.\n", dst_tool->tool_path, dst_tool->name);
+        return -1;
+    }
+
+    int deb_fd = open(deb_path, O_RDONLY | O_CLOEXEC);
+    if (deb_fd < 0) {
+        upkg_util_error("Failed to open '%s': %s\n", deb_path, strerror(errno));
+        return -1;
+    }
+
+    ar_member_t *members = NULL;
+    int member_count = 0;
+    if (read_ar_members(deb_fd, &members, &member_count) != 0) {
+        upkg_util_error("Failed to read archive members of '%s'.\n", deb_path);
+        close(deb_fd);
+        return -1;
+    }
+    if (member_count == 0 || strcmp(members[0].name, "debian-binary") != 0) {
+        upkg_util_error("'%s' is not a .deb package (debian-binary must come first).\n", deb_path);
+        free(members);
+        close(deb_fd);
+        return -1;
+    }
+
+    // Work out what has to change before writing anything.
+    bool needs_rewrite = false;
+    for (int i = 0; i < member_count; i++) {
+        const char *name = members[i].name;
+        upkg_compress_t src;
+        if ((strncmp(name, "control.tar", 11) == 0 && compress_from_suffix(name + 11, &src) == 0) ||
+            (strncmp(name, "data.tar", 8) == 0 && compress_from_suffix(name + 8, &src) == 0)) {
+            if (src != opts->compress || opts->frame_size > 0) {
+                needs_rewrite = true;
+            }
+        }
+    }
+    if (!needs_rewrite && opts->in_place) {
+        printf("%s already uses %s compression, skipping.\n", deb_path, dst_tool->name);
+        free(members);
+        close(deb_fd);
+        return 0;
+    }
+
+    char *dest_path = repack_destination(deb_path, opts);
+    if (!dest_path) {
+        free(members);
+        close(deb_fd);
+        return -1;
+    }
+
+    size_t tmp_len = strlen(dest_path) + 16;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        upkg_util_error("Memory allocation failed for temporary path.\n");
+        free(dest_path);
+        free(members);
+        close(deb_fd);
+        return -1;
+    }
+    snprintf(tmp_path, tmp_len, "%s.upkg-XXXXXX", dest_path);
+
+    int out_fd = mkostemp(tmp_path, O_CLOEXEC);
+    if (out_fd < 0) {
+        upkg_util_error("Failed to create temporary archive '%s': %s\n", tmp_path, strerror(errno));
+        free(tmp_path);
+        free(dest_path);
+        free(members);
+        close(deb_fd);
+        return -1;
+    }
+    fchmod(out_fd, 0644);
+
+    // A dying encoder must surface as EPIPE, not kill upkg.
+    void (*old_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    int ret = write_all(out_fd, AR_MAGIC, AR_MAGIC_LEN);
+    for (int i = 0; ret == 0 && i < member_count; i++) {
+        const ar_member_t *m = &members[i];
+        const char *prefix = NULL;
+        const char *suffix = NULL;
+        if (strncmp(m->name, "control.tar", 11) == 0) {
+            prefix = "control.tar";
+            suffix = m->name + 11;
+        } else if (strncmp(m->name, "data.tar", 8) == 0) {
+            prefix = "data.tar";
+            suffix = m->name + 8;
+        }
+
+        upkg_compress_t src;
+        if (!prefix || compress_from_suffix(suffix, &src) != 0 ||
+            (src == opts->compress && opts->frame_size == 0)) {
+            upkg_util_log_verbose("Copying member '%s' unchanged.\n", m->name);
+            ret = copy_member(deb_fd, m, out_fd);
+            continue;
+        }
+
+        const compress_tool_t *src_tool = find_compress_tool(src);
+        if (src_tool->tool_path && access(src_tool->tool_path, X_OK) != 0) {
+            upkg_util_error("%s is required to decode member '%s'.\n", src_tool->tool_path, m->name);
+            ret = -1;
+            break;
+        }
+
+        char new_name[17];
+        snprintf(new_name, sizeof(new_name), "%s%s", prefix, dst_tool->suffix);
+
+        off_t header_offset = lseek(out_fd, 0, SEEK_CUR);
+        if (header_offset < 0 || write_ar_header(out_fd, new_name, 0, m->header) != 0) {
+            ret = -1;
+            break;
+        }
+        off_t data_offset = header_offset + AR_HEADER_LEN;
+
+        uint8_t digest[UPKG_SHA256_DIGEST_LENGTH];
+        unsigned long long raw_size = 0;
+        int frame_count = 0;
+        upkg_util_log_verbose("Transcoding '%s' -> '%s'...\n", m->name, new_name);
+        if (transcode_member(deb_fd, m, src_tool, dst_tool, opts->frame_size, out_fd,
+                             digest, &raw_size, &frame_count) != 0) {
+            upkg_util_error("Failed to transcode member '%s'.\n", m->name);
+            ret = -1;
+            break;
+        }
+
+        off_t end_offset = lseek(out_fd, 0, SEEK_END);
+        if (end_offset < 0) {
+            ret = -1;
+            break;
+        }
+        unsigned long long new_size = (unsigned long long)(end_offset - data_offset);
+        if (patch_ar_size(out_fd, header_offset, new_size) != 0) {
+            upkg_util_error("Failed to finalize header of member '%s'.\n", new_name);
+            ret = -1;
+            break;
+        }
+        if ((new_size & 1) && write_all(out_fd, "\n", 1) != 0) {
+            ret = -1;
+            break;
+        }
+
+        if (verify_member(out_fd, data_offset, new_size, dst_tool, digest) != 0) {
+            upkg_util_error("Checksum mismatch after repacking '%s'; original left untouched.\n", m->name);
+            ret = -1;
+            break;
+        }
+
+        char hex[UPKG_SHA256_HEX_LENGTH];
+        upkg_digest_to_hex(digest, UPKG_SHA256_DIGEST_LENGTH, hex);
+        printf("  %-16s -> %-16s %llu -> %llu bytes (%llu raw, %d frame%s) sha256:%s\n",
+               m->name, new_name, m->size, new_size, raw_size, frame_count,
+               frame_count == 1 ? "" : "s", hex);
+    }
+
+    signal(SIGPIPE, old_sigpipe);
+
+    if (ret == 0 && fsync(out_fd) != 0) {
+        upkg_util_error("Failed to sync repacked archive: %s\n", strerror(errno));
+        ret = -1;
+    }
+    if (close(out_fd) != 0) {
+        ret = -1;
+    }
+    close(deb_fd);
+
+    if (ret == 0 && rename(tmp_path, dest_path) != 0) {
+        upkg_util_error("Failed to move repacked archive into place: %s\n", strerror(errno));
+        ret = -1;
+    }
+    if (ret != 0) {
+        unlink(tmp_path);
+    } else {
+        printf("Repacked %s -> %s (%s)\n", deb_path, dest_path, dst_tool->name);
+    }
+
+    free(tmp_path);
+    free(dest_path);
+    free(members);
+    return ret;
+}
+
+// --- Archive Walking ---
+
+#define TAR_BLOCK_SIZE 512
+#define WALK_NAME_MAX 65536               // Longest GNU long name or pax header accepted
+#define WALK_CONTROL_DATA_MAX (1 << 20)   // Larger control files are skipped, not read
+
+/**
+ * @brief Buffered reader over a decoded member stream.
+ */
+typedef struct {
+    int fd;
+    size_t pos;
+    size_t len;
+    char buffer[REPACK_BUFFER_SIZE];
+} stream_reader_t;
+
+/**
+ * @brief Reads or skips bytes from the stream.
+ * @param r The reader.
+ * @param dst Destination buffer, or NULL to discard the bytes.
+ * @param n The number of bytes.
+ * @return 0 on success, 1 on end of stream before the first byte, -1 on a
+ *         read error or a stream that ends part-way.
+ */
+static int reader_read(stream_reader_t *r, void *dst, unsigned long long n) {
+    char *out = (char *)dst;
+    bool started = false;
+    while (n > 0) {
+        if (r->pos == r->len) {
+            ssize_t got = read(r->fd, r->buffer, sizeof(r->buffer));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return (got == 0 && !started) ? 1 : -1;
+            r->pos = 0;
+            r->len = (size_t)got;
+        }
+        size_t take = r->len - r->pos;
+        if (take > n) take = (size_t)n;
+        if (out) {
+            memcpy(out, r->buffer + r->pos, take);
+            out += take;
+        }
+        r->pos += take;
+        n -= take;
+        started = true;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a numeric tar header field (octal, or base-256 when the high bit is set).
+ * @param field The field.
+ * @param len The field width.
+ * @return The value.
+ */
+static unsigned long long tar_number(const char *field, size_t len) {
+    const unsigned char *p = (const unsigned char *)field;
+    unsigned long long value = 0;
+    if (p[0] & 0x80) {
+        value = p[0] & 0x7f;
+        for (size_t i = 1; i < len; i++) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+    size_t i = 0;
+    while (i < len && (p[i] == ' ' || p[i] == '\0')) i++;
+    for (; i < len && p[i] >= '0' && p[i] <= '7'; i++) {
+        value = (value << 3) | (unsigned long long)(p[i] - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Checks a tar header's checksum.
+ * @param header The 512-byte header.
+ * @return true if it matches.
+ */
+static bool tar_checksum_ok(const char *header) {
+    const unsigned char *p = (const unsigned char *)header;
+    unsigned long long sum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : p[i];
+    }
+    return sum == tar_number(header + 148, 8);
+}
+
+/**
+ * @brief Picks "path" and "size" out of a pax extended header.
+ * @param records The header's "<len> key=value\n" records.
+ * @param len Length of records.
+ * @param path Output: the path override (replaced if present).
+ * @param size Output: the size override.
+ * @param have_size Output: set if a size was present.
+ * @return 0 on success, -1 on malformed records or allocation failure.
+ */
+static int parse_pax(const char *records, size_t len, char **path, unsigned long long *size, bool *have_size) {
+    size_t pos = 0;
+    while (pos < len) {
+        char *end;
+        unsigned long record_len = strtoul(records + pos, &end, 10);
+        if (end == records + pos || *end != ' ' || record_len == 0 || record_len > len - pos) return -1;
+        const char *key = end + 1;
+        const char *record_end = records + pos + record_len - 1;  // The trailing '\n'
+        const char *eq = memchr(key, '=', (size_t)(record_end - key));
+        if (!eq) return -1;
+
+        size_t key_len = (size_t)(eq - key);
+        if (key_len == 4 && memcmp(key, "path", 4) == 0) {
+            char *value = strndup(eq + 1, (size_t)(record_end - eq - 1));
+            if (!value) return -1;
+            free(*path);
+            *path = value;
+        } else if (key_len == 4 && memcmp(key, "size", 4) == 0) {
+            *size = strtoull(eq + 1, NULL, 10);
+            *have_size = true;
+        }
+        pos += record_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Walks the entries of one decoded tar stream.
+ * @param r The reader over the stream.
+ * @param part The member being walked.
+ * @param visit The entry callback.
+ * @param user Passed through to visit.
+ * @return 0 on success, -1 on failure.
+ */
+static int walk_tar(stream_reader_t *r, upkg_deb_part_t part, upkg_deb_entry_fn visit, void *user) {
+    char header[TAR_BLOCK_SIZE];
+    char name[TAR_BLOCK_SIZE];
+    char *long_name = NULL;
+    unsigned long long pax_size = 0;
+    bool have_pax_size = false;
+    int zero_blocks = 0;
+    int ret = 0;
+
+    for (;;) {
+        int got = reader_read(r, header, TAR_BLOCK_SIZE);
+        if (got == 1) break;  // Writers may omit the end-of-archive blocks
+        if (got != 0) {
+            upkg_util_error("Truncated tar stream.\n");
+            ret = -1;
+            break;
+        }
+
+        bool all_zero = true;
+        for (int i = 0; i < TAR_BLOCK_SIZE && all_zero; i++) {
+            all_zero = header[i] == '\0';
+        }
+        if (all_zero) {
+            if (++zero_blocks == 2) break;
+            continue;
+        }
+        zero_blocks = 0;
+        if (!tar_checksum_ok(header)) {
+            upkg_util_error("Corrupt tar header (bad checksum).\n");
+            ret = -1;
+            break;
+        }
+
+        unsigned long long size = tar_number(header + 124, 12);
+        unsigned long long padding = (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+        char type = header[156];
+
+        // GNU long names and pax headers describe the entry that follows
+        if (type == 'L' || type == 'x') {
+            if (size > WALK_NAME_MAX) {
+                upkg_util_error("Oversized tar extended header (%llu bytes).\n", size);
+                ret = -1;
+                break;
+            }
+            char *text = malloc((size_t)size + 1);
+            if (!text || reader_read(r, text, size) != 0 || reader_read(r, NULL, padding) != 0) {
+                upkg_util_error("Failed to read tar extended header.\n");
+                free(text);
+                ret = -1;
+                break;
+            }
+            text[size] = '\0';
+            if (type == 'L') {
+                free(long_name);
+                long_name = text;
+            } else {
+                ret = parse_pax(text, (size_t)size, &long_name, &pax_size, &have_pax_size);
+                free(text);
+                if (ret != 0) {
+                    upkg_util_error("Malformed pax header.\n");
+                    break;
+                }
+            }
+            continue;
+        }
+        if (type == 'g') {
+            if (reader_read(r, NULL, size + padding) != 0) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+
+        if (have_pax_size) {
+            size = pax_size;
+            padding = (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+        }
+        if (!long_name) {
+            // ustar splits long paths into prefix "/" name
+            if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+                snprintf(name, sizeof(name), "%.155s/%.100s", header + 345, header);
+            } else {
+                snprintf(name, sizeof(name), "%.100s", header);
+            }
+        }
+
+        upkg_deb_entry_t entry;
+        entry.part = part;
+        entry.path = long_name ? long_name : name;
+        entry.type = (type == '\0' || type == '7') ? '0' : type;
+        entry.size = size;
+        entry.data = NULL;
+
+        char *data = NULL;
+        unsigned long long consumed = 0;
+        if (part == UPKG_DEB_CONTROL && entry.type == '0' && size <= WALK_CONTROL_DATA_MAX) {
+            data = malloc((size_t)size + 1);
+            if (!data || reader_read(r, data, size) != 0) {
+                upkg_util_error("Failed to read control file '%s'.\n", entry.path);
+                free(data);
+                ret = -1;
+                break;
+            }
+            data[size] = '\0';
+            entry.data = data;
+            consumed = size;
+        }
+
+        ret = visit(&entry, user);
+        free(data);
+        free(long_name);
+        long_name = NULL;
+        have_pax_size = false;
+        if (ret != 0) break;
+
+        if (reader_read(r, NULL, size - consumed + padding) != 0) {
+            upkg_util_error("Truncated tar stream in '%s'.\n", entry.path);
+            ret = -1;
+            break;
+        }
+    }
+
+    free(long_name);
+    return ret;
+}
+
+/**
+ * @brief Walks the tar entries of a .deb's control and data members.
+ */
+int upkg_repack_walk_deb(const char *deb_path, upkg_deb_entry_fn visit, void *user) {
+    if (!deb_path || !visit) {
+        upkg_util_error("walk_deb: NULL deb_path or callback.\n");
+        return -1;
+    }
+
+    int deb_fd = open(deb_path, O_RDONLY | O_CLOEXEC);
+    if (deb_fd < 0) {
+        upkg_util_error("Failed to open '%s': %s\n", deb_path, strerror(errno));
+        return -1;
+    }
+
+    ar_member_t *members = NULL;
+    int member_count = 0;
+    if (read_ar_members(deb_fd, &members, &member_count) != 0) {
+        upkg_util_error("Failed to read archive members of '%s'.\n", deb_path);
+        close(deb_fd);
+        return -1;
+    }
+
+    stream_reader_t *reader = malloc(sizeof(*reader));
+    if (!reader) {
+        upkg_util_error("Failed to allocate tar reader.\n");
+        free(members);
+        close(deb_fd);
+        return -1;
+    }
+
+    int ret = 0;
+    for (int i = 0; i < member_count && ret == 0; i++) {
+        const char *name = members[i].name;
+        upkg_deb_part_t part;
+        upkg_compress_t compress;
+        if (strncmp(name, "control.tar", 11) == 0 && compress_from_suffix(name + 11, &compress) == 0) {
+            part = UPKG_DEB_CONTROL;
+        } else if (strncmp(name, "data.tar", 8) == 0 && compress_from_suffix(name + 8, &compress) == 0) {
+            part = UPKG_DEB_DATA;
+        } else {
+            continue;
+        }
+
+        const compress_tool_t *tool = find_compress_tool(compress);
+        if (tool->tool_path && access(tool->tool_path, X_OK) != 0) {
+            upkg_util_error("%s is required to read '%s'.\n", tool->tool_path, name);
+            ret = -1;
+            break;
+        }
+
+        int read_fd;
+        pid_t feeder_pid, decoder_pid;
+        if (open_decoded_range(deb_fd, members[i].data_offset, members[i].size, tool,
+                               &read_fd, &feeder_pid, &decoder_pid) != 0) {
+            ret = -1;
+            break;
+        }
+        reader->fd = read_fd;
+        reader->pos = reader->len = 0;
+        ret = walk_tar(reader, part, visit, user);
+        // Drain the record padding after the end blocks so the decoder exits cleanly
+        while (ret == 0) {
+            ssize_t n = read(read_fd, reader->buffer, sizeof(reader->buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+        }
+        if (close_decoded_range(read_fd, tool, feeder_pid, decoder_pid) != 0 && ret == 0) {
+            upkg_util_error("Failed to decode '%s' in '%s'.\n", name, deb_path);
+            ret = -1;
+        }
+    }
+
+    free(reader);
+    free(members);
+    close(deb_fd);
+    return ret;
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * Filename:    upkg_repack.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Recompression of .deb archives into faster-to-decode formats
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_REPACK_H
+#define UPKG_REPACK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// --- Compression Formats ---
+
+/**
+ * @brief Compression formats understood for control.tar.* and data.tar.* members.
+ */
+typedef enum {
+    UPKG_COMPRESS_NONE = 0,  // Plain .tar member
+    UPKG_COMPRESS_GZIP,
+    UPKG_COMPRESS_XZ,
+    UPKG_COMPRESS_ZSTD,
+    UPKG_COMPRESS_BZIP2,
+    UPKG_COMPRESS_LZMA
+} upkg_compress_t;
+
+/**
+ * @brief Options controlling a repack run.
+ */
+typedef struct {
+    upkg_compress_t compress;  // Target compression for the tar members
+    size_t frame_size;         // Uncompressed bytes per independent frame, 0 for a single frame
+    bool in_place;             // Replace the input .deb instead of writing to output_dir
+    const char *output_dir;    // Destination directory when not repacking in place
+} upkg_repack_options_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Looks up a compression format by name ("zstd", "xz", "gzip", "none").
+ * @param name The format name as given on the command line.
+ * @param compress Output parameter for the parsed format.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int upkg_repack_parse_compress(const char *name, upkg_compress_t *compress);
+
+/**
+ * @brief Returns the canonical file suffix for a compression format (e.g. ".zst").
+ * @param compress The compression format.
+ * @return A static string; empty for UPKG_COMPRESS_NONE.
+ */
+const char *upkg_repack_compress_suffix(upkg_compress_t compress);
+
+/**
+ * @brief Rewrites a .deb so its control and data members use another compression.
+ *
+ * Each tar member is streamed through its decompressor and the target
+ * compressor without touching disk in between. The uncompressed tar stream is
+ * hashed with SHA-256 on the way through, and the rewritten member is decoded
+ * again and must hash identically before the new archive replaces anything.
+ *
+ * @param deb_path The path to the .deb package file.
+ * @param opts The repack options.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_repack_deb(const char *deb_path, const upkg_repack_options_t *opts);
+
+// --- Archive Walking ---
+
+/**
+ * @brief The tar member of a .deb an entry belongs to.
+ */
+typedef enum {
+    UPKG_DEB_CONTROL,
+    UPKG_DEB_DATA
+} upkg_deb_part_t;
+
+/**
+ * @brief One tar entry of a .deb, as passed to a walk callback.
+ */
+typedef struct {
+    upkg_deb_part_t part;
+    const char *path;         // As stored in the archive, e.g. "./usr/bin/foo"
+    char type;                // tar typeflag: '0' file, '1' hard link, '2' symlink, '5' directory, ...
+    unsigned long long size;  // Payload bytes; 0 for links and directories
+    const char *data;         // Control member files only: the NUL-terminated contents, else NULL
+} upkg_deb_entry_t;
+
+/**
+ * @brief Receives the entries of a .deb in archive order.
+ * @param entry The entry; valid only for the duration of the call.
+ * @param user The caller's context pointer.
+ * @return 0 to continue, -1 to stop the walk with an error.
+ */
+typedef int (*upkg_deb_entry_fn)(const upkg_deb_entry_t *entry, void *user);
+
+/**
+ * @brief Reads the tar headers of a .deb's control and data members without
+ *        extracting anything. Payloads are decoded and skipped, except small
+ *        control files, which are handed to the callback in full.
+ * @param deb_path The path to the .deb package file.
+ * @param visit Called for every entry.
+ * @param user Passed through to visit.
+ * @return 0 on success, -1 on a malformed archive or if visit failed.
+ */
+int upkg_repack_walk_deb(const char *deb_path, upkg_deb_entry_fn visit, void *user);
+
+#endif // UPKG_REPACK_H
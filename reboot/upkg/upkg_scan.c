@@ -0,0 +1,383 @@
+/******************************************************************************
+ * Filename:    upkg_scan.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Parallel filesystem scanner for files no package owns
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "upkg_scan.h"
+#include "upkg_bloom.h"
+#include "upkg_db.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// --- Walk State ---
+
+/**
+ * @brief Raw record returned by getdents64(2).
+ */
+struct scan_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct scan_dir_node {
+    char *path;                    // Absolute directory path
+    struct scan_dir_node *next;
+} scan_dir_node_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    scan_dir_node_t *queue;        // Directories waiting to be read (LIFO keeps the frontier small)
+    int active;                    // Workers currently reading a directory
+    size_t root_len;               // Prefix stripped to make paths install-root relative
+    const upkg_bloom_t *bloom;
+    const upkg_index_t *owners;
+} scan_shared_t;
+
+typedef struct {
+    scan_shared_t *shared;
+    upkg_scan_result_t result;
+    char *buffer;
+} scan_worker_t;
+
+/**
+ * @brief Pushes a directory onto the shared work queue.
+ * @param shared The shared walk state.
+ * @param path The absolute directory path (ownership is taken).
+ */
+static void scan_push(scan_shared_t *shared, char *path) {
+    scan_dir_node_t *node = malloc(sizeof(scan_dir_node_t));
+    if (!node) {
+        upkg_util_error("Failed to queue directory '%s' for scanning.\n", path);
+        free(path);
+        return;
+    }
+    node->path = path;
+
+    pthread_mutex_lock(&shared->lock);
+    node->next = shared->queue;
+    shared->queue = node;
+    pthread_cond_signal(&shared->cond);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+/**
+ * @brief Appends an unowned file to a worker's private result.
+ * @param result The worker's result.
+ * @param path The install-root relative path.
+ * @param size The file size.
+ * @return 0 on success, -1 on failure.
+ */
+static int scan_add_entry(upkg_scan_result_t *result, const char *path, off_t size) {
+    if (result->count >= result->capacity) {
+        size_t capacity = result->capacity ? result->capacity * 2 : 64;
+        upkg_scan_entry_t *entries = realloc(result->entries, capacity * sizeof(upkg_scan_entry_t));
+        if (!entries) {
+            upkg_util_error("Failed to allocate memory for scan results.\n");
+            return -1;
+        }
+        result->entries = entries;
+        result->capacity = capacity;
+    }
+    result->entries[result->count].path = strdup(path);
+    if (!result->entries[result->count].path) return -1;
+    result->entries[result->count].size = size;
+    result->count++;
+    return 0;
+}
+
+/**
+ * @brief Reads one directory with getdents64, queueing subdirectories and
+ *        checking every file against the ownership filter and index.
+ * @param worker The calling worker.
+ * @param dir_path The absolute directory path.
+ */
+static void scan_directory(scan_worker_t *worker, const char *dir_path) {
+    scan_shared_t *shared = worker->shared;
+
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        upkg_util_log_verbose("Cannot open directory %s: %s\n", dir_path, strerror(errno));
+        return;
+    }
+
+    size_t dir_len = strlen(dir_path);
+    for (;;) {
+        long nread = syscall(SYS_getdents64, fd, worker->buffer, UPKG_SCAN_DIRENT_BUFFER);
+        if (nread <= 0) {
+            if (nread < 0) {
+                upkg_util_log_verbose("getdents64 failed on %s: %s\n", dir_path, strerror(errno));
+            }
+            break;
+        }
+
+        for (long pos = 0; pos < nread;) {
+            struct scan_dirent64 *d = (struct scan_dirent64 *)(worker->buffer + pos);
+            pos += d->d_reclen;
+
+            const char *name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = d->d_type;
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG
+                     : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+            }
+            if (type != DT_DIR && type != DT_REG && type != DT_LNK) {
+                continue; // Sockets, fifos and device nodes are never package payload
+            }
+
+            size_t name_len = strlen(name);
+            char *full_path = malloc(dir_len + name_len + 2);
+            if (!full_path) continue;
+            memcpy(full_path, dir_path, dir_len);
+            full_path[dir_len] = '/';
+            memcpy(full_path + dir_len + 1, name, name_len + 1);
+
+            if (type == DT_DIR) {
+                scan_push(shared, full_path);
+                continue;
+            }
+
+            worker->result.files_scanned++;
+            const char *relative = full_path + shared->root_len;
+            while (*relative == '/') relative++;
+
+            bool owned = false;
+            if (upkg_bloom_maybe_contains(shared->bloom, relative)) {
+                worker->result.bloom_hits++;
+                owned = upkg_index_find(shared->owners, relative) != NULL;
+            }
+            if (!owned) {
+                struct stat st;
+                off_t size = (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) ? st.st_size : 0;
+                scan_add_entry(&worker->result, relative, size);
+            }
+            free(full_path);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief Worker thread: drains the directory queue until every worker is idle.
+ * @param arg The worker's scan_worker_t.
+ * @return NULL.
+ */
+static void *scan_worker_main(void *arg) {
+    scan_worker_t *worker = arg;
+    scan_shared_t *shared = worker->shared;
+
+    for (;;) {
+        pthread_mutex_lock(&shared->lock);
+        while (!shared->queue && shared->active > 0) {
+            pthread_cond_wait(&shared->cond, &shared->lock);
+        }
+        if (!shared->queue) {
+            // Queue empty and nobody can add more: the walk is complete
+            pthread_cond_broadcast(&shared->cond);
+            pthread_mutex_unlock(&shared->lock);
+            return NULL;
+        }
+        scan_dir_node_t *node = shared->queue;
+        shared->queue = node->next;
+        shared->active++;
+        pthread_mutex_unlock(&shared->lock);
+
+        scan_directory(worker, node->path);
+        free(node->path);
+        free(node);
+
+        pthread_mutex_lock(&shared->lock);
+        shared->active--;
+        if (shared->active == 0 && !shared->queue) {
+            pthread_cond_broadcast(&shared->cond);
+        }
+        pthread_mutex_unlock(&shared->lock);
+    }
+}
+
+/**
+ * @brief Orders scan entries by path for stable output.
+ */
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const upkg_scan_entry_t *)a)->path, ((const upkg_scan_entry_t *)b)->path);
+}
+
+/**
+ * @brief Builds a Bloom filter over every key of the ownership index.
+ * @param owners The path ownership index.
+ * @return The filter, or NULL on failure.
+ */
+static upkg_bloom_t *build_owner_bloom(const upkg_index_t *owners) {
+    upkg_bloom_t *bloom = upkg_bloom_create(owners->count);
+    if (!bloom) return NULL;
+
+    for (size_t i = 0; i < owners->size; i++) {
+        for (const upkg_index_entry_t *e = owners->buckets[i]; e; e = e->next) {
+            upkg_bloom_add(bloom, e->key);
+        }
+    }
+    return bloom;
+}
+
+// --- Public Functions ---
+
+/**
+ * @brief Walks a directory tree in parallel and collects regular files and
+ *        symlinks that no installed package owns.
+ * @param dir The directory to scan, relative to the install root (e.g. "usr").
+ * @param root The install root.
+ * @param result Output; entries are sorted by path. Free with upkg_scan_free_result.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_scan_unowned(const char *dir, const char *root, upkg_scan_result_t *result) {
+    if (!dir || !root || !result) return -1;
+    memset(result, 0, sizeof(*result));
+
+    const upkg_index_t *owners = upkg_db_path_index();
+    if (!owners) return -1;
+    upkg_bloom_t *bloom = build_owner_bloom(owners);
+    if (!bloom) return -1;
+
+    while (*dir == '/') dir++;
+    char *start = (*dir != '\0') ? upkg_util_concat_path(root, dir) : strdup(root);
+    if (!start) {
+        upkg_bloom_destroy(bloom);
+        return -1;
+    }
+    size_t start_len = strlen(start);
+    while (start_len > 1 && start[start_len - 1] == '/') {
+        start[--start_len] = '\0';
+    }
+
+    scan_shared_t shared;
+    memset(&shared, 0, sizeof(shared));
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.cond, NULL);
+    shared.root_len = strlen(root);
+    shared.bloom = bloom;
+    shared.owners = owners;
+    scan_push(&shared, start);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_count = (cpus < 1) ? 1 : (cpus > UPKG_SCAN_MAX_THREADS) ? UPKG_SCAN_MAX_THREADS : (int)cpus;
+    scan_worker_t workers[UPKG_SCAN_MAX_THREADS];
+    pthread_t threads[UPKG_SCAN_MAX_THREADS];
+    int started = 0;
+    int ret = 0;
+
+    // Fewer threads than requested still complete the walk
+    for (int i = 0; i < thread_count; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].shared = &shared;
+        workers[i].buffer = malloc(UPKG_SCAN_DIRENT_BUFFER);
+        if (!workers[i].buffer) {
+            break;
+        }
+        if (pthread_create(&threads[i], NULL, scan_worker_main, &workers[i]) != 0) {
+            free(workers[i].buffer);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        upkg_util_error("Failed to start scanner threads.\n");
+        scan_dir_node_t *node = shared.queue;
+        while (node) {
+            scan_dir_node_t *next = node->next;
+            free(node->path);
+            free(node);
+            node = next;
+        }
+        ret = -1;
+    }
+    upkg_util_log_verbose("Scanning %s with %d threads\n", dir, started);
+
+    // Merge the per-thread results
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        upkg_scan_result_t *r = &workers[i].result;
+        result->files_scanned += r->files_scanned;
+        result->bloom_hits += r->bloom_hits;
+        if (result->count == 0) {
+            *result = (upkg_scan_result_t){ r->entries, r->count, r->capacity,
+                                            result->files_scanned, result->bloom_hits };
+        } else if (r->count > 0) {
+            upkg_scan_entry_t *entries = realloc(result->entries, (result->count + r->count) * sizeof(upkg_scan_entry_t));
+            if (entries) {
+                memcpy(entries + result->count, r->entries, r->count * sizeof(upkg_scan_entry_t));
+                result->entries = entries;
+                result->count += r->count;
+                result->capacity = result->count;
+            } else {
+                upkg_util_error("Failed to merge scan results.\n");
+                for (size_t e = 0; e < r->count; e++) free(r->entries[e].path);
+                ret = -1;
+            }
+            free(r->entries);
+        } else {
+            free(r->entries);
+        }
+        free(workers[i].buffer);
+    }
+
+    pthread_cond_destroy(&shared.cond);
+    pthread_mutex_destroy(&shared.lock);
+    upkg_bloom_destroy(bloom);
+
+    if (result->count > 1) {
+        qsort(result->entries, result->count, sizeof(upkg_scan_entry_t), compare_entries);
+    }
+    return ret;
+}
+
+/**
+ * @brief Frees the entries held by a scan result.
+ * @param result The result to clear.
+ */
+void upkg_scan_free_result(upkg_scan_result_t *result) {
+    if (!result) return;
+    for (size_t i = 0; i < result->count; i++) {
+        free(result->entries[i].path);
+    }
+    free(result->entries);
+    result->entries = NULL;
+    result->count = 0;
+    result->capacity = 0;
+}
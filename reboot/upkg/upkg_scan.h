@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Filename:    upkg_scan.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Parallel filesystem scanner for files no package owns
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef UPKG_SCAN_H
+#define UPKG_SCAN_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// --- Scanner Configuration ---
+#define UPKG_SCAN_MAX_THREADS 16
+#define UPKG_SCAN_DIRENT_BUFFER (64 * 1024)
+
+// --- Scan Result Structures ---
+typedef struct {
+    char *path;      // Relative to the install root
+    off_t size;
+} upkg_scan_entry_t;
+
+typedef struct {
+    upkg_scan_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    unsigned long long files_scanned;
+    unsigned long long bloom_hits;     // Paths the filter could not rule out
+} upkg_scan_result_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Walks a directory tree in parallel and collects regular files and
+ *        symlinks that no installed package owns.
+ *
+ * Each path is first tested against a Bloom filter built from the path
+ * ownership index; only filter hits are confirmed against the exact index,
+ * and only unowned files are stat()ed for their size.
+ *
+ * @param dir The directory to scan, relative to the install root (e.g. "usr").
+ * @param root The install root.
+ * @param result Output; entries are sorted by path. Free with upkg_scan_free_result.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_scan_unowned(const char *dir, const char *root, upkg_scan_result_t *result);
+
+/**
+ * @brief Frees the entries held by a scan result.
+ * @param result The result to clear.
+ */
+void upkg_scan_free_result(upkg_scan_result_t *result);
+
+#endif // UPKG_SCAN_H
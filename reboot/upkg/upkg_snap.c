@@ -0,0 +1,330 @@
+/******************************************************************************
+ * Filename:    upkg_snap.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Immutable package index snapshots for lock-free readers
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_snap.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+// --- Structures ---
+
+// A published copy of one package record, shared by every snapshot that
+// contains it and cached by the table node it was copied from
+struct upkg_snap_record {
+    upkg_hash_package_info_t data;
+    unsigned int refs;              // Writer side only
+};
+
+struct upkg_snap {
+    size_t count;
+    struct upkg_snap_record **records;   // Sorted by package name
+    struct upkg_snap_record **slots;     // Open addressing on the FNV-1a hash
+    size_t slot_mask;
+    unsigned int pins;                   // Atomic; iterators holding this snapshot
+    uint64_t retired_epoch;              // Epoch at which it was replaced
+    struct upkg_snap *next_retired;
+};
+
+// --- State ---
+
+static bool g_enabled = false;
+static upkg_snap_t *g_current = NULL;           // Atomic
+static upkg_snap_t *g_retired = NULL;           // Writer side only
+static uint64_t g_epoch = 1;                    // Atomic
+
+// Per reader slot: the epoch the reader entered at, or 0 outside a section
+static uint64_t g_reader_epoch[UPKG_SNAP_MAX_READERS];
+static int g_reader_claimed[UPKG_SNAP_MAX_READERS];
+
+static pthread_key_t g_slot_key;
+static pthread_once_t g_slot_key_once = PTHREAD_ONCE_INIT;
+static __thread int t_slot = -1;
+static __thread int t_depth = 0;
+static __thread const upkg_snap_t *t_snap = NULL;
+
+// --- Records ---
+
+/**
+ * @brief Drops one reference to a record, freeing it with the last one.
+ */
+void upkg_snap_release_record(struct upkg_snap_record *record) {
+    if (!record || --record->refs > 0) return;
+    upkg_hash_free_package_info(&record->data);
+    free(record);
+}
+
+/**
+ * @brief Orders records by package name.
+ */
+static int compare_records(const void *a, const void *b) {
+    const struct upkg_snap_record *ra = *(struct upkg_snap_record *const *)a;
+    const struct upkg_snap_record *rb = *(struct upkg_snap_record *const *)b;
+    return strcmp(ra->data.package_name, rb->data.package_name);
+}
+
+// --- Snapshots ---
+
+/**
+ * @brief Frees a snapshot and drops its record references.
+ */
+static void snap_free(upkg_snap_t *snap) {
+    if (!snap) return;
+    for (size_t i = 0; i < snap->count; i++) {
+        upkg_snap_release_record(snap->records[i]);
+    }
+    free(snap->records);
+    free(snap->slots);
+    free(snap);
+}
+
+/**
+ * @brief Builds a snapshot of a table, copying only records that changed
+ *        since they were last published.
+ * @return The snapshot, or NULL on allocation failure.
+ */
+static upkg_snap_t *snap_build(upkg_hash_table_t *table) {
+    upkg_snap_t *snap = calloc(1, sizeof(*snap));
+    if (!snap) return NULL;
+
+    size_t total = table ? table->count : 0;
+    size_t slots = 16;
+    while (slots < total * 2) slots <<= 1;
+    snap->records = calloc(total ? total : 1, sizeof(*snap->records));
+    snap->slots = calloc(slots, sizeof(*snap->slots));
+    snap->slot_mask = slots - 1;
+    if (!snap->records || !snap->slots) {
+        snap_free(snap);
+        return NULL;
+    }
+
+    for (size_t b = 0; table && b < table->size; b++) {
+        for (upkg_hash_node_t *node = table->buckets[b]; node; node = node->next) {
+            if (!node->data.package_name || snap->count >= total) continue;
+            if (!node->published) {
+                struct upkg_snap_record *record = calloc(1, sizeof(*record));
+                if (!record || upkg_hash_copy_package_info(&node->data, &record->data) != 0) {
+                    free(record);
+                    snap_free(snap);
+                    return NULL;
+                }
+                record->refs = 1;   // The node's cache
+                node->published = record;
+            }
+            node->published->refs++;
+            snap->records[snap->count++] = node->published;
+        }
+    }
+
+    qsort(snap->records, snap->count, sizeof(*snap->records), compare_records);
+    for (size_t i = 0; i < snap->count; i++) {
+        size_t s = upkg_hash_fnv1a(snap->records[i]->data.package_name) & snap->slot_mask;
+        while (snap->slots[s]) s = (s + 1) & snap->slot_mask;
+        snap->slots[s] = snap->records[i];
+    }
+    return snap;
+}
+
+/**
+ * @brief Frees retired snapshots that no reader section or pin can reach.
+ * @return The number of snapshots still waiting.
+ */
+static int snap_reclaim(void) {
+    // Readers that entered at or before a snapshot's retire epoch may hold it
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < UPKG_SNAP_MAX_READERS; i++) {
+        uint64_t e = __atomic_load_n(&g_reader_epoch[i], __ATOMIC_SEQ_CST);
+        if (e != 0 && e < oldest) oldest = e;
+    }
+
+    int waiting = 0;
+    upkg_snap_t **link = &g_retired;
+    while (*link) {
+        upkg_snap_t *snap = *link;
+        if (snap->retired_epoch < oldest && __atomic_load_n(&snap->pins, __ATOMIC_ACQUIRE) == 0) {
+            *link = snap->next_retired;
+            snap_free(snap);
+        } else {
+            link = &snap->next_retired;
+            waiting++;
+        }
+    }
+    return waiting;
+}
+
+/**
+ * @brief Swaps in a new current snapshot and retires the old one.
+ */
+static void snap_swap(upkg_snap_t *snap) {
+    upkg_snap_t *old = __atomic_exchange_n(&g_current, snap, __ATOMIC_SEQ_CST);
+    if (old) {
+        old->retired_epoch = __atomic_load_n(&g_epoch, __ATOMIC_SEQ_CST);
+        old->next_retired = g_retired;
+        g_retired = old;
+    }
+    __atomic_add_fetch(&g_epoch, 1, __ATOMIC_SEQ_CST);
+}
+
+// --- Writer Side ---
+
+/**
+ * @brief Turns publication on.
+ */
+void upkg_snap_enable(void) {
+    g_enabled = true;
+}
+
+/**
+ * @brief Publishes a snapshot of a table and reclaims unreachable ones.
+ */
+int upkg_snap_publish(upkg_hash_table_t *table) {
+    if (!g_enabled) return 0;
+
+    upkg_snap_t *snap = snap_build(table);
+    if (!snap) {
+        upkg_util_error("Failed to publish a package index snapshot; readers keep the previous one.\n");
+        return -1;
+    }
+    snap_swap(snap);
+    int waiting = snap_reclaim();
+    upkg_util_log_verbose("Published snapshot of %zu packages (%d older still in use).\n", snap->count, waiting);
+    return 0;
+}
+
+/**
+ * @brief Unpublishes, waits for readers and pins, and frees every snapshot.
+ */
+void upkg_snap_shutdown(void) {
+    if (!g_enabled && !g_retired && !__atomic_load_n(&g_current, __ATOMIC_SEQ_CST)) return;
+    snap_swap(NULL);
+    while (snap_reclaim() > 0) {
+        sched_yield();
+    }
+    g_enabled = false;
+}
+
+// --- Reader Side ---
+
+/**
+ * @brief Frees a thread's reader slot when the thread exits.
+ */
+static void release_slot(void *arg) {
+    int slot = (int)(intptr_t)arg - 1;
+    __atomic_store_n(&g_reader_epoch[slot], 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&g_reader_claimed[slot], 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Creates the key whose destructor frees reader slots.
+ */
+static void create_slot_key(void) {
+    pthread_key_create(&g_slot_key, release_slot);
+}
+
+/**
+ * @brief Claims a reader slot for the calling thread, waiting if all are taken.
+ */
+static int claim_slot(void) {
+    pthread_once(&g_slot_key_once, create_slot_key);
+    for (;;) {
+        for (int i = 0; i < UPKG_SNAP_MAX_READERS; i++) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&g_reader_claimed[i], &expected, 1, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                pthread_setspecific(g_slot_key, (void *)(intptr_t)(i + 1));
+                return i;
+            }
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Enters a read section and returns the current snapshot.
+ */
+const upkg_snap_t *upkg_snap_read_begin(void) {
+    if (t_depth++ > 0) return t_snap;
+    if (t_slot < 0) t_slot = claim_slot();
+
+    // Announce the epoch before loading the pointer: a writer that retires
+    // what we load sees us as active when it scans the slots
+    __atomic_store_n(&g_reader_epoch[t_slot], __atomic_load_n(&g_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    t_snap = __atomic_load_n(&g_current, __ATOMIC_SEQ_CST);
+    return t_snap;
+}
+
+/**
+ * @brief Leaves a read section.
+ */
+void upkg_snap_read_end(void) {
+    if (t_depth == 0 || --t_depth > 0) return;
+    t_snap = NULL;
+    __atomic_store_n(&g_reader_epoch[t_slot], 0, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Returns the current snapshot, pinned until upkg_snap_unpin.
+ */
+const upkg_snap_t *upkg_snap_pin(void) {
+    upkg_snap_t *snap = (upkg_snap_t *)upkg_snap_read_begin();
+    if (snap) __atomic_add_fetch(&snap->pins, 1, __ATOMIC_ACQ_REL);
+    upkg_snap_read_end();
+    return snap;
+}
+
+/**
+ * @brief Releases a pin.
+ */
+void upkg_snap_unpin(const upkg_snap_t *snap) {
+    if (snap) __atomic_sub_fetch(&((upkg_snap_t *)snap)->pins, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Looks up a package in a snapshot.
+ */
+const upkg_hash_package_info_t *upkg_snap_find(const upkg_snap_t *snap, const char *name) {
+    if (!snap || !name) return NULL;
+    size_t s = upkg_hash_fnv1a(name) & snap->slot_mask;
+    for (const struct upkg_snap_record *r; (r = snap->slots[s]) != NULL; s = (s + 1) & snap->slot_mask) {
+        if (strcmp(r->data.package_name, name) == 0) return &r->data;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of packages in a snapshot.
+ */
+size_t upkg_snap_count(const upkg_snap_t *snap) {
+    return snap ? snap->count : 0;
+}
+
+/**
+ * @brief Returns a snapshot's records in name order.
+ */
+const upkg_hash_package_info_t *upkg_snap_at(const upkg_snap_t *snap, size_t index) {
+    return snap && index < snap->count ? &snap->records[index]->data : NULL;
+}
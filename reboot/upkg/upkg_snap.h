@@ -0,0 +1,133 @@
+/******************************************************************************
+ * Filename:    upkg_snap.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Immutable package index snapshots for lock-free readers
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_SNAP_H
+#define UPKG_SNAP_H
+
+#include "upkg_hash.h"
+#include <stddef.h>
+
+/*
+ * upkg_main_hash_table is the writer's table: it is changed in place and
+ * resized under the database lock. Threads that query while another
+ * thread commits read a snapshot instead. A snapshot is an immutable copy
+ * of the table published with one atomic pointer swap at each commit, so
+ * readers never block and never see a half-applied change.
+ *
+ * Records are shared between successive snapshots; only packages changed
+ * since the last publication are copied. A replaced snapshot is freed once
+ * every reader that could still hold it has left its read section
+ * (epoch-based reclamation) and no iterator pins it.
+ *
+ * Publishing, reclaiming and table changes happen on the writer side
+ * (under the database lock or an exclusive libupkg call). Reading is
+ * allowed from any thread; at most UPKG_SNAP_MAX_READERS threads can be
+ * registered at once, and further threads wait for a slot.
+ */
+
+#define UPKG_SNAP_MAX_READERS 128
+
+typedef struct upkg_snap upkg_snap_t;
+
+// --- Writer Side ---
+
+/**
+ * @brief Turns publication on. Until called, upkg_snap_publish does
+ *        nothing, so single-threaded users (the CLI) pay no copying cost.
+ */
+void upkg_snap_enable(void);
+
+/**
+ * @brief Publishes a snapshot of a table and reclaims snapshots no reader
+ *        can still hold.
+ * @param table The writer's table, or NULL to publish an empty snapshot.
+ * @return 0 on success (or when publication is off), -1 on allocation failure;
+ *         the previous snapshot then stays current.
+ */
+int upkg_snap_publish(upkg_hash_table_t *table);
+
+/**
+ * @brief Drops a table node's cached snapshot record. upkg_hash calls this
+ *        whenever a node's record is replaced or freed.
+ * @param record The cached record, or NULL.
+ */
+void upkg_snap_release_record(struct upkg_snap_record *record);
+
+/**
+ * @brief Unpublishes the current snapshot, waits for readers and pins to
+ *        drain, frees every snapshot and turns publication off.
+ */
+void upkg_snap_shutdown(void);
+
+// --- Reader Side ---
+
+/**
+ * @brief Enters a read section and returns the current snapshot. Sections
+ *        nest per thread; nested calls return the same snapshot.
+ * @return The snapshot, or NULL if none is published. Valid until the
+ *         matching upkg_snap_read_end.
+ */
+const upkg_snap_t *upkg_snap_read_begin(void);
+
+/**
+ * @brief Leaves a read section.
+ */
+void upkg_snap_read_end(void);
+
+/**
+ * @brief Returns the current snapshot and keeps it alive until unpinned,
+ *        for readers that span calls or threads (e.g. iterators).
+ * @return The pinned snapshot, or NULL if none is published.
+ */
+const upkg_snap_t *upkg_snap_pin(void);
+
+/**
+ * @brief Releases a pin taken by upkg_snap_pin.
+ * @param snap The pinned snapshot, or NULL.
+ */
+void upkg_snap_unpin(const upkg_snap_t *snap);
+
+/**
+ * @brief Looks up a package in a snapshot.
+ * @param snap The snapshot.
+ * @param name The package name.
+ * @return The record, or NULL if the snapshot has no such package.
+ */
+const upkg_hash_package_info_t *upkg_snap_find(const upkg_snap_t *snap, const char *name);
+
+/**
+ * @brief Returns the number of packages in a snapshot.
+ * @param snap The snapshot, or NULL.
+ * @return The package count.
+ */
+size_t upkg_snap_count(const upkg_snap_t *snap);
+
+/**
+ * @brief Returns a snapshot's records in name order.
+ * @param snap The snapshot.
+ * @param index A position below upkg_snap_count.
+ * @return The record.
+ */
+const upkg_hash_package_info_t *upkg_snap_at(const upkg_snap_t *snap, size_t index);
+
+#endif // UPKG_SNAP_H
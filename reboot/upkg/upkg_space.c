@@ -0,0 +1,464 @@
+/******************************************************************************
+ * Filename:    upkg_space.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Free-space planning for install transactions
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#include "upkg_space.h"
+#include "upkg_config.h"
+#include "upkg_hash.h"
+#include "upkg_pack.h"
+#include "upkg_repack.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+// Define PATH_MAX if not defined
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// --- Mount Resolution ---
+
+/**
+ * @brief Finds the top directory of the filesystem holding a path.
+ * @param path An existing path.
+ * @param dev The path's device.
+ * @return A newly allocated path, or NULL on allocation failure.
+ */
+static char *find_mount_point(const char *path, dev_t dev) {
+    char *current = realpath(path, NULL);
+    if (!current) return strdup(path);
+
+    // Climb while the parent is still on the same device
+    char parent[PATH_MAX];
+    while (strcmp(current, "/") != 0) {
+        upkg_util_safe_strncpy(parent, current, sizeof(parent));
+        char *slash = strrchr(parent, '/');
+        if (!slash) break;
+        slash[slash == parent ? 1 : 0] = '\0';
+
+        struct stat st;
+        if (stat(parent, &st) != 0 || st.st_dev != dev) break;
+        strcpy(current, parent);
+    }
+    return current;
+}
+
+/**
+ * @brief Returns the plan's entry for a device, adding it on first use.
+ * @param plan The plan.
+ * @param dev The device.
+ * @param path An existing path on the device, for statvfs.
+ * @return The entry's index, or -1 on failure.
+ */
+static int mount_for_dev(upkg_space_plan_t *plan, dev_t dev, const char *path) {
+    for (int i = 0; i < plan->mount_count; i++) {
+        if (plan->mounts[i].dev == dev) return i;
+    }
+
+    struct statvfs vfs;
+    if (statvfs(path, &vfs) != 0) {
+        upkg_util_error("Cannot check free space on '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    upkg_space_mount_t *mounts = realloc(plan->mounts, (size_t)(plan->mount_count + 1) * sizeof(*mounts));
+    if (!mounts) {
+        upkg_util_error("Failed to allocate memory for the space plan.\n");
+        return -1;
+    }
+    plan->mounts = mounts;
+
+    upkg_space_mount_t *m = &mounts[plan->mount_count];
+    memset(m, 0, sizeof(*m));
+    m->dev = dev;
+    m->mount_point = find_mount_point(path, dev);
+    if (!m->mount_point) {
+        upkg_util_error("Failed to allocate memory for the space plan.\n");
+        return -1;
+    }
+    m->block_size = vfs.f_frsize ? vfs.f_frsize : vfs.f_bsize;
+    if (m->block_size == 0) m->block_size = 4096;
+    m->available = (unsigned long long)vfs.f_bavail * m->block_size;
+    m->counts_inodes = vfs.f_files != 0;
+    m->inodes_available = vfs.f_favail;
+    return plan->mount_count++;
+}
+
+/**
+ * @brief Finds the filesystem a path will be written to: that of its
+ *        nearest existing ancestor.
+ * @param plan The plan.
+ * @param dir The directory the path is created in.
+ * @return The mount's index, or -1 on failure.
+ */
+static int resolve_dir(upkg_space_plan_t *plan, const char *dir) {
+    // Archives list a directory's files together, so one entry of cache does most of the work
+    if (plan->last_dir && strcmp(plan->last_dir, dir) == 0) {
+        return plan->last_mount;
+    }
+
+    char probe[PATH_MAX];
+    upkg_util_safe_strncpy(probe, dir[0] ? dir : ".", sizeof(probe));
+    struct stat st;
+    while (stat(probe, &st) != 0) {
+        char *slash = strrchr(probe, '/');
+        if (!slash) {
+            strcpy(probe, ".");
+        } else if (slash == probe) {
+            probe[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+        if (strcmp(probe, ".") == 0 || strcmp(probe, "/") == 0) {
+            if (stat(probe, &st) != 0) {
+                upkg_util_error("Cannot stat '%s': %s\n", probe, strerror(errno));
+                return -1;
+            }
+            break;
+        }
+    }
+
+    int mount = mount_for_dev(plan, st.st_dev, probe);
+    if (mount >= 0) {
+        char *copy = strdup(dir);
+        if (copy) {
+            free(plan->last_dir);
+            plan->last_dir = copy;
+            plan->last_mount = mount;
+        }
+    }
+    return mount;
+}
+
+/**
+ * @brief Charges bytes and inodes to a mount, rounding bytes up to whole blocks.
+ * @param m The mount.
+ * @param bytes The payload size.
+ * @param inodes The number of inodes.
+ */
+static void charge(upkg_space_mount_t *m, unsigned long long bytes, unsigned long long inodes) {
+    m->needed += (bytes + m->block_size - 1) / m->block_size * m->block_size;
+    m->inodes_needed += inodes;
+}
+
+/**
+ * @brief Credits an existing file that the transaction replaces or deletes.
+ *        Each path is credited once per plan.
+ * @param plan The plan.
+ * @param path The file's full path.
+ * @return 0 on success, -1 on failure.
+ */
+static int credit_path(upkg_space_plan_t *plan, const char *path) {
+    struct stat st;
+    if (lstat(path, &st) != 0 || S_ISDIR(st.st_mode)) return 0;
+    if (upkg_index_find(plan->credited, path)) return 0;
+
+    char dir[PATH_MAX];
+    upkg_util_safe_strncpy(dir, path, sizeof(dir));
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = '\0';
+    int mount = mount_for_dev(plan, st.st_dev, slash ? (dir[0] ? dir : "/") : ".");
+    if (mount < 0) return -1;
+    if (upkg_index_insert(plan->credited, path, "") != 0) return -1;
+
+    // Space held by other hard links stays in use
+    if (st.st_nlink <= 1) {
+        plan->mounts[mount].freed += (unsigned long long)st.st_blocks * 512;
+        plan->mounts[mount].inodes_freed++;
+    }
+    return 0;
+}
+
+// --- Plan Building ---
+
+typedef struct {
+    upkg_space_plan_t *plan;
+    int cache_mount;          // control_dir's mount, or -1 when an earlier extraction is reused
+    char path[PATH_MAX];
+} install_walk_t;
+
+/**
+ * @brief Charges one archive entry to the install root and the extraction cache.
+ */
+static int visit_entry(const upkg_deb_entry_t *entry, void *user) {
+    install_walk_t *walk = (install_walk_t *)user;
+    upkg_space_plan_t *plan = walk->plan;
+    unsigned long long inodes = entry->type == '1' ? 0 : 1;
+
+    if (walk->cache_mount >= 0) {
+        charge(&plan->mounts[walk->cache_mount], entry->type == '0' ? entry->size : 0, inodes);
+    }
+    if (entry->part != UPKG_DEB_DATA || inodes == 0) return 0;
+
+    const char *rel = entry->path;
+    while (rel[0] == '.' && rel[1] == '/') rel += 2;
+    while (*rel == '/') rel++;
+    if (*rel == '\0' || strcmp(rel, ".") == 0) return 0;
+
+    int len = snprintf(walk->path, sizeof(walk->path), "%s/%s", g_system_install_root, rel);
+    if (len < 0 || (size_t)len >= sizeof(walk->path)) {
+        upkg_util_error("Path too long in package: %s\n", rel);
+        return -1;
+    }
+    while (len > 1 && walk->path[len - 1] == '/') walk->path[--len] = '\0';
+
+    struct stat st;
+    if (entry->type == '5') {
+        if (stat(walk->path, &st) == 0) return 0;  // Already there
+    } else if (credit_path(plan, walk->path) != 0) {
+        return -1;
+    }
+
+    char *slash = strrchr(walk->path, '/');
+    *slash = '\0';
+    int mount = resolve_dir(plan, walk->path);
+    *slash = '/';
+    if (mount < 0) return -1;
+
+    if (entry->type == '5') {
+        charge(&plan->mounts[mount], 1, 1);
+    } else {
+        charge(&plan->mounts[mount], entry->type == '0' ? entry->size : 0, 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Initializes an empty plan.
+ */
+void upkg_space_init(upkg_space_plan_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->last_mount = -1;
+}
+
+/**
+ * @brief Starts charging a .deb: sets up the walk state and charges the
+ *        raw members to the extraction cache.
+ * @param plan The plan.
+ * @param deb_path The package file.
+ * @return The walk state (free it), or NULL on failure.
+ */
+static install_walk_t *begin_install(upkg_space_plan_t *plan, const char *deb_path) {
+    if (!plan || !deb_path || !g_system_install_root || !g_control_dir) {
+        upkg_util_error("space_add_install: NULL parameter or missing configuration.\n");
+        return NULL;
+    }
+    if (!plan->credited) {
+        plan->credited = upkg_index_create(1024);
+        if (!plan->credited) return NULL;
+    }
+
+    struct stat deb_st;
+    if (stat(deb_path, &deb_st) != 0) {
+        upkg_util_error("Cannot stat '%s': %s\n", deb_path, strerror(errno));
+        return NULL;
+    }
+
+    install_walk_t *walk = malloc(sizeof(*walk));
+    if (!walk) {
+        upkg_util_error("Failed to allocate memory for the space plan.\n");
+        return NULL;
+    }
+    walk->plan = plan;
+    walk->cache_mount = -1;
+
+    // The extraction cache keeps the raw members and both unpacked trees
+    char *extract_dir = upkg_pack_create_extraction_path(g_control_dir, deb_path);
+    if (!extract_dir) {
+        free(walk);
+        return NULL;
+    }
+    if (!upkg_util_file_exists(extract_dir)) {
+        walk->cache_mount = resolve_dir(plan, g_control_dir);
+        if (walk->cache_mount < 0) {
+            free(extract_dir);
+            free(walk);
+            return NULL;
+        }
+        charge(&plan->mounts[walk->cache_mount], (unsigned long long)deb_st.st_size, 8);
+    }
+    free(extract_dir);
+    return walk;
+}
+
+/**
+ * @brief Adds a .deb install to the plan.
+ */
+int upkg_space_add_install(upkg_space_plan_t *plan, const char *deb_path) {
+    install_walk_t *walk = begin_install(plan, deb_path);
+    if (!walk) return -1;
+
+    int ret = upkg_repack_walk_deb(deb_path, visit_entry, walk);
+    if (ret != 0) {
+        upkg_util_error("Failed to read the contents of '%s'.\n", deb_path);
+    }
+    free(walk);
+    return ret;
+}
+
+/**
+ * @brief Adds a .deb install from entries already read.
+ */
+int upkg_space_add_entries(upkg_space_plan_t *plan, const char *deb_path, const upkg_deb_entry_t *entries, int count) {
+    install_walk_t *walk = begin_install(plan, deb_path);
+    if (!walk) return -1;
+
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++) {
+        ret = visit_entry(&entries[i], walk);
+    }
+    free(walk);
+    return ret;
+}
+
+/**
+ * @brief Credits the files of a package the transaction removes.
+ */
+int upkg_space_add_removal(upkg_space_plan_t *plan, const char *package_name) {
+    if (!plan || !package_name || !g_system_install_root) return -1;
+    const upkg_hash_package_info_t *pkg = upkg_hash_search(upkg_main_hash_table, package_name);
+    if (!pkg) return 0;
+    if (!plan->credited) {
+        plan->credited = upkg_index_create(1024);
+        if (!plan->credited) return -1;
+    }
+
+    char path[PATH_MAX];
+    for (int i = 0; i < pkg->file_count; i++) {
+        int len = snprintf(path, sizeof(path), "%s/%s", g_system_install_root, pkg->file_list[i]);
+        if (len < 0 || (size_t)len >= sizeof(path)) continue;
+        if (credit_path(plan, path) != 0) return -1;
+    }
+    return 0;
+}
+
+// --- Checking ---
+
+/**
+ * @brief Formats a byte count with a binary unit.
+ * @param bytes The count.
+ * @param buf Output buffer.
+ * @param len Size of buf.
+ * @return buf.
+ */
+static const char *format_size(unsigned long long bytes, char *buf, size_t len) {
+    static const char *const units[] = { "KiB", "MiB", "GiB", "TiB" };
+    if (bytes < 1024) {
+        snprintf(buf, len, "%llu B", bytes);
+        return buf;
+    }
+    double value = (double)bytes / 1024.0;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024.0;
+        unit++;
+    }
+    snprintf(buf, len, "%.1f %s", value, units[unit]);
+    return buf;
+}
+
+/**
+ * @brief Checks the plan against each filesystem's free space.
+ */
+int upkg_space_check(const upkg_space_plan_t *plan) {
+    if (!plan) return -1;
+
+    char *table = NULL;
+    size_t table_len = 0;
+    FILE *out = open_memstream(&table, &table_len);
+    if (!out) {
+        upkg_util_error("Failed to allocate memory for the space report.\n");
+        return -1;
+    }
+
+    int width = 11;
+    for (int i = 0; i < plan->mount_count; i++) {
+        int len = (int)strlen(plan->mounts[i].mount_point);
+        if (len > width) width = len;
+    }
+
+    int short_mounts = 0;
+    fprintf(out, "  %-*s %11s %11s %11s %11s\n", width, "Mount point", "Needed", "Freed", "Available", "Short");
+    for (int i = 0; i < plan->mount_count; i++) {
+        const upkg_space_mount_t *m = &plan->mounts[i];
+        unsigned long long net = m->needed > m->freed ? m->needed - m->freed : 0;
+        unsigned long long net_inodes = m->inodes_needed > m->inodes_freed ? m->inodes_needed - m->inodes_freed : 0;
+        bool bytes_short = net > m->available;
+        bool inodes_short = m->counts_inodes && net_inodes > m->inodes_available;
+
+        char needed[16], freed[16], available[16], shortfall[16];
+        fprintf(out, "  %-*s %11s %11s %11s %11s\n", width, m->mount_point,
+                format_size(m->needed, needed, sizeof(needed)),
+                format_size(m->freed, freed, sizeof(freed)),
+                format_size(m->available, available, sizeof(available)),
+                bytes_short ? format_size(net - m->available, shortfall, sizeof(shortfall)) : "-");
+        if (inodes_short) {
+            fprintf(out, "  %-*s needs %llu inodes, %llu available\n", width, "", net_inodes, m->inodes_available);
+        }
+        if (bytes_short || inodes_short) short_mounts++;
+    }
+    fclose(out);
+
+    if (short_mounts > 0) {
+        upkg_util_error("Not enough free space on %d filesystem%s; nothing was installed.\n%s",
+                        short_mounts, short_mounts == 1 ? "" : "s", table);
+    } else {
+        upkg_util_log_verbose("Free space check passed:\n%s", table);
+    }
+    free(table);
+    return short_mounts > 0 ? 1 : 0;
+}
+
+/**
+ * @brief Frees a plan.
+ */
+void upkg_space_free(upkg_space_plan_t *plan) {
+    if (!plan) return;
+    for (int i = 0; i < plan->mount_count; i++) {
+        free(plan->mounts[i].mount_point);
+    }
+    free(plan->mounts);
+    if (plan->credited) upkg_index_destroy(plan->credited);
+    free(plan->last_dir);
+    memset(plan, 0, sizeof(*plan));
+}
+
+/**
+ * @brief Plans and checks a group of .deb installs.
+ */
+int upkg_space_check_installs(const char *const *deb_paths, int count) {
+    upkg_space_plan_t plan;
+    upkg_space_init(&plan);
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++) {
+        ret = upkg_space_add_install(&plan, deb_paths[i]);
+    }
+    if (ret == 0) {
+        ret = upkg_space_check(&plan);
+    }
+    upkg_space_free(&plan);
+    return ret;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * Filename:    upkg_space.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Free-space planning for install transactions
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_SPACE_H
+#define UPKG_SPACE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "upkg_index.h"
+#include "upkg_repack.h"
+
+/*
+ * An install transaction is sized from the tar headers of its packages
+ * (upkg_repack_walk_deb) before anything is extracted. Every payload file
+ * is charged, rounded up to the block size, to the filesystem its path
+ * lands on under the install root; the extraction cache in control_dir is
+ * charged for the whole package unless an earlier extraction of the same
+ * .deb is there to be overwritten. Files of installed packages that the
+ * transaction overwrites, and every file of a package it removes, are
+ * credited back. upkg_space_check then compares each filesystem's net need
+ * with statvfs.
+ *
+ * Files a new version no longer ships are deleted only after its payload is
+ * in place, so they are not credited: the check covers the peak, not the
+ * final usage. Each new directory is charged one block.
+ */
+
+// --- Plan Structures ---
+
+typedef struct {
+    dev_t dev;
+    char *mount_point;                   // Top directory of the filesystem
+    unsigned long block_size;            // f_frsize
+    unsigned long long needed;           // Bytes the transaction writes here
+    unsigned long long freed;            // Bytes released by replaced or removed packages
+    unsigned long long available;        // f_bavail * f_frsize
+    unsigned long long inodes_needed;
+    unsigned long long inodes_freed;
+    unsigned long long inodes_available; // f_favail
+    bool counts_inodes;                  // False where statvfs reports no inode limit
+} upkg_space_mount_t;
+
+typedef struct {
+    upkg_space_mount_t *mounts;
+    int mount_count;
+    upkg_index_t *credited;              // Existing paths already credited as freed
+    char *last_dir;                      // Most recently resolved directory and its mount
+    int last_mount;
+} upkg_space_plan_t;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Initializes an empty plan.
+ * @param plan The plan.
+ */
+void upkg_space_init(upkg_space_plan_t *plan);
+
+/**
+ * @brief Adds the space a .deb needs, and what replacing its installed
+ *        version frees, to the plan.
+ * @param plan The plan.
+ * @param deb_path The package file.
+ * @return 0 on success, -1 if the package could not be read.
+ */
+int upkg_space_add_install(upkg_space_plan_t *plan, const char *deb_path);
+
+/**
+ * @brief Adds a .deb install from entries already read with
+ *        upkg_repack_walk_deb, so the archive is not decoded again.
+ * @param plan The plan.
+ * @param deb_path The package file.
+ * @param entries Its entries, in archive order.
+ * @param count The number of entries.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_space_add_entries(upkg_space_plan_t *plan, const char *deb_path, const upkg_deb_entry_t *entries, int count);
+
+/**
+ * @brief Credits the files of an installed package the transaction removes.
+ * @param plan The plan.
+ * @param package_name The package; ignored if not installed.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int upkg_space_add_removal(upkg_space_plan_t *plan, const char *package_name);
+
+/**
+ * @brief Checks that every filesystem the plan touches has room for it.
+ *        A shortfall is reported with a per-mount breakdown.
+ * @param plan The plan.
+ * @return 0 if the transaction fits, 1 if it does not, -1 on failure.
+ */
+int upkg_space_check(const upkg_space_plan_t *plan);
+
+/**
+ * @brief Frees a plan.
+ * @param plan The plan.
+ */
+void upkg_space_free(upkg_space_plan_t *plan);
+
+/**
+ * @brief Plans and checks a group of .deb installs in one call.
+ * @param deb_paths The package files.
+ * @param count The number of packages.
+ * @return 0 if they fit, 1 if they do not, -1 if a package could not be sized.
+ */
+int upkg_space_check_installs(const char *const *deb_paths, int count);
+
+#endif // UPKG_SPACE_H
@@ -0,0 +1,276 @@
+/******************************************************************************
+ * Filename:    upkg_store.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Storage backend registry and the shared record encoding
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+// Control fields in encoding order
+static const size_t encoded_fields[] = {
+    offsetof(upkg_hash_package_info_t, package_name),
+    offsetof(upkg_hash_package_info_t, version),
+    offsetof(upkg_hash_package_info_t, architecture),
+    offsetof(upkg_hash_package_info_t, maintainer),
+    offsetof(upkg_hash_package_info_t, description),
+    offsetof(upkg_hash_package_info_t, depends),
+    offsetof(upkg_hash_package_info_t, installed_size),
+    offsetof(upkg_hash_package_info_t, section),
+    offsetof(upkg_hash_package_info_t, priority),
+    offsetof(upkg_hash_package_info_t, homepage),
+    offsetof(upkg_hash_package_info_t, filename)
+};
+
+#define ENCODED_FIELD_COUNT (sizeof(encoded_fields) / sizeof(encoded_fields[0]))
+#define NULL_STRING_LENGTH UINT32_MAX
+
+static const upkg_store_backend_t *const backends[] = {
+    &upkg_store_dir_backend,
+    &upkg_store_mmap_backend,
+    &upkg_store_btree_backend,
+    NULL
+};
+
+// --- Registry ---
+
+/**
+ * @brief Looks up a backend by name.
+ */
+const upkg_store_backend_t *upkg_store_backend(const char *name) {
+    for (size_t i = 0; name && backends[i]; i++) {
+        if (strcmp(backends[i]->name, name) == 0) return backends[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the NULL-terminated list of all backends.
+ */
+const upkg_store_backend_t *const *upkg_store_backends(void) {
+    return backends;
+}
+
+// --- Dispatch ---
+
+/**
+ * @brief Opens (creating if needed) a store under a directory.
+ */
+upkg_store_t *upkg_store_open(const upkg_store_backend_t *backend, const char *dir) {
+    if (!backend || !dir) return NULL;
+    upkg_store_t *store = backend->open(dir);
+    if (store) store->backend = backend;
+    return store;
+}
+
+/**
+ * @brief Reads one record.
+ */
+int upkg_store_get(upkg_store_t *store, const char *name, upkg_hash_package_info_t *pkg) {
+    memset(pkg, 0, sizeof(*pkg));
+    if (!upkg_store_valid_name(name)) return 1;
+    return store->backend->get(store, name, pkg);
+}
+
+/**
+ * @brief Adds or replaces a record.
+ */
+int upkg_store_put(upkg_store_t *store, const upkg_hash_package_info_t *pkg) {
+    if (!pkg || !upkg_store_valid_name(pkg->package_name)) return -1;
+    return store->backend->put(store, pkg);
+}
+
+/**
+ * @brief Deletes a record.
+ */
+int upkg_store_delete(upkg_store_t *store, const char *name) {
+    if (!upkg_store_valid_name(name)) return -1;
+    return store->backend->del(store, name);
+}
+
+/**
+ * @brief Visits every record.
+ */
+int upkg_store_iterate(upkg_store_t *store, upkg_store_visit_fn visit, void *user) {
+    return store->backend->iterate(store, visit, user);
+}
+
+/**
+ * @brief Makes buffered changes durable.
+ */
+int upkg_store_commit(upkg_store_t *store) {
+    return store->backend->commit(store);
+}
+
+/**
+ * @brief Closes a store.
+ */
+void upkg_store_close(upkg_store_t *store) {
+    if (store) store->backend->close(store);
+}
+
+/**
+ * @brief Checks that a package name is usable as a record key.
+ */
+bool upkg_store_valid_name(const char *name) {
+    return name && name[0] != '\0' && name[0] != '.' && strchr(name, '/') == NULL;
+}
+
+// --- Record Encoding ---
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} encode_buf_t;
+
+/**
+ * @brief Appends bytes, growing the buffer; remembers allocation failure.
+ */
+static void encode_bytes(encode_buf_t *buf, const void *data, size_t len) {
+    if (buf->failed) return;
+    if (buf->len + len > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 256;
+        while (cap < buf->len + len) cap *= 2;
+        uint8_t *grown = realloc(buf->data, cap);
+        if (!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+/**
+ * @brief Appends a little-endian u32.
+ */
+static void encode_u32(encode_buf_t *buf, uint32_t v) {
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    encode_bytes(buf, b, sizeof(b));
+}
+
+/**
+ * @brief Appends a length-prefixed string; NULL is encoded distinctly from "".
+ */
+static void encode_string(encode_buf_t *buf, const char *s) {
+    if (!s) {
+        encode_u32(buf, NULL_STRING_LENGTH);
+        return;
+    }
+    size_t len = strlen(s);
+    encode_u32(buf, (uint32_t)len);
+    encode_bytes(buf, s, len);
+}
+
+/**
+ * @brief Appends a counted string list.
+ */
+static void encode_list(encode_buf_t *buf, char *const *list, int count) {
+    encode_u32(buf, (uint32_t)(count > 0 ? count : 0));
+    for (int i = 0; i < count; i++) encode_string(buf, list[i]);
+}
+
+/**
+ * @brief Serializes a record.
+ */
+int upkg_store_encode(const upkg_hash_package_info_t *pkg, uint8_t **out, size_t *len) {
+    encode_buf_t buf = { 0 };
+    for (size_t i = 0; i < ENCODED_FIELD_COUNT; i++) {
+        encode_string(&buf, *(char *const *)((const char *)pkg + encoded_fields[i]));
+    }
+    encode_list(&buf, pkg->file_list, pkg->file_count);
+    encode_list(&buf, pkg->provided_sonames, pkg->provided_soname_count);
+    encode_list(&buf, pkg->needed_sonames, pkg->needed_soname_count);
+    encode_list(&buf, pkg->dir_list, pkg->dir_count);
+    if (buf.failed) {
+        free(buf.data);
+        return -1;
+    }
+    *out = buf.data;
+    *len = buf.len;
+    return 0;
+}
+
+/**
+ * @brief Reads a length-prefixed string.
+ * @return 0 on success, -1 if truncated or out of memory.
+ */
+static int decode_string(const uint8_t **p, const uint8_t *end, char **out) {
+    *out = NULL;
+    if (end - *p < 4) return -1;
+    uint32_t len = (uint32_t)(*p)[0] | (uint32_t)(*p)[1] << 8 | (uint32_t)(*p)[2] << 16 | (uint32_t)(*p)[3] << 24;
+    *p += 4;
+    if (len == NULL_STRING_LENGTH) return 0;
+    if ((size_t)(end - *p) < len) return -1;
+    *out = strndup((const char *)*p, len);
+    *p += len;
+    return *out ? 0 : -1;
+}
+
+/**
+ * @brief Reads a counted string list.
+ */
+static int decode_list(const uint8_t **p, const uint8_t *end, char ***list, int *count) {
+    *list = NULL;
+    *count = 0;
+    if (end - *p < 4) return -1;
+    uint32_t n = (uint32_t)(*p)[0] | (uint32_t)(*p)[1] << 8 | (uint32_t)(*p)[2] << 16 | (uint32_t)(*p)[3] << 24;
+    *p += 4;
+    if (n == 0) return 0;
+    if (n > (size_t)(end - *p) / 4) return -1;   // Each entry takes at least its length
+    *list = calloc(n, sizeof(char *));
+    if (!*list) return -1;
+    for (uint32_t i = 0; i < n; i++) {
+        if (decode_string(p, end, &(*list)[i]) != 0 || !(*list)[i]) {
+            *count = (int)i + 1;
+            return -1;
+        }
+    }
+    *count = (int)n;
+    return 0;
+}
+
+/**
+ * @brief Parses a record written by upkg_store_encode.
+ */
+int upkg_store_decode(const uint8_t *data, size_t len, upkg_hash_package_info_t *pkg) {
+    memset(pkg, 0, sizeof(*pkg));
+    const uint8_t *p = data, *end = data + len;
+    int ret = 0;
+    for (size_t i = 0; i < ENCODED_FIELD_COUNT && ret == 0; i++) {
+        ret = decode_string(&p, end, (char **)((char *)pkg + encoded_fields[i]));
+    }
+    if (ret == 0) ret = decode_list(&p, end, &pkg->file_list, &pkg->file_count);
+    if (ret == 0) ret = decode_list(&p, end, &pkg->provided_sonames, &pkg->provided_soname_count);
+    if (ret == 0) ret = decode_list(&p, end, &pkg->needed_sonames, &pkg->needed_soname_count);
+    if (ret == 0) ret = decode_list(&p, end, &pkg->dir_list, &pkg->dir_count);
+    if (ret != 0 || !pkg->package_name) {
+        upkg_hash_free_package_info(pkg);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/******************************************************************************
+ * Filename:    upkg_store.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Pluggable storage backends for package records
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_STORE_H
+#define UPKG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "upkg_hash.h"
+
+/*
+ * A storage backend keeps package records (upkg_hash_package_info_t) under
+ * a directory, keyed by package name. Backends are a table of functions:
+ *
+ *   "dir"    one directory of text files per package; the format upkg_db
+ *            has always used, and the one generations and manifests assume
+ *   "mmap"   one image file sorted by name and mmap()ed on open; lookups
+ *            binary-search it, changes are buffered and rewrite it on commit
+ *   "btree"  an embedded copy-on-write B+tree in one file; a commit appends
+ *            only the changed pages and then switches the root
+ *
+ * put and delete may be buffered until commit; get and iterate always see
+ * uncommitted changes. iterate visits packages in no particular order.
+ * make bench compares them at 100, 10k and 100k packages.
+ */
+
+typedef struct upkg_store upkg_store_t;
+
+// Called once per record; return nonzero to stop iterating
+typedef int (*upkg_store_visit_fn)(const upkg_hash_package_info_t *pkg, void *user);
+
+// --- Backend Table ---
+typedef struct {
+    const char *name;
+    upkg_store_t *(*open)(const char *dir);
+    int (*get)(upkg_store_t *store, const char *name, upkg_hash_package_info_t *pkg);
+    int (*put)(upkg_store_t *store, const upkg_hash_package_info_t *pkg);
+    int (*del)(upkg_store_t *store, const char *name);
+    int (*iterate)(upkg_store_t *store, upkg_store_visit_fn visit, void *user);
+    int (*commit)(upkg_store_t *store);
+    void (*close)(upkg_store_t *store);
+} upkg_store_backend_t;
+
+// Every backend's store struct starts with this
+struct upkg_store {
+    const upkg_store_backend_t *backend;
+};
+
+extern const upkg_store_backend_t upkg_store_dir_backend;
+extern const upkg_store_backend_t upkg_store_mmap_backend;
+extern const upkg_store_backend_t upkg_store_btree_backend;
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Looks up a backend by name.
+ * @param name "dir", "mmap" or "btree".
+ * @return The backend, or NULL if unknown.
+ */
+const upkg_store_backend_t *upkg_store_backend(const char *name);
+
+/**
+ * @brief Returns the NULL-terminated list of all backends.
+ */
+const upkg_store_backend_t *const *upkg_store_backends(void);
+
+/**
+ * @brief Opens (creating if needed) a store under a directory.
+ * @param backend The backend.
+ * @param dir The directory holding the store's files.
+ * @return The store, or NULL on failure.
+ */
+upkg_store_t *upkg_store_open(const upkg_store_backend_t *backend, const char *dir);
+
+/**
+ * @brief Reads one record.
+ * @param store The store.
+ * @param name The package name.
+ * @param pkg Output; free with upkg_hash_free_package_info.
+ * @return 0 if found, 1 if absent, -1 on error.
+ */
+int upkg_store_get(upkg_store_t *store, const char *name, upkg_hash_package_info_t *pkg);
+
+/**
+ * @brief Adds or replaces a record.
+ * @param store The store.
+ * @param pkg The record.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_store_put(upkg_store_t *store, const upkg_hash_package_info_t *pkg);
+
+/**
+ * @brief Deletes a record; deleting an absent record is not an error.
+ * @param store The store.
+ * @param name The package name.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_store_delete(upkg_store_t *store, const char *name);
+
+/**
+ * @brief Visits every record, including uncommitted changes.
+ * @param store The store.
+ * @param visit Called per record; the record is only valid during the call.
+ * @param user Passed to visit.
+ * @return The number of records visited, or -1 on error.
+ */
+int upkg_store_iterate(upkg_store_t *store, upkg_store_visit_fn visit, void *user);
+
+/**
+ * @brief Makes buffered changes durable.
+ * @param store The store.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_store_commit(upkg_store_t *store);
+
+/**
+ * @brief Closes a store, discarding uncommitted changes.
+ * @param store The store (may be NULL).
+ */
+void upkg_store_close(upkg_store_t *store);
+
+/**
+ * @brief Checks that a package name is usable as a record key (and, for
+ *        the dir backend, as a directory name).
+ * @param name The package name.
+ * @return true if the name is usable.
+ */
+bool upkg_store_valid_name(const char *name);
+
+/**
+ * @brief Serializes a record into the compact binary form the single-file
+ *        backends store: length-prefixed control fields, then the four lists.
+ * @param pkg The record.
+ * @param out Output buffer (caller frees).
+ * @param len Output length.
+ * @return 0 on success, -1 if out of memory.
+ */
+int upkg_store_encode(const upkg_hash_package_info_t *pkg, uint8_t **out, size_t *len);
+
+/**
+ * @brief Parses a record written by upkg_store_encode.
+ * @param data The encoded record.
+ * @param len Its length.
+ * @param pkg Output; free with upkg_hash_free_package_info.
+ * @return 0 on success, -1 if malformed or out of memory.
+ */
+int upkg_store_decode(const uint8_t *data, size_t len, upkg_hash_package_info_t *pkg);
+
+#endif // UPKG_STORE_H
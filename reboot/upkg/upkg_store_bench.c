@@ -0,0 +1,230 @@
+/******************************************************************************
+ * Filename:    upkg_store_bench.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Benchmarks the storage backends against synthetic databases
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_store.h"
+#include "upkg_metrics.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <unistd.h>
+
+/*
+ * Usage: upkg_store_bench [-b backend] [packages ...]
+ *
+ * For each size (default 100, 10000 and 100000 packages) and backend,
+ * fills a fresh store under $TMPDIR with synthetic records, then reopens it
+ * and measures:
+ *   open     opening the store and answering the first lookup
+ *   lookup   mean of random point lookups
+ *   scan     decoding every record (what upkg_db_load does)
+ *   commit   mean of replacing one record and committing
+ * "Cold" means a fresh store handle; the page cache stays warm.
+ */
+
+#define BENCH_FILES_PER_PACKAGE 20
+#define BENCH_LOOKUPS 1000
+#define BENCH_COMMITS 20
+
+// --- Synthetic Records ---
+
+/**
+ * @brief Fills in a synthetic package record; free with upkg_hash_free_package_info.
+ */
+static int make_package(int i, int revision, upkg_hash_package_info_t *pkg) {
+    char buf[256];
+    memset(pkg, 0, sizeof(*pkg));
+    snprintf(buf, sizeof(buf), "bench-pkg-%06d", i);
+    pkg->package_name = strdup(buf);
+    snprintf(buf, sizeof(buf), "1.%d-%d", i % 97, revision);
+    pkg->version = strdup(buf);
+    pkg->architecture = strdup("amd64");
+    pkg->maintainer = strdup("Bench Maintainer <bench@example.org>");
+    pkg->description = strdup("Synthetic package used to compare storage backends of the package database");
+    pkg->depends = strdup("libc6 (>= 2.34), libbench-common");
+    pkg->installed_size = strdup("512");
+
+    pkg->file_list = calloc(BENCH_FILES_PER_PACKAGE, sizeof(char *));
+    pkg->dir_list = calloc(2, sizeof(char *));
+    pkg->provided_sonames = calloc(1, sizeof(char *));
+    if (!pkg->file_list || !pkg->dir_list || !pkg->provided_sonames) return -1;
+    for (int f = 0; f < BENCH_FILES_PER_PACKAGE; f++) {
+        snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d/data/file-%02d.dat", i, f);
+        pkg->file_list[pkg->file_count++] = strdup(buf);
+    }
+    snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d", i);
+    pkg->dir_list[pkg->dir_count++] = strdup(buf);
+    snprintf(buf, sizeof(buf), "usr/share/bench-pkg-%06d/data", i);
+    pkg->dir_list[pkg->dir_count++] = strdup(buf);
+    snprintf(buf, sizeof(buf), "libbench%d.so.1", i);
+    pkg->provided_sonames[pkg->provided_soname_count++] = strdup(buf);
+    return pkg->package_name && pkg->version ? 0 : -1;
+}
+
+// --- Measurements ---
+
+/**
+ * @brief Counts scanned records.
+ */
+static int count_record(const upkg_hash_package_info_t *pkg, void *user) {
+    (void)pkg;
+    (*(int *)user)++;
+    return 0;
+}
+
+/**
+ * @brief Removes one path for nftw.
+ */
+static int remove_path(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Converts a nanosecond interval to milliseconds.
+ */
+static double ms_since(uint64_t start) {
+    return (double)(upkg_metrics_now_ns() - start) / 1e6;
+}
+
+/**
+ * @brief Fills a store with n records and measures it.
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_backend(const upkg_store_backend_t *backend, int n, const char *tmp) {
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/upkg-bench-%s-XXXXXX", tmp, backend->name);
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return -1;
+    }
+
+    int ret = -1;
+    double load_ms = 0, open_ms = 0, lookup_us = 0, scan_ms = 0, commit_ms = 0;
+    upkg_hash_package_info_t pkg;
+
+    // Load
+    uint64_t start = upkg_metrics_now_ns();
+    upkg_store_t *store = upkg_store_open(backend, dir);
+    for (int i = 0; store && i < n; i++) {
+        if (make_package(i, 1, &pkg) != 0 || upkg_store_put(store, &pkg) != 0) {
+            upkg_hash_free_package_info(&pkg);
+            goto out;
+        }
+        upkg_hash_free_package_info(&pkg);
+    }
+    if (!store || upkg_store_commit(store) != 0) goto out;
+    upkg_store_close(store);
+    load_ms = ms_since(start);
+
+    // Cold open: a fresh handle answering its first lookup
+    char name[64];
+    snprintf(name, sizeof(name), "bench-pkg-%06d", n / 2);
+    start = upkg_metrics_now_ns();
+    store = upkg_store_open(backend, dir);
+    if (!store || upkg_store_get(store, name, &pkg) != 0) goto out;
+    open_ms = ms_since(start);
+    upkg_hash_free_package_info(&pkg);
+
+    // Point lookups
+    unsigned int seed = 12345;
+    start = upkg_metrics_now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        snprintf(name, sizeof(name), "bench-pkg-%06d", rand_r(&seed) % n);
+        if (upkg_store_get(store, name, &pkg) != 0) goto out;
+        upkg_hash_free_package_info(&pkg);
+    }
+    lookup_us = ms_since(start) * 1000.0 / BENCH_LOOKUPS;
+
+    // Full scan
+    int scanned = 0;
+    start = upkg_metrics_now_ns();
+    if (upkg_store_iterate(store, count_record, &scanned) != n || scanned != n) goto out;
+    scan_ms = ms_since(start);
+
+    // Single-record commits
+    start = upkg_metrics_now_ns();
+    for (int i = 0; i < BENCH_COMMITS; i++) {
+        if (make_package(rand_r(&seed) % n, 2 + i, &pkg) != 0 || upkg_store_put(store, &pkg) != 0 ||
+            upkg_store_commit(store) != 0) {
+            upkg_hash_free_package_info(&pkg);
+            goto out;
+        }
+        upkg_hash_free_package_info(&pkg);
+    }
+    commit_ms = ms_since(start) / BENCH_COMMITS;
+    ret = 0;
+
+out:
+    upkg_store_close(store);
+    if (ret == 0) {
+        printf("%-6s %9d %10.1f %10.3f %10.2f %10.1f %10.3f\n", backend->name, n, load_ms,
+               open_ms, lookup_us, scan_ms, commit_ms);
+    } else {
+        printf("%-6s %9d   failed\n", backend->name, n);
+    }
+    fflush(stdout);
+    nftw(dir, remove_path, 16, FTW_DEPTH | FTW_PHYS);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    static const int default_sizes[] = { 100, 10000, 100000 };
+    const upkg_store_backend_t *only = NULL;
+    int sizes[64], size_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            only = upkg_store_backend(argv[++i]);
+            if (!only) {
+                fprintf(stderr, "Unknown backend '%s'.\n", argv[i]);
+                return 1;
+            }
+        } else if (atoi(argv[i]) > 0 && size_count < (int)(sizeof(sizes) / sizeof(sizes[0]))) {
+            sizes[size_count++] = atoi(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-b dir|mmap|btree] [packages ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size_count == 0) {
+        size_count = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+        memcpy(sizes, default_sizes, sizeof(default_sizes));
+    }
+    const char *tmp = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    int failed = 0;
+    printf("%-6s %9s %10s %10s %10s %10s %10s\n", "store", "packages", "load(ms)", "open(ms)", "lookup(us)",
+           "scan(ms)", "commit(ms)");
+    for (int s = 0; s < size_count; s++) {
+        for (const upkg_store_backend_t *const *b = upkg_store_backends(); *b; b++) {
+            if (only && *b != only) continue;
+            if (bench_backend(*b, sizes[s], tmp) != 0) failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,643 @@
+/******************************************************************************
+ * Filename:    upkg_store_btree.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Storage backend: an embedded copy-on-write B+tree
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_store.h"
+#include "upkg_digest.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * <dir>/packages.btree, little-endian, in BT_PAGE_SIZE pages:
+ *
+ *   header   two slots at offsets 0 and 512, the newer valid one wins:
+ *            "UPKGBT01" <u64 generation><u64 root><u64 end><u64 count>
+ *            <u32 CRC-32C of the preceding 40 bytes>
+ *   node     <u8 leaf><u8 0><u16 n>, then for a leaf n entries
+ *            <u16 key length><key><u64 value offset><u32 value length>,
+ *            for an inner node <u64 child 0> and n entries
+ *            <u16 key length><key><u64 child>; child i+1 holds keys >= key i
+ *   value    an upkg_store_encode record, anywhere past the header
+ *
+ * Nothing committed is ever overwritten: put appends its value, and commit
+ * appends every changed node (a leaf and its path to the root) before
+ * writing the other header slot to point at the new root. A crash leaves
+ * the previous root intact. Deletes do not rebalance, and superseded pages
+ * are not reclaimed; the file only grows by the changed path per commit.
+ */
+
+#define BTREE_FILE "packages.btree"
+#define BT_MAGIC "UPKGBT01"
+#define BT_PAGE_SIZE 4096
+#define BT_HEADER_SLOT 512
+#define BT_HEADER_BYTES 44
+#define BT_NODE_HEADER 4
+#define BT_MAX_KEY 255
+#define BT_LEAF_ENTRY(klen) (2 + (klen) + 12)
+#define BT_INNER_ENTRY(klen) (2 + (klen) + 8)
+#define BT_MAX_KEYS ((BT_PAGE_SIZE - BT_NODE_HEADER) / BT_INNER_ENTRY(1) + 1)
+
+typedef struct bt_node {
+    bool leaf;
+    bool dirty;
+    uint64_t page;                          // 0 until written
+    int n;
+    size_t bytes;                           // Serialized size
+    char *keys[BT_MAX_KEYS + 1];
+    uint64_t value_offset[BT_MAX_KEYS + 1]; // Leaf
+    uint32_t value_len[BT_MAX_KEYS + 1];
+    uint64_t child_page[BT_MAX_KEYS + 2];   // Inner
+    struct bt_node *child[BT_MAX_KEYS + 2]; // Loaded children, or NULL
+} bt_node_t;
+
+typedef struct {
+    upkg_store_t base;
+    char *path;
+    int fd;
+    uint64_t generation;
+    uint64_t root_page;
+    uint64_t end;                           // Where the next append goes
+    uint64_t count;
+    bt_node_t *root;                        // Loaded lazily
+    bool dirty;
+} bt_store_t;
+
+// --- Byte Order ---
+
+/**
+ * @brief Reads a little-endian integer of n bytes.
+ */
+static uint64_t get_le(const uint8_t *p, int n) {
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+/**
+ * @brief Stores a little-endian integer of n bytes.
+ */
+static void put_le(uint8_t *p, uint64_t v, int n) {
+    for (int i = 0; i < n; i++, v >>= 8) p[i] = (uint8_t)v;
+}
+
+// --- Nodes ---
+
+/**
+ * @brief Allocates an empty node.
+ */
+static bt_node_t *node_new(bool leaf) {
+    bt_node_t *node = calloc(1, sizeof(*node));
+    if (!node) return NULL;
+    node->leaf = leaf;
+    node->dirty = true;
+    node->bytes = BT_NODE_HEADER + (leaf ? 0 : 8);
+    return node;
+}
+
+/**
+ * @brief Frees a node and its loaded subtree.
+ */
+static void node_free(bt_node_t *node) {
+    if (!node) return;
+    for (int i = 0; i < node->n; i++) free(node->keys[i]);
+    if (!node->leaf) {
+        for (int i = 0; i <= node->n; i++) node_free(node->child[i]);
+    }
+    free(node);
+}
+
+/**
+ * @brief Reads and parses a node page.
+ * @return The node, or NULL if unreadable or corrupt.
+ */
+static bt_node_t *node_read(bt_store_t *store, uint64_t page) {
+    uint8_t buf[BT_PAGE_SIZE];
+    if (pread(store->fd, buf, sizeof(buf), (off_t)page) != (ssize_t)sizeof(buf)) {
+        upkg_util_error("%s: cannot read node at %llu.\n", store->path, (unsigned long long)page);
+        return NULL;
+    }
+
+    bt_node_t *node = node_new(buf[0] != 0);
+    if (!node) return NULL;
+    node->dirty = false;
+    node->page = page;
+    int n = (int)get_le(buf + 2, 2);
+    size_t pos = BT_NODE_HEADER;
+    if (!node->leaf) {
+        node->child_page[0] = get_le(buf + pos, 8);
+        pos += 8;
+    }
+
+    bool valid = n <= BT_MAX_KEYS;
+    for (int i = 0; valid && i < n; i++) {
+        size_t klen = pos + 2 <= sizeof(buf) ? (size_t)get_le(buf + pos, 2) : SIZE_MAX;
+        size_t entry = node->leaf ? BT_LEAF_ENTRY(klen) : BT_INNER_ENTRY(klen);
+        valid = klen <= BT_MAX_KEY && pos + entry <= sizeof(buf);
+        if (!valid) break;
+        node->keys[i] = strndup((const char *)buf + pos + 2, klen);
+        valid = node->keys[i] != NULL;
+        if (node->leaf) {
+            node->value_offset[i] = get_le(buf + pos + 2 + klen, 8);
+            node->value_len[i] = (uint32_t)get_le(buf + pos + 2 + klen + 8, 4);
+        } else {
+            node->child_page[i + 1] = get_le(buf + pos + 2 + klen, 8);
+        }
+        node->n = i + 1;
+        pos += entry;
+    }
+    if (!valid) {
+        upkg_util_error("%s: corrupt node at %llu.\n", store->path, (unsigned long long)page);
+        node_free(node);
+        return NULL;
+    }
+    node->bytes = pos;
+    return node;
+}
+
+/**
+ * @brief Returns child i of an inner node, reading it on first use.
+ */
+static bt_node_t *node_child(bt_store_t *store, bt_node_t *node, int i) {
+    if (!node->child[i]) node->child[i] = node_read(store, node->child_page[i]);
+    return node->child[i];
+}
+
+/**
+ * @brief Returns the root node, reading it (or creating an empty leaf) on first use.
+ */
+static bt_node_t *tree_root(bt_store_t *store) {
+    if (!store->root) store->root = store->root_page ? node_read(store, store->root_page) : node_new(true);
+    return store->root;
+}
+
+/**
+ * @brief Returns the first index whose key is >= name (leaf position).
+ */
+static int lower_bound(const bt_node_t *node, const char *name) {
+    int lo = 0, hi = node->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(node->keys[mid], name) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Returns the child to descend into for name: the number of keys <= name.
+ */
+static int child_index(const bt_node_t *node, const char *name) {
+    int lo = 0, hi = node->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(node->keys[mid], name) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Returns the serialized size of entry i.
+ */
+static size_t entry_bytes(const bt_node_t *node, int i) {
+    size_t klen = strlen(node->keys[i]);
+    return node->leaf ? BT_LEAF_ENTRY(klen) : BT_INNER_ENTRY(klen);
+}
+
+/**
+ * @brief Splits an overfull node in two by bytes.
+ * @param node The node; keeps the lower half.
+ * @param separator Output: the first key of the upper half (copied for a
+ *        leaf, moved up out of an inner node).
+ * @return The new upper node, or NULL if out of memory.
+ */
+static bt_node_t *node_split(bt_node_t *node, char **separator) {
+    bt_node_t *right = node_new(node->leaf);
+    if (!right) return NULL;
+
+    // Keep entries on the left until about half of the bytes are there
+    int mid = 0;
+    size_t left_bytes = BT_NODE_HEADER + (node->leaf ? 0 : 8);
+    while (mid < node->n - 1 && left_bytes + entry_bytes(node, mid) <= node->bytes / 2) {
+        left_bytes += entry_bytes(node, mid);
+        mid++;
+    }
+    if (mid == 0) {
+        left_bytes += entry_bytes(node, 0);
+        mid = 1;
+    }
+
+    if (node->leaf) {
+        *separator = strdup(node->keys[mid]);
+        if (!*separator) {
+            free(right);
+            return NULL;
+        }
+        for (int i = mid; i < node->n; i++) {
+            int j = i - mid;
+            right->keys[j] = node->keys[i];
+            right->value_offset[j] = node->value_offset[i];
+            right->value_len[j] = node->value_len[i];
+        }
+        right->n = node->n - mid;
+        right->bytes = node->bytes - left_bytes + BT_NODE_HEADER;
+    } else {
+        // keys[mid] moves up; its right child becomes the new node's child 0
+        *separator = node->keys[mid];
+        size_t moved = entry_bytes(node, mid);
+        right->child_page[0] = node->child_page[mid + 1];
+        right->child[0] = node->child[mid + 1];
+        for (int i = mid + 1; i < node->n; i++) {
+            int j = i - mid - 1;
+            right->keys[j] = node->keys[i];
+            right->child_page[j + 1] = node->child_page[i + 1];
+            right->child[j + 1] = node->child[i + 1];
+        }
+        right->n = node->n - mid - 1;
+        right->bytes = node->bytes - left_bytes - moved + BT_NODE_HEADER + 8;
+    }
+    node->n = mid;
+    node->bytes = left_bytes;
+    node->dirty = true;
+    return right;
+}
+
+// --- Tree Operations ---
+
+/**
+ * @brief Inserts or replaces a key below node.
+ * @param split Output: the new right sibling if node split, else NULL.
+ * @param separator Output: the key separating node and *split.
+ * @param added Set to true if the key was new.
+ * @return 0 on success, -1 on failure.
+ */
+static int tree_insert(bt_store_t *store, bt_node_t *node, const char *name, uint64_t offset, uint32_t len,
+                       bt_node_t **split, char **separator, bool *added) {
+    *split = NULL;
+    node->dirty = true;
+
+    if (node->leaf) {
+        int i = lower_bound(node, name);
+        if (i < node->n && strcmp(node->keys[i], name) == 0) {
+            node->value_offset[i] = offset;
+            node->value_len[i] = len;
+            return 0;
+        }
+        char *key = strdup(name);
+        if (!key) return -1;
+        memmove(&node->keys[i + 1], &node->keys[i], (size_t)(node->n - i) * sizeof(node->keys[0]));
+        memmove(&node->value_offset[i + 1], &node->value_offset[i], (size_t)(node->n - i) * sizeof(uint64_t));
+        memmove(&node->value_len[i + 1], &node->value_len[i], (size_t)(node->n - i) * sizeof(uint32_t));
+        node->keys[i] = key;
+        node->value_offset[i] = offset;
+        node->value_len[i] = len;
+        node->n++;
+        node->bytes += BT_LEAF_ENTRY(strlen(name));
+        *added = true;
+    } else {
+        int i = child_index(node, name);
+        bt_node_t *child = node_child(store, node, i);
+        if (!child) return -1;
+
+        bt_node_t *child_split;
+        char *child_separator;
+        if (tree_insert(store, child, name, offset, len, &child_split, &child_separator, added) != 0) return -1;
+        if (!child_split) return 0;
+
+        memmove(&node->keys[i + 1], &node->keys[i], (size_t)(node->n - i) * sizeof(node->keys[0]));
+        memmove(&node->child_page[i + 2], &node->child_page[i + 1], (size_t)(node->n - i) * sizeof(uint64_t));
+        memmove(&node->child[i + 2], &node->child[i + 1], (size_t)(node->n - i) * sizeof(node->child[0]));
+        node->keys[i] = child_separator;
+        node->child_page[i + 1] = 0;
+        node->child[i + 1] = child_split;
+        node->n++;
+        node->bytes += BT_INNER_ENTRY(strlen(child_separator));
+    }
+
+    if (node->bytes > BT_PAGE_SIZE || node->n > BT_MAX_KEYS - 1) {
+        *split = node_split(node, separator);
+        if (!*split) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the leaf holding name.
+ * @return The leaf, or NULL on read error.
+ */
+static bt_node_t *tree_leaf(bt_store_t *store, const char *name, bool mark_dirty) {
+    bt_node_t *node = tree_root(store);
+    while (node && !node->leaf) {
+        if (mark_dirty) node->dirty = true;
+        node = node_child(store, node, child_index(node, name));
+    }
+    return node;
+}
+
+/**
+ * @brief Writes a dirty subtree, children first, and returns its page.
+ * @return 0 on success, -1 on write failure.
+ */
+static int tree_write(bt_store_t *store, bt_node_t *node) {
+    if (!node->dirty) return 0;
+    if (!node->leaf) {
+        for (int i = 0; i <= node->n; i++) {
+            if (node->child[i]) {
+                if (tree_write(store, node->child[i]) != 0) return -1;
+                node->child_page[i] = node->child[i]->page;
+            }
+        }
+    }
+
+    uint8_t buf[BT_PAGE_SIZE];
+    memset(buf, 0, sizeof(buf));
+    buf[0] = node->leaf ? 1 : 0;
+    put_le(buf + 2, (uint64_t)node->n, 2);
+    size_t pos = BT_NODE_HEADER;
+    if (!node->leaf) {
+        put_le(buf + pos, node->child_page[0], 8);
+        pos += 8;
+    }
+    for (int i = 0; i < node->n; i++) {
+        size_t klen = strlen(node->keys[i]);
+        put_le(buf + pos, klen, 2);
+        memcpy(buf + pos + 2, node->keys[i], klen);
+        if (node->leaf) {
+            put_le(buf + pos + 2 + klen, node->value_offset[i], 8);
+            put_le(buf + pos + 2 + klen + 8, node->value_len[i], 4);
+        } else {
+            put_le(buf + pos + 2 + klen, node->child_page[i + 1], 8);
+        }
+        pos += entry_bytes(node, i);
+    }
+
+    uint64_t page = (store->end + BT_PAGE_SIZE - 1) / BT_PAGE_SIZE * BT_PAGE_SIZE;
+    if (pwrite(store->fd, buf, sizeof(buf), (off_t)page) != (ssize_t)sizeof(buf)) return -1;
+    store->end = page + BT_PAGE_SIZE;
+    node->page = page;
+    node->dirty = false;
+    return 0;
+}
+
+typedef struct {
+    upkg_store_visit_fn visit;
+    void *user;
+    int visited;
+    int stop;
+} bt_walk_t;
+
+/**
+ * @brief Visits the records of a subtree in key order.
+ * @return 0 on success, -1 on error.
+ */
+static int tree_walk(bt_store_t *store, bt_node_t *node, bt_walk_t *walk) {
+    if (!node->leaf) {
+        for (int i = 0; i <= node->n && !walk->stop; i++) {
+            bt_node_t *child = node_child(store, node, i);
+            if (!child || tree_walk(store, child, walk) != 0) return -1;
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < node->n && !walk->stop; i++) {
+        uint8_t *blob = malloc(node->value_len[i] ? node->value_len[i] : 1);
+        upkg_hash_package_info_t pkg;
+        if (!blob || pread(store->fd, blob, node->value_len[i], (off_t)node->value_offset[i]) != (ssize_t)node->value_len[i] ||
+            upkg_store_decode(blob, node->value_len[i], &pkg) != 0) {
+            free(blob);
+            return -1;
+        }
+        free(blob);
+        walk->visited++;
+        walk->stop = walk->visit(&pkg, walk->user);
+        upkg_hash_free_package_info(&pkg);
+    }
+    return 0;
+}
+
+// --- Header ---
+
+/**
+ * @brief Reads the newer valid header slot.
+ * @return 0 on success (an empty file is a fresh tree), -1 if neither slot is valid.
+ */
+static int header_read(bt_store_t *store) {
+    uint8_t buf[BT_HEADER_SLOT * 2];
+    ssize_t got = pread(store->fd, buf, sizeof(buf), 0);
+    if (got == 0) return 0;
+
+    bool found = false;
+    for (int slot = 0; slot < 2 && got == (ssize_t)sizeof(buf); slot++) {
+        const uint8_t *h = buf + slot * BT_HEADER_SLOT;
+        if (memcmp(h, BT_MAGIC, 8) != 0 ||
+            upkg_digest_crc32c(0, h, BT_HEADER_BYTES - 4) != (uint32_t)get_le(h + BT_HEADER_BYTES - 4, 4)) {
+            continue;
+        }
+        uint64_t generation = get_le(h + 8, 8);
+        if (found && generation < store->generation) continue;
+        store->generation = generation;
+        store->root_page = get_le(h + 16, 8);
+        store->end = get_le(h + 24, 8);
+        store->count = get_le(h + 32, 8);
+        found = true;
+    }
+    if (!found) upkg_util_error("%s is not a package B-tree.\n", store->path);
+    return found ? 0 : -1;
+}
+
+/**
+ * @brief Writes the next generation's header into the slot not in use.
+ * @return 0 on success, -1 on failure.
+ */
+static int header_write(bt_store_t *store, uint64_t generation) {
+    uint8_t h[BT_HEADER_BYTES];
+    memcpy(h, BT_MAGIC, 8);
+    put_le(h + 8, generation, 8);
+    put_le(h + 16, store->root_page, 8);
+    put_le(h + 24, store->end, 8);
+    put_le(h + 32, store->count, 8);
+    put_le(h + 40, upkg_digest_crc32c(0, h, BT_HEADER_BYTES - 4), 4);
+    off_t slot = (off_t)(generation % 2) * BT_HEADER_SLOT;
+    return pwrite(store->fd, h, sizeof(h), slot) == (ssize_t)sizeof(h) ? 0 : -1;
+}
+
+// --- Backend ---
+
+/**
+ * @brief Opens (creating) the tree file under dir; only the header is read.
+ */
+static upkg_store_t *bt_open(const char *dir) {
+    bt_store_t *store = calloc(1, sizeof(*store));
+    if (!store) return NULL;
+    store->fd = -1;
+    store->path = upkg_util_concat_path(dir, BTREE_FILE);
+    if (store->path && upkg_util_create_dir_recursive(dir, 0755) == 0) {
+        store->fd = open(store->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    if (store->fd < 0 || header_read(store) != 0) {
+        if (store->fd >= 0) close(store->fd);
+        free(store->path);
+        free(store);
+        return NULL;
+    }
+    if (store->end < BT_PAGE_SIZE) store->end = BT_PAGE_SIZE;
+    return &store->base;
+}
+
+/**
+ * @brief Descends to the leaf and reads the value.
+ */
+static int bt_get(upkg_store_t *base, const char *name, upkg_hash_package_info_t *pkg) {
+    bt_store_t *store = (bt_store_t *)base;
+    bt_node_t *leaf = tree_leaf(store, name, false);
+    if (!leaf) return -1;
+    int i = lower_bound(leaf, name);
+    if (i == leaf->n || strcmp(leaf->keys[i], name) != 0) return 1;
+
+    uint32_t len = leaf->value_len[i];
+    uint8_t *blob = malloc(len ? len : 1);
+    if (!blob) return -1;
+    int ret = pread(store->fd, blob, len, (off_t)leaf->value_offset[i]) == (ssize_t)len
+            ? upkg_store_decode(blob, len, pkg) : -1;
+    free(blob);
+    return ret;
+}
+
+/**
+ * @brief Appends the value and inserts its key.
+ */
+static int bt_put(upkg_store_t *base, const upkg_hash_package_info_t *pkg) {
+    bt_store_t *store = (bt_store_t *)base;
+    if (strlen(pkg->package_name) > BT_MAX_KEY) return -1;
+    bt_node_t *root = tree_root(store);
+    if (!root) return -1;
+
+    uint8_t *blob;
+    size_t len;
+    if (upkg_store_encode(pkg, &blob, &len) != 0) return -1;
+    uint64_t offset = store->end;
+    ssize_t wrote = pwrite(store->fd, blob, len, (off_t)offset);
+    free(blob);
+    if (wrote != (ssize_t)len) return -1;
+    store->end += len;
+
+    bt_node_t *split;
+    char *separator;
+    bool added = false;
+    if (tree_insert(store, root, pkg->package_name, offset, (uint32_t)len, &split, &separator, &added) != 0) return -1;
+    if (split) {
+        bt_node_t *new_root = node_new(false);
+        if (!new_root) return -1;
+        new_root->child[0] = root;
+        new_root->child[1] = split;
+        new_root->keys[0] = separator;
+        new_root->n = 1;
+        new_root->bytes += BT_INNER_ENTRY(strlen(separator));
+        store->root = new_root;
+    }
+    if (added) store->count++;
+    store->dirty = true;
+    return 0;
+}
+
+/**
+ * @brief Removes a key from its leaf (leaves are not merged).
+ */
+static int bt_del(upkg_store_t *base, const char *name) {
+    bt_store_t *store = (bt_store_t *)base;
+    bt_node_t *leaf = tree_leaf(store, name, false);
+    if (!leaf) return -1;
+    int i = lower_bound(leaf, name);
+    if (i == leaf->n || strcmp(leaf->keys[i], name) != 0) return 0;
+
+    tree_leaf(store, name, true);
+    leaf->dirty = true;
+    leaf->bytes -= entry_bytes(leaf, i);
+    free(leaf->keys[i]);
+    memmove(&leaf->keys[i], &leaf->keys[i + 1], (size_t)(leaf->n - i - 1) * sizeof(leaf->keys[0]));
+    memmove(&leaf->value_offset[i], &leaf->value_offset[i + 1], (size_t)(leaf->n - i - 1) * sizeof(uint64_t));
+    memmove(&leaf->value_len[i], &leaf->value_len[i + 1], (size_t)(leaf->n - i - 1) * sizeof(uint32_t));
+    leaf->n--;
+    store->count--;
+    store->dirty = true;
+    return 0;
+}
+
+/**
+ * @brief Walks the tree in key order.
+ */
+static int bt_iterate(upkg_store_t *base, upkg_store_visit_fn visit, void *user) {
+    bt_store_t *store = (bt_store_t *)base;
+    bt_node_t *root = tree_root(store);
+    bt_walk_t walk = { visit, user, 0, 0 };
+    if (!root || tree_walk(store, root, &walk) != 0) return -1;
+    return walk.visited;
+}
+
+/**
+ * @brief Appends the changed nodes, syncs, then switches the header.
+ */
+static int bt_commit(upkg_store_t *base) {
+    bt_store_t *store = (bt_store_t *)base;
+    if (!store->dirty) return 0;
+
+    if (tree_write(store, store->root) != 0 || fdatasync(store->fd) != 0) {
+        upkg_util_error("Failed to write %s: %s\n", store->path, strerror(errno));
+        return -1;
+    }
+    store->root_page = store->root->page;
+    if (header_write(store, store->generation + 1) != 0 || fdatasync(store->fd) != 0) {
+        upkg_util_error("Failed to update the header of %s: %s\n", store->path, strerror(errno));
+        return -1;
+    }
+    store->generation++;
+    store->dirty = false;
+    return 0;
+}
+
+/**
+ * @brief Closes the file and frees the loaded nodes.
+ */
+static void bt_close(upkg_store_t *base) {
+    bt_store_t *store = (bt_store_t *)base;
+    node_free(store->root);
+    close(store->fd);
+    free(store->path);
+    free(store);
+}
+
+const upkg_store_backend_t upkg_store_btree_backend = {
+    .name = "btree",
+    .open = bt_open,
+    .get = bt_get,
+    .put = bt_put,
+    .del = bt_del,
+    .iterate = bt_iterate,
+    .commit = bt_commit,
+    .close = bt_close,
+};
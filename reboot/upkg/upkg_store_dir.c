@@ -0,0 +1,407 @@
+/******************************************************************************
+ * Filename:    upkg_store_dir.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Storage backend: one directory of text files per package
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_store.h"
+#include "upkg_cpu.h"
+#include "upkg_util.h"
+#include "upkg_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * <dir>/<package>/{control,files,sonames,needed,dirs}; see upkg_db.h.
+ * Every file is replaced atomically, so put and delete are durable as soon
+ * as they return and commit has nothing left to do.
+ */
+
+typedef struct {
+    upkg_store_t base;
+    char *dir;
+} dir_store_t;
+
+// --- Record Layout ---
+
+/**
+ * @brief Maps a control file field to its slot in the package record.
+ */
+typedef struct {
+    const char *name;
+    size_t offset;
+} db_field_t;
+
+static const db_field_t db_fields[] = {
+    { "Package",        offsetof(upkg_hash_package_info_t, package_name) },
+    { "Version",        offsetof(upkg_hash_package_info_t, version) },
+    { "Architecture",   offsetof(upkg_hash_package_info_t, architecture) },
+    { "Maintainer",     offsetof(upkg_hash_package_info_t, maintainer) },
+    { "Installed-Size", offsetof(upkg_hash_package_info_t, installed_size) },
+    { "Section",        offsetof(upkg_hash_package_info_t, section) },
+    { "Priority",       offsetof(upkg_hash_package_info_t, priority) },
+    { "Depends",        offsetof(upkg_hash_package_info_t, depends) },
+    { "Homepage",       offsetof(upkg_hash_package_info_t, homepage) },
+    { "Filename",       offsetof(upkg_hash_package_info_t, filename) },
+    { "Description",    offsetof(upkg_hash_package_info_t, description) }
+};
+
+#define DB_FIELD_COUNT (sizeof(db_fields) / sizeof(db_fields[0]))
+#define DB_FIELD_SLOT(pkg, field) ((char **)((char *)(pkg) + (field)->offset))
+
+// --- File Helpers ---
+
+/**
+ * @brief Writes a newline-separated string list into a record directory.
+ * @param record_dir The package's record directory.
+ * @param name The file name within the record directory.
+ * @param list The strings to write.
+ * @param count The number of strings.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_list_file(const char *record_dir, const char *name, char *const *list, int count) {
+    char *path = upkg_util_concat_path(record_dir, name);
+    if (!path) return -1;
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        upkg_util_error("Failed to allocate buffer for '%s'.\n", path);
+        free(path);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (list[i]) {
+            fprintf(mem, "%s\n", list[i]);
+        }
+    }
+    fclose(mem);
+
+    int ret = upkg_util_write_file_atomic(path, buffer, len);
+    free(buffer);
+    free(path);
+    return ret;
+}
+
+/**
+ * @brief Reads a newline-separated string list from a record directory.
+ * @param record_dir The package's record directory.
+ * @param name The file name within the record directory.
+ * @param list Output string array.
+ * @param count Output number of strings.
+ * @return 0 on success (a missing file yields an empty list), -1 on failure.
+ */
+static int read_list_file(const char *record_dir, const char *name, char ***list, int *count) {
+    *list = NULL;
+    *count = 0;
+
+    char *path = upkg_util_concat_path(record_dir, name);
+    if (!path) return -1;
+
+    size_t len = 0;
+    char *content = upkg_util_read_file_content(path, &len);
+    free(path);
+    if (!content) {
+        return 0;
+    }
+
+    int lines = (int)upkg_cpu_count_byte(content, '\n', len);
+    if (len > 0 && content[len - 1] != '\n') lines++;
+
+    if (lines > 0) {
+        *list = calloc((size_t)lines, sizeof(char *));
+        if (!*list) {
+            upkg_util_error("Failed to allocate memory for record list '%s'.\n", name);
+            free(content);
+            return -1;
+        }
+    }
+
+    char *line = content;
+    while (line < content + len) {
+        char *end = memchr(line, '\n', (size_t)(content + len - line));
+        if (end) *end = '\0';
+        if (*line != '\0') {
+            (*list)[*count] = strdup(line);
+            if (!(*list)[*count]) {
+                upkg_util_free_string_list(list, count);
+                free(content);
+                return -1;
+            }
+            (*count)++;
+        }
+        if (!end) break;
+        line = end + 1;
+    }
+
+    free(content);
+    return 0;
+}
+
+/**
+ * @brief Parses a record's control file into the package structure.
+ * @param record_dir The package's record directory.
+ * @param pkg_info The package record to fill in.
+ * @return 0 on success, -1 on failure.
+ */
+static int read_control_file(const char *record_dir, upkg_hash_package_info_t *pkg_info) {
+    char *path = upkg_util_concat_path(record_dir, "control");
+    if (!path) return -1;
+
+    size_t len = 0;
+    char *content = upkg_util_read_file_content(path, &len);
+    if (!content) {
+        upkg_util_log_verbose("Skipping record without control file: %s\n", path);
+        free(path);
+        return -1;
+    }
+    free(path);
+
+    char *line = content;
+    while (line < content + len) {
+        char *end = memchr(line, '\n', (size_t)(content + len - line));
+        if (end) *end = '\0';
+
+        char *colon = strchr(line, ':');
+        if (colon) {
+            *colon = '\0';
+            char *value = colon + 1;
+            while (*value == ' ') value++;
+            for (size_t i = 0; i < DB_FIELD_COUNT; i++) {
+                if (strcmp(line, db_fields[i].name) == 0) {
+                    char **slot = DB_FIELD_SLOT(pkg_info, &db_fields[i]);
+                    free(*slot);
+                    *slot = strdup(value);
+                    break;
+                }
+            }
+        }
+        if (!end) break;
+        line = end + 1;
+    }
+
+    free(content);
+    return pkg_info->package_name ? 0 : -1;
+}
+
+
+// --- Backend ---
+
+/**
+ * @brief Opens a directory store; the directory is created by the first put.
+ */
+static upkg_store_t *dir_open(const char *dir) {
+    dir_store_t *store = calloc(1, sizeof(*store));
+    if (!store) return NULL;
+    store->dir = strdup(dir);
+    if (!store->dir) {
+        free(store);
+        return NULL;
+    }
+    return &store->base;
+}
+
+/**
+ * @brief Reads every file of one record directory.
+ * @return 0 on success, -1 if the record is missing or unreadable.
+ */
+static int read_record(const char *record_dir, upkg_hash_package_info_t *pkg_info) {
+    if (read_control_file(record_dir, pkg_info) == 0 &&
+        read_list_file(record_dir, "files", &pkg_info->file_list, &pkg_info->file_count) == 0 &&
+        read_list_file(record_dir, "sonames", &pkg_info->provided_sonames, &pkg_info->provided_soname_count) == 0 &&
+        read_list_file(record_dir, "needed", &pkg_info->needed_sonames, &pkg_info->needed_soname_count) == 0 &&
+        read_list_file(record_dir, "dirs", &pkg_info->dir_list, &pkg_info->dir_count) == 0) {
+        return 0;
+    }
+    upkg_hash_free_package_info(pkg_info);
+    return -1;
+}
+
+/**
+ * @brief Reads one record directory.
+ */
+static int dir_get(upkg_store_t *base, const char *name, upkg_hash_package_info_t *pkg_info) {
+    dir_store_t *store = (dir_store_t *)base;
+    char *record_dir = upkg_util_concat_path(store->dir, name);
+    if (!record_dir) return -1;
+
+    struct stat st;
+    int ret = upkg_vfs->stat(record_dir, &st) == 0 && S_ISDIR(st.st_mode) ? read_record(record_dir, pkg_info) : 1;
+    free(record_dir);
+    return ret;
+}
+
+/**
+ * @brief Writes a record directory: control first, then the lists.
+ */
+static int dir_put(upkg_store_t *base, const upkg_hash_package_info_t *pkg_info) {
+    dir_store_t *store = (dir_store_t *)base;
+    char *record_dir = upkg_util_concat_path(store->dir, pkg_info->package_name);
+    if (!record_dir) return -1;
+    if (upkg_util_create_dir_recursive(record_dir, 0755) != 0) {
+        upkg_util_error("Failed to create record directory '%s'.\n", record_dir);
+        free(record_dir);
+        return -1;
+    }
+
+    char *buffer = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buffer, &len);
+    if (!mem) {
+        upkg_util_error("Failed to allocate control buffer.\n");
+        free(record_dir);
+        return -1;
+    }
+    for (size_t i = 0; i < DB_FIELD_COUNT; i++) {
+        char *const *slot = (char *const *)((const char *)pkg_info + db_fields[i].offset);
+        if (*slot) {
+            fprintf(mem, "%s: %s\n", db_fields[i].name, *slot);
+        }
+    }
+    fclose(mem);
+
+    char *control_path = upkg_util_concat_path(record_dir, "control");
+    int ret = control_path ? upkg_util_write_file_atomic(control_path, buffer, len) : -1;
+    free(control_path);
+    free(buffer);
+
+    if (ret == 0) {
+        ret = write_list_file(record_dir, "files", pkg_info->file_list, pkg_info->file_count);
+    }
+    if (ret == 0) {
+        ret = write_list_file(record_dir, "sonames", pkg_info->provided_sonames, pkg_info->provided_soname_count);
+    }
+    if (ret == 0) {
+        ret = write_list_file(record_dir, "needed", pkg_info->needed_sonames, pkg_info->needed_soname_count);
+    }
+    if (ret == 0) {
+        ret = write_list_file(record_dir, "dirs", pkg_info->dir_list, pkg_info->dir_count);
+    }
+
+    if (ret == 0) {
+        upkg_util_log_verbose("Stored package record: %s\n", record_dir);
+    }
+    free(record_dir);
+    return ret;
+}
+
+/**
+ * @brief Deletes a record directory, including its manifest.
+ */
+static int dir_del(upkg_store_t *base, const char *name) {
+    static const char *const record_files[] = { "control", "files", "sonames", "needed", "dirs", "manifest" };
+    dir_store_t *store = (dir_store_t *)base;
+
+    char *record_dir = upkg_util_concat_path(store->dir, name);
+    if (!record_dir) return -1;
+
+    // Drop the control file first so a half-deleted record is ignored on load
+    for (size_t i = 0; i < sizeof(record_files) / sizeof(record_files[0]); i++) {
+        char *path = upkg_util_concat_path(record_dir, record_files[i]);
+        if (path && upkg_vfs->unlink(path) != 0 && errno != ENOENT) {
+            upkg_util_error("Failed to remove '%s': %s\n", path, strerror(errno));
+        }
+        free(path);
+    }
+
+    int ret = 0;
+    if (upkg_vfs->rmdir(record_dir) != 0 && errno != ENOENT) {
+        upkg_util_error("Failed to remove record directory '%s': %s\n", record_dir, strerror(errno));
+        ret = -1;
+    }
+    free(record_dir);
+    return ret;
+}
+
+/**
+ * @brief Reads every record directory; dot-names (.lock, .dirtab, ...) are skipped.
+ */
+static int dir_iterate(upkg_store_t *base, upkg_store_visit_fn visit, void *user) {
+    dir_store_t *store = (dir_store_t *)base;
+    upkg_vfs_dir_t *dp = upkg_vfs->opendir(store->dir);
+    if (!dp) {
+        upkg_util_log_verbose("Database directory '%s' not readable: %s\n", store->dir, strerror(errno));
+        return 0; // Fresh install: nothing recorded yet
+    }
+
+    int visited = 0;
+    const char *entry;
+    while ((entry = upkg_vfs->readdir(dp)) != NULL) {
+        if (!upkg_store_valid_name(entry)) {
+            continue;
+        }
+
+        char *record_dir = upkg_util_concat_path(store->dir, entry);
+        if (!record_dir) {
+            upkg_vfs->closedir(dp);
+            return -1;
+        }
+
+        upkg_hash_package_info_t pkg_info;
+        memset(&pkg_info, 0, sizeof(pkg_info));
+        int stop = 0;
+        if (read_record(record_dir, &pkg_info) == 0) {
+            visited++;
+            stop = visit(&pkg_info, user);
+            upkg_hash_free_package_info(&pkg_info);
+        } else {
+            upkg_util_error("Ignoring unreadable package record: %s\n", record_dir);
+        }
+        free(record_dir);
+        if (stop) break;
+    }
+    upkg_vfs->closedir(dp);
+    return visited;
+}
+
+/**
+ * @brief Nothing is buffered.
+ */
+static int dir_commit(upkg_store_t *base) {
+    (void)base;
+    return 0;
+}
+
+/**
+ * @brief Frees the store.
+ */
+static void dir_close(upkg_store_t *base) {
+    dir_store_t *store = (dir_store_t *)base;
+    free(store->dir);
+    free(store);
+}
+
+const upkg_store_backend_t upkg_store_dir_backend = {
+    .name = "dir",
+    .open = dir_open,
+    .get = dir_get,
+    .put = dir_put,
+    .del = dir_del,
+    .iterate = dir_iterate,
+    .commit = dir_commit,
+    .close = dir_close,
+};
@@ -0,0 +1,511 @@
+/******************************************************************************
+ * Filename:    upkg_store_mmap.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Storage backend: one sorted, mmap()ed image file
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_store.h"
+#include "upkg_index.h"
+#include "upkg_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * <dir>/packages.img, little-endian:
+ *   header   "UPKGIMG1", <u32 record count><u32 reserved><u64 index offset>
+ *   records  <u32 name length><name><u32 length><upkg_store_encode bytes>
+ *   index    one u64 record offset per record, sorted by name
+ * Changes wait in memory (with a name -> slot index so get sees them) and a
+ * commit merges them with the old image into a new file renamed over it.
+ */
+
+#define IMAGE_FILE "packages.img"
+#define IMAGE_MAGIC "UPKGIMG1"
+#define IMAGE_HEADER_SIZE 24
+
+typedef struct {
+    char *name;
+    uint8_t *blob;          // NULL for a deletion
+    size_t len;
+} image_change_t;
+
+typedef struct {
+    upkg_store_t base;
+    char *path;
+    uint8_t *map;
+    size_t map_size;
+    uint32_t count;
+    const uint8_t *index;
+    image_change_t *changes;
+    size_t change_count;
+    size_t change_cap;
+    upkg_index_t *pending;  // name -> change slot (decimal)
+} image_store_t;
+
+// --- Image Access ---
+
+/**
+ * @brief Reads a little-endian u32.
+ */
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * @brief Reads a little-endian u64.
+ */
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+/**
+ * @brief Stores a little-endian u32.
+ */
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Stores a little-endian u64.
+ */
+static void put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+/**
+ * @brief Locates record i of the image, checking it lies inside the file.
+ * @return 0 on success, -1 if the image is corrupt.
+ */
+static int image_record(const image_store_t *store, uint32_t i, const char **name, size_t *name_len,
+                        const uint8_t **blob, size_t *blob_len) {
+    uint64_t offset = get_u64(store->index + (size_t)i * 8);
+    if (offset < IMAGE_HEADER_SIZE || offset + 4 > store->map_size) return -1;
+    uint32_t nlen = get_u32(store->map + offset);
+    if (offset + 4 + nlen + 4 > store->map_size) return -1;
+    uint32_t blen = get_u32(store->map + offset + 4 + nlen);
+    if (offset + 8 + nlen + blen > store->map_size) return -1;
+    *name = (const char *)store->map + offset + 4;
+    *name_len = nlen;
+    *blob = store->map + offset + 8 + nlen;
+    *blob_len = blen;
+    return 0;
+}
+
+/**
+ * @brief Compares a NUL-terminated name with a counted one, like strcmp.
+ */
+static int compare_name(const char *a, const char *b, size_t b_len) {
+    size_t a_len = strlen(a);
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp) return cmp;
+    return a_len < b_len ? -1 : a_len > b_len ? 1 : 0;
+}
+
+/**
+ * @brief Binary-searches the image for a name.
+ * @return 0 if found (blob set), 1 if absent, -1 if the image is corrupt.
+ */
+static int image_find(const image_store_t *store, const char *name, const uint8_t **blob, size_t *blob_len) {
+    uint32_t lo = 0, hi = store->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const char *rec_name;
+        size_t rec_len;
+        if (image_record(store, mid, &rec_name, &rec_len, blob, blob_len) != 0) return -1;
+        int cmp = compare_name(name, rec_name, rec_len);
+        if (cmp == 0) return 0;
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Maps the image file, if there is one.
+ * @return 0 on success (an absent file is an empty store), -1 on failure.
+ */
+static int image_map(image_store_t *store) {
+    int fd = open(store->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < IMAGE_HEADER_SIZE) {
+        close(fd);
+        upkg_util_error("%s is not a package image.\n", store->path);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const uint8_t *p = map;
+    uint32_t count = get_u32(p + 8);
+    uint64_t index_offset = get_u64(p + 16);
+    if (memcmp(p, IMAGE_MAGIC, 8) != 0 || index_offset < IMAGE_HEADER_SIZE ||
+        index_offset > (uint64_t)st.st_size || ((uint64_t)st.st_size - index_offset) / 8 != count) {
+        munmap(map, (size_t)st.st_size);
+        upkg_util_error("%s is not a package image.\n", store->path);
+        return -1;
+    }
+    store->map = map;
+    store->map_size = (size_t)st.st_size;
+    store->count = count;
+    store->index = p + index_offset;
+    return 0;
+}
+
+/**
+ * @brief Unmaps the image.
+ */
+static void image_unmap(image_store_t *store) {
+    if (store->map) munmap(store->map, store->map_size);
+    store->map = NULL;
+    store->map_size = 0;
+    store->count = 0;
+    store->index = NULL;
+}
+
+// --- Pending Changes ---
+
+/**
+ * @brief Returns the pending change for a name, or NULL.
+ */
+static image_change_t *pending_change(const image_store_t *store, const char *name) {
+    const char *slot = upkg_index_lookup(store->pending, name);
+    return slot ? &store->changes[strtoul(slot, NULL, 10)] : NULL;
+}
+
+/**
+ * @brief Records a put (blob non-NULL) or delete, replacing any earlier change.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int pending_set(image_store_t *store, const char *name, uint8_t *blob, size_t len) {
+    image_change_t *change = pending_change(store, name);
+    if (change) {
+        free(change->blob);
+        change->blob = blob;
+        change->len = len;
+        return 0;
+    }
+
+    if (store->change_count == store->change_cap) {
+        size_t cap = store->change_cap ? store->change_cap * 2 : 64;
+        image_change_t *grown = realloc(store->changes, cap * sizeof(*grown));
+        if (!grown) return -1;
+        store->changes = grown;
+        store->change_cap = cap;
+    }
+    char slot[24];
+    snprintf(slot, sizeof(slot), "%zu", store->change_count);
+    change = &store->changes[store->change_count];
+    change->name = strdup(name);
+    if (!change->name || upkg_index_insert(store->pending, name, slot) != 0) {
+        free(change->name);
+        return -1;
+    }
+    change->blob = blob;
+    change->len = len;
+    store->change_count++;
+    return 0;
+}
+
+/**
+ * @brief Drops all pending changes.
+ */
+static void pending_clear(image_store_t *store) {
+    for (size_t i = 0; i < store->change_count; i++) {
+        free(store->changes[i].name);
+        free(store->changes[i].blob);
+    }
+    store->change_count = 0;
+    upkg_index_destroy(store->pending);
+    store->pending = upkg_index_create(64);
+}
+
+/**
+ * @brief qsort comparator for change pointers by name.
+ */
+static int compare_changes(const void *a, const void *b) {
+    return strcmp((*(image_change_t *const *)a)->name, (*(image_change_t *const *)b)->name);
+}
+
+// --- Merged Walk ---
+
+typedef int (*image_walk_fn)(const char *name, size_t name_len, const uint8_t *blob, size_t len, void *user);
+
+/**
+ * @brief Walks the image and the pending changes merged in name order,
+ *        skipping deletions.
+ * @return The number of records walked, or -1 on error.
+ */
+static int image_walk(image_store_t *store, image_walk_fn fn, void *user) {
+    image_change_t **sorted = NULL;
+    if (store->change_count) {
+        sorted = malloc(store->change_count * sizeof(*sorted));
+        if (!sorted) return -1;
+        for (size_t i = 0; i < store->change_count; i++) sorted[i] = &store->changes[i];
+        qsort(sorted, store->change_count, sizeof(*sorted), compare_changes);
+    }
+
+    int walked = 0;
+    uint32_t i = 0;
+    size_t j = 0;
+    while (i < store->count || j < store->change_count) {
+        const char *name = NULL;
+        size_t name_len = 0, len = 0;
+        const uint8_t *blob = NULL;
+        if (i < store->count && image_record(store, i, &name, &name_len, &blob, &len) != 0) {
+            walked = -1;
+            break;
+        }
+
+        int cmp = i == store->count ? 1 : j == store->change_count ? -1
+                : -compare_name(sorted[j]->name, name, name_len);
+        if (cmp < 0) {
+            i++;
+        } else {
+            if (cmp == 0) i++;
+            const image_change_t *change = sorted[j++];
+            if (!change->blob) continue;
+            name = change->name;
+            name_len = strlen(change->name);
+            blob = change->blob;
+            len = change->len;
+        }
+
+        walked++;
+        if (fn(name, name_len, blob, len, user)) break;
+    }
+    free(sorted);
+    return walked;
+}
+
+// --- Backend ---
+
+/**
+ * @brief Opens the image under dir and maps it.
+ */
+static upkg_store_t *image_open(const char *dir) {
+    image_store_t *store = calloc(1, sizeof(*store));
+    if (!store) return NULL;
+    store->path = upkg_util_concat_path(dir, IMAGE_FILE);
+    store->pending = upkg_index_create(64);
+    if (!store->path || !store->pending || upkg_util_create_dir_recursive(dir, 0755) != 0 ||
+        image_map(store) != 0) {
+        upkg_index_destroy(store->pending);
+        free(store->path);
+        free(store);
+        return NULL;
+    }
+    return &store->base;
+}
+
+/**
+ * @brief Looks in the pending changes, then the image.
+ */
+static int image_get(upkg_store_t *base, const char *name, upkg_hash_package_info_t *pkg) {
+    image_store_t *store = (image_store_t *)base;
+    const image_change_t *change = pending_change(store, name);
+    if (change) {
+        return change->blob ? upkg_store_decode(change->blob, change->len, pkg) : 1;
+    }
+
+    const uint8_t *blob;
+    size_t len;
+    int found = image_find(store, name, &blob, &len);
+    return found == 0 ? upkg_store_decode(blob, len, pkg) : found;
+}
+
+/**
+ * @brief Buffers a put until commit.
+ */
+static int image_put(upkg_store_t *base, const upkg_hash_package_info_t *pkg) {
+    uint8_t *blob;
+    size_t len;
+    if (upkg_store_encode(pkg, &blob, &len) != 0) return -1;
+    if (pending_set((image_store_t *)base, pkg->package_name, blob, len) != 0) {
+        free(blob);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Buffers a delete until commit.
+ */
+static int image_del(upkg_store_t *base, const char *name) {
+    return pending_set((image_store_t *)base, name, NULL, 0);
+}
+
+typedef struct {
+    upkg_store_visit_fn visit;
+    void *user;
+    int failed;
+} image_visit_t;
+
+/**
+ * @brief Decodes one walked record and hands it to the visitor.
+ */
+static int visit_record(const char *name, size_t name_len, const uint8_t *blob, size_t len, void *user) {
+    (void)name;
+    (void)name_len;
+    image_visit_t *v = user;
+    upkg_hash_package_info_t pkg;
+    if (upkg_store_decode(blob, len, &pkg) != 0) {
+        v->failed = 1;
+        return 1;
+    }
+    int stop = v->visit(&pkg, v->user);
+    upkg_hash_free_package_info(&pkg);
+    return stop;
+}
+
+/**
+ * @brief Visits the merged image and pending changes.
+ */
+static int image_iterate(upkg_store_t *base, upkg_store_visit_fn visit, void *user) {
+    image_visit_t v = { visit, user, 0 };
+    int walked = image_walk((image_store_t *)base, visit_record, &v);
+    return v.failed ? -1 : walked;
+}
+
+typedef struct {
+    FILE *out;
+    uint64_t offset;
+    uint64_t *offsets;
+    size_t count;
+    size_t cap;
+} image_writer_t;
+
+/**
+ * @brief Appends one record to the new image and remembers its offset.
+ */
+static int write_record(const char *name, size_t name_len, const uint8_t *blob, size_t len, void *user) {
+    image_writer_t *w = user;
+    if (w->count == w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 1024;
+        uint64_t *grown = realloc(w->offsets, cap * sizeof(*grown));
+        if (!grown) return 1;
+        w->offsets = grown;
+        w->cap = cap;
+    }
+    uint8_t nlen[4], blen[4];
+    put_u32(nlen, (uint32_t)name_len);
+    put_u32(blen, (uint32_t)len);
+    if (fwrite(nlen, 1, 4, w->out) != 4 || fwrite(name, 1, name_len, w->out) != name_len ||
+        fwrite(blen, 1, 4, w->out) != 4 || fwrite(blob, 1, len, w->out) != len) {
+        return 1;
+    }
+    w->offsets[w->count++] = w->offset;
+    w->offset += 8 + name_len + len;
+    return 0;
+}
+
+/**
+ * @brief Writes the merged image to a new file, renames it into place and
+ *        maps it.
+ */
+static int image_commit(upkg_store_t *base) {
+    image_store_t *store = (image_store_t *)base;
+    if (store->change_count == 0) return 0;
+
+    size_t tmp_len = strlen(store->path) + 5;
+    char *tmp = malloc(tmp_len);
+    if (!tmp) return -1;
+    snprintf(tmp, tmp_len, "%s.tmp", store->path);
+
+    image_writer_t w = { fopen(tmp, "wb"), IMAGE_HEADER_SIZE, NULL, 0, 0 };
+    if (!w.out) {
+        upkg_util_error("Failed to create %s: %s\n", tmp, strerror(errno));
+        free(tmp);
+        return -1;
+    }
+
+    uint8_t header[IMAGE_HEADER_SIZE] = { 0 };
+    int ret = fwrite(header, 1, sizeof(header), w.out) == sizeof(header) ? 0 : -1;
+    if (ret == 0 && image_walk(store, write_record, &w) != (int)w.count) ret = -1;
+    for (size_t i = 0; i < w.count && ret == 0; i++) {
+        uint8_t b[8];
+        put_u64(b, w.offsets[i]);
+        if (fwrite(b, 1, 8, w.out) != 8) ret = -1;
+    }
+    if (ret == 0) {
+        memcpy(header, IMAGE_MAGIC, 8);
+        put_u32(header + 8, (uint32_t)w.count);
+        put_u64(header + 16, w.offset);
+        if (fseek(w.out, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), w.out) != sizeof(header) ||
+            fflush(w.out) != 0 || fdatasync(fileno(w.out)) != 0) {
+            ret = -1;
+        }
+    }
+    if (fclose(w.out) != 0) ret = -1;
+    free(w.offsets);
+
+    if (ret == 0 && rename(tmp, store->path) != 0) ret = -1;
+    if (ret != 0) {
+        upkg_util_error("Failed to write %s: %s\n", store->path, strerror(errno));
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+
+    image_unmap(store);
+    pending_clear(store);
+    return image_map(store);
+}
+
+/**
+ * @brief Unmaps the image and drops pending changes.
+ */
+static void image_close(upkg_store_t *base) {
+    image_store_t *store = (image_store_t *)base;
+    image_unmap(store);
+    for (size_t i = 0; i < store->change_count; i++) {
+        free(store->changes[i].name);
+        free(store->changes[i].blob);
+    }
+    free(store->changes);
+    upkg_index_destroy(store->pending);
+    free(store->path);
+    free(store);
+}
+
+const upkg_store_backend_t upkg_store_mmap_backend = {
+    .name = "mmap",
+    .open = image_open,
+    .get = image_get,
+    .put = image_put,
+    .del = image_del,
+    .iterate = image_iterate,
+    .commit = image_commit,
+    .close = image_close,
+};
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Filename:    upkg_trace.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: USDT static tracepoints for bpftrace, perf and SystemTap
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_TRACE_H
+#define UPKG_TRACE_H
+
+#include "upkg_metrics.h"
+
+/*
+ * USDT probes under the "upkg" provider. With <sys/sdt.h> (systemtap-sdt-dev)
+ * present each probe compiles to a single nop plus an ELF note, so an
+ * unattached probe costs nothing beyond computing its arguments. Without
+ * the header, or when built with -DUPKG_NO_TRACE, the probes vanish and
+ * their arguments are not evaluated.
+ *
+ *   install__start  (const char *deb_path)
+ *   install__done   (const char *deb_path, const char *package, int result, uint64_t ns)
+ *   extract__member (const char *archive, int64_t size, int result, uint64_t ns)
+ *   file__write     (const char *path, int64_t size, uint64_t ns)
+ *   db__commit      (const char *package, uint64_t files, int result, uint64_t ns)
+ *   command__spawn  (const char *command, int pid)
+ *   command__exit   (const char *command, int pid, int status)
+ *   hash__resize    (uint64_t old_buckets, uint64_t new_buckets, uint64_t count, uint64_t ns)
+ *
+ * List them with `bpftrace -l 'usdt:./upkg:*'`; see trace/ for examples.
+ */
+
+#if !defined(UPKG_NO_TRACE) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define UPKG_TRACE_ENABLED 1
+#endif
+#endif
+
+#ifdef UPKG_TRACE_ENABLED
+#define UPKG_TRACE1(name, a)             DTRACE_PROBE1(upkg, name, a)
+#define UPKG_TRACE2(name, a, b)          DTRACE_PROBE2(upkg, name, a, b)
+#define UPKG_TRACE3(name, a, b, c)       DTRACE_PROBE3(upkg, name, a, b, c)
+#define UPKG_TRACE4(name, a, b, c, d)    DTRACE_PROBE4(upkg, name, a, b, c, d)
+// Timestamp for a probe's duration argument
+#define UPKG_TRACE_NOW()                 upkg_metrics_now_ns()
+#else
+#define UPKG_TRACE1(name, a)             do { (void)sizeof(a); } while (0)
+#define UPKG_TRACE2(name, a, b)          do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define UPKG_TRACE3(name, a, b, c)       do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define UPKG_TRACE4(name, a, b, c, d)    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#define UPKG_TRACE_NOW()                 ((uint64_t)0)
+#endif
+
+#endif // UPKG_TRACE_H
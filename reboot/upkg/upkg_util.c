@@ -21,11 +21,14 @@
  ******************************************************************************/
 
 #include "upkg_util.h"
+#include "upkg_metrics.h"
+#include "upkg_trace.h"
+#include "upkg_vfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <errno.h>
@@ -40,59 +43,103 @@
 #define PATH_MAX 4096
 #endif
 
-// External global variable for verbose logging
-extern bool g_verbose_mode;
+// Verbose logging switch, set by the CLI's -v/--verbose
+bool g_verbose_mode = false;
 
-// --- Logging Functions ---
+// --- Memory Management ---
 
 /**
- * @brief Logging function for verbose output
+ * @brief Frees allocated memory pointed to by a char pointer and sets the pointer to NULL.
+ * @param ptr A pointer to the char pointer that needs to be freed.
  */
-void upkg_util_log_verbose(const char *format, ...) {
-    if (!g_verbose_mode) return;
-    
-    va_list args;
-    va_start(args, format);
-    printf("[VERBOSE] ");
-    vprintf(format, args);
-    va_end(args);
+void upkg_util_free_and_null(char **ptr) {
+    if (ptr != NULL && *ptr != NULL) {
+        free(*ptr);
+        *ptr = NULL;
+    }
 }
 
 /**
- * @brief Logging function for debug output
+ * @brief Frees an array of strings and resets the array pointer and count.
+ * @param list Pointer to the string array.
+ * @param count Pointer to the number of strings in the array.
  */
-void upkg_util_log_debug(const char *format, ...) {
-    if (!g_verbose_mode) return;
-    
-    va_list args;
-    va_start(args, format);
-    printf("[DEBUG] ");
-    vprintf(format, args);
-    va_end(args);
+void upkg_util_free_string_list(char ***list, int *count) {
+    if (!list || !count) return;
+
+    if (*list) {
+        for (int i = 0; i < *count; i++) {
+            free((*list)[i]);
+        }
+        free(*list);
+        *list = NULL;
+    }
+    *count = 0;
 }
 
 /**
- * @brief Prints error messages with formatting support
+ * @brief Makes a deep copy of an array of strings.
+ * @param src The source array (may be NULL when count is 0).
+ * @param count The number of strings in src.
+ * @param dst Output parameter for the copied array (NULL when count is 0).
+ * @return 0 on success, -1 on allocation failure.
  */
-void upkg_util_error(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stderr, "ERROR: ");
-    vfprintf(stderr, format, args);
-    va_end(args);
-}
+int upkg_util_copy_string_list(char *const *src, int count, char ***dst) {
+    if (!dst) return -1;
 
-// --- Memory Management ---
+    *dst = NULL;
+    if (!src || count <= 0) {
+        return 0;
+    }
+
+    char **copy = calloc((size_t)count, sizeof(char *));
+    if (!copy) {
+        upkg_util_error("Failed to allocate memory for string list copy.\n");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        copy[i] = src[i] ? strdup(src[i]) : NULL;
+        if (src[i] && !copy[i]) {
+            int copied = i;
+            upkg_util_free_string_list(&copy, &copied);
+            upkg_util_error("Failed to duplicate string list entry.\n");
+            return -1;
+        }
+    }
+    *dst = copy;
+    return 0;
+}
 
 /**
- * @brief Frees allocated memory pointed to by a char pointer and sets the pointer to NULL.
- * @param ptr A pointer to the char pointer that needs to be freed.
+ * @brief Appends a copy of a string to an array unless it is already present.
+ * @param list Pointer to the string array (grown with realloc).
+ * @param count Pointer to the number of strings in the array.
+ * @param value The string to add.
+ * @return 0 on success (including when already present), -1 on allocation failure.
  */
-void upkg_util_free_and_null(char **ptr) {
-    if (ptr != NULL && *ptr != NULL) {
-        free(*ptr);
-        *ptr = NULL;
+int upkg_util_add_unique_string(char ***list, int *count, const char *value) {
+    if (!list || !count || !value) return -1;
+
+    for (int i = 0; i < *count; i++) {
+        if (strcmp((*list)[i], value) == 0) {
+            return 0;
+        }
     }
+
+    char **new_list = realloc(*list, sizeof(char *) * (size_t)(*count + 1));
+    if (!new_list) {
+        upkg_util_error("Failed to grow string list.\n");
+        return -1;
+    }
+    *list = new_list;
+
+    (*list)[*count] = strdup(value);
+    if (!(*list)[*count]) {
+        upkg_util_error("Failed to duplicate string list entry.\n");
+        return -1;
+    }
+    (*count)++;
+    return 0;
 }
 
 // --- String Manipulation ---
@@ -138,6 +185,42 @@ char *upkg_util_safe_strncpy(char *dest, const char *src, size_t n) {
     return dest;
 }
 
+/**
+ * @brief Parses a byte count with an optional K, M or G (binary) suffix.
+ * @param str The string to parse, e.g. "4M".
+ * @param out Output parameter for the parsed byte count.
+ * @return 0 on success, -1 if the string is not a valid size.
+ */
+int upkg_util_parse_size(const char *str, unsigned long long *out) {
+    if (!str || !out || !isdigit((unsigned char)str[0])) {
+        return -1;
+    }
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (errno != 0) {
+        return -1;
+    }
+
+    unsigned int shift = 0;
+    switch (toupper((unsigned char)*end)) {
+        case '\0': break;
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        default: return -1;
+    }
+    if (shift > 0 && (*end == 'i' || *end == 'I')) end++;
+    if (*end == 'b' || *end == 'B') end++;
+    if (*end != '\0' || (shift > 0 && value > (~0ULL >> shift))) {
+        return -1;
+    }
+
+    *out = value << shift;
+    return 0;
+}
+
 /**
  * @brief Concatenates a directory path and a filename, handling slashes correctly.
  * @param dir The directory path.
@@ -178,7 +261,8 @@ char *upkg_util_concat_path(const char *dir, const char *file) {
  * @return 1 if the file exists, 0 if it does not, -1 if an error occurred.
  */
 int upkg_util_file_exists(const char *filepath) {
-    return (access(filepath, F_OK) == 0);
+    struct stat st;
+    return upkg_vfs->stat(filepath, &st) == 0;
 }
 
 /**
@@ -218,7 +302,7 @@ int upkg_util_create_dir_recursive(const char *path, mode_t mode) {
     for (p = temp_path + 1; *p; p++) {
         if (*p == '/') {
             *p = '\0'; // Temporarily terminate string
-            if (mkdir(temp_path, mode) == -1 && errno != EEXIST) {
+            if (upkg_vfs->mkdir(temp_path, mode) == -1 && errno != EEXIST) {
                 perror("Failed to create directory");
                 fprintf(stderr, "Directory: %s\n", temp_path);
                 ret = -1;
@@ -228,7 +312,7 @@ int upkg_util_create_dir_recursive(const char *path, mode_t mode) {
             *p = '/'; // Restore slash
         }
     }
-    if (ret == 0 && mkdir(temp_path, mode) == -1 && errno != EEXIST) {
+    if (ret == 0 && upkg_vfs->mkdir(temp_path, mode) == -1 && errno != EEXIST) {
         perror("Failed to create final directory");
         fprintf(stderr, "Directory: %s\n", temp_path);
         ret = -1;
@@ -246,38 +330,33 @@ int upkg_util_create_dir_recursive(const char *path, mode_t mode) {
  * The caller is responsible for freeing the returned buffer.
  */
 char *upkg_util_read_file_content(const char *filepath, size_t *len) {
-    FILE *f = fopen(filepath, "rb"); // Open in binary mode for exact size reading
+    if (len) *len = 0;
+    upkg_vfs_file_t *f = upkg_vfs->open(filepath, O_RDONLY, 0);
     if (!f) {
-        if (len) *len = 0;
-        return NULL;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long file_size_long = ftell(f);
-    if (file_size_long == -1) {
-        perror("ftell error");
-        fclose(f);
-        if (len) *len = 0;
         return NULL;
     }
-    size_t file_size = (size_t)file_size_long;
-    fseek(f, 0, SEEK_SET);
 
+    struct stat st;
+    size_t file_size = upkg_vfs->stat(filepath, &st) == 0 ? (size_t)st.st_size : 0;
     char *buffer = (char *)malloc(file_size + 1); // +1 for null terminator
     if (!buffer) {
         upkg_util_error("Memory allocation failed for file content\n");
-        fclose(f);
-        if (len) *len = 0;
+        upkg_vfs->close(f);
         return NULL;
     }
 
-    size_t bytes_read = fread(buffer, 1, file_size, f);
+    size_t bytes_read = 0;
+    while (bytes_read < file_size) {
+        ssize_t n = upkg_vfs->read(f, buffer + bytes_read, file_size - bytes_read);
+        if (n <= 0) break;
+        bytes_read += (size_t)n;
+    }
     if (bytes_read != file_size) {
         upkg_util_log_verbose("Warning: Mismatch in expected vs. actual bytes read for %s\n", filepath);
     }
     buffer[bytes_read] = '\0'; // Null-terminate the content
 
-    fclose(f);
+    upkg_vfs->close(f);
     if (len) *len = bytes_read;
     return buffer;
 }
@@ -289,29 +368,29 @@ char *upkg_util_read_file_content(const char *filepath, size_t *len) {
  * @return 0 on success, -1 on failure.
  */
 int upkg_util_copy_file(const char *source_path, const char *destination_path) {
-    FILE *src, *dest;
-    char buffer[4096]; // Buffer for reading/writing chunks
-    size_t bytes;
+    upkg_vfs_file_t *src, *dest;
+    char buffer[65536]; // Buffer for reading/writing chunks
+    ssize_t bytes;
     int ret = 0;
 
-    src = fopen(source_path, "rb"); // Open source file in binary read mode
+    src = upkg_vfs->open(source_path, O_RDONLY, 0);
     if (!src) {
         perror("Error opening source file for copy");
         fprintf(stderr, "Source: %s\n", source_path);
         return -1;
     }
 
-    dest = fopen(destination_path, "wb"); // Open destination file in binary write mode
+    dest = upkg_vfs->open(destination_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (!dest) {
         perror("Error opening destination file for copy");
         fprintf(stderr, "Destination: %s\n", destination_path);
-        fclose(src); // Ensure source file is closed
+        upkg_vfs->close(src); // Ensure source file is closed
         return -1;
     }
 
     // Read from source and write to destination in chunks
-    while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-        if (fwrite(buffer, 1, bytes, dest) != bytes) {
+    while ((bytes = upkg_vfs->read(src, buffer, sizeof(buffer))) > 0) {
+        if (upkg_vfs->write(dest, buffer, (size_t)bytes) != bytes) {
             perror("Error writing to destination file during copy");
             ret = -1;
             break;
@@ -319,19 +398,19 @@ int upkg_util_copy_file(const char *source_path, const char *destination_path) {
     }
 
     // Check for read errors on the source file
-    if (ferror(src)) {
+    if (bytes < 0) {
         perror("Error reading from source file during copy");
         ret = -1;
     }
 
-    fclose(src);  // Close both file streams
-    fclose(dest);
+    upkg_vfs->close(src);  // Close both files
+    if (upkg_vfs->close(dest) != 0) ret = -1;
 
     // Preserve permissions: get source permissions and apply to destination
     struct stat st;
-    if (stat(source_path, &st) == 0) {
+    if (upkg_vfs->stat(source_path, &st) == 0) {
         // Apply only the permission bits (0777 mask) from the source file mode.
-        if (chmod(destination_path, st.st_mode & 0777) == -1) {
+        if (upkg_vfs->chmod(destination_path, st.st_mode & 0777) == -1) {
             perror("Warning: Could not set permissions on copied file");
             // Do not return -1 for this warning, as the file content is already copied.
         }
@@ -342,6 +421,39 @@ int upkg_util_copy_file(const char *source_path, const char *destination_path) {
     return ret;
 }
 
+/**
+ * @brief Writes a buffer to a file through a temporary name and rename().
+ * @param path The final file path.
+ * @param data The contents.
+ * @param len The number of bytes in data.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_util_write_file_atomic(const char *path, const char *data, size_t len) {
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        upkg_util_error("Database path too long: %s\n", path);
+        return -1;
+    }
+
+    upkg_vfs_file_t *f = upkg_vfs->open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (!f) {
+        upkg_util_error("Failed to open '%s' for writing: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+    if ((len > 0 && upkg_vfs->write(f, data, len) != (ssize_t)len) || upkg_vfs->sync(f) != 0) {
+        upkg_util_error("Failed to write '%s': %s\n", tmp_path, strerror(errno));
+        upkg_vfs->close(f);
+        upkg_vfs->unlink(tmp_path);
+        return -1;
+    }
+    if (upkg_vfs->close(f) != 0 || upkg_vfs->rename(tmp_path, path) != 0) {
+        upkg_util_error("Failed to move '%s' into place: %s\n", path, strerror(errno));
+        upkg_vfs->unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
 // --- Configuration File Operations ---
 
 /**
@@ -440,6 +552,51 @@ char *upkg_util_get_config_value(const char *filepath, const char *key, char sep
  * @return 0 on successful command execution, or a non-zero exit status/error code on failure.
  */
 int upkg_util_execute_command(const char *command_path, char *const argv[]) {
+    return upkg_util_execute_command_in(NULL, command_path, argv);
+}
+
+/**
+ * @brief Executes an external command in a child process started in dir.
+ * @param dir The child's working directory, or NULL to inherit.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @return 0 on successful command execution, or a non-zero exit status/error code on failure.
+ */
+int upkg_util_execute_command_in(const char *dir, const char *command_path, char *const argv[]) {
+    uint64_t start = upkg_metrics_now_ns();
+    pid_t pid = upkg_util_spawn_command_in(dir, command_path, argv, -1, -1);
+    if (pid == -1) {
+        return -1;
+    }
+    int ret = upkg_util_wait_command(pid, command_path);
+    upkg_metrics_observe_since(UPKG_METRIC_COMMAND_SECONDS, start);
+    return ret;
+}
+
+/**
+ * @brief Starts an external command in a child process with optional stdin/stdout redirection.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @param stdin_fd File descriptor to use as the child's stdin, or -1 to inherit.
+ * @param stdout_fd File descriptor to use as the child's stdout, or -1 to inherit.
+ * @return The child's pid on success, -1 on failure.
+ */
+pid_t upkg_util_spawn_command(const char *command_path, char *const argv[], int stdin_fd, int stdout_fd) {
+    return upkg_util_spawn_command_in(NULL, command_path, argv, stdin_fd, stdout_fd);
+}
+
+/**
+ * @brief Starts an external command in a child process whose working
+ *        directory is dir; the caller's directory is left alone.
+ * @param dir The child's working directory, or NULL to inherit.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @param stdin_fd File descriptor to use as the child's stdin, or -1 to inherit.
+ * @param stdout_fd File descriptor to use as the child's stdout, or -1 to inherit.
+ * @return The child's pid on success, -1 on failure.
+ */
+pid_t upkg_util_spawn_command_in(const char *dir, const char *command_path, char *const argv[],
+                                 int stdin_fd, int stdout_fd) {
     upkg_util_log_debug("Executing command: %s\n", command_path);
     pid_t pid = fork();
 
@@ -447,30 +604,52 @@ int upkg_util_execute_command(const char *command_path, char *const argv[]) {
         perror("Failed to fork process");
         return -1;
     } else if (pid == 0) { // Child process
+        if (dir && chdir(dir) != 0) {
+            perror("Failed to change directory");
+            _exit(1);
+        }
+        if (stdin_fd >= 0 && stdin_fd != STDIN_FILENO) {
+            if (dup2(stdin_fd, STDIN_FILENO) == -1) _exit(1);
+        }
+        if (stdout_fd >= 0 && stdout_fd != STDOUT_FILENO) {
+            if (dup2(stdout_fd, STDOUT_FILENO) == -1) _exit(1);
+        }
         execv(command_path, argv);
         // If execv returns, an error occurred
         perror("Failed to execute command");
         _exit(1); // Exit child process with error status
-    } else { // Parent process
-        int status;
-        if (waitpid(pid, &status, 0) == -1) {
-            perror("Failed to wait for child process");
-            return -1;
-        }
-        if (WIFEXITED(status)) {
-            if (WEXITSTATUS(status) == 0) {
-                upkg_util_log_debug("Command '%s' succeeded.\n", command_path);
-                return 0; // Command succeeded
-            } else {
-                upkg_util_error("Command exited with non-zero status: %d\n", WEXITSTATUS(status));
-                fprintf(stderr, "  Command: %s\n", command_path);
-                return WEXITSTATUS(status);
-            }
-        } else if (WIFSIGNALED(status)) {
-            upkg_util_error("Command terminated by signal: %d\n", WTERMSIG(status));
+    }
+    UPKG_TRACE2(command__spawn, command_path, (int)pid);
+    return pid;
+}
+
+/**
+ * @brief Waits for a child process started by upkg_util_spawn_command.
+ * @param pid The child's pid.
+ * @param command_path The executable path, used for error messages.
+ * @return 0 if the command exited successfully, its non-zero exit status, or -1 on error.
+ */
+int upkg_util_wait_command(pid_t pid, const char *command_path) {
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno == EINTR) continue;
+        perror("Failed to wait for child process");
+        return -1;
+    }
+    UPKG_TRACE3(command__exit, command_path, (int)pid, status);
+    if (WIFEXITED(status)) {
+        if (WEXITSTATUS(status) == 0) {
+            upkg_util_log_debug("Command '%s' succeeded.\n", command_path);
+            return 0; // Command succeeded
+        } else {
+            upkg_util_error("Command exited with non-zero status: %d\n", WEXITSTATUS(status));
             fprintf(stderr, "  Command: %s\n", command_path);
-            return -1;
+            return WEXITSTATUS(status);
         }
+    } else if (WIFSIGNALED(status)) {
+        upkg_util_error("Command terminated by signal: %d\n", WTERMSIG(status));
+        fprintf(stderr, "  Command: %s\n", command_path);
+        return -1;
     }
     return -1; // Should not reach here if fork/exec/wait logic is sound
 }
@@ -500,23 +679,6 @@ static int extract_deb_archive(const char *deb_path, const char *destination_dir
         return -1;
     }
 
-    // Save current working directory
-    char current_dir[PATH_MAX];
-    if (getcwd(current_dir, sizeof(current_dir)) == NULL) {
-        perror("getcwd failed");
-        upkg_util_error("Failed to get current working directory.\n");
-        free(absolute_deb_path);
-        return -1;
-    }
-
-    // Change to the destination directory where 'ar' will extract files
-    if (chdir(destination_dir) != 0) {
-        perror("Failed to change directory for .deb extraction");
-        upkg_util_error("Could not change to '%s'.\n", destination_dir);
-        free(absolute_deb_path);
-        return -1;
-    }
-
     char *ar_path = "/usr/bin/ar"; // Standard path for 'ar' utility
 
     // Arguments for 'ar -x <deb_file>' - use absolute path
@@ -527,14 +689,8 @@ static int extract_deb_archive(const char *deb_path, const char *destination_dir
         NULL
     };
 
-    // Execute the 'ar' command
-    int result = upkg_util_execute_command(ar_path, argv_ar);
-
-    // Change back to the original directory
-    if (chdir(current_dir) != 0) {
-        perror("Failed to change back to original directory");
-        upkg_util_log_verbose("Continuing, but directory state is unexpected.\n");
-    }
+    // Execute the 'ar' command; it extracts into its working directory, which only the child changes
+    int result = upkg_util_execute_command_in(destination_dir, ar_path, argv_ar);
 
     // Clean up the absolute path
     free(absolute_deb_path);
@@ -631,21 +787,6 @@ static int extract_tar_archive(const char *archive_path, const char *destination
         return -1;
     }
 
-    // Save current working directory
-    char current_dir[PATH_MAX];
-    if (getcwd(current_dir, sizeof(current_dir)) == NULL) {
-        perror("getcwd failed");
-        upkg_util_error("Failed to get current working directory.\n");
-        return -1;
-    }
-
-    // Change to the destination directory where 'tar' will extract files
-    if (chdir(destination_dir) != 0) {
-        perror("Failed to change directory for tar extraction");
-        upkg_util_error("Could not change to '%s'.\n", destination_dir);
-        return -1;
-    }
-
     char *tar_path = "/usr/bin/tar"; // Standard path for 'tar' utility
 
     // Arguments for 'tar -xf <archive_file>'
@@ -656,14 +797,12 @@ static int extract_tar_archive(const char *archive_path, const char *destination
         NULL
     };
 
-    // Execute the 'tar' command
-    int result = upkg_util_execute_command(tar_path, argv_tar);
-
-    // Change back to the original directory
-    if (chdir(current_dir) != 0) {
-        perror("Failed to change back to original directory");
-        upkg_util_log_verbose("Continuing, but directory state is unexpected.\n");
-    }
+    // Execute the 'tar' command; like 'ar', only the child changes directory
+    struct stat archive_st;
+    int64_t archive_size = stat(archive_path, &archive_st) == 0 ? (int64_t)archive_st.st_size : -1;
+    uint64_t trace_start = UPKG_TRACE_NOW();
+    int result = upkg_util_execute_command_in(destination_dir, tar_path, argv_tar);
+    UPKG_TRACE4(extract__member, archive_path, archive_size, result, UPKG_TRACE_NOW() - trace_start);
 
     if (result != 0) {
         upkg_util_error("Failed to execute 'tar' for archive extraction.\n");
@@ -26,36 +26,53 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include "upkg_log.h"
 
 // Define PATH_MAX if not defined
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
-// --- Logging Functions ---
+// --- Logging Macros ---
+// Arguments are only evaluated when the level is enabled (see upkg_log.h)
+
+#define upkg_util_log_verbose(...) UPKG_LOG(UPKG_LOG_VERBOSE, __VA_ARGS__)
+#define upkg_util_log_debug(...)   UPKG_LOG(UPKG_LOG_DEBUG, __VA_ARGS__)
+#define upkg_util_error(...)       UPKG_LOG(UPKG_LOG_ERROR, __VA_ARGS__)
+
+// --- Memory Management ---
 
 /**
- * @brief Logging function for verbose output
+ * @brief Frees allocated memory pointed to by a char pointer and sets the pointer to NULL.
+ * @param ptr A pointer to the char pointer that needs to be freed.
  */
-void upkg_util_log_verbose(const char *format, ...);
+void upkg_util_free_and_null(char **ptr);
 
 /**
- * @brief Logging function for debug output
+ * @brief Frees an array of strings and resets the array pointer and count.
+ * @param list Pointer to the string array.
+ * @param count Pointer to the number of strings in the array.
  */
-void upkg_util_log_debug(const char *format, ...);
+void upkg_util_free_string_list(char ***list, int *count);
 
 /**
- * @brief Prints error messages with formatting support
+ * @brief Makes a deep copy of an array of strings.
+ * @param src The source array (may be NULL when count is 0).
+ * @param count The number of strings in src.
+ * @param dst Output parameter for the copied array (NULL when count is 0).
+ * @return 0 on success, -1 on allocation failure.
  */
-void upkg_util_error(const char *format, ...);
-
-// --- Memory Management ---
+int upkg_util_copy_string_list(char *const *src, int count, char ***dst);
 
 /**
- * @brief Frees allocated memory pointed to by a char pointer and sets the pointer to NULL.
- * @param ptr A pointer to the char pointer that needs to be freed.
+ * @brief Appends a copy of a string to an array unless it is already present.
+ * @param list Pointer to the string array (grown with realloc).
+ * @param count Pointer to the number of strings in the array.
+ * @param value The string to add.
+ * @return 0 on success (including when already present), -1 on allocation failure.
  */
-void upkg_util_free_and_null(char **ptr);
+int upkg_util_add_unique_string(char ***list, int *count, const char *value);
 
 // --- String Manipulation ---
 
@@ -75,6 +92,14 @@ char *upkg_util_trim_whitespace(char *str);
  */
 char *upkg_util_safe_strncpy(char *dest, const char *src, size_t n);
 
+/**
+ * @brief Parses a byte count with an optional K, M or G (binary) suffix.
+ * @param str The string to parse, e.g. "4M".
+ * @param out Output parameter for the parsed byte count.
+ * @return 0 on success, -1 if the string is not a valid size.
+ */
+int upkg_util_parse_size(const char *str, unsigned long long *out);
+
 /**
  * @brief Concatenates a directory path and a filename, handling slashes correctly.
  * @param dir The directory path.
@@ -118,6 +143,15 @@ char *upkg_util_read_file_content(const char *filepath, size_t *len);
  */
 int upkg_util_copy_file(const char *source_path, const char *destination_path);
 
+/**
+ * @brief Writes a buffer to a file through a temporary name and rename().
+ * @param path The final file path.
+ * @param data The contents.
+ * @param len The number of bytes in data.
+ * @return 0 on success, -1 on failure.
+ */
+int upkg_util_write_file_atomic(const char *path, const char *data, size_t len);
+
 // --- Configuration File Operations ---
 
 /**
@@ -155,4 +189,45 @@ int upkg_util_extract_deb_complete(const char *deb_path, const char *extract_dir
  */
 int upkg_util_execute_command(const char *command_path, char *const argv[]);
 
+/**
+ * @brief Like upkg_util_execute_command, but runs the child in another
+ *        working directory without changing the caller's, so extractions
+ *        can run on several threads at once.
+ * @param dir The child's working directory, or NULL to inherit.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @return 0 on successful command execution, or a non-zero exit status/error code on failure.
+ */
+int upkg_util_execute_command_in(const char *dir, const char *command_path, char *const argv[]);
+
+/**
+ * @brief Starts an external command in a child process with optional stdin/stdout redirection.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @param stdin_fd File descriptor to use as the child's stdin, or -1 to inherit.
+ * @param stdout_fd File descriptor to use as the child's stdout, or -1 to inherit.
+ * @return The child's pid on success, -1 on failure.
+ */
+pid_t upkg_util_spawn_command(const char *command_path, char *const argv[], int stdin_fd, int stdout_fd);
+
+/**
+ * @brief Like upkg_util_spawn_command, with the child started in dir.
+ * @param dir The child's working directory, or NULL to inherit.
+ * @param command_path The absolute path to the executable.
+ * @param argv An array of null-terminated strings for the arguments.
+ * @param stdin_fd File descriptor to use as the child's stdin, or -1 to inherit.
+ * @param stdout_fd File descriptor to use as the child's stdout, or -1 to inherit.
+ * @return The child's pid on success, -1 on failure.
+ */
+pid_t upkg_util_spawn_command_in(const char *dir, const char *command_path, char *const argv[],
+                                 int stdin_fd, int stdout_fd);
+
+/**
+ * @brief Waits for a child process started by upkg_util_spawn_command.
+ * @param pid The child's pid.
+ * @param command_path The executable path, used for error messages.
+ * @return 0 if the command exited successfully, its non-zero exit status, or -1 on error.
+ */
+int upkg_util_wait_command(pid_t pid, const char *command_path);
+
 #endif // UPKG_UTIL_H
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Filename:    upkg_vfs.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: The POSIX filesystem backend and the current-backend switch
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_vfs.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+
+const upkg_vfs_ops_t *upkg_vfs = &upkg_vfs_posix;
+
+struct upkg_vfs_file {
+    int fd;
+};
+
+struct upkg_vfs_dir {
+    DIR *dp;
+};
+
+/**
+ * @brief Switches the filesystem backend.
+ */
+void upkg_vfs_use(const upkg_vfs_ops_t *ops) {
+    upkg_vfs = ops ? ops : &upkg_vfs_posix;
+}
+
+// --- POSIX Backend ---
+
+/**
+ * @brief open(2) wrapped in a file handle.
+ */
+static upkg_vfs_file_t *posix_open(const char *path, int flags, mode_t mode) {
+    upkg_vfs_file_t *file = malloc(sizeof(*file));
+    if (!file) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->fd = open(path, flags | O_CLOEXEC, mode);
+    if (file->fd < 0) {
+        int saved = errno;
+        free(file);
+        errno = saved;
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * @brief read(2), retried on EINTR.
+ */
+static ssize_t posix_read(upkg_vfs_file_t *file, void *buf, size_t len) {
+    ssize_t n;
+    do {
+        n = read(file->fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+/**
+ * @brief write(2) until everything is written.
+ */
+static ssize_t posix_write(upkg_vfs_file_t *file, const void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(file->fd, (const char *)buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+/**
+ * @brief fsync(2).
+ */
+static int posix_sync(upkg_vfs_file_t *file) {
+    return fsync(file->fd);
+}
+
+/**
+ * @brief close(2) and free the handle.
+ */
+static int posix_close(upkg_vfs_file_t *file) {
+    int ret = close(file->fd);
+    free(file);
+    return ret;
+}
+
+/**
+ * @brief opendir(3) wrapped in a handle.
+ */
+static upkg_vfs_dir_t *posix_opendir(const char *path) {
+    DIR *dp = opendir(path);
+    if (!dp) return NULL;
+    upkg_vfs_dir_t *dir = malloc(sizeof(*dir));
+    if (!dir) {
+        closedir(dp);
+        errno = ENOMEM;
+        return NULL;
+    }
+    dir->dp = dp;
+    return dir;
+}
+
+/**
+ * @brief readdir(3), skipping "." and "..".
+ */
+static const char *posix_readdir(upkg_vfs_dir_t *dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir->dp)) != NULL) {
+        const char *n = entry->d_name;
+        if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0'))) continue;
+        return n;
+    }
+    return NULL;
+}
+
+/**
+ * @brief closedir(3) and free the handle.
+ */
+static void posix_closedir(upkg_vfs_dir_t *dir) {
+    closedir(dir->dp);
+    free(dir);
+}
+
+const upkg_vfs_ops_t upkg_vfs_posix = {
+    .name = "posix",
+    .stat = stat,
+    .lstat = lstat,
+    .mkdir = mkdir,
+    .rmdir = rmdir,
+    .unlink = unlink,
+    .rename = rename,
+    .symlink = symlink,
+    .readlink = readlink,
+    .chmod = chmod,
+    .open = posix_open,
+    .read = posix_read,
+    .write = posix_write,
+    .sync = posix_sync,
+    .close = posix_close,
+    .opendir = posix_opendir,
+    .readdir = posix_readdir,
+    .closedir = posix_closedir,
+};
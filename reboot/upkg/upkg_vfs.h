@@ -0,0 +1,96 @@
+/******************************************************************************
+ * Filename:    upkg_vfs.h
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: Filesystem operations table with POSIX and in-memory backends
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+#ifndef UPKG_VFS_H
+#define UPKG_VFS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * The install, remove, record store and manifest code reach the filesystem
+ * through upkg_vfs instead of calling libc directly. The POSIX backend is
+ * the default; the memory backend keeps a whole tree in RAM so those code
+ * paths can be benchmarked without disk I/O or page-cache noise, with
+ * inode numbers and timestamps from a counter so runs are repeatable.
+ *
+ * Every function follows its POSIX namesake: -1 (or NULL) with errno set
+ * on failure. open takes O_RDONLY, or O_WRONLY with O_CREAT, O_TRUNC and
+ * O_EXCL. Extraction (dpkg-deb/tar child processes), generation snapshots,
+ * history and the database lock stay on the real filesystem.
+ */
+
+typedef struct upkg_vfs_file upkg_vfs_file_t;
+typedef struct upkg_vfs_dir upkg_vfs_dir_t;
+
+// --- Operations Table ---
+typedef struct {
+    const char *name;
+    int (*stat)(const char *path, struct stat *st);
+    int (*lstat)(const char *path, struct stat *st);
+    int (*mkdir)(const char *path, mode_t mode);
+    int (*rmdir)(const char *path);
+    int (*unlink)(const char *path);
+    int (*rename)(const char *from, const char *to);
+    int (*symlink)(const char *target, const char *path);
+    ssize_t (*readlink)(const char *path, char *buf, size_t size);
+    int (*chmod)(const char *path, mode_t mode);
+    upkg_vfs_file_t *(*open)(const char *path, int flags, mode_t mode);
+    ssize_t (*read)(upkg_vfs_file_t *file, void *buf, size_t len);
+    ssize_t (*write)(upkg_vfs_file_t *file, const void *buf, size_t len);
+    int (*sync)(upkg_vfs_file_t *file);
+    int (*close)(upkg_vfs_file_t *file);
+    upkg_vfs_dir_t *(*opendir)(const char *path);
+    const char *(*readdir)(upkg_vfs_dir_t *dir);   // Skips "." and ".."; NULL at the end
+    void (*closedir)(upkg_vfs_dir_t *dir);
+} upkg_vfs_ops_t;
+
+// --- Global Variables ---
+extern const upkg_vfs_ops_t upkg_vfs_posix;
+extern const upkg_vfs_ops_t upkg_vfs_memory;
+extern const upkg_vfs_ops_t *upkg_vfs;          // The backend in use; &upkg_vfs_posix by default
+
+// --- Function Prototypes ---
+
+/**
+ * @brief Switches the filesystem backend. Not thread-safe; call before
+ *        any other upkg work starts.
+ * @param ops The backend, or NULL for POSIX.
+ */
+void upkg_vfs_use(const upkg_vfs_ops_t *ops);
+
+/**
+ * @brief Empties the memory backend back to a lone "/" and restarts its
+ *        inode and clock counters.
+ */
+void upkg_vfs_memory_reset(void);
+
+/**
+ * @brief Reports the memory backend's size.
+ * @param files Output: number of nodes (files, directories, symlinks), or NULL.
+ * @return The total bytes of file contents held.
+ */
+size_t upkg_vfs_memory_usage(size_t *files);
+
+#endif // UPKG_VFS_H
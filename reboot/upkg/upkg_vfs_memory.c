@@ -0,0 +1,733 @@
+/******************************************************************************
+ * Filename:    upkg_vfs_memory.c
+ * Author:      <michkochris@gmail.com>
+ * Date:        started 10-18-2026
+ * Description: In-memory filesystem backend for deterministic benchmarks
+ *
+ * Copyright (c) 2025 upkg (ulinux) All rights reserved.
+ * GPLV3
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+
+#include "upkg_vfs.h"
+#include "upkg_hash.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+/*
+ * Nodes are found by full normalized path in one hash table and linked
+ * into their parent's child list for readdir. Intermediate symlinks are
+ * not followed (lookups through them fail with ENOTDIR); stat follows a
+ * final symlink. Directories cannot be renamed. One mutex serializes
+ * every operation.
+ */
+
+#define MEMFS_INITIAL_BUCKETS 1024
+#define MEMFS_SYMLINK_HOPS 8
+
+typedef struct memfs_node {
+    char *path;                     // Normalized, "/" for the root
+    mode_t mode;
+    ino_t ino;
+    struct timespec mtime;
+    uint8_t *data;                  // File contents or symlink target
+    size_t size;
+    size_t cap;
+    int open_count;
+    bool unlinked;                  // Freed on last close
+    struct memfs_node *parent;
+    struct memfs_node *first_child;
+    struct memfs_node *prev_sibling;
+    struct memfs_node *next_sibling;
+    struct memfs_node *hash_next;
+} memfs_node_t;
+
+struct upkg_vfs_file {
+    memfs_node_t *node;
+    size_t pos;
+    bool writable;
+};
+
+struct upkg_vfs_dir {
+    char **names;
+    size_t count;
+    size_t next;
+};
+
+static pthread_mutex_t g_memfs_lock = PTHREAD_MUTEX_INITIALIZER;
+static memfs_node_t **g_buckets = NULL;
+static size_t g_bucket_count = 0;
+static size_t g_node_count = 0;
+static size_t g_data_bytes = 0;
+static ino_t g_next_ino = 1;
+static time_t g_clock = 0;
+
+// --- Paths ---
+
+/**
+ * @brief Normalizes a path: absolute, no empty, "." or ".." components,
+ *        no trailing slash.
+ * @return The path (caller frees), or NULL with errno set.
+ */
+static char *normalize(const char *path) {
+    if (!path || path[0] != '/') {
+        errno = path ? ENOENT : EFAULT;
+        return NULL;
+    }
+    size_t len = strlen(path);
+    char *out = malloc(len + 2);
+    if (!out) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t o = 0;
+    const char *p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *start = p;
+        while (*p && *p != '/') p++;
+        size_t n = (size_t)(p - start);
+        if (n == 0 || (n == 1 && start[0] == '.')) continue;
+        if (n == 2 && start[0] == '.' && start[1] == '.') {
+            while (o > 0 && out[o - 1] != '/') o--;
+            if (o > 0) o--;
+            continue;
+        }
+        out[o++] = '/';
+        memcpy(out + o, start, n);
+        o += n;
+    }
+    if (o == 0) out[o++] = '/';
+    out[o] = '\0';
+    return out;
+}
+
+/**
+ * @brief Returns a pointer to the last component of a normalized path.
+ */
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// --- Node Table ---
+
+/**
+ * @brief Looks up a normalized path.
+ */
+static memfs_node_t *table_find(const char *path) {
+    if (!g_bucket_count) return NULL;
+    for (memfs_node_t *n = g_buckets[upkg_hash_fnv1a(path) % g_bucket_count]; n; n = n->hash_next) {
+        if (strcmp(n->path, path) == 0) return n;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds a node to the table, growing it when the load passes one.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int table_add(memfs_node_t *node) {
+    if (g_node_count + 1 > g_bucket_count) {
+        size_t count = g_bucket_count ? g_bucket_count * 2 : MEMFS_INITIAL_BUCKETS;
+        memfs_node_t **buckets = calloc(count, sizeof(*buckets));
+        if (!buckets) return -1;
+        for (size_t b = 0; b < g_bucket_count; b++) {
+            memfs_node_t *n = g_buckets[b];
+            while (n) {
+                memfs_node_t *next = n->hash_next;
+                size_t slot = upkg_hash_fnv1a(n->path) % count;
+                n->hash_next = buckets[slot];
+                buckets[slot] = n;
+                n = next;
+            }
+        }
+        free(g_buckets);
+        g_buckets = buckets;
+        g_bucket_count = count;
+    }
+    size_t slot = upkg_hash_fnv1a(node->path) % g_bucket_count;
+    node->hash_next = g_buckets[slot];
+    g_buckets[slot] = node;
+    g_node_count++;
+    return 0;
+}
+
+/**
+ * @brief Removes a node from the table.
+ */
+static void table_remove(memfs_node_t *node) {
+    memfs_node_t **link = &g_buckets[upkg_hash_fnv1a(node->path) % g_bucket_count];
+    while (*link && *link != node) link = &(*link)->hash_next;
+    if (*link) {
+        *link = node->hash_next;
+        g_node_count--;
+    }
+}
+
+// --- Nodes ---
+
+/**
+ * @brief Frees a node's memory.
+ */
+static void node_free(memfs_node_t *node) {
+    g_data_bytes -= S_ISREG(node->mode) ? node->size : 0;
+    free(node->data);
+    free(node->path);
+    free(node);
+}
+
+/**
+ * @brief Unlinks a node from its parent and the table; frees it unless open.
+ */
+static void node_detach(memfs_node_t *node) {
+    table_remove(node);
+    if (node->prev_sibling) node->prev_sibling->next_sibling = node->next_sibling;
+    else if (node->parent) node->parent->first_child = node->next_sibling;
+    if (node->next_sibling) node->next_sibling->prev_sibling = node->prev_sibling;
+    node->parent = NULL;
+    node->prev_sibling = node->next_sibling = NULL;
+    node->unlinked = true;
+    if (node->open_count == 0) node_free(node);
+}
+
+/**
+ * @brief Finds the parent directory of a normalized path.
+ * @return The parent, or NULL with errno set.
+ */
+static memfs_node_t *find_parent(const char *path) {
+    if (strcmp(path, "/") == 0) {
+        errno = EEXIST;
+        return NULL;
+    }
+    const char *slash = strrchr(path, '/');
+    char *parent_path = strndup(path, slash == path ? 1 : (size_t)(slash - path));
+    if (!parent_path) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memfs_node_t *parent = table_find(parent_path);
+    free(parent_path);
+    if (!parent) {
+        errno = ENOENT;
+        return NULL;
+    }
+    if (!S_ISDIR(parent->mode)) {
+        errno = ENOTDIR;
+        return NULL;
+    }
+    return parent;
+}
+
+/**
+ * @brief Creates a node under its parent.
+ * @return The node, or NULL with errno set.
+ */
+static memfs_node_t *node_create(const char *path, mode_t mode) {
+    memfs_node_t *parent = find_parent(path);
+    if (!parent) return NULL;
+    if (table_find(path)) {
+        errno = EEXIST;
+        return NULL;
+    }
+
+    memfs_node_t *node = calloc(1, sizeof(*node));
+    if (node) node->path = strdup(path);
+    if (!node || !node->path || table_add(node) != 0) {
+        if (node) free(node->path);
+        free(node);
+        errno = ENOMEM;
+        return NULL;
+    }
+    node->mode = mode;
+    node->ino = g_next_ino++;
+    node->mtime.tv_sec = ++g_clock;
+    node->parent = parent;
+    node->next_sibling = parent->first_child;
+    if (parent->first_child) parent->first_child->prev_sibling = node;
+    parent->first_child = node;
+    parent->mtime.tv_sec = g_clock;
+    return node;
+}
+
+/**
+ * @brief Creates the root directory if the table is empty.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int ensure_root(void) {
+    if (table_find("/")) return 0;
+    memfs_node_t *root = calloc(1, sizeof(*root));
+    if (root) root->path = strdup("/");
+    if (!root || !root->path || table_add(root) != 0) {
+        if (root) free(root->path);
+        free(root);
+        errno = ENOMEM;
+        return -1;
+    }
+    root->mode = S_IFDIR | 0755;
+    root->ino = g_next_ino++;
+    return 0;
+}
+
+/**
+ * @brief Looks up a path, optionally following a final symlink.
+ * @return The node, or NULL with errno set.
+ */
+static memfs_node_t *lookup(const char *path, bool follow) {
+    if (ensure_root() != 0) return NULL;
+    char *norm = normalize(path);
+    if (!norm) return NULL;
+
+    memfs_node_t *node = NULL;
+    for (int hops = 0;; hops++) {
+        node = table_find(norm);
+        if (!node || !follow || !S_ISLNK(node->mode)) break;
+        if (hops == MEMFS_SYMLINK_HOPS) {
+            free(norm);
+            errno = ELOOP;
+            return NULL;
+        }
+
+        // Resolve the target relative to the link's directory
+        size_t dir_len = (size_t)(base_name(norm) - norm);
+        char *target = malloc(dir_len + node->size + 2);
+        if (!target) {
+            free(norm);
+            errno = ENOMEM;
+            return NULL;
+        }
+        if (node->size > 0 && node->data[0] == '/') {
+            memcpy(target, node->data, node->size);
+            target[node->size] = '\0';
+        } else {
+            memcpy(target, norm, dir_len);
+            memcpy(target + dir_len, node->data, node->size);
+            target[dir_len + node->size] = '\0';
+        }
+        free(norm);
+        norm = normalize(target);
+        free(target);
+        if (!norm) return NULL;
+    }
+    if (!node) errno = ENOENT;
+    free(norm);
+    return node;
+}
+
+/**
+ * @brief Fills a stat buffer from a node.
+ */
+static void fill_stat(const memfs_node_t *node, struct stat *st) {
+    memset(st, 0, sizeof(*st));
+    st->st_mode = node->mode;
+    st->st_ino = node->ino;
+    st->st_nlink = 1;
+    st->st_size = (off_t)node->size;
+    st->st_mtim = node->mtime;
+    st->st_ctim = node->mtime;
+    st->st_atim = node->mtime;
+}
+
+// --- Operations ---
+
+/**
+ * @brief stat(2) over the memory tree.
+ */
+static int mem_stat(const char *path, struct stat *st) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, true);
+    if (node) fill_stat(node, st);
+    pthread_mutex_unlock(&g_memfs_lock);
+    return node ? 0 : -1;
+}
+
+/**
+ * @brief lstat(2) over the memory tree.
+ */
+static int mem_lstat(const char *path, struct stat *st) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, false);
+    if (node) fill_stat(node, st);
+    pthread_mutex_unlock(&g_memfs_lock);
+    return node ? 0 : -1;
+}
+
+/**
+ * @brief Creates a node of the given type at path.
+ * @return The node, or NULL with errno set. Called with the lock held.
+ */
+static memfs_node_t *create_at(const char *path, mode_t mode) {
+    if (ensure_root() != 0) return NULL;
+    char *norm = normalize(path);
+    if (!norm) return NULL;
+    memfs_node_t *node = node_create(norm, mode);
+    free(norm);
+    return node;
+}
+
+/**
+ * @brief mkdir(2) over the memory tree.
+ */
+static int mem_mkdir(const char *path, mode_t mode) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = create_at(path, S_IFDIR | (mode & 07777));
+    pthread_mutex_unlock(&g_memfs_lock);
+    return node ? 0 : -1;
+}
+
+/**
+ * @brief rmdir(2) over the memory tree.
+ */
+static int mem_rmdir(const char *path) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, false);
+    int ret = -1;
+    if (node && !S_ISDIR(node->mode)) errno = ENOTDIR;
+    else if (node && node->first_child) errno = ENOTEMPTY;
+    else if (node && !node->parent) errno = EBUSY;
+    else if (node) {
+        node->parent->mtime.tv_sec = ++g_clock;
+        node_detach(node);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return ret;
+}
+
+/**
+ * @brief unlink(2) over the memory tree.
+ */
+static int mem_unlink(const char *path) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, false);
+    int ret = -1;
+    if (node && S_ISDIR(node->mode)) errno = EISDIR;
+    else if (node) {
+        node->parent->mtime.tv_sec = ++g_clock;
+        node_detach(node);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return ret;
+}
+
+/**
+ * @brief rename(2) over the memory tree, for files and symlinks.
+ */
+static int mem_rename(const char *from, const char *to) {
+    pthread_mutex_lock(&g_memfs_lock);
+    int ret = -1;
+    memfs_node_t *node = lookup(from, false);
+    char *norm = node ? normalize(to) : NULL;
+    memfs_node_t *parent = norm ? find_parent(norm) : NULL;
+    if (node && S_ISDIR(node->mode)) {
+        errno = EXDEV;
+    } else if (parent) {
+        memfs_node_t *existing = table_find(norm);
+        if (existing == node) {
+            ret = 0;
+        } else if (existing && S_ISDIR(existing->mode)) {
+            errno = EISDIR;
+        } else {
+            if (existing) node_detach(existing);
+
+            // Unhook from the old parent and table, then rehook under the new name
+            table_remove(node);
+            if (node->prev_sibling) node->prev_sibling->next_sibling = node->next_sibling;
+            else node->parent->first_child = node->next_sibling;
+            if (node->next_sibling) node->next_sibling->prev_sibling = node->prev_sibling;
+            node->parent->mtime.tv_sec = ++g_clock;
+
+            free(node->path);
+            node->path = norm;
+            norm = NULL;
+            node->parent = parent;
+            node->prev_sibling = NULL;
+            node->next_sibling = parent->first_child;
+            if (parent->first_child) parent->first_child->prev_sibling = node;
+            parent->first_child = node;
+            parent->mtime.tv_sec = g_clock;
+            ret = table_add(node) == 0 ? 0 : -1;
+        }
+    }
+    free(norm);
+    pthread_mutex_unlock(&g_memfs_lock);
+    return ret;
+}
+
+/**
+ * @brief symlink(2) over the memory tree.
+ */
+static int mem_symlink(const char *target, const char *path) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = create_at(path, S_IFLNK | 0777);
+    if (node) {
+        node->size = strlen(target);
+        node->data = (uint8_t *)strdup(target);
+        if (!node->data) {
+            node_detach(node);
+            node = NULL;
+            errno = ENOMEM;
+        }
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return node ? 0 : -1;
+}
+
+/**
+ * @brief readlink(2) over the memory tree.
+ */
+static ssize_t mem_readlink(const char *path, char *buf, size_t size) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, false);
+    ssize_t n = -1;
+    if (node && !S_ISLNK(node->mode)) {
+        errno = EINVAL;
+    } else if (node) {
+        n = (ssize_t)(node->size < size ? node->size : size);
+        memcpy(buf, node->data, (size_t)n);
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return n;
+}
+
+/**
+ * @brief chmod(2) over the memory tree.
+ */
+static int mem_chmod(const char *path, mode_t mode) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, true);
+    if (node) node->mode = (node->mode & S_IFMT) | (mode & 07777);
+    pthread_mutex_unlock(&g_memfs_lock);
+    return node ? 0 : -1;
+}
+
+/**
+ * @brief open(2) over the memory tree.
+ */
+static upkg_vfs_file_t *mem_open(const char *path, int flags, mode_t mode) {
+    pthread_mutex_lock(&g_memfs_lock);
+    bool writable = (flags & O_ACCMODE) != O_RDONLY;
+    memfs_node_t *node = lookup(path, true);
+    if (node && (flags & O_CREAT) && (flags & O_EXCL)) {
+        errno = EEXIST;
+        node = NULL;
+    } else if (!node && errno == ENOENT && (flags & O_CREAT)) {
+        node = create_at(path, S_IFREG | (mode & 07777));
+    } else if (node && S_ISDIR(node->mode)) {
+        errno = EISDIR;
+        node = NULL;
+    }
+
+    upkg_vfs_file_t *file = NULL;
+    if (node) {
+        file = calloc(1, sizeof(*file));
+        if (!file) {
+            errno = ENOMEM;
+        } else {
+            file->node = node;
+            file->writable = writable;
+            node->open_count++;
+            if (writable && (flags & O_TRUNC)) {
+                g_data_bytes -= node->size;
+                node->size = 0;
+                node->mtime.tv_sec = ++g_clock;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return file;
+}
+
+/**
+ * @brief read(2) from a memory file.
+ */
+static ssize_t mem_read(upkg_vfs_file_t *file, void *buf, size_t len) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = file->node;
+    size_t n = file->pos < node->size ? node->size - file->pos : 0;
+    if (n > len) n = len;
+    memcpy(buf, node->data + file->pos, n);
+    file->pos += n;
+    pthread_mutex_unlock(&g_memfs_lock);
+    return (ssize_t)n;
+}
+
+/**
+ * @brief write(2) to a memory file, growing it geometrically.
+ */
+static ssize_t mem_write(upkg_vfs_file_t *file, const void *buf, size_t len) {
+    if (!file->writable) {
+        errno = EBADF;
+        return -1;
+    }
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = file->node;
+    ssize_t ret = (ssize_t)len;
+    if (file->pos + len > node->cap) {
+        size_t cap = node->cap ? node->cap : 256;
+        while (cap < file->pos + len) cap *= 2;
+        uint8_t *grown = realloc(node->data, cap);
+        if (!grown) {
+            errno = ENOSPC;
+            ret = -1;
+        } else {
+            node->data = grown;
+            node->cap = cap;
+        }
+    }
+    if (ret >= 0) {
+        memcpy(node->data + file->pos, buf, len);
+        file->pos += len;
+        if (file->pos > node->size) {
+            g_data_bytes += file->pos - node->size;
+            node->size = file->pos;
+        }
+        node->mtime.tv_sec = ++g_clock;
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return ret;
+}
+
+/**
+ * @brief Nothing to flush.
+ */
+static int mem_sync(upkg_vfs_file_t *file) {
+    (void)file;
+    return 0;
+}
+
+/**
+ * @brief Closes a handle; a file unlinked while open is freed now.
+ */
+static int mem_close(upkg_vfs_file_t *file) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = file->node;
+    if (--node->open_count == 0 && node->unlinked) node_free(node);
+    pthread_mutex_unlock(&g_memfs_lock);
+    free(file);
+    return 0;
+}
+
+/**
+ * @brief Snapshots a directory's entry names.
+ */
+static upkg_vfs_dir_t *mem_opendir(const char *path) {
+    pthread_mutex_lock(&g_memfs_lock);
+    memfs_node_t *node = lookup(path, true);
+    upkg_vfs_dir_t *dir = NULL;
+    if (node && !S_ISDIR(node->mode)) {
+        errno = ENOTDIR;
+    } else if (node) {
+        size_t count = 0;
+        for (memfs_node_t *c = node->first_child; c; c = c->next_sibling) count++;
+        dir = calloc(1, sizeof(*dir));
+        if (dir) dir->names = calloc(count ? count : 1, sizeof(char *));
+        for (memfs_node_t *c = node->first_child; dir && dir->names && c; c = c->next_sibling) {
+            dir->names[dir->count] = strdup(base_name(c->path));
+            if (dir->names[dir->count]) dir->count++;
+        }
+        if (dir && !dir->names) {
+            free(dir);
+            dir = NULL;
+        }
+        if (!dir) errno = ENOMEM;
+    }
+    pthread_mutex_unlock(&g_memfs_lock);
+    return dir;
+}
+
+/**
+ * @brief Returns the next snapshotted name.
+ */
+static const char *mem_readdir(upkg_vfs_dir_t *dir) {
+    return dir->next < dir->count ? dir->names[dir->next++] : NULL;
+}
+
+/**
+ * @brief Frees a directory snapshot.
+ */
+static void mem_closedir(upkg_vfs_dir_t *dir) {
+    for (size_t i = 0; i < dir->count; i++) free(dir->names[i]);
+    free(dir->names);
+    free(dir);
+}
+
+const upkg_vfs_ops_t upkg_vfs_memory = {
+    .name = "memory",
+    .stat = mem_stat,
+    .lstat = mem_lstat,
+    .mkdir = mem_mkdir,
+    .rmdir = mem_rmdir,
+    .unlink = mem_unlink,
+    .rename = mem_rename,
+    .symlink = mem_symlink,
+    .readlink = mem_readlink,
+    .chmod = mem_chmod,
+    .open = mem_open,
+    .read = mem_read,
+    .write = mem_write,
+    .sync = mem_sync,
+    .close = mem_close,
+    .opendir = mem_opendir,
+    .readdir = mem_readdir,
+    .closedir = mem_closedir,
+};
+
+// --- Housekeeping ---
+
+/**
+ * @brief Empties the memory backend.
+ */
+void upkg_vfs_memory_reset(void) {
+    pthread_mutex_lock(&g_memfs_lock);
+    for (size_t b = 0; b < g_bucket_count; b++) {
+        memfs_node_t *n = g_buckets[b];
+        while (n) {
+            memfs_node_t *next = n->hash_next;
+            // Nodes still open are leaked rather than left dangling
+            if (n->open_count == 0) node_free(n);
+            n = next;
+        }
+    }
+    free(g_buckets);
+    g_buckets = NULL;
+    g_bucket_count = 0;
+    g_node_count = 0;
+    g_data_bytes = 0;
+    g_next_ino = 1;
+    g_clock = 0;
+    pthread_mutex_unlock(&g_memfs_lock);
+}
+
+/**
+ * @brief Reports the memory backend's size.
+ */
+size_t upkg_vfs_memory_usage(size_t *files) {
+    pthread_mutex_lock(&g_memfs_lock);
+    size_t bytes = g_data_bytes;
+    if (files) *files = g_node_count;
+    pthread_mutex_unlock(&g_memfs_lock);
+    return bytes;
+}